@@ -10,6 +10,28 @@
 
 #include "testbinhelper.h"
 
+#include "binfilehelper.h"
+#include "deepstarcomponent.h"
+#include "starblocklist.h"
+#include "htmesh/HTMesh.h"
+#include "htmesh/MeshIterator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+// The HTM level follows the faint magnitude at the start of the data of star catalogs
+int htmLevel(BinFileHelper &reader)
+{
+    quint8 level = 0;
+    fseek(reader.getFileHandle(), reader.getDataOffset() + 2, SEEK_SET);
+    if (!fread(&level, 1, 1, reader.getFileHandle()))
+        return -1;
+    return level;
+}
+}
+
 TestBinHelper::TestBinHelper(QObject *parent) : QObject(parent)
 {
 }
@@ -32,11 +54,133 @@ void TestBinHelper::cleanup()
 
 void TestBinHelper::testLoadBinary_data()
 {
+    QTest::addColumn<QString>("FILE");
+
+    QTest::newRow("named stars") << "namedstars.dat";
+    QTest::newRow("unnamed stars") << "unnamedstars.dat";
+    QTest::newRow("Tycho-2") << "deepstars.dat";
+    QTest::newRow("USNO-NOMAD") << "USNO-NOMAD-1e8.dat";
 }
 
 void TestBinHelper::testLoadBinary()
 {
-    QSKIP("Not implemented yet.");
+    QFETCH(QString, FILE);
+
+    if (!BinFileHelper::testFileExists(FILE))
+        QSKIP(qPrintable(QString("Catalog %1 is not installed.").arg(FILE)));
+
+    BinFileHelper reader;
+    QVERIFY(reader.openFile(FILE) != nullptr);
+    QVERIFY(reader.readHeader());
+    QVERIFY(!reader.isMapped());
+    QVERIFY(reader.getRecords(0).data == nullptr);
+
+    const int level = htmLevel(reader);
+    QVERIFY(level > 0);
+
+    QVERIFY(reader.mapFile());
+    QVERIFY(reader.isMapped());
+
+    // Spans of the map must hold the same bytes as the records read from the file
+    const int recordSize = reader.guessRecordSize();
+    const int trixels    = 8 << (2 * level);
+    QByteArray buffer;
+    for (int id = 0; id < trixels; id += 37)
+    {
+        const BinFileHelper::RecordSpan records = reader.getRecords(id);
+        QCOMPARE(records.count, reader.getRecordCount(id));
+
+        const int bytes = qMin<quint32>(records.count, 64) * recordSize;
+        buffer.resize(bytes);
+        QCOMPARE(BinFileHelper::unsigned_KDE_fseek(reader.getFileHandle(), reader.getOffset(id), SEEK_SET), 0);
+        QCOMPARE(fread(buffer.data(), 1, bytes, reader.getFileHandle()), static_cast<size_t>(bytes));
+        QVERIFY(memcmp(buffer.constData(), records.data, bytes) == 0);
+        QVERIFY(reader.getMappedData(reader.getOffset(id), bytes) == records.data);
+    }
+
+    QVERIFY(reader.getMappedData(0, 1) != nullptr);
+    QVERIFY(reader.getMappedData(-1, 1) == nullptr);
+
+    reader.unmapFile();
+    QVERIFY(!reader.isMapped());
+    QVERIFY(reader.getFileHandle() != nullptr);
+}
+
+void TestBinHelper::testPanFullSky_data()
+{
+    QTest::addColumn<QString>("FILE");
+    QTest::addColumn<double>("FOV");
+    QTest::addColumn<double>("MAGLIM");
+    QTest::addColumn<bool>("MAPPED");
+
+    for (const QString &file : { QString("deepstars.dat"), QString("USNO-NOMAD-1e8.dat") })
+    {
+        for (bool mapped : { false, true })
+        {
+            const char *mode = mapped ? "mapped" : "stdio";
+            QTest::newRow(qPrintable(QString("%1 60deg %2").arg(file, mode))) << file << 60.0 << 10.0 << mapped;
+            QTest::newRow(qPrintable(QString("%1 15deg %2").arg(file, mode))) << file << 15.0 << 12.5 << mapped;
+            QTest::newRow(qPrintable(QString("%1 3deg %2").arg(file, mode))) << file << 3.0 << 15.0 << mapped;
+        }
+    }
+}
+
+void TestBinHelper::testPanFullSky()
+{
+    QFETCH(QString, FILE);
+    QFETCH(double, FOV);
+    QFETCH(double, MAGLIM);
+    QFETCH(bool, MAPPED);
+
+    if (!BinFileHelper::testFileExists(FILE))
+        QSKIP(qPrintable(QString("Catalog %1 is not installed.").arg(FILE)));
+
+    // The catalog is opened, and mapped in memory, by the component its trixels are loaded for
+    DeepStarComponent component(nullptr, FILE, 0.0);
+    QVERIFY(component.fileOpen());
+    BinFileHelper *reader = component.getStarReader();
+    if (MAPPED)
+        QVERIFY(reader->isMapped());
+    else
+        reader->unmapFile();
+
+    const int level = htmLevel(*reader);
+    QVERIFY(level > 0);
+
+    HTMesh mesh(level, level);
+    QVector<std::shared_ptr<StarBlockList>> lists;
+    quint64 stars = 0;
+
+    // Pan the whole sky in steps of a field of view, filling the trixels under each field like a draw does
+    QBENCHMARK
+    {
+        // Start each pass with no star loaded, the blocks going back to StarBlockFactory
+        lists.clear();
+        lists.resize(mesh.size());
+        stars = 0;
+        for (double dec = -90.0 + FOV / 2; dec < 90.0; dec += FOV)
+        {
+            const double step = FOV / std::max(0.1, std::cos(dec * M_PI / 180.0));
+            for (double ra = 0; ra < 360.0; ra += step)
+            {
+                mesh.intersect(ra, dec, FOV / 2);
+                MeshIterator region(&mesh);
+                while (region.hasNext())
+                {
+                    const Trixel trixel = region.next();
+                    if (!lists[trixel])
+                        lists[trixel].reset(new StarBlockList(trixel, &component));
+                    QVERIFY(lists[trixel]->fillToMag(MAGLIM));
+                    stars += lists[trixel]->getStarCount();
+                }
+            }
+        }
+    }
+
+    lists.clear();
+    QVERIFY(stars > 0);
+    qDebug() << FILE << "panned at" << FOV << "degrees, drawing" << stars << "stars per pass"
+             << (MAPPED ? "from the memory map" : "from the file");
 }
 
 QTEST_GUILESS_MAIN(TestBinHelper)
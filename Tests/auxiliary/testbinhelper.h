@@ -29,6 +29,9 @@ private slots:
 
     void testLoadBinary_data();
     void testLoadBinary();
+
+    void testPanFullSky_data();
+    void testPanFullSky();
 };
 
 #endif // TESTBINHELPER_H
@@ -0,0 +1,266 @@
+/***************************************************************************
+                   testcatalogdb.cpp  -  KStars Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "testcatalogdb.h"
+
+#include "catalogdb.h"
+#include "dms.h"
+#include "kspaths.h"
+#include "skyobjects/skyobject.h"
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QtConcurrent>
+#include <QtTest>
+
+namespace
+{
+const QString DB_FILE = "skycomponents.sqlite";
+
+// More rows than two import batches of CatalogDB, which commits every 10000 rows
+const int GRID_ROWS = 20500;
+
+QString dbPath()
+{
+    return KSPaths::writableLocation(QStandardPaths::GenericDataLocation) + DB_FILE;
+}
+
+// Objects of the test catalog, on a grid covering the sky, as written in the catalog file
+QString gridRAText(int row)
+{
+    return QString::number((row % 200) * 0.12 + 0.05, 'f', 2);
+}
+
+QString gridDecText(int row)
+{
+    return QString::number(-85.0 + (row / 200) * 1.65 + 0.1, 'f', 2);
+}
+
+// The trixel of an object of the test catalog, from its coordinates read as by CatalogDB
+Trixel gridTrixel(const CatalogDB &catalogDB, int row)
+{
+    return catalogDB.FindTrixel(dms(gridRAText(row), false).Degrees(), dms(gridDecText(row), true).Degrees());
+}
+
+// Runs statements on a connection of its own to the database file
+bool execute(const QString &connection, const QStringList &statements)
+{
+    bool ok = true;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection);
+        db.setDatabaseName(dbPath());
+        ok = db.open();
+        for (int i = 0; ok && i < statements.size(); ++i)
+        {
+            QSqlQuery query(db);
+            ok = query.exec(statements.at(i));
+            if (!ok)
+                qWarning() << query.lastError();
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connection);
+    return ok;
+}
+}
+
+TestCatalogDB::TestCatalogDB() : QObject()
+{
+}
+
+void TestCatalogDB::initTestCase()
+{
+    // Use a database of its own, in the user folder of test mode
+    QStandardPaths::setTestModeEnabled(true);
+    QVERIFY(QStandardPaths::isTestModeEnabled());
+
+    QDir(KSPaths::writableLocation(QStandardPaths::GenericDataLocation)).removeRecursively();
+    QVERIFY(QDir().mkpath(KSPaths::writableLocation(QStandardPaths::GenericDataLocation)));
+}
+
+void TestCatalogDB::cleanupTestCase()
+{
+    QVERIFY(QStandardPaths::isTestModeEnabled());
+    QDir(KSPaths::writableLocation(QStandardPaths::GenericDataLocation)).removeRecursively();
+}
+
+void TestCatalogDB::cleanup()
+{
+    // The connection of the CatalogDB of each test
+    QSqlDatabase::removeDatabase("skydb");
+}
+
+void TestCatalogDB::testUpgradeSchema()
+{
+    // A database of an older version, without trixels in the DSO table
+    QVERIFY(!QFile::exists(dbPath()));
+    QVERIFY(execute("oldschema", QStringList()
+                    << "CREATE TABLE Version (Version CHAR DEFAULT NULL)"
+                    << "CREATE TABLE ObjectDesignation (id INTEGER NOT NULL DEFAULT NULL PRIMARY KEY,"
+                    " id_Catalog INTEGER DEFAULT NULL REFERENCES Catalog (id),"
+                    " UID_DSO INTEGER DEFAULT NULL REFERENCES DSO (UID), LongName MEDIUMTEXT DEFAULT NULL,"
+                    " IDNumber INTEGER DEFAULT NULL, Trixel INTEGER NULL)"
+                    << "CREATE TABLE Catalog (id INTEGER DEFAULT NULL PRIMARY KEY AUTOINCREMENT,"
+                    " Name CHAR NOT NULL DEFAULT 'NULL', Prefix CHAR DEFAULT 'NULL', Color CHAR DEFAULT '#CC0000',"
+                    " Epoch FLOAT DEFAULT 2000.0, Author CHAR DEFAULT NULL, License MEDIUMTEXT DEFAULT NULL,"
+                    " FluxFreq CHAR DEFAULT 'NULL', FluxUnit CHAR DEFAULT 'NULL')"
+                    << "CREATE TABLE DSO (UID INTEGER DEFAULT NULL PRIMARY KEY AUTOINCREMENT,"
+                    " RA DOUBLE NOT NULL DEFAULT 0.0, Dec DOUBLE DEFAULT 0.0, Type INTEGER DEFAULT NULL,"
+                    " Magnitude DECIMAL DEFAULT NULL, PositionAngle INTEGER DEFAULT NULL,"
+                    " MajorAxis FLOAT NOT NULL DEFAULT NULL, MinorAxis FLOAT DEFAULT NULL, Flux FLOAT DEFAULT NULL,"
+                    " Add1 VARCHAR DEFAULT NULL, Add2 INTEGER DEFAULT NULL, Add3 INTEGER DEFAULT NULL,"
+                    " Add4 INTEGER DEFAULT NULL)"
+                    << "INSERT INTO Catalog (id, Name, Prefix, Epoch) VALUES (1, 'Old', 'OLD', 2000.0)"
+                    << "INSERT INTO DSO (UID, RA, Dec, Type, Magnitude, MajorAxis) VALUES (1, 10.68, 41.27, 8, 3.4, 190)"
+                    << "INSERT INTO DSO (UID, RA, Dec, Type, Magnitude, MajorAxis) VALUES (2, 83.82, -5.39, 5, 4.0, 85)"
+                    << "INSERT INTO DSO (UID, RA, Dec, Type, Magnitude, MajorAxis) VALUES (3, 250.42, 36.46, 4, 5.8, 20)"
+                    << "INSERT INTO ObjectDesignation (id_Catalog, UID_DSO, LongName, IDNumber) VALUES (1, 1, 'Andromeda', 31)"
+                    << "INSERT INTO ObjectDesignation (id_Catalog, UID_DSO, LongName, IDNumber) VALUES (1, 2, 'Orion', 42)"
+                    << "INSERT INTO ObjectDesignation (id_Catalog, UID_DSO, LongName, IDNumber) VALUES (1, 3, '', 13)"));
+
+    CatalogDB catalogDB;
+    QVERIFY(catalogDB.Initialize());
+    QCOMPARE(catalogDB.DatabaseFile(), dbPath());
+
+    // The column is added and filled, and the trixels are indexed
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "upgraded");
+        db.setDatabaseName(dbPath());
+        QVERIFY(db.open());
+
+        QSqlQuery query(db);
+        QVERIFY(query.exec("SELECT RA, Dec, Trixel FROM DSO"));
+        int rows = 0;
+        while (query.next())
+        {
+            QVERIFY(!query.value(2).isNull());
+            QCOMPARE(query.value(2).toInt(), catalogDB.FindTrixel(query.value(0).toDouble(), query.value(1).toDouble()));
+            ++rows;
+        }
+        QCOMPARE(rows, 3);
+
+        QVERIFY(query.exec("SELECT name FROM sqlite_master WHERE type = 'index' AND name = 'DSO_Trixel'"));
+        QVERIFY(query.next());
+
+        query.clear();
+        db.close();
+    }
+    QSqlDatabase::removeDatabase("upgraded");
+
+    // Names are listed with the trixel of their object, as the objects get them
+    QList<QPair<int, QString>> names;
+    QHash<QString, Trixel> nameTrixels;
+    catalogDB.GetObjectNames("Old", names, nameTrixels);
+    QCOMPARE(names.size(), 5);
+    QVERIFY(names.contains(qMakePair(int(SkyObject::GALAXY), QString("OLD 31"))));
+    QVERIFY(names.contains(qMakePair(int(SkyObject::GALAXY), QString("Andromeda"))));
+    QVERIFY(names.contains(qMakePair(int(SkyObject::GLOBULAR_CLUSTER), QString("OLD 13"))));
+    QCOMPARE(nameTrixels.value("Andromeda"), catalogDB.FindTrixel(10.68, 41.27));
+    QCOMPARE(nameTrixels.value("OLD 42"), catalogDB.FindTrixel(83.82, -5.39));
+
+    // Trixels are read again on an upgraded database
+    QHash<Trixel, QList<SkyObject *>> objects;
+    const Trixel trixel = catalogDB.FindTrixel(83.82, -5.39);
+    QCOMPARE(CatalogDB::GetObjectsInTrixels(catalogDB.DatabaseFile(), catalogDB.FindCatalog("Old"),
+                                            QVector<Trixel>() << trixel, objects, nullptr),
+             1);
+    QCOMPARE(objects.value(trixel).size(), 1);
+    QCOMPARE(objects.value(trixel).first()->name(), QString("OLD 42"));
+    QCOMPARE(objects.value(trixel).first()->longname(), QString("Orion"));
+    for (const auto &list : objects)
+        qDeleteAll(list);
+}
+
+void TestCatalogDB::testImportBatches()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QFile file(dir.filePath("grid.txt"));
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+    {
+        QTextStream stream(&file);
+        stream << "# Delimiter: ,\n"
+               << "# Name: Test Grid\n"
+               << "# Prefix: TG\n"
+               << "# Color: #00FF00\n"
+               << "# Epoch: 2000\n"
+               << "# ID RA Dc Tp Nm Mg\n";
+        for (int row = 0; row < GRID_ROWS; ++row)
+        {
+            stream << row + 1 << ',' << gridRAText(row) << ',' << gridDecText(row) << ",8,Grid Object " << row + 1
+                   << ',' << 10.0 + (row % 50) * 0.1 << '\n';
+        }
+    }
+    file.close();
+
+    CatalogDB catalogDB;
+    QVERIFY(catalogDB.Initialize());
+    QVERIFY(catalogDB.AddCatalogContents(file.fileName()));
+
+    // Every row is committed, including those of the last, incomplete batch
+    QCOMPARE(catalogDB.GetObjectCount("Test Grid"), GRID_ROWS);
+
+    QList<QPair<int, QString>> names;
+    QHash<QString, Trixel> nameTrixels;
+    catalogDB.GetObjectNames("Test Grid", names, nameTrixels);
+    QCOMPARE(names.size(), 2 * GRID_ROWS);
+    QCOMPARE(nameTrixels.value("TG 1"), gridTrixel(catalogDB, 0));
+    QCOMPARE(nameTrixels.value(QString("Grid Object %1").arg(GRID_ROWS)), gridTrixel(catalogDB, GRID_ROWS - 1));
+}
+
+void TestCatalogDB::testObjectsInTrixels()
+{
+    CatalogDB catalogDB;
+    QVERIFY(catalogDB.Initialize());
+    const int catalogId = catalogDB.FindCatalog("Test Grid");
+    QVERIFY(catalogId >= 0);
+
+    // Trixels of the grid, with the number of objects in each
+    QHash<Trixel, int> expected;
+    for (int row = 0; row < GRID_ROWS; ++row)
+        expected[gridTrixel(catalogDB, row)]++;
+    QVERIFY(expected.size() > 1);
+
+    // The objects of each trixel queried are all in that trixel, and no other object is
+    QHash<Trixel, QList<SkyObject *>> objects;
+    const QVector<Trixel> trixels = expected.keys().toVector();
+    QCOMPARE(CatalogDB::GetObjectsInTrixels(catalogDB.DatabaseFile(), catalogId, trixels, objects, nullptr),
+             GRID_ROWS);
+    QCOMPARE(objects.size(), expected.size());
+    for (auto trixel = objects.constBegin(); trixel != objects.constEnd(); ++trixel)
+    {
+        QCOMPARE(trixel.value().size(), expected.value(trixel.key()));
+        for (SkyObject *obj : trixel.value())
+            QCOMPARE(catalogDB.FindTrixel(obj->ra0().Degrees(), obj->dec0().Degrees()), trixel.key());
+    }
+    for (const auto &list : objects)
+        qDeleteAll(list);
+    objects.clear();
+
+    // A region query may run in a worker thread, through a connection of its own
+    const QString dbFile = catalogDB.DatabaseFile();
+    const Trixel first   = trixels.first();
+    QFuture<int> count   = QtConcurrent::run([&objects, dbFile, catalogId, first]()
+    {
+        return CatalogDB::GetObjectsInTrixels(dbFile, catalogId, QVector<Trixel>() << first, objects, nullptr);
+    });
+    QCOMPARE(count.result(), expected.value(first));
+    QCOMPARE(objects.value(first).size(), expected.value(first));
+    for (const auto &list : objects)
+        qDeleteAll(list);
+}
+
+QTEST_GUILESS_MAIN(TestCatalogDB)
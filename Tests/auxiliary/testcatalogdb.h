@@ -0,0 +1,39 @@
+/***************************************************************************
+                    testcatalogdb.h  -  KStars Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QObject>
+
+/**
+ * @class TestCatalogDB
+ * @short Tests for the trixels of the DSO table of CatalogDB: schema upgrade, imports and region queries
+ */
+class TestCatalogDB : public QObject
+{
+    Q_OBJECT
+
+  public:
+    TestCatalogDB();
+    ~TestCatalogDB() override = default;
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void cleanup();
+
+    void testUpgradeSchema();
+    void testImportBatches();
+    void testObjectsInTrixels();
+};
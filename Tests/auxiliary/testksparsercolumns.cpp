@@ -0,0 +1,253 @@
+/***************************************************************************
+               testksparsercolumns.cpp  -  KStars Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "testksparsercolumns.h"
+
+#include <QFile>
+#include <QTemporaryFile>
+#include <QtTest>
+
+namespace
+{
+typedef QList<QPair<QString, KSParser::DataTypes>> Sequence;
+
+// The columns of a custom catalog, see CatalogDB::buildParserSequence()
+Sequence catalogSequence()
+{
+    return Sequence() << qMakePair(QString("ID"), KSParser::D_QSTRING) << qMakePair(QString("RA"), KSParser::D_QSTRING)
+                      << qMakePair(QString("Dc"), KSParser::D_QSTRING) << qMakePair(QString("Tp"), KSParser::D_INT)
+                      << qMakePair(QString("Nm"), KSParser::D_QSTRING) << qMakePair(QString("Mg"), KSParser::D_FLOAT)
+                      << qMakePair(QString("Mj"), KSParser::D_FLOAT) << qMakePair(QString("Mn"), KSParser::D_FLOAT)
+                      << qMakePair(QString("PA"), KSParser::D_DOUBLE) << qMakePair(QString("Ig"), KSParser::D_SKIP);
+}
+
+// A catalog row for each number
+QByteArray catalogRows(int count)
+{
+    QByteArray rows;
+    for (int i = 0; i < count; ++i)
+    {
+        rows += QString("%1,%2:%3:%4,%5%6:%7:%8,%9,\"NGC %1, part %10\",%11,%12,%13,%14,x\n")
+                    .arg(i).arg(i % 24).arg(i % 60).arg((i % 600) / 10.0)
+                    .arg(i % 2 ? '-' : '+').arg(i % 90).arg(i % 60).arg(i % 60)
+                    .arg(i % 20).arg(i % 3).arg(5 + (i % 100) / 10.0).arg(i % 120).arg(i % 80).arg(i % 180)
+                    .toUtf8();
+    }
+    return rows;
+}
+}
+
+TestKSParserColumns::TestKSParserColumns() : QObject()
+{
+}
+
+void TestKSParserColumns::cleanupTestCase()
+{
+    for (const QString &file : files)
+        QFile::remove(file);
+}
+
+QString TestKSParserColumns::writeFile(const QByteArray &contents)
+{
+    QTemporaryFile file;
+    file.setAutoRemove(false);
+    if (!file.open())
+        return QString();
+
+    file.write(contents);
+    files.append(file.fileName());
+    return file.fileName();
+}
+
+void TestKSParserColumns::compare(KSParser &parser, const Sequence &sequence,
+                                  const std::function<bool(const KSParser::ColumnsConsumer &)> &read)
+{
+    QList<QHash<QString, QVariant>> rows;
+    while (parser.HasNextRow())
+    {
+        QHash<QString, QVariant> row = parser.ReadNextRow();
+        // The last read is a dummy row if the file ends with lines that are skipped
+        if (row.value(sequence.first().first) != KSParser::EBROKEN_QSTRING)
+            rows.append(row);
+    }
+
+    int read_rows = 0;
+    QVERIFY(read([&](const KSParser::Columns &columns)
+    {
+        for (int row = 0; row < columns.rowCount(); ++row, ++read_rows)
+        {
+            QVERIFY(read_rows < rows.size());
+            for (int i = 0; i < sequence.size(); ++i)
+            {
+                if (sequence.at(i).second == KSParser::D_SKIP)
+                    QVERIFY(!columns.value(i, row).isValid());
+                else
+                    QCOMPARE(columns.value(i, row), rows.at(read_rows).value(sequence.at(i).first));
+            }
+        }
+    }));
+    QCOMPARE(read_rows, rows.size());
+}
+
+void TestKSParserColumns::testCSVColumns_data()
+{
+    QTest::addColumn<QByteArray>("contents");
+
+    QTest::newRow("catalog") << QByteArray("# Name: Test\n# Delimiter: ,\n") + catalogRows(100);
+    QTest::newRow("quotes") << QByteArray("1,\"a, b\",\"\",\"c\"(, )\"d\",3,-3.141,,x\n"
+                                          "2,\"\",\",x,y,4,1e3,z\n"
+                                          "3,\"a,,b\",c,d\",5,2.5,,x\n");
+    QTest::newRow("skipped") << QByteArray("\n#1,a,b,c,1,1,1,x\nno delimiter\n1,a,b\n\n1,a,b,c,1,1,1,x,extra\n");
+    QTest::newRow("conversions") << QByteArray(" 7 , a , b ,c, 12 , 1.5 , -2e-3 ,x\r\n"
+                                               "x,,,,,,,\r\n"
+                                               "8,M 31,Andromède,\"Ω, Centauri\",3q,2,,\n");
+    QTest::newRow("no end of line") << QByteArray("\xEF\xBB\xBF" "1,a,b,c,1,1,1,x\n2,a,b,c,2,2,2,x");
+}
+
+void TestKSParserColumns::testCSVColumns()
+{
+    QFETCH(QByteArray, contents);
+
+    const Sequence sequence = Sequence() << qMakePair(QString("ID"), KSParser::D_QSTRING)
+                                         << qMakePair(QString("A"), KSParser::D_QSTRING)
+                                         << qMakePair(QString("B"), KSParser::D_QSTRING)
+                                         << qMakePair(QString("C"), KSParser::D_QSTRING)
+                                         << qMakePair(QString("I"), KSParser::D_INT)
+                                         << qMakePair(QString("F"), KSParser::D_FLOAT)
+                                         << qMakePair(QString("D"), KSParser::D_DOUBLE)
+                                         << qMakePair(QString("S"), KSParser::D_SKIP);
+    const QString file = writeFile(contents);
+    QVERIFY(!file.isEmpty());
+
+    const bool catalog = QString(QTest::currentDataTag()) == "catalog";
+    const Sequence used = catalog ? catalogSequence() : sequence;
+
+    KSParser parser(file, '#', used);
+    compare(parser, used, [&](const KSParser::ColumnsConsumer &consumer)
+    {
+        return KSParser::ReadCSVColumns(file, '#', used, consumer);
+    });
+}
+
+void TestKSParserColumns::testFixedWidthColumns()
+{
+    const Sequence sequence = Sequence() << qMakePair(QString("A"), KSParser::D_QSTRING)
+                                         << qMakePair(QString("I"), KSParser::D_INT)
+                                         << qMakePair(QString("F"), KSParser::D_FLOAT)
+                                         << qMakePair(QString("B"), KSParser::D_QSTRING);
+    const QList<int> widths = QList<int>() << 5 << 4 << 6;
+    const QString file      = writeFile("this  12 -3.14 times\n"
+                                        "# comment line long enough\n"
+                                        "short\n"
+                                        "Ωmega 7    2.5 wide 😀 char\n"
+                                        "😀xyz  8    1.0 after\n"
+                                        "                   \n"
+                                        "last   9   9.9");
+    QVERIFY(!file.isEmpty());
+
+    KSParser parser(file, '#', sequence, widths);
+    compare(parser, sequence, [&](const KSParser::ColumnsConsumer &consumer)
+    {
+        return KSParser::ReadFixedWidthColumns(file, '#', sequence, widths, consumer);
+    });
+
+    QVERIFY(!KSParser::ReadFixedWidthColumns(file, '#', sequence, widths.mid(1), [](const KSParser::Columns &) {}));
+}
+
+void TestKSParserColumns::testBlocks()
+{
+    // Enough rows for several blocks, which must be consumed in order
+    const int count         = 200000;
+    const Sequence sequence = catalogSequence();
+    const QString file      = writeFile(catalogRows(count));
+    QVERIFY(!file.isEmpty());
+
+    int blocks = 0, rows = 0;
+    QVERIFY(KSParser::ReadCSVColumns(file, '#', sequence, [&](const KSParser::Columns &columns)
+    {
+        const int id = columns.columnIndex("ID"), nm = columns.columnIndex("Nm"), tp = columns.columnIndex("Tp");
+        for (int row = 0; row < columns.rowCount(); ++row, ++rows)
+        {
+            QCOMPARE(columns.stringValue(id, row).toInt(), rows);
+            QCOMPARE(columns.stringValue(nm, row), QString("NGC %1, part %2").arg(rows).arg(rows % 3));
+            QCOMPARE(columns.intValue(tp, row), rows % 20);
+        }
+        QCOMPARE(columns.columnIndex("Flux"), -1);
+        QCOMPARE(columns.floatValue(-1, 0), 0.0f);
+        QVERIFY(columns.stringValue(-1, 0).isEmpty());
+        ++blocks;
+    }));
+
+    QCOMPARE(rows, count);
+    QVERIFY(blocks > 1);
+}
+
+void TestKSParserColumns::testMissingFile()
+{
+    bool called = false;
+    QVERIFY(!KSParser::ReadCSVColumns("/nonexistent/catalog.txt", '#', catalogSequence(),
+                                      [&](const KSParser::Columns &) { called = true; }));
+    QVERIFY(!called);
+}
+
+void TestKSParserColumns::benchmarkCSV_data()
+{
+    QTest::addColumn<bool>("columns");
+
+    QTest::newRow("rows") << false;
+    QTest::newRow("columns") << true;
+}
+
+void TestKSParserColumns::benchmarkCSV()
+{
+    QFETCH(bool, columns);
+
+    // Two million rows, like those of large custom catalogs
+    const int count         = 2000000;
+    const Sequence sequence = catalogSequence();
+    static QString file;
+    if (file.isEmpty())
+    {
+        QByteArray contents;
+        for (int i = 0; i < count; i += 100000)
+            contents += catalogRows(100000);
+        file = writeFile(contents);
+    }
+    QVERIFY(!file.isEmpty());
+
+    int rows = 0;
+    QBENCHMARK_ONCE
+    {
+        rows = 0;
+        if (columns)
+        {
+            KSParser::ReadCSVColumns(file, '#', sequence, [&](const KSParser::Columns &block)
+            {
+                rows += block.rowCount();
+            });
+        }
+        else
+        {
+            KSParser parser(file, '#', sequence);
+            while (parser.HasNextRow())
+            {
+                parser.ReadNextRow();
+                ++rows;
+            }
+        }
+    }
+    QCOMPARE(rows, count);
+}
+
+QTEST_GUILESS_MAIN(TestKSParserColumns)
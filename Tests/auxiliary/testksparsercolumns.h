@@ -0,0 +1,56 @@
+/***************************************************************************
+                testksparsercolumns.h  -  KStars Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#pragma once
+
+#include "ksparser.h"
+
+#include <QObject>
+#include <QStringList>
+
+/**
+ * @class TestKSParserColumns
+ * @short Tests for the parsing of whole files in columns by KSParser, which must read the same rows as ReadNextRow()
+ */
+class TestKSParserColumns : public QObject
+{
+    Q_OBJECT
+
+  public:
+    TestKSParserColumns();
+    ~TestKSParserColumns() override = default;
+
+  private slots:
+    void cleanupTestCase();
+
+    void testCSVColumns_data();
+    void testCSVColumns();
+
+    void testFixedWidthColumns();
+    void testBlocks();
+    void testMissingFile();
+
+    void benchmarkCSV_data();
+    void benchmarkCSV();
+
+  private:
+    /** @return the name of a new temporary file with the given contents */
+    QString writeFile(const QByteArray &contents);
+
+    /** Compare the rows read with ReadNextRow() and the columns read by a function */
+    static void compare(KSParser &parser, const QList<QPair<QString, KSParser::DataTypes>> &sequence,
+                        const std::function<bool(const KSParser::ColumnsConsumer &)> &read);
+
+    QStringList files;
+};
@@ -0,0 +1,216 @@
+/***************************************************************************
+              testskyobjectnamesearch.cpp  -  KStars Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "testskyobjectnamesearch.h"
+
+#include "auxiliary/skyobjectnamesearch.h"
+#include "skyobjects/skyobject.h"
+
+#include <QtTest>
+
+#include <random>
+
+Q_DECLARE_METATYPE(SkyObjectNameSearch::MatchType)
+
+namespace
+{
+// The search never dereferences the objects, stand-ins are told apart by address
+const SkyObject *object(quintptr id)
+{
+    return reinterpret_cast<const SkyObject *>(id * 16);
+}
+
+void addNames(SkyObjectNameSearch &search)
+{
+    search.add("M 31", object(1), SkyObject::GALAXY);
+    search.add("NGC 224", object(1), SkyObject::GALAXY);
+    search.add("Andromeda Galaxy", object(1), SkyObject::GALAXY);
+    search.add("M 3", object(2), SkyObject::GLOBULAR_CLUSTER);
+    search.add("M 33", object(3), SkyObject::GALAXY);
+    search.add("Triangulum Galaxy", object(3), SkyObject::GALAXY);
+    search.add("Mars", object(4), SkyObject::PLANET);
+    search.add("Betelgeuse", object(5), SkyObject::STAR);
+    search.add("alpha Orionis", object(5), SkyObject::STAR);
+    search.add("Andromeda", object(6), SkyObject::CONSTELLATION);
+    search.add("Sirius", object(7), SkyObject::STAR);
+    search.add("Whirlpool Galaxy", object(8), SkyObject::GALAXY);
+    search.add("C/1995 O1 (Hale-Bopp)", object(9), SkyObject::COMET);
+    search.build();
+}
+}
+
+TestSkyObjectNameSearch::TestSkyObjectNameSearch() : QObject()
+{
+}
+
+void TestSkyObjectNameSearch::testDistance_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<int>("distance");
+
+    QTest::newRow("equal") << "sirius" << "sirius" << 0;
+    QTest::newRow("prefix") << "betel" << "betelgeuse" << 0;
+    QTest::newRow("substring") << "galaxy" << "andromedagalaxy" << 0;
+    QTest::newRow("wrong letter") << "betelgeaze" << "betelgeuse" << 2;
+    QTest::newRow("missing letter") << "andromda" << "andromedagalaxy" << 1;
+    QTest::newRow("extra letter") << "siriius" << "sirius" << 1;
+    QTest::newRow("swapped letters") << "whirlpoolglaaxy" << "whirlpoolgalaxy" << 2;
+    QTest::newRow("empty name") << "mars" << "" << 4;
+}
+
+void TestSkyObjectNameSearch::testDistance()
+{
+    QFETCH(QString, text);
+    QFETCH(QString, name);
+    QFETCH(int, distance);
+
+    QCOMPARE(SkyObjectNameSearch::distance(text, name), distance);
+}
+
+void TestSkyObjectNameSearch::testSearch_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QString>("first");
+    QTest::addColumn<SkyObjectNameSearch::MatchType>("match");
+
+    QTest::newRow("exact") << "M 31" << "M 31" << SkyObjectNameSearch::EXACT_MATCH;
+    QTest::newRow("case and white space") << "ngc224" << "NGC 224" << SkyObjectNameSearch::EXACT_MATCH;
+    QTest::newRow("prefix") << "betel" << "Betelgeuse" << SkyObjectNameSearch::PREFIX_MATCH;
+    QTest::newRow("substring") << "pool" << "Whirlpool Galaxy" << SkyObjectNameSearch::SUBSTRING_MATCH;
+    QTest::newRow("short substring") << "31" << "M 31" << SkyObjectNameSearch::SUBSTRING_MATCH;
+    QTest::newRow("one letter substring") << "3" << "M 3" << SkyObjectNameSearch::SUBSTRING_MATCH;
+    QTest::newRow("punctuation") << "hale bopp" << "C/1995 O1 (Hale-Bopp)" << SkyObjectNameSearch::FUZZY_MATCH;
+    QTest::newRow("fuzzy") << "Betelgeuze" << "Betelgeuse" << SkyObjectNameSearch::FUZZY_MATCH;
+    QTest::newRow("fuzzy substring") << "whirlpol galaxy" << "Whirlpool Galaxy" << SkyObjectNameSearch::FUZZY_MATCH;
+    QTest::newRow("unknown") << "Vega" << QString() << SkyObjectNameSearch::EXACT_MATCH;
+}
+
+void TestSkyObjectNameSearch::testSearch()
+{
+    QFETCH(QString, text);
+    QFETCH(QString, first);
+    QFETCH(SkyObjectNameSearch::MatchType, match);
+
+    SkyObjectNameSearch search;
+    addNames(search);
+
+    const QVector<SkyObjectNameSearch::Match> matches = search.search(text, 10);
+    if (first.isEmpty())
+    {
+        QVERIFY(matches.isEmpty());
+        return;
+    }
+
+    QVERIFY(!matches.isEmpty());
+    QCOMPARE(matches.first().name, first);
+    QCOMPARE(matches.first().match, match);
+}
+
+void TestSkyObjectNameSearch::testRanking()
+{
+    SkyObjectNameSearch search;
+    addNames(search);
+
+    // The exact name first, then the names starting with the text in alphabetical order, then the others
+    QVector<SkyObjectNameSearch::Match> matches = search.search("m3", 10);
+    QCOMPARE(matches.size(), 3);
+    QCOMPARE(matches.at(0).name, QString("M 3"));
+    QCOMPARE(matches.at(1).name, QString("M 31"));
+    QCOMPARE(matches.at(2).name, QString("M 33"));
+
+    matches = search.search("andromeda", 10);
+    QCOMPARE(matches.size(), 2);
+    QCOMPARE(matches.at(0).name, QString("Andromeda"));
+    QCOMPARE(matches.at(0).match, SkyObjectNameSearch::EXACT_MATCH);
+    QCOMPARE(matches.at(1).name, QString("Andromeda Galaxy"));
+    QCOMPARE(matches.at(1).match, SkyObjectNameSearch::PREFIX_MATCH);
+
+    // Names containing the text, earliest first, then shortest first, then in alphabetical order
+    matches = search.search("galaxy", 10);
+    QCOMPARE(matches.size(), 3);
+    QCOMPARE(matches.at(0).name, QString("Andromeda Galaxy"));
+    QCOMPARE(matches.at(1).name, QString("Whirlpool Galaxy"));
+    QCOMPARE(matches.at(2).name, QString("Triangulum Galaxy"));
+
+    // The limit applies to all the matches
+    QCOMPARE(search.search("m", 2).size(), 2);
+    QVERIFY(search.search("m", 0).isEmpty());
+}
+
+void TestSkyObjectNameSearch::testTypes()
+{
+    SkyObjectNameSearch search;
+    addNames(search);
+
+    QVector<SkyObjectNameSearch::Match> matches =
+        search.search("andromeda", 10, SkyObjectNameSearch::typeMask(SkyObject::GALAXY));
+    QCOMPARE(matches.size(), 1);
+    QCOMPARE(matches.first().object, object(1));
+
+    matches = search.search("a", 10, SkyObjectNameSearch::typeMask(SkyObject::STAR) |
+                                         SkyObjectNameSearch::typeMask(SkyObject::PLANET));
+    QCOMPARE(matches.size(), 1);
+    QCOMPARE(matches.first().name, QString("alpha Orionis"));
+
+    QVERIFY(search.search("M 31", 10, SkyObjectNameSearch::typeMask(SkyObject::STAR)).isEmpty());
+    QCOMPARE(SkyObjectNameSearch::typeMask(SkyObject::TYPE_UNKNOWN), SkyObjectNameSearch::typeMask(200));
+}
+
+void TestSkyObjectNameSearch::benchmarkSearch_data()
+{
+    QTest::addColumn<QString>("text");
+
+    QTest::newRow("letter") << "n";
+    QTest::newRow("prefix") << "ngc 12";
+    QTest::newRow("substring") << "4567";
+    QTest::newRow("two digits substring") << "31";
+    QTest::newRow("fuzzy") << "andromeda galxy";
+}
+
+void TestSkyObjectNameSearch::benchmarkSearch()
+{
+    QFETCH(QString, text);
+
+    // A million names, like those of large custom catalogs
+    static SkyObjectNameSearch search;
+    if (search.size() == 0)
+    {
+        const QStringList catalogs = QStringList() << "NGC" << "IC" << "UGC" << "PGC" << "HD" << "HIP" << "TYC";
+        const QStringList words    = QStringList() << "Andromeda" << "Galaxy" << "Nebula" << "Cluster" << "Cygnus"
+                                                   << "Orion" << "Veil" << "Loop" << "Arc" << "Cloud";
+        std::mt19937 generator(42);
+
+        for (int i = 0; i < 1000000; ++i)
+        {
+            QString name;
+            if (i % 10 == 0)
+                name = QString("%1 %2 %3").arg(words.at(generator() % words.size()))
+                           .arg(words.at(generator() % words.size())).arg(i);
+            else
+                name = QString("%1 %2").arg(catalogs.at(i % catalogs.size())).arg(generator() % 10000000);
+            search.add(name, object(i + 1), i % SkyObject::NUMBER_OF_KNOWN_TYPES);
+        }
+        search.build();
+    }
+
+    QVector<SkyObjectNameSearch::Match> matches;
+    QBENCHMARK
+    {
+        matches = search.search(text, 100);
+    }
+    QVERIFY(!matches.isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestSkyObjectNameSearch)
@@ -0,0 +1,43 @@
+/***************************************************************************
+               testskyobjectnamesearch.h  -  KStars Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QObject>
+
+/**
+ * @class TestSkyObjectNameSearch
+ * @short Tests for SkyObjectNameSearch, the ranked name search of the Find Object dialog
+ */
+class TestSkyObjectNameSearch : public QObject
+{
+    Q_OBJECT
+
+  public:
+    TestSkyObjectNameSearch();
+    ~TestSkyObjectNameSearch() override = default;
+
+  private slots:
+    void testDistance_data();
+    void testDistance();
+
+    void testSearch_data();
+    void testSearch();
+
+    void testRanking();
+    void testTypes();
+
+    void benchmarkSearch_data();
+    void benchmarkSearch();
+};
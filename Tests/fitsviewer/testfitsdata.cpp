@@ -9,8 +9,22 @@
  */
 
 #include <QtTest>
+#include <QPainter>
+#include <QThreadPool>
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+#include <QRandomGenerator>
+#endif
+#include <cmath>
 #include <memory>
 #include "testfitsdata.h"
+#include "Options.h"
+#include "fitsviewer/fpack.h"
+#include "fitsviewer/fitsbufferarena.h"
+#include "fitsviewer/fitsdemosaic.h"
+#include "fitsviewer/fitsimagepyramid.h"
+#include "fitsviewer/fitskernels.h"
+#include "fitsviewer/fitssepdetector.h"
+#include "fitsviewer/fitsworkerpool.h"
 
 Q_DECLARE_METATYPE(FITSMode);
 
@@ -28,12 +42,18 @@ void TestFitsData::cleanupTestCase()
 
 void TestFitsData::init()
 {
-
+    // Tests change the loading options, restore them even when a test fails
+    m_MemoryMappedFITS = Options::memoryMappedFITS();
+    m_StreamCompressedFITS = Options::streamCompressedFITS();
+    m_ParallelFITSDecompression = Options::parallelFITSDecompression();
 }
 
 void TestFitsData::cleanup()
 {
-
+    Options::setMemoryMappedFITS(m_MemoryMappedFITS);
+    Options::setStreamCompressedFITS(m_StreamCompressedFITS);
+    Options::setParallelFITSDecompression(m_ParallelFITSDecompression);
+    FITSBufferArena::Instance()->setBudget(static_cast<uint64_t>(Options::fITSBufferCacheSize()) * 1024 * 1024);
 }
 
 void TestFitsData::testComputeHFR_data()
@@ -175,11 +195,11 @@ void TestFitsData::initGenericDataFixture()
             << 2.09     // HFR found with the SEP detection
             << 41.08    // ADU
             << 41.08    // Mean
-            << 360.18   // StdDev
+            << 360.29   // StdDev
             << 0.114    // SNR
             << 57832L   // Max
             << 21L      // Min
-            << 0.0      // Median
+            << 31.0     // Median
             << QRect(591 - 16/2, 482 - 16/2, 16, 16);
 #endif
 }
@@ -235,7 +255,6 @@ void TestFitsData::testLoadFits()
     QCOMPARE((long)fd->getMax(), MAXIMUM);
     QCOMPARE((long)fd->getMin(), MINIMUM);
 
-    QWARN("No MEDIAN calculation in the current implementation");
     QVERIFY(abs(fd->getMedian() - MEDIAN) < 0.01);
 
     // Without searching for stars, there are no stars found
@@ -283,6 +302,542 @@ void TestFitsData::testLoadFits()
 #endif
 }
 
+void TestFitsData::testMemoryMappedLoad_data()
+{
+#if QT_VERSION < 0x050900
+    QSKIP("Skipping fixture-based test on old QT version.");
+#else
+    QTest::addColumn<QString>("NAME");
+    QTest::addColumn<FITSMode>("MODE");
+    QTest::addColumn<bool>("MAPPED");
+
+    // 16-bit samples with BZERO are byte-swapped and offset from the mapping
+    QTest::newRow("M47-16BIT-NORMAL") << "m47_sim_stars.fits" << FITS_NORMAL << true;
+    QTest::newRow("NGC4535-16BIT-FOCUS") << "ngc4535-autofocus1.fits" << FITS_FOCUS << true;
+    QTest::newRow("BAHTINOV-8BIT-NORMAL") << "bahtinov-focus.fits" << FITS_NORMAL << true;
+#endif
+}
+
+void TestFitsData::testMemoryMappedLoad()
+{
+#if QT_VERSION < 0x050900
+    QSKIP("Skipping fixture-based test on old QT version.");
+#else
+    QFETCH(QString, NAME);
+    QFETCH(FITSMode, MODE);
+    QFETCH(bool, MAPPED);
+
+    if(!QFile::exists(NAME))
+        QSKIP("Skipping load test because of missing fixture");
+
+    // Reference load through CFITSIO
+    Options::setMemoryMappedFITS(false);
+    std::unique_ptr<FITSData> reference(new FITSData(MODE));
+    QFuture<bool> worker = reference->loadFITS(NAME);
+    QTRY_VERIFY_WITH_TIMEOUT(worker.isFinished(), 10000);
+    QVERIFY(worker.result());
+    QVERIFY(!reference->isMemoryMapped());
+
+    // Same file, read from a mapping
+    Options::setMemoryMappedFITS(true);
+    std::unique_ptr<FITSData> mapped(new FITSData(MODE));
+    worker = mapped->loadFITS(NAME);
+    QTRY_VERIFY_WITH_TIMEOUT(worker.isFinished(), 10000);
+    QVERIFY(worker.result());
+    QCOMPARE(mapped->isMemoryMapped(), MAPPED);
+
+    QCOMPARE(mapped->width(), reference->width());
+    QCOMPARE(mapped->height(), reference->height());
+    QCOMPARE(mapped->channels(), reference->channels());
+    QCOMPARE(mapped->getBytesPerPixel(), reference->getBytesPerPixel());
+
+    size_t const bufferSize = reference->width() * reference->height() * reference->channels() * reference->getBytesPerPixel();
+    QVERIFY(memcmp(mapped->getImageBuffer(), reference->getImageBuffer(), bufferSize) == 0);
+
+    QCOMPARE(mapped->getMin(), reference->getMin());
+    QCOMPARE(mapped->getMax(), reference->getMax());
+    QCOMPARE(mapped->getMean(), reference->getMean());
+    QCOMPARE(mapped->getStdDev(), reference->getStdDev());
+#endif
+}
+
+void TestFitsData::testLoadBenchmark_data()
+{
+#if QT_VERSION < 0x050900
+    QSKIP("Skipping fixture-based test on old QT version.");
+#else
+    QTest::addColumn<QString>("NAME");
+    QTest::addColumn<bool>("MAPPED");
+
+    // Mapped first, as the peak resident set size only grows
+    QTest::newRow("BAHTINOV-8BIT-MAPPED") << "bahtinov-focus.fits" << true;
+    QTest::newRow("BAHTINOV-8BIT-CFITSIO") << "bahtinov-focus.fits" << false;
+    QTest::newRow("M47-16BIT-MAPPED") << "m47_sim_stars.fits" << true;
+    QTest::newRow("M47-16BIT-CFITSIO") << "m47_sim_stars.fits" << false;
+#endif
+}
+
+void TestFitsData::testLoadBenchmark()
+{
+#if QT_VERSION < 0x050900
+    QSKIP("Skipping fixture-based test on old QT version.");
+#else
+    QFETCH(QString, NAME);
+    QFETCH(bool, MAPPED);
+
+    if(!QFile::exists(NAME))
+        QSKIP("Skipping load test because of missing fixture");
+
+    Options::setMemoryMappedFITS(MAPPED);
+
+    qint64 const peakBefore = FITSWorkerPool::peakResidentSetSize();
+
+    QBENCHMARK
+    {
+        std::unique_ptr<FITSData> d(new FITSData(FITS_GUIDE));
+        QVERIFY(d->loadFITS(NAME).result());
+        QCOMPARE(d->isMemoryMapped(), MAPPED);
+    }
+
+    qint64 const peakAfter = FITSWorkerPool::peakResidentSetSize();
+    if (peakAfter >= 0)
+        QWARN(QString("Peak RSS %1 kB, grew by %2 kB").arg(peakAfter / 1024).arg((peakAfter - peakBefore) / 1024)
+              .toStdString().c_str());
+#endif
+}
+
+void TestFitsData::testCompressedLoad_data()
+{
+#if QT_VERSION < 0x050900
+    QSKIP("Skipping fixture-based test on old QT version.");
+#else
+    QTest::addColumn<QString>("NAME");
+    QTest::addColumn<bool>("STREAM");
+    QTest::addColumn<bool>("PARALLEL");
+    QTest::addColumn<int>("TILE");
+
+    // Tiles are whole rows by default, or squares of TILE pixels
+    QTest::newRow("M47-FPACK") << "m47_sim_stars.fits" << false << false << 0;
+    QTest::newRow("M47-STREAM") << "m47_sim_stars.fits" << true << false << 0;
+    QTest::newRow("M47-STREAM-PARALLEL") << "m47_sim_stars.fits" << true << true << 0;
+    QTest::newRow("M47-STREAM-PARALLEL-TILED") << "m47_sim_stars.fits" << true << true << 100;
+#endif
+}
+
+void TestFitsData::testCompressedLoad()
+{
+#if QT_VERSION < 0x050900
+    QSKIP("Skipping fixture-based test on old QT version.");
+#else
+    QFETCH(QString, NAME);
+    QFETCH(bool, STREAM);
+    QFETCH(bool, PARALLEL);
+    QFETCH(int, TILE);
+
+    if(!QFile::exists(NAME))
+        QSKIP("Skipping load test because of missing fixture");
+
+    // Compress the fixture next to the original, so that it is not considered temporary and removed on load
+    QString const compressed = NAME + ".fz";
+    QFile::remove(compressed);
+    fpstate fpvar;
+    fp_init(&fpvar);
+    if (TILE > 0)
+    {
+        fpvar.ntile[0] = TILE;
+        fpvar.ntile[1] = TILE;
+    }
+    int isLossLess = 0;
+    QVERIFY(fp_pack(NAME.toLatin1().data(), compressed.toLatin1().data(), fpvar, &isLossLess) >= 0);
+
+    std::unique_ptr<FITSData> reference(new FITSData());
+    QVERIFY(reference->loadFITS(NAME).result());
+
+    Options::setStreamCompressedFITS(STREAM);
+    Options::setParallelFITSDecompression(PARALLEL);
+
+    std::unique_ptr<FITSData> d(new FITSData());
+    QVERIFY(d->loadFITS(compressed).result());
+    QVERIFY(d->isCompressed());
+    QCOMPARE(d->compressedFilename(), compressed);
+
+    QCOMPARE(d->width(), reference->width());
+    QCOMPARE(d->height(), reference->height());
+    size_t const bufferSize = reference->width() * reference->height() * reference->channels() * reference->getBytesPerPixel();
+    QVERIFY(memcmp(d->getImageBuffer(), reference->getImageBuffer(), bufferSize) == 0);
+    QCOMPARE(d->getMean(), reference->getMean());
+
+    QBENCHMARK
+    {
+        std::unique_ptr<FITSData> b(new FITSData());
+        QVERIFY(b->loadFITS(compressed).result());
+    }
+
+    QFile::remove(compressed);
+#endif
+}
+
+void TestFitsData::testStatisticsKernels_data()
+{
+    QTest::addColumn<int>("DATATYPE");
+
+    QTest::newRow("UINT8") << TBYTE;
+    QTest::newRow("UINT16") << TUSHORT;
+    QTest::newRow("FLOAT") << TFLOAT;
+    QTest::newRow("DOUBLE") << TDOUBLE;
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+namespace
+{
+template <typename T>
+void verifyMoments(uint32_t count)
+{
+    // Pseudo-random samples over the whole range of the type, with an odd count to exercise the vector tails
+    QVector<T> samples(count);
+    double const range = std::is_floating_point<T>::value ? 100000.0 : std::numeric_limits<T>::max() + 1.0;
+    QRandomGenerator generator(42);
+    for (auto &sample : samples)
+        sample = static_cast<T>(generator.generateDouble() * range);
+
+    double min = samples[0], max = samples[0], sum = 0;
+    for (auto sample : samples)
+    {
+        min = qMin<double>(min, sample);
+        max = qMax<double>(max, sample);
+        sum += sample;
+    }
+    double const mean = sum / count;
+    double squares = 0;
+    for (auto sample : samples)
+        squares += (sample - mean) * (sample - mean);
+    double const variance = squares / count;
+
+    FITSKernels::Moments moments = FITSKernels::computeMoments<T>(samples.constData(), count);
+    QCOMPARE(moments.count, static_cast<uint64_t>(count));
+    QCOMPARE(moments.min, min);
+    QCOMPARE(moments.max, max);
+    QVERIFY(qAbs(moments.mean - mean) < 1e-6 * qMax(1.0, mean));
+    QVERIFY(qAbs(moments.variance() - variance) < 1e-6 * qMax(1.0, variance));
+
+    // Median and median absolute deviation from the histogram counted along with the moments
+    QVector<T> sorted = samples;
+    std::nth_element(sorted.begin(), sorted.begin() + count / 2, sorted.end());
+    double const median = sorted[count / 2];
+    QVector<double> deviations(count);
+    for (uint32_t i = 0; i < count; i++)
+        deviations[i] = qAbs(samples[i] - median);
+    std::nth_element(deviations.begin(), deviations.begin() + count / 2, deviations.end());
+    double const mad = deviations[count / 2];
+
+    bool const exactBins = std::is_integral<T>::value;
+    uint32_t const binCount = exactBins ? static_cast<uint32_t>(range) : 65536;
+    double const origin = exactBins ? 0 : min;
+    double const binWidth = exactBins ? 1 : (max - min) / binCount;
+    QVector<uint32_t> frequency(binCount, 0);
+    FITSKernels::Moments fused = FITSKernels::computeMomentsAndHistogram<T>(samples.constData(), count, origin, binWidth,
+                                 frequency.data(), binCount);
+    QCOMPARE(fused.min, moments.min);
+    QCOMPARE(fused.max, moments.max);
+
+    double const histogramMedian = FITSKernels::histogramMedian(frequency.constData(), binCount, origin, binWidth, exactBins);
+    double const histogramMAD = FITSKernels::histogramMAD(frequency.constData(), binCount, origin, binWidth, histogramMedian);
+    QVERIFY(qAbs(histogramMedian - median) <= (exactBins ? 0 : binWidth));
+    QVERIFY(qAbs(histogramMAD - mad) <= (exactBins ? 0 : 2 * binWidth));
+
+    // Throughput on a frame of 8 megapixels, 64 MB at most
+    QVector<T> frame(8 * 1000 * 1000);
+    memcpy(frame.data(), samples.constData(), count * sizeof(T));
+
+    QElapsedTimer timer;
+    timer.start();
+    int iterations = 0;
+    QBENCHMARK
+    {
+        FITSKernels::computeMoments<T>(frame.constData(), frame.size());
+        iterations++;
+    }
+    double const seconds = timer.nsecsElapsed() / 1e9;
+    QWARN(QString("%1 kernel: %2 GB/s").arg(FITSKernels::instructionSet())
+          .arg(iterations * frame.size() * sizeof(T) / seconds / 1e9, 0, 'f', 2).toStdString().c_str());
+}
+}
+#endif
+
+void TestFitsData::testStatisticsKernels()
+{
+#if QT_VERSION < QT_VERSION_CHECK(5, 10, 0)
+    QSKIP("Skipping kernel test without QRandomGenerator on old QT version.");
+#else
+    QFETCH(int, DATATYPE);
+
+    switch (DATATYPE)
+    {
+        case TBYTE:
+            verifyMoments<uint8_t>(100003);
+            break;
+        case TUSHORT:
+            verifyMoments<uint16_t>(100003);
+            break;
+        case TFLOAT:
+            verifyMoments<float>(100003);
+            break;
+        case TDOUBLE:
+            verifyMoments<double>(100003);
+            break;
+    }
+#endif
+}
+
+void TestFitsData::testBufferArena()
+{
+    FITSBufferArena *arena = FITSBufferArena::Instance();
+    arena->clear();
+    arena->setBudget(64 * 1024 * 1024);
+
+    // A released buffer serves the next request of about the same size
+    uint8_t *first = arena->acquire(10 * 1000 * 1000);
+    QVERIFY(first != nullptr);
+    memset(first, 0, 10 * 1000 * 1000);
+    arena->release(first);
+    FITSBufferArena::Statistics before = arena->statistics();
+    uint8_t *second = arena->acquire(10 * 1000 * 1000 - 100);
+    QCOMPARE(second, first);
+    QCOMPARE(arena->statistics().hits, before.hits + 1);
+
+    // A much smaller request does not get the large buffer
+    uint8_t *small = arena->acquire(1000);
+    QVERIFY(small != first);
+    arena->release(small);
+    arena->release(second);
+
+    // Released buffers beyond the budget are freed, least recently used first
+    arena->setBudget(12 * 1024 * 1024);
+    QVERIFY(arena->statistics().cachedBytes <= 12 * 1024 * 1024);
+    uint8_t *other = arena->acquire(5 * 1000 * 1000);
+    arena->release(other);
+    QVERIFY(arena->statistics().cachedBytes <= 12 * 1024 * 1024);
+
+    // Buffers that were not acquired from the arena, or were released already, are left alone
+    FITSBufferArena::Statistics const beforeForeign = arena->statistics();
+    uint8_t *foreign = new uint8_t[16];
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("not acquired from the arena"));
+    arena->release(foreign);
+    delete[] foreign;
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("not acquired from the arena"));
+    arena->release(other);
+    QCOMPARE(arena->statistics().cachedBytes, beforeForeign.cachedBytes);
+    QCOMPARE(arena->statistics().acquiredBytes, beforeForeign.acquiredBytes);
+
+    arena->clear();
+    QCOMPARE(arena->statistics().cachedBytes, static_cast<uint64_t>(0));
+}
+
+void TestFitsData::testDemosaic_data()
+{
+    QTest::addColumn<int>("METHOD");
+    QTest::addColumn<int>("FILTER");
+    QTest::addColumn<int>("BITS");
+
+    QTest::newRow("NEAREST_RGGB_8") << static_cast<int>(DC1394_BAYER_METHOD_NEAREST) << static_cast<int>(DC1394_COLOR_FILTER_RGGB) << 8;
+    QTest::newRow("NEAREST_GBRG_16") << static_cast<int>(DC1394_BAYER_METHOD_NEAREST) << static_cast<int>(DC1394_COLOR_FILTER_GBRG) << 16;
+    QTest::newRow("BILINEAR_GRBG_8") << static_cast<int>(DC1394_BAYER_METHOD_BILINEAR) << static_cast<int>(DC1394_COLOR_FILTER_GRBG) << 8;
+    QTest::newRow("BILINEAR_RGGB_16") << static_cast<int>(DC1394_BAYER_METHOD_BILINEAR) << static_cast<int>(DC1394_COLOR_FILTER_RGGB) << 16;
+    QTest::newRow("VNG_BGGR_8") << static_cast<int>(DC1394_BAYER_METHOD_VNG) << static_cast<int>(DC1394_COLOR_FILTER_BGGR) << 8;
+    QTest::newRow("VNG_RGGB_16") << static_cast<int>(DC1394_BAYER_METHOD_VNG) << static_cast<int>(DC1394_COLOR_FILTER_RGGB) << 16;
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+namespace
+{
+template <typename T>
+void verifyDemosaic(dc1394bayer_method_t method, dc1394color_filter_t filter)
+{
+    // A one-shot color frame the size of a 4144x2822 sensor, with an odd width to exercise the row tails:
+    // a smooth gradient with noise, so the VNG gradients take all directions
+    int const width = 4143, height = 2822;
+    size_t const size = static_cast<size_t>(width) * height;
+    double const range = std::numeric_limits<T>::max();
+    QVector<T> bayer(size);
+    QRandomGenerator generator(42);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            bayer[y * width + x] = static_cast<T>(qBound(0.0, range * (0.25 + 0.5 * x / width * y / height) +
+                                                  (generator.generateDouble() - 0.5) * range / 8, range));
+
+    // Current path: bayer.c into interleaved RGB, then copied into planes
+    QElapsedTimer timer;
+    timer.start();
+    QVector<T> interleaved(3 * size, 0);
+    QVector<T> reference(3 * size);
+    dc1394error_t error_code = sizeof(T) == 1 ?
+                               dc1394_bayer_decoding_8bit(reinterpret_cast<const uint8_t *>(bayer.constData()),
+                                       reinterpret_cast<uint8_t *>(interleaved.data()), width, height, filter, method) :
+                               dc1394_bayer_decoding_16bit(reinterpret_cast<const uint16_t *>(bayer.constData()),
+                                       reinterpret_cast<uint16_t *>(interleaved.data()), width, height, filter, method, 16);
+    QCOMPARE(error_code, DC1394_SUCCESS);
+    for (size_t i = 0; i < size; i++)
+    {
+        reference[i] = interleaved[3 * i];
+        reference[i + size] = interleaved[3 * i + 1];
+        reference[i + 2 * size] = interleaved[3 * i + 2];
+    }
+    double const bayerMilliseconds = timer.nsecsElapsed() / 1e6;
+
+    // Parallel path, straight into planes
+    QVector<T> planar(3 * size);
+    timer.restart();
+    QCOMPARE(FITSDemosaic::demosaic<T>(bayer.constData(), width, height, filter, method, planar.data(), size),
+             DC1394_SUCCESS);
+    double const planarMilliseconds = timer.nsecsElapsed() / 1e6;
+
+    QVERIFY(planar == reference);
+
+    QWARN(QString("bayer.c %1 ms, parallel planar %2 ms on %3 threads").arg(bayerMilliseconds, 0, 'f', 1)
+          .arg(planarMilliseconds, 0, 'f', 1).arg(FITSWorkerPool::threadPool()->maxThreadCount())
+          .toStdString().c_str());
+
+    QBENCHMARK
+    {
+        FITSDemosaic::demosaic<T>(bayer.constData(), width, height, filter, method, planar.data(), size);
+    }
+}
+}
+#endif
+
+void TestFitsData::testDemosaic()
+{
+#if QT_VERSION < QT_VERSION_CHECK(5, 10, 0)
+    QSKIP("Skipping demosaic test without QRandomGenerator on old QT version.");
+#else
+    QFETCH(int, METHOD);
+    QFETCH(int, FILTER);
+    QFETCH(int, BITS);
+
+    QVERIFY(FITSDemosaic::supports(static_cast<dc1394bayer_method_t>(METHOD)));
+
+    if (BITS == 8)
+        verifyDemosaic<uint8_t>(static_cast<dc1394bayer_method_t>(METHOD), static_cast<dc1394color_filter_t>(FILTER));
+    else
+        verifyDemosaic<uint16_t>(static_cast<dc1394bayer_method_t>(METHOD), static_cast<dc1394color_filter_t>(FILTER));
+#endif
+}
+
+void TestFitsData::testStreamReusesBuffers_data()
+{
+#if QT_VERSION < 0x050900
+    QSKIP("Skipping fixture-based test on old QT version.");
+#else
+    initGenericDataFixture();
+#endif
+}
+
+void TestFitsData::testStreamReusesBuffers()
+{
+#if QT_VERSION < 0x050900
+    QSKIP("Skipping fixture-based test on old QT version.");
+#else
+    QFETCH(QString, NAME);
+    QFETCH(FITSMode, MODE);
+
+    if(!QFile::exists(NAME))
+        QSKIP("Skipping load test because of missing fixture");
+
+    // Read frames into buffers, as they would be when received from a camera
+    Options::setMemoryMappedFITS(false);
+    FITSWorkerPool::resetStageStatistics();
+
+    uint64_t misses = 0;
+    for (int frame = 0; frame < 10; frame++)
+    {
+        std::unique_ptr<FITSData> fd(new FITSData(MODE));
+        QFuture<bool> worker = fd->loadFITS(NAME);
+        QTRY_VERIFY_WITH_TIMEOUT(worker.isFinished(), 10000);
+        QVERIFY(worker.result());
+        QVERIFY(fd->findStars(ALGORITHM_SEP) > 0);
+
+        // After the first frame, all buffers come from the arena
+        if (frame == 1)
+            misses = FITSBufferArena::Instance()->statistics().misses;
+    }
+
+    QCOMPARE(FITSBufferArena::Instance()->statistics().misses, misses);
+
+    for (int stage = 0; stage < FITSWorkerPool::STAGE_COUNT; stage++)
+    {
+        FITSWorkerPool::StageStatistics const statistics = FITSWorkerPool::stageStatistics(static_cast<FITSWorkerPool::Stage>(stage));
+        if (statistics.count > 0)
+            QWARN(QString("Stage %1: %2 runs, %3 ms average, %4 ms max")
+                  .arg(FITSWorkerPool::stageName(static_cast<FITSWorkerPool::Stage>(stage))).arg(statistics.count)
+                  .arg(statistics.totalNanoseconds / 1e6 / statistics.count, 0, 'f', 2)
+                  .arg(statistics.maxNanoseconds / 1e6, 0, 'f', 2).toStdString().c_str());
+    }
+
+    QCOMPARE(FITSWorkerPool::stageStatistics(FITSWorkerPool::STAGE_LOAD).count, static_cast<quint64>(10));
+    QCOMPARE(FITSWorkerPool::stageStatistics(FITSWorkerPool::STAGE_STAR_DETECTION).count, static_cast<quint64>(10));
+#endif
+}
+
+void TestFitsData::testPyramidBufferSwap()
+{
+#if QT_VERSION < 0x050900
+    QSKIP("Skipping fixture-based test on old QT version.");
+#else
+    QString const NAME = "m47_sim_stars.fits";
+    if(!QFile::exists(NAME))
+        QSKIP("Skipping pyramid test because of missing fixture");
+
+    std::unique_ptr<FITSData> d(new FITSData(FITS_NORMAL));
+    QVERIFY(d->loadFITS(NAME).result());
+
+    // Connected as the view does, so tiles are not rendered from a buffer being changed or freed
+    FITSImagePyramid pyramid;
+    connect(d.get(), &FITSData::bufferAboutToChange, &pyramid, &FITSImagePyramid::clear, Qt::DirectConnection);
+
+    Stretch stretch(static_cast<int>(d->width()), static_cast<int>(d->height()), d->channels(),
+                    d->property("dataType").toInt());
+    stretch.computeParams(d->getImageBuffer());
+
+    // A coarse overview, so tiles are requested at full resolution, and drawn in red until they are ready
+    QImage overview(d->width() / 16, d->height() / 16, QImage::Format_RGB32);
+    overview.fill(Qt::red);
+
+    size_t const size = static_cast<size_t>(d->width()) * d->height() * d->channels() * d->getBytesPerPixel();
+    QByteArray const original(reinterpret_cast<char const *>(d->getImageBuffer()), static_cast<int>(size));
+
+    // Paints the whole image at 100%, which queues all its tiles, and returns the color drawn in the middle
+    QImage surface(d->width(), d->height(), QImage::Format_RGB32);
+    auto paint = [&]()
+    {
+        surface.fill(Qt::black);
+        QPainter painter(&surface);
+        pyramid.paint(&painter, surface.rect(), 1.0);
+        painter.end();
+        return QColor(surface.pixel(surface.width() / 2, surface.height() / 2));
+    };
+
+    for (int i = 0; i < 20; i++)
+    {
+        // Redo of a stretch, which changes the buffer in place while tiles are queued
+        pyramid.setImage(d.get(), stretch, overview, 16);
+        QCOMPARE(paint(), QColor(Qt::red));
+        d->applyFilter(FITS_AUTO_STRETCH);
+        QCOMPARE(paint(), QColor(Qt::black));
+
+        // Undo of the stretch, which replaces the buffer as FITSHistogramCommand::reverseDelta() does
+        pyramid.setImage(d.get(), stretch, overview, 16);
+        QCOMPARE(paint(), QColor(Qt::red));
+        uint8_t *restored = FITSBufferArena::Instance()->acquire(size);
+        QVERIFY(restored != nullptr);
+        memcpy(restored, original.constData(), size);
+        d->setImageBuffer(restored);
+        QCOMPARE(paint(), QColor(Qt::black));
+    }
+
+    QVERIFY(memcmp(d->getImageBuffer(), original.constData(), size) == 0);
+#endif
+}
+
 void TestFitsData::testCentroidAlgorithmBenchmark_data()
 {
 #if QT_VERSION < 0x050900
@@ -405,4 +960,139 @@ void TestFitsData::testSEPAlgorithmBenchmark()
 #endif
 }
 
+void TestFitsData::testSEPSubframeDetection_data()
+{
+#if QT_VERSION < 0x050900
+    QSKIP("Skipping fixture-based test on old QT version.");
+#else
+    initGenericDataFixture();
+#endif
+}
+
+void TestFitsData::testSEPSubframeDetection()
+{
+#if QT_VERSION < 0x050900
+    QSKIP("Skipping fixture-based test on old QT version.");
+#else
+    QFETCH(QString, NAME);
+    QFETCH(QRect, TRACKING_BOX);
+
+    if(!QFile::exists(NAME))
+        QSKIP("Skipping load test because of missing fixture");
+
+    std::unique_ptr<FITSData> d(new FITSData());
+    QFuture<bool> worker = d->loadFITS(NAME);
+    QTRY_VERIFY_WITH_TIMEOUT(worker.isFinished(), 10000);
+    QVERIFY(worker.result());
+
+    // Reference detection through the FITS data
+    QCOMPARE(d->findStars(ALGORITHM_SEP, TRACKING_BOX), 1);
+    Edge const reference = *d->getStarCenters()[0];
+
+    // Same tracking box, detected directly in the image buffer by a detector kept across frames like the guider does
+    FITSSEPDetector detector(nullptr);
+    FITSSEPDetector::ImageView const view = FITSSEPDetector::imageView(d.get(), TRACKING_BOX);
+    QCOMPARE(view.width, TRACKING_BOX.width());
+    QCOMPARE(view.height, TRACKING_BOX.height());
+
+    QList<Edge*> stars;
+    QCOMPARE(detector.findSourcesInView(view, stars), 1);
+    QCOMPARE(stars[0]->x, reference.x);
+    QCOMPARE(stars[0]->y, reference.y);
+    QCOMPARE(stars[0]->HFR, reference.HFR);
+    qDeleteAll(stars);
+
+    // Later frames reuse the scratch buffer of the detector
+    FITSBufferArena::Statistics const before = FITSBufferArena::Instance()->statistics();
+    QBENCHMARK
+    {
+        detector.findSourcesInView(view, stars);
+        qDeleteAll(stars);
+    }
+    QCOMPARE(FITSBufferArena::Instance()->statistics().misses, before.misses);
+    QCOMPARE(FITSBufferArena::Instance()->statistics().hits, before.hits);
+    QVERIFY(detector.lastDetectionTime() > 0);
+    QWARN(QString("Subframe detection in %1 ms").arg(detector.lastDetectionTime()).toStdString().c_str());
+#endif
+}
+
+void TestFitsData::testSEPTiledDetection_data()
+{
+#if QT_VERSION < 0x050900
+    QSKIP("Skipping fixture-based test on old QT version.");
+#else
+    QTest::addColumn<QString>("NAME");
+    QTest::addColumn<int>("TILE_SIZE");
+
+    QTest::newRow("M47-256") << "m47_sim_stars.fits" << 256;
+    QTest::newRow("M47-384") << "m47_sim_stars.fits" << 384;
+    QTest::newRow("M47-512") << "m47_sim_stars.fits" << 512;
+#endif
+}
+
+void TestFitsData::testSEPTiledDetection()
+{
+#if QT_VERSION < 0x050900
+    QSKIP("Skipping fixture-based test on old QT version.");
+#else
+    QFETCH(QString, NAME);
+    QFETCH(int, TILE_SIZE);
+
+    if(!QFile::exists(NAME))
+        QSKIP("Skipping load test because of missing fixture");
+
+    std::unique_ptr<FITSData> d(new FITSData());
+    QFuture<bool> worker = d->loadFITS(NAME);
+    QTRY_VERIFY_WITH_TIMEOUT(worker.isFinished(), 10000);
+    QVERIFY(worker.result());
+
+    // Tiles are only used with several threads
+    int const threads = FITSWorkerPool::threadPool()->maxThreadCount();
+    FITSWorkerPool::threadPool()->setMaxThreadCount(qMax(4, threads));
+
+    QList<Edge*> reference, tiled;
+    SkyBackground referenceBackground, tiledBackground;
+
+    FITSSEPDetector single(d.get());
+    single.configure("tiledExtraction", false);
+    int const count = single.findSourcesAndBackground(reference, QRect(), &referenceBackground);
+
+    FITSSEPDetector parallel(d.get());
+    parallel.configure("tiledExtraction", true).configure("tileSize", TILE_SIZE);
+    QCOMPARE(parallel.findSourcesAndBackground(tiled, QRect(), &tiledBackground), count);
+
+    FITSWorkerPool::threadPool()->setMaxThreadCount(threads);
+
+    // Sources in the overlap of tiles are counted once, and the background is estimated on the same cells
+    QCOMPARE(tiledBackground.starsDetected, referenceBackground.starsDetected);
+    QVERIFY(std::abs(tiledBackground.mean - referenceBackground.mean) < 0.01);
+    QVERIFY(std::abs(tiledBackground.sigma - referenceBackground.sigma) < 0.01);
+
+    // Deblending draws differ from tile to tile, which may change the few stars selected at the end of the catalog
+    double referenceHFR = 0, tiledHFR = 0;
+    int matched = 0;
+    for (auto const * star : tiled)
+    {
+        tiledHFR += star->HFR;
+        for (auto const * other : reference)
+        {
+            if (std::hypot(star->x - other->x, star->y - other->y) < 0.5)
+            {
+                QVERIFY(std::abs(star->HFR - other->HFR) < 0.05);
+                matched++;
+                break;
+            }
+        }
+    }
+    for (auto const * star : reference)
+        referenceHFR += star->HFR;
+
+    QVERIFY(matched >= count * 9 / 10);
+    QVERIFY(std::abs(tiledHFR - referenceHFR) / count < 0.01);
+
+    qDeleteAll(reference);
+    qDeleteAll(tiled);
+#endif
+}
+
 QTEST_GUILESS_MAIN(TestFitsData)
@@ -23,6 +23,10 @@ class TestFitsData : public QObject
     private:
         void initGenericDataFixture();
 
+        bool m_MemoryMappedFITS { false };
+        bool m_StreamCompressedFITS { false };
+        bool m_ParallelFITSDecompression { false };
+
     private slots:
         void initTestCase();
         void cleanupTestCase();
@@ -33,6 +37,28 @@ class TestFitsData : public QObject
         void testLoadFits_data();
         void testLoadFits();
 
+        void testMemoryMappedLoad_data();
+        void testMemoryMappedLoad();
+
+        void testLoadBenchmark_data();
+        void testLoadBenchmark();
+
+        void testCompressedLoad_data();
+        void testCompressedLoad();
+
+        void testStatisticsKernels_data();
+        void testStatisticsKernels();
+
+        void testBufferArena();
+
+        void testDemosaic_data();
+        void testDemosaic();
+
+        void testStreamReusesBuffers_data();
+        void testStreamReusesBuffers();
+
+        void testPyramidBufferSwap();
+
         void testCentroidAlgorithmBenchmark_data();
         void testCentroidAlgorithmBenchmark();
 
@@ -45,6 +71,12 @@ class TestFitsData : public QObject
         void testSEPAlgorithmBenchmark_data();
         void testSEPAlgorithmBenchmark();
 
+        void testSEPSubframeDetection_data();
+        void testSEPSubframeDetection();
+
+        void testSEPTiledDetection_data();
+        void testSEPTiledDetection();
+
         void testComputeHFR_data();
         void testComputeHFR();
 
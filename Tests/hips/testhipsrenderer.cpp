@@ -0,0 +1,133 @@
+/***************************************************************************
+                  testhipsrenderer.cpp  -  KStars Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "testhipsrenderer.h"
+
+#include "hips/hipsrenderer.h"
+
+#include <QThread>
+#include <QtTest>
+
+#include <cmath>
+
+namespace
+{
+const int TILE_WIDTH = 512;
+// Size of the tiles on screen, a survey slightly magnified on a full HD sky map
+const double TILE_SIZE = 600.0;
+const QSize MAP_SIZE(1920, 1080);
+}
+
+TestHIPSRenderer::TestHIPSRenderer() : QObject()
+{
+    // A different color on each pixel, so that any misplaced pixel is found
+    m_tileImage = QImage(TILE_WIDTH, TILE_WIDTH, QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < TILE_WIDTH; y++)
+        for (int x = 0; x < TILE_WIDTH; x++)
+            m_tileImage.setPixel(x, y, qRgb(x % 256, y % 256, (x / 2 + y / 2) % 256));
+}
+
+void TestHIPSRenderer::createTiles(HIPSRenderer &renderer, const QSize &size)
+{
+    renderer.m_tiles.clear();
+
+    // Tiles overlap by a tenth, so that the order in which they are drawn matters, and are slightly sheared like
+    // the diamonds of HEALPix pixels away from the center of a projection
+    const double step = TILE_SIZE * 0.9, shear = 0.1;
+
+    for (double top = -TILE_SIZE / 2; top < size.height(); top += step)
+    {
+        for (double left = -TILE_SIZE / 2; left < size.width(); left += step)
+        {
+            HIPSRenderer::tile_t tile;
+            tile.level  = 3;
+            tile.pix    = renderer.m_tiles.size();
+            tile.image  = &m_tileImage;
+            tile.source = m_tileImage.rect();
+
+            auto toScreen = [&](double u, double v)
+            {
+                return QPointF(left + (u + shear * v) * TILE_SIZE, top + v * TILE_SIZE);
+            };
+
+            tile.corners[0] = toScreen(1, 1);
+            tile.corners[1] = toScreen(1, 0);
+            tile.corners[2] = toScreen(0, 0);
+            tile.corners[3] = toScreen(0, 1);
+
+            // Grand children in the order of the UV table of HIPSRenderer, corners from north to west
+            for (int j = 0; j < 16; j++)
+            {
+                const double u = 0.5 * ((j >> 3) & 1) + 0.25 * ((j >> 1) & 1);
+                const double v = 0.5 * ((j >> 2) & 1) + 0.25 * (j & 1);
+
+                tile.fine[j][0] = toScreen(u + 0.25, v + 0.25);
+                tile.fine[j][1] = toScreen(u + 0.25, v);
+                tile.fine[j][2] = toScreen(u, v);
+                tile.fine[j][3] = toScreen(u, v + 0.25);
+            }
+
+            tile.minY = static_cast<int>(std::floor(top));
+            tile.maxY = static_cast<int>(std::ceil(top + TILE_SIZE));
+            renderer.m_tiles.append(tile);
+        }
+    }
+}
+
+void TestHIPSRenderer::testRasterize_data()
+{
+    QTest::addColumn<int>("BANDS");
+    QTest::addColumn<bool>("BILINEAR");
+
+    const int cores = QThread::idealThreadCount();
+
+    for (bool bilinear : { false, true })
+    {
+        const char *interpolation = bilinear ? "bilinear" : "nearest";
+        QTest::newRow(qPrintable(QString("1 band %1").arg(interpolation))) << 1 << bilinear;
+        if (cores > 2)
+            QTest::newRow(qPrintable(QString("2 bands %1").arg(interpolation))) << 2 << bilinear;
+        if (cores > 1)
+            QTest::newRow(qPrintable(QString("%1 bands %2").arg(cores).arg(interpolation))) << cores << bilinear;
+    }
+}
+
+void TestHIPSRenderer::testRasterize()
+{
+    QFETCH(int, BANDS);
+    QFETCH(bool, BILINEAR);
+
+    HIPSRenderer renderer;
+    createTiles(renderer, MAP_SIZE);
+    QVERIFY(!renderer.m_tiles.isEmpty());
+
+    // Reference: all tiles drawn serially, in a single band
+    QImage reference(MAP_SIZE, QImage::Format_ARGB32_Premultiplied);
+    reference.fill(Qt::transparent);
+    renderer.rasterize(1, BILINEAR, &reference);
+
+    QImage image(MAP_SIZE, QImage::Format_ARGB32_Premultiplied);
+
+    QBENCHMARK
+    {
+        image.fill(Qt::transparent);
+        renderer.rasterize(BANDS, BILINEAR, &image);
+    }
+
+    // Bands only split the rows of the destination, the result must be the same as a serial render
+    QCOMPARE(image, reference);
+    QVERIFY(image.pixel(MAP_SIZE.width() / 2, MAP_SIZE.height() / 2) != 0);
+}
+
+QTEST_GUILESS_MAIN(TestHIPSRenderer)
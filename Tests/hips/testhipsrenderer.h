@@ -0,0 +1,43 @@
+/***************************************************************************
+                   testhipsrenderer.h  -  KStars Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QImage>
+#include <QObject>
+
+class HIPSRenderer;
+
+/**
+ * @class TestHIPSRenderer
+ * @short Tests for the rasterization of HiPS tiles in parallel bands of the sky map image
+ */
+class TestHIPSRenderer : public QObject
+{
+    Q_OBJECT
+
+  public:
+    TestHIPSRenderer();
+    ~TestHIPSRenderer() override = default;
+
+  private slots:
+    void testRasterize_data();
+    void testRasterize();
+
+  private:
+    // Cover the destination with overlapping tiles, as if collected from a full screen survey
+    void createTiles(HIPSRenderer &renderer, const QSize &size);
+
+    QImage m_tileImage;
+};
@@ -0,0 +1,180 @@
+/***************************************************************************
+                  testpixdisccache.cpp  -  KStars Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "testpixdisccache.h"
+
+#include "hips/pixdisccache.h"
+
+#include <QDateTime>
+#include <QDirIterator>
+#include <QFile>
+#include <QImage>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <memory>
+
+namespace
+{
+const qint64 UID = 1234;
+const int TILE_WIDTH = 16;
+
+// A tile with a different color on each pixel, so that any misplaced pixel is found
+QImage createTile(QImage::Format format, int seed)
+{
+    QImage image(TILE_WIDTH, TILE_WIDTH, QImage::Format_ARGB32);
+    for (int y = 0; y < image.height(); y++)
+        for (int x = 0; x < image.width(); x++)
+            image.setPixel(x, y, qRgba((x * 16 + seed) % 256, (y * 16 + seed) % 256, (x + y + seed) % 256,
+                                       format == QImage::Format_ARGB32 ? (x * y) % 256 : 255));
+    return image.convertToFormat(format);
+}
+
+QString tileFile(const QString &path, const pixCacheKey_t &key)
+{
+    return QString("%1/%2/Norder%3/Npix%4.tile").arg(path).arg(key.uid).arg(key.level).arg(key.pix);
+}
+}
+
+TestPixDiscCache::TestPixDiscCache() : QObject()
+{
+}
+
+void TestPixDiscCache::testRoundTrip_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::addColumn<int>("loadedFormat");
+
+    QTest::newRow("RGB32") << static_cast<int>(QImage::Format_RGB32) << static_cast<int>(QImage::Format_RGB32);
+    QTest::newRow("ARGB32") << static_cast<int>(QImage::Format_ARGB32) << static_cast<int>(QImage::Format_ARGB32);
+    QTest::newRow("RGB888") << static_cast<int>(QImage::Format_RGB888) << static_cast<int>(QImage::Format_RGB32);
+}
+
+void TestPixDiscCache::testRoundTrip()
+{
+    QFETCH(int, format);
+    QFETCH(int, loadedFormat);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    PixDiscCache cache;
+    cache.setCacheDirectory(dir.path());
+
+    const pixCacheKey_t key { 5, 321, UID };
+    const QImage tile = createTile(static_cast<QImage::Format>(format), 7);
+
+    QVERIFY(cache.load(key) == nullptr);
+    cache.save(key, tile);
+    QVERIFY(QFile::exists(tileFile(dir.path(), key)));
+    QVERIFY(cache.cacheSize() > 0);
+
+    std::unique_ptr<QImage> loaded(cache.load(key));
+    QVERIFY(loaded != nullptr);
+    QCOMPARE(static_cast<int>(loaded->format()), loadedFormat);
+    QCOMPARE(*loaded, tile.convertToFormat(static_cast<QImage::Format>(loadedFormat)));
+
+    // The allsky image and the tiles of other sources are cached apart
+    QVERIFY(cache.load({ HIPS_ALLSKY_LEVEL, 0, UID }) == nullptr);
+    QVERIFY(cache.load({ 5, 321, UID + 1 }) == nullptr);
+
+    // Release the mapped tile before removing it
+    loaded.reset();
+    cache.clear();
+    QCOMPARE(cache.cacheSize(), 0);
+    QVERIFY(cache.load(key) == nullptr);
+}
+
+void TestPixDiscCache::testInvalidTile()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    PixDiscCache cache;
+    cache.setCacheDirectory(dir.path());
+
+    const pixCacheKey_t key { 4, 12, UID };
+    cache.save(key, createTile(QImage::Format_RGB32, 0));
+
+    // A truncated tile is not mapped
+    QFile file(tileFile(dir.path(), key));
+    QVERIFY(file.open(QFile::ReadWrite));
+    QVERIFY(file.resize(file.size() / 2));
+    file.close();
+    QVERIFY(cache.load(key) == nullptr);
+
+    // Neither is a file which is not a tile
+    QVERIFY(file.open(QFile::WriteOnly | QFile::Truncate));
+    QVERIFY(file.write(QByteArray(4096, 'x')) == 4096);
+    file.close();
+    QVERIFY(cache.load(key) == nullptr);
+}
+
+void TestPixDiscCache::testExpiry()
+{
+#if QT_VERSION < QT_VERSION_CHECK(5,10,0)
+    QSKIP("The times of the tiles can only be set with Qt 5.10 or later");
+#else
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    PixDiscCache cache;
+    cache.setCacheDirectory(dir.path());
+
+    // Tiles saved one minute apart, the first one the longest ago
+    const int count = 5;
+    for (int pix = 0; pix < count; pix++)
+    {
+        const pixCacheKey_t key { 6, pix, UID };
+        cache.save(key, createTile(QImage::Format_RGB32, pix));
+
+        QFile file(tileFile(dir.path(), key));
+        QVERIFY(file.open(QFile::ReadWrite));
+        QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs((pix - 60) * 60), QFileDevice::FileModificationTime));
+    }
+
+    const qint64 tileSize = QFileInfo(tileFile(dir.path(), { 6, 0, UID })).size();
+    QCOMPARE(cache.cacheSize(), count * tileSize);
+
+    // Room for the tiles saved, and a bit more
+    const qint64 maxSize = count * tileSize + tileSize / 2;
+    cache.setMaximumCacheSize(maxSize);
+
+    // Using the oldest tile makes it the most recently used
+    delete cache.load({ 6, 0, UID });
+
+    // One more tile is over the maximum size, the least recently used are removed to go 10% under it
+    cache.save({ 6, count, UID }, createTile(QImage::Format_RGB32, count));
+
+    QVERIFY(cache.cacheSize() <= maxSize - maxSize / 10);
+    QVERIFY(QFile::exists(tileFile(dir.path(), { 6, 0, UID })));
+    QVERIFY(QFile::exists(tileFile(dir.path(), { 6, count, UID })));
+    QVERIFY(!QFile::exists(tileFile(dir.path(), { 6, 1, UID })));
+    QVERIFY(!QFile::exists(tileFile(dir.path(), { 6, 2, UID })));
+    QVERIFY(QFile::exists(tileFile(dir.path(), { 6, 3, UID })));
+    QVERIFY(QFile::exists(tileFile(dir.path(), { 6, 4, UID })));
+
+    // The size of the cache matches the tiles kept
+    qint64 size = 0;
+    QDirIterator it(dir.path(), QStringList() << "*.tile", QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        it.next();
+        size += it.fileInfo().size();
+    }
+    QCOMPARE(cache.cacheSize(), size);
+#endif
+}
+
+QTEST_GUILESS_MAIN(TestPixDiscCache)
@@ -0,0 +1,36 @@
+/***************************************************************************
+                   testpixdisccache.h  -  KStars Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QObject>
+
+/**
+ * @class TestPixDiscCache
+ * @short Tests for the disc cache of decoded HiPS tiles: round trip of the tiles and expiry
+ */
+class TestPixDiscCache : public QObject
+{
+    Q_OBJECT
+
+  public:
+    TestPixDiscCache();
+    ~TestPixDiscCache() override = default;
+
+  private slots:
+    void testRoundTrip_data();
+    void testRoundTrip();
+    void testInvalidTile();
+    void testExpiry();
+};
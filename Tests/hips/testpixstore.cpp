@@ -0,0 +1,236 @@
+/***************************************************************************
+                    testpixstore.cpp  -  KStars Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "testpixstore.h"
+
+#include "hips/hipsimporter.h"
+#include "hips/pixstore.h"
+
+#include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QtTest>
+
+namespace
+{
+const qint64 UID = 1234;
+
+// A small PNG tile, different for each pix
+QByteArray tileData(int pix)
+{
+    QImage image(16, 16, QImage::Format_RGB32);
+    image.fill(qRgb(pix % 256, (pix * 7) % 256, (pix * 13) % 256));
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+    return data;
+}
+
+bool writeFile(const QString &name, const QByteArray &data)
+{
+    if (!QDir().mkpath(QFileInfo(name).absolutePath()))
+        return false;
+
+    QFile file(name);
+    return file.open(QFile::WriteOnly) && file.write(data) == data.size();
+}
+}
+
+TestPixStore::TestPixStore() : QObject()
+{
+}
+
+void TestPixStore::testWriteRead()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    PixStore store;
+    store.setStoreDirectory(dir.path());
+
+    const pixCacheKey_t key { 3, 5, UID };
+    QVERIFY(!store.contains(key));
+    QVERIFY(store.read(key).isEmpty());
+    QCOMPARE(store.count(UID), 0);
+
+    for (int pix = 0; pix < 10; pix++)
+        QVERIFY(store.write({ 3, pix, UID }, tileData(pix)));
+
+    // Writing a stored tile again is accepted, and does not append it
+    const qint64 size = store.storeSize();
+    QVERIFY(store.write(key, tileData(5)));
+    QCOMPARE(store.storeSize(), size);
+
+    QCOMPARE(store.count(UID), 10);
+    QCOMPARE(store.count(UID + 1), 0);
+    for (int pix = 0; pix < 10; pix++)
+    {
+        QVERIFY(store.contains({ 3, pix, UID }));
+        QCOMPARE(store.read({ 3, pix, UID }), tileData(pix));
+    }
+
+    // Other sources and levels are not found
+    QVERIFY(!store.contains({ 4, 5, UID }));
+    QVERIFY(!store.contains({ 3, 5, UID + 1 }));
+
+    // Tiles appended after the pack was mapped are read as well
+    QVERIFY(store.write({ 4, 20, UID }, tileData(20)));
+    QCOMPARE(store.read({ 4, 20, UID }), tileData(20));
+    QCOMPARE(store.read(key), tileData(5));
+
+    store.clear();
+    QVERIFY(!store.contains(key));
+    QCOMPARE(store.storeSize(), 0);
+}
+
+void TestPixStore::testReopen()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    {
+        PixStore store;
+        store.setStoreDirectory(dir.path());
+        for (int pix = 0; pix < 10; pix++)
+            QVERIFY(store.write({ 5, pix, UID }, tileData(pix)));
+        store.flush();
+    }
+
+    const QString packName  = QString("%1/%2.pack").arg(dir.path()).arg(UID);
+    const QString indexName = QString("%1/%2.idx").arg(dir.path()).arg(UID);
+    QVERIFY(QFile::exists(packName));
+    QVERIFY(QFile::exists(indexName));
+
+    // With the saved index
+    {
+        PixStore store;
+        store.setStoreDirectory(dir.path());
+        QCOMPARE(store.count(UID), 10);
+        QCOMPARE(store.read({ 5, 7, UID }), tileData(7));
+    }
+
+    // Without index, the pack is scanned
+    QVERIFY(QFile::remove(indexName));
+    {
+        PixStore store;
+        store.setStoreDirectory(dir.path());
+        QCOMPARE(store.count(UID), 10);
+        QCOMPARE(store.read({ 5, 3, UID }), tileData(3));
+    }
+
+    // A partial record at the end of the pack is dropped, and the index out of date is rebuilt
+    const qint64 packSize = QFileInfo(packName).size();
+    {
+        QFile pack(packName);
+        QVERIFY(pack.open(QFile::Append));
+        QVERIFY(pack.write(QByteArray(7, 'x')) == 7);
+    }
+    {
+        PixStore store;
+        store.setStoreDirectory(dir.path());
+        QCOMPARE(store.count(UID), 10);
+        QCOMPARE(store.read({ 5, 9, UID }), tileData(9));
+        QCOMPARE(store.storeSize(), packSize);
+    }
+    QCOMPARE(QFileInfo(packName).size(), packSize);
+}
+
+void TestPixStore::testMaximumSize()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    PixStore store;
+    store.setStoreDirectory(dir.path());
+
+    // Room for a few tiles only
+    const qint64 maxSize = 4 * (tileData(0).size() + 64);
+    store.setMaximumStoreSize(maxSize);
+    QCOMPARE(store.getMaximumStoreSize(), maxSize);
+
+    int written = 0;
+    for (int pix = 0; pix < 20; pix++)
+        written += store.write({ 3, pix, UID }, tileData(pix)) ? 1 : 0;
+
+    QVERIFY(written > 0);
+    QVERIFY(written < 20);
+    QCOMPARE(store.count(UID), written);
+    QVERIFY(store.storeSize() <= maxSize);
+}
+
+void TestPixStore::testImportDirectory()
+{
+    QTemporaryDir source, storeDir;
+    QVERIFY(source.isValid());
+    QVERIFY(storeDir.isValid());
+
+    // A local copy of a HiPS source, with files which are not tiles of its format
+    struct SourceTile
+    {
+        pixCacheKey_t key;
+        QString path;
+    };
+    const QList<SourceTile> tiles { { { HIPS_ALLSKY_LEVEL, 0, UID }, "Norder3/Allsky.png" },
+                                    { { 3, 5, UID }, "Norder3/Dir0/Npix5.png" },
+                                    { { 3, 700, UID }, "Norder3/Dir0/Npix700.png" },
+                                    { { 4, 2800, UID }, "Norder4/Dir0/Npix2800.png" },
+                                    { { 6, 12345, UID }, "Norder6/Dir10000/Npix12345.png" } };
+
+    for (const SourceTile &tile : tiles)
+        QVERIFY(writeFile(source.filePath(tile.path), tileData(tile.key.pix)));
+    QVERIFY(writeFile(source.filePath("Norder3/Dir0/Npix6.jpg"), tileData(6)));
+    QVERIFY(writeFile(source.filePath("properties"), "hips_order = 6\n"));
+
+    PixStore store;
+    store.setStoreDirectory(storeDir.path());
+
+    HIPSImporter importer;
+    QSignalSpy finished(&importer, &HIPSImporter::finished);
+    QVERIFY(finished.isValid());
+
+    QVERIFY(importer.importDirectory(source.path(), &store, UID, "png"));
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, 10000);
+    QTRY_VERIFY(!importer.isRunning());
+
+    // Imported, skipped, failed, bytes, seconds and error
+    QList<QVariant> result = finished.takeFirst();
+    QCOMPARE(result.at(0).toInt(), tiles.size());
+    QCOMPARE(result.at(1).toInt(), 0);
+    QCOMPARE(result.at(2).toInt(), 0);
+    QVERIFY(result.at(5).toString().isEmpty());
+
+    QCOMPARE(store.count(UID), tiles.size());
+    for (const SourceTile &tile : tiles)
+        QCOMPARE(store.read(tile.key), tileData(tile.key.pix));
+    QVERIFY(!store.contains({ 3, 6, UID }));
+
+    // The import saved the index, so that a new store finds the tiles without scanning
+    QVERIFY(QFile::exists(QString("%1/%2.idx").arg(storeDir.path()).arg(UID)));
+
+    // Tiles already stored are skipped
+    QVERIFY(importer.importDirectory(source.path(), &store, UID, "png"));
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, 10000);
+    QTRY_VERIFY(!importer.isRunning());
+
+    result = finished.takeFirst();
+    QCOMPARE(result.at(0).toInt(), 0);
+    QCOMPARE(result.at(1).toInt(), tiles.size());
+}
+
+QTEST_GUILESS_MAIN(TestPixStore)
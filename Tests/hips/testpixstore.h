@@ -0,0 +1,36 @@
+/***************************************************************************
+                     testpixstore.h  -  KStars Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QObject>
+
+/**
+ * @class TestPixStore
+ * @short Tests for the offline store of HiPS tiles, and their import from a local HiPS directory tree
+ */
+class TestPixStore : public QObject
+{
+    Q_OBJECT
+
+  public:
+    TestPixStore();
+    ~TestPixStore() override = default;
+
+  private slots:
+    void testWriteRead();
+    void testReopen();
+    void testMaximumSize();
+    void testImportDirectory();
+};
@@ -0,0 +1,217 @@
+/***************************************************************************
+              test_schedulerevaluation.cpp  -  KStars Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "test_schedulerevaluation.h"
+
+#include "ekos/scheduler/scheduler.h"
+#include "ekos/scheduler/schedulerjob.h"
+#include "kstarsdata.h"
+
+#include <QtConcurrent>
+#include <QtTest>
+
+#include <algorithm>
+#include <memory>
+
+using Ekos::Scheduler;
+
+namespace
+{
+// Evaluation night: a summer night in southern France, with a fixed time zone offset
+const QDateTime EVALUATION_TIME(QDate(2020, 6, 15), QTime(22, 0));
+// Dawn and dusk of that night, in day fractions
+const double DAWN = 0.22;
+const double DUSK = 0.93;
+
+std::shared_ptr<SchedulerJob::Conditions const> createConditions(QDateTime const &now)
+{
+    std::shared_ptr<SchedulerJob::Conditions> conditions =
+        std::make_shared<SchedulerJob::Conditions>(GeoLocation(dms(1.44), dms(43.6), "Toulouse", "", "France", 2.0));
+    conditions->now                   = KStarsDateTime(now);
+    conditions->settingAltitudeCutoff = 3;
+    conditions->leadTime              = 5;
+    conditions->preDawnTime           = 45;
+    return conditions;
+}
+
+// Vega, M31 and M51: rising, low and setting at evaluation time
+QList<SchedulerJob> createJobs(SchedulerJob::StartupCondition startup, double minAltitude, bool twilight)
+{
+    struct Target
+    {
+        QString name;
+        double ra, dec;
+    };
+    QList<Target> const targets { { "Vega", 18.62, 38.78 }, { "M31", 0.71, 41.27 }, { "M51", 13.50, 47.20 } };
+
+    QList<SchedulerJob> jobs;
+    for (int i = 0; i < targets.size(); i++)
+    {
+        SchedulerJob job;
+        dms ra, dec;
+        ra.setH(targets[i].ra);
+        dec.setD(targets[i].dec);
+        job.setName(targets[i].name);
+        job.setTargetCoords(ra, dec);
+        job.setMinAltitude(minAltitude);
+        job.setEnforceTwilight(twilight);
+        job.setLightFramesRequired(true);
+        job.setCulminationOffset(-60);
+
+        job.setFileStartupCondition(startup);
+        job.setStartupCondition(startup);
+        if (SchedulerJob::START_AT == startup)
+        {
+            job.setFileStartupTime(EVALUATION_TIME.addSecs((i + 1) * 2 * 3600));
+            job.setStartupTime(job.getFileStartupTime());
+        }
+
+        job.setEstimatedTime(3600);
+        job.setState(SchedulerJob::JOB_EVALUATION);
+        jobs.append(job);
+    }
+    jobs.first().setLeadTime(0);
+    return jobs;
+}
+
+void compareResults(std::vector<SchedulerJob> const &actual, std::vector<SchedulerJob> const &expected)
+{
+    QCOMPARE(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); i++)
+    {
+        QCOMPARE(actual[i].getName(), expected[i].getName());
+        QCOMPARE(actual[i].getState(), expected[i].getState());
+        QCOMPARE(actual[i].getStartupTime(), expected[i].getStartupTime());
+        QCOMPARE(actual[i].getCompletionTime(), expected[i].getCompletionTime());
+        QCOMPARE(actual[i].getLeadTime(), expected[i].getLeadTime());
+        QCOMPARE(actual[i].getScore(), expected[i].getScore());
+    }
+}
+}
+
+TestSchedulerEvaluation::TestSchedulerEvaluation() : QObject()
+{
+}
+
+void TestSchedulerEvaluation::initTestCase()
+{
+    // Jobs only need the clock and the default location of KStars, which differs from the one of the evaluations
+    if (KStarsData::Instance() == nullptr)
+        KStarsData::Create();
+}
+
+void TestSchedulerEvaluation::testWorkerMatchesSynchronous_data()
+{
+    QTest::addColumn<int>("startup");
+    QTest::addColumn<double>("minAltitude");
+    QTest::addColumn<bool>("twilight");
+
+    QTest::newRow("ASAP") << static_cast<int>(SchedulerJob::START_ASAP) << -90.0 << false;
+    QTest::newRow("ASAP, altitude") << static_cast<int>(SchedulerJob::START_ASAP) << 30.0 << false;
+    QTest::newRow("ASAP, altitude, twilight") << static_cast<int>(SchedulerJob::START_ASAP) << 30.0 << true;
+    QTest::newRow("culmination") << static_cast<int>(SchedulerJob::START_CULMINATION) << -90.0 << true;
+    QTest::newRow("fixed startup, altitude") << static_cast<int>(SchedulerJob::START_AT) << 20.0 << false;
+}
+
+void TestSchedulerEvaluation::testWorkerMatchesSynchronous()
+{
+    QFETCH(int, startup);
+    QFETCH(double, minAltitude);
+    QFETCH(bool, twilight);
+
+    QList<SchedulerJob> const jobs = createJobs(static_cast<SchedulerJob::StartupCondition>(startup), minAltitude, twilight);
+    std::shared_ptr<SchedulerJob::Conditions const> const conditions = createConditions(EVALUATION_TIME);
+
+    auto const createEvaluation = [&]()
+    {
+        std::shared_ptr<Scheduler::JobEvaluation> evaluation = std::make_shared<Scheduler::JobEvaluation>();
+        evaluation->conditions             = conditions;
+        evaluation->now                    = conditions->now;
+        evaluation->dawn                   = DAWN;
+        evaluation->dusk                   = DUSK;
+        evaluation->leadTime               = conditions->leadTime;
+        evaluation->preDawnTime            = conditions->preDawnTime;
+        evaluation->settingAltitudeCutoff  = conditions->settingAltitudeCutoff;
+        evaluation->altitudeDecimals       = 1;
+        evaluation->moonSeparationDecimals = 1;
+        // There is no Moon without a sky map, consider it below the horizon
+        evaluation->ignoreMissingMoon      = true;
+        for (SchedulerJob const &job : jobs)
+            evaluation->inputs.push_back(job.detached(conditions));
+        return evaluation;
+    };
+
+    // Evaluate in the test thread
+    std::shared_ptr<Scheduler::JobEvaluation> const synchronous = createEvaluation();
+    Scheduler::scheduleJobs(*synchronous);
+
+    // Evaluate the same jobs in a worker thread, as the Scheduler does
+    std::shared_ptr<Scheduler::JobEvaluation> const worker = createEvaluation();
+    QtConcurrent::run([worker]()
+    {
+        Scheduler::scheduleJobs(*worker);
+    }).waitForFinished();
+
+    QVERIFY(std::any_of(synchronous->results.begin(), synchronous->results.end(), [](SchedulerJob const & job)
+    {
+        return SchedulerJob::JOB_SCHEDULED == job.getState();
+    }));
+    compareResults(worker->results, synchronous->results);
+    QCOMPARE(worker->messages, synchronous->messages);
+}
+
+void TestSchedulerEvaluation::testReusedSchedule()
+{
+    QList<SchedulerJob> const jobs = createJobs(SchedulerJob::START_ASAP, 30.0, true);
+
+    auto const createEvaluation = [&](QDateTime const &now)
+    {
+        std::shared_ptr<SchedulerJob::Conditions const> const conditions = createConditions(now);
+        std::shared_ptr<Scheduler::JobEvaluation> evaluation = std::make_shared<Scheduler::JobEvaluation>();
+        evaluation->conditions            = conditions;
+        evaluation->now                   = conditions->now;
+        evaluation->dawn                  = DAWN;
+        evaluation->dusk                  = DUSK;
+        evaluation->leadTime              = conditions->leadTime;
+        evaluation->preDawnTime           = conditions->preDawnTime;
+        evaluation->settingAltitudeCutoff = conditions->settingAltitudeCutoff;
+        evaluation->ignoreMissingMoon     = true;
+        for (SchedulerJob const &job : jobs)
+            evaluation->inputs.push_back(job.detached(conditions));
+        return evaluation;
+    };
+
+    std::shared_ptr<Scheduler::JobEvaluation> const first = createEvaluation(EVALUATION_TIME);
+    Scheduler::scheduleJobs(*first);
+
+    // Schedules reused later in the night, or after the clock was set back, match a complete evaluation
+    for (int const minutes : { 1, 30, 6 * 60, -60 })
+    {
+        QDateTime const now = EVALUATION_TIME.addSecs(minutes * 60);
+
+        std::shared_ptr<Scheduler::JobEvaluation> const reusing = createEvaluation(now);
+        reusing->previousSchedules = first->schedules;
+        Scheduler::scheduleJobs(*reusing);
+
+        std::shared_ptr<Scheduler::JobEvaluation> const complete = createEvaluation(now);
+        Scheduler::scheduleJobs(*complete);
+
+        for (SchedulerJob const &job : reusing->results)
+            if (SchedulerJob::JOB_SCHEDULED == job.getState())
+                QVERIFY(now <= job.getStartupTime());
+        compareResults(reusing->results, complete->results);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestSchedulerEvaluation)
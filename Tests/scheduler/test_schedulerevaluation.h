@@ -0,0 +1,38 @@
+/***************************************************************************
+               test_schedulerevaluation.h  -  KStars Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QObject>
+
+/**
+ * @class TestSchedulerEvaluation
+ * @short Tests that the Scheduler schedules jobs in its worker thread as it would in the GUI thread
+ */
+class TestSchedulerEvaluation : public QObject
+{
+    Q_OBJECT
+
+  public:
+    TestSchedulerEvaluation();
+    ~TestSchedulerEvaluation() override = default;
+
+  private slots:
+    void initTestCase();
+
+    void testWorkerMatchesSynchronous_data();
+    void testWorkerMatchesSynchronous();
+
+    void testReusedSchedule();
+};
@@ -0,0 +1,102 @@
+/***************************************************************************
+                  test_schedulerjob.cpp  -  KStars Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "test_schedulerjob.h"
+
+#include "ekos/scheduler/schedulerjob.h"
+#include "kstarsdata.h"
+
+#include <QtTest>
+
+#include <cmath>
+
+namespace
+{
+// Samples are 5 minutes apart: the interpolation error is at most a few hundredths of a degree, near the zenith
+const double ALTITUDE_TOLERANCE = 0.05;
+}
+
+TestSchedulerJob::TestSchedulerJob() : QObject()
+{
+}
+
+void TestSchedulerJob::initTestCase()
+{
+    if (KStarsData::Instance() == nullptr)
+        KStarsData::Create();
+
+    // Observe from mid-northern latitude, the time zone of KStars being UTC
+    GeoLocation * const geo = KStarsData::Instance()->geo();
+    m_Latitude  = geo->lat()->Degrees();
+    m_Longitude = geo->lng()->Degrees();
+    geo->setLat(dms(43.6));
+    geo->setLong(dms(1.44));
+}
+
+void TestSchedulerJob::cleanupTestCase()
+{
+    GeoLocation * const geo = KStarsData::Instance()->geo();
+    geo->setLat(dms(m_Latitude));
+    geo->setLong(dms(m_Longitude));
+}
+
+void TestSchedulerJob::testInterpolatedAltitude_data()
+{
+    QTest::addColumn<double>("ra");
+    QTest::addColumn<double>("dec");
+
+    // Vega culminates close to the zenith, M31 low in the night, Polaris is circumpolar, M51 sets during the night
+    QTest::newRow("Vega") << 18.62 << 38.78;
+    QTest::newRow("M31") << 0.71 << 41.27;
+    QTest::newRow("Polaris") << 2.53 << 89.26;
+    QTest::newRow("M51") << 13.50 << 47.20;
+    QTest::newRow("Fomalhaut") << 22.96 << -29.62;
+}
+
+void TestSchedulerJob::testInterpolatedAltitude()
+{
+    QFETCH(double, ra);
+    QFETCH(double, dec);
+
+    dms targetRA, targetDec;
+    targetRA.setH(ra);
+    targetDec.setD(dec);
+
+    SchedulerJob job;
+    job.setTargetCoords(targetRA, targetDec);
+
+    // Compare every minute of a night, which crosses several samples and the limit of the ephemeris cache
+    QDateTime const dusk(QDate(2020, 8, 15), QTime(19, 30));
+    for (int minute = 0; minute <= 11 * 60; minute++)
+    {
+        QDateTime const when = dusk.addSecs(minute * 60);
+
+        bool isSetting = false, expectedSetting = false;
+        double const altitude = job.getAltitude(when, &isSetting);
+        double const expected = SchedulerJob::findAltitude(job.getTargetCoords(), when, &expectedSetting);
+
+        QVERIFY2(std::fabs(altitude - expected) <= ALTITUDE_TOLERANCE,
+                 qPrintable(QString("At %1, interpolated altitude %2 differs from %3 by more than %4 degrees.")
+                            .arg(when.toString(Qt::ISODate)).arg(altitude).arg(expected).arg(ALTITUDE_TOLERANCE)));
+
+        // The setting flag may only differ within a sample of the meridian, where the hour angle wraps
+        bool beforeSetting = false, afterSetting = false;
+        SchedulerJob::findAltitude(job.getTargetCoords(), when.addSecs(-5 * 60), &beforeSetting);
+        SchedulerJob::findAltitude(job.getTargetCoords(), when.addSecs(5 * 60), &afterSetting);
+        if (beforeSetting == afterSetting)
+            QCOMPARE(isSetting, expectedSetting);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestSchedulerJob)
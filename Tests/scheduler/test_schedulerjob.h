@@ -0,0 +1,41 @@
+/***************************************************************************
+                   test_schedulerjob.h  -  KStars Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QObject>
+
+/**
+ * @class TestSchedulerJob
+ * @short Tests for the ephemeris cache of SchedulerJob
+ */
+class TestSchedulerJob : public QObject
+{
+    Q_OBJECT
+
+  public:
+    TestSchedulerJob();
+    ~TestSchedulerJob() override = default;
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void testInterpolatedAltitude_data();
+    void testInterpolatedAltitude();
+
+  private:
+    double m_Latitude { 0 };
+    double m_Longitude { 0 };
+};
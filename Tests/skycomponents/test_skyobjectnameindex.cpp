@@ -0,0 +1,171 @@
+/***************************************************************************
+                test_skyobjectnameindex.cpp  -  KStars Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "test_skyobjectnameindex.h"
+
+#include "skycomponent.h"
+#include "skyobjectnameindex.h"
+#include "skyobjects/skyobject.h"
+
+#include <QtTest>
+
+#include <memory>
+
+namespace
+{
+// Stand-ins for the components owning the objects, only compared by address
+const SkyComponent *const DEEP_SKY = reinterpret_cast<const SkyComponent *>(0x10);
+const SkyComponent *const CATALOG  = reinterpret_cast<const SkyComponent *>(0x20);
+const SkyComponent *const STARS    = reinterpret_cast<const SkyComponent *>(0x30);
+
+// A component that loads its objects when they are looked up, like a large custom catalog
+class OnDemandComponent : public SkyComponent
+{
+  public:
+    void draw(SkyPainter *) override {}
+
+    SkyObject *findByName(const QString &name) override
+    {
+        lookups.append(name);
+        return (name == object.name() || name == object.longname()) ? &object : nullptr;
+    }
+
+    SkyObject object { SkyObject::GALAXY, 0.0, 0.0, 15.0, "PGC 1000", QString(), "Deferred Galaxy" };
+    QStringList lookups;
+};
+}
+
+TestSkyObjectNameIndex::TestSkyObjectNameIndex() : QObject()
+{
+}
+
+void TestSkyObjectNameIndex::testFind_data()
+{
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("exact") << "M 31" << "M 31";
+    QTest::newRow("case") << "m 31" << "M 31";
+    QTest::newRow("white space") << "M31" << "M 31";
+    QTest::newRow("long name") << "andromeda galaxy" << "M 31";
+    QTest::newRow("designation") << "NGC224" << "M 31";
+    QTest::newRow("deep sky before stars") << "Pleiades" << "M 45";
+    QTest::newRow("genetive name") << "alpha Centauri" << "Rigil Kentaurus";
+    QTest::newRow("Greek genetive name") << QString::fromUtf8("α Centauri") << "Rigil Kentaurus";
+    QTest::newRow("unknown") << "M 310" << QString();
+}
+
+void TestSkyObjectNameIndex::testFind()
+{
+    QFETCH(QString, name);
+    QFETCH(QString, expected);
+
+    SkyObjectNameIndex index;
+    SkyObject m31(SkyObject::GALAXY, 0.7, 41.3, 3.4, "M 31", "NGC 224", "Andromeda Galaxy");
+    SkyObject m45(SkyObject::OPEN_CLUSTER, 3.8, 24.1, 1.6, "M 45", QString(), "Pleiades");
+    SkyObject pleiad(SkyObject::STAR, 3.8, 24.1, 2.9, "Alcyone", QString(), "Pleiades");
+    SkyObject rigil(SkyObject::STAR, 14.7, -60.8, -0.3, "Rigil Kentaurus", "alp Cen");
+
+    // Stars come last in the search order, even when indexed first
+    index.insert(pleiad.longname(), &pleiad, STARS);
+    for (SkyObject *object : { &m31, &m45 })
+    {
+        index.insert(object->name(), object, DEEP_SKY);
+        index.insert(object->longname(), object, DEEP_SKY);
+        index.insert(object->name2(), object, DEEP_SKY);
+    }
+    index.insert(rigil.name(), &rigil, STARS);
+    index.insert("alpha Centauri", &rigil, STARS);
+    index.insert(QString::fromUtf8("α Centauri"), &rigil, STARS);
+
+    SkyObject *found = index.find(name);
+    QCOMPARE(found ? found->name() : QString(), expected);
+}
+
+void TestSkyObjectNameIndex::testPrefix()
+{
+    SkyObjectNameIndex index;
+    std::vector<std::unique_ptr<SkyObject>> objects;
+
+    for (int i = 1; i <= 110; ++i)
+    {
+        objects.emplace_back(new SkyObject(SkyObject::GALAXY, 0.0, 0.0, 10.0, QString("M %1").arg(i)));
+        index.insert(objects.back()->name(), objects.back().get(), DEEP_SKY);
+    }
+
+    const QList<QPair<QString, SkyObject *>> found = index.findByPrefix("m 10");
+    QCOMPARE(found.size(), 11);
+    QCOMPARE(found.first().first, QString("M 10"));
+    QCOMPARE(found.last().first, QString("M 109"));
+
+    QCOMPARE(index.findByPrefix("M", 5).size(), 5);
+    QVERIFY(index.findByPrefix("NGC").isEmpty());
+}
+
+void TestSkyObjectNameIndex::testRemove()
+{
+    SkyObjectNameIndex index;
+    SkyObject builtin(SkyObject::GALAXY, 0.0, 0.0, 10.0, "Arp 148");
+    SkyObject custom(SkyObject::GALAXY, 0.0, 0.0, 10.0, "Arp 148", QString(), "Mayall's Object");
+
+    index.insert(builtin.name(), &builtin, DEEP_SKY);
+    index.insert(custom.name(), &custom, CATALOG);
+    index.insert(custom.longname(), &custom, CATALOG);
+    QCOMPARE(index.find("Arp 148"), &builtin);
+    QCOMPARE(index.size(), 2);
+
+    // Removing one object leaves the other with the same name
+    index.remove(&builtin);
+    QCOMPARE(index.find("Arp 148"), &custom);
+
+    // Removing a custom catalog drops all its names
+    index.removeOwner(CATALOG);
+    QVERIFY(index.find("Arp 148") == nullptr);
+    QVERIFY(index.find("Mayall's Object") == nullptr);
+    QCOMPARE(index.size(), 0);
+}
+
+void TestSkyObjectNameIndex::testDeferred()
+{
+    SkyObjectNameIndex index;
+    OnDemandComponent catalog;
+    SkyObject builtin(SkyObject::GALAXY, 0.0, 0.0, 10.0, "Arp 148");
+
+    index.insert(builtin.name(), &builtin, DEEP_SKY);
+    index.insertDeferred(catalog.object.name(), catalog.object.type(), &catalog);
+    index.insertDeferred(catalog.object.longname(), catalog.object.type(), &catalog);
+    index.insertDeferred("Arp 148", SkyObject::GALAXY, &catalog);
+    QCOMPARE(index.size(), 3);
+
+    // Deferred names are resolved by their component, with the name as indexed
+    QCOMPARE(index.find("pgc1000"), &catalog.object);
+    QCOMPARE(index.find("deferred galaxy"), &catalog.object);
+    QCOMPARE(catalog.lookups, QStringList() << "PGC 1000" << "Deferred Galaxy");
+
+    // Among objects of the same rank, the first one indexed wins, without loading the other
+    QCOMPARE(index.find("Arp 148"), &builtin);
+    QCOMPARE(catalog.lookups.size(), 2);
+
+    // Deferred names are listed without their object
+    const QList<QPair<QString, SkyObject *>> found = index.findByPrefix("PGC");
+    QCOMPARE(found.size(), 1);
+    QVERIFY(found.first().second == nullptr);
+
+    index.removeOwner(&catalog);
+    QVERIFY(index.find("PGC 1000") == nullptr);
+    QCOMPARE(index.find("Arp 148"), &builtin);
+    QCOMPARE(index.size(), 1);
+}
+
+QTEST_GUILESS_MAIN(TestSkyObjectNameIndex)
@@ -0,0 +1,38 @@
+/***************************************************************************
+                 test_skyobjectnameindex.h  -  KStars Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QObject>
+
+/**
+ * @class TestSkyObjectNameIndex
+ * @short Tests for the index of names of SkyMapComposite
+ */
+class TestSkyObjectNameIndex : public QObject
+{
+    Q_OBJECT
+
+  public:
+    TestSkyObjectNameIndex();
+    ~TestSkyObjectNameIndex() override = default;
+
+  private slots:
+    void testFind_data();
+    void testFind();
+
+    void testPrefix();
+    void testRemove();
+    void testDeferred();
+};
@@ -0,0 +1,232 @@
+/***************************************************************************
+                 test_starblockfactory.cpp  -  KStars Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "test_starblockfactory.h"
+
+#include "starblock.h"
+#include "starblockfactory.h"
+#include "starblocklist.h"
+#include "skyobjects/deepstardata.h"
+#include "skyobjects/starobject.h"
+
+#include <QAtomicInt>
+#include <QtConcurrent>
+#include <QtTest>
+
+#include <random>
+
+namespace
+{
+// Trixels of the tests, spread over all the shards
+const int TRIXELS = 64;
+// Lists longer than this would overflow the magnitudes of the synthetic stars
+const int MAX_BLOCKS = 20;
+// The RA of a star encodes its trixel and its index in the list
+const qint32 TRIXEL_STRIDE = 100000;
+}
+
+TestStarBlockFactory::TestStarBlockFactory() : QObject()
+{
+}
+
+void TestStarBlockFactory::initTestCase()
+{
+    StarBlockFactory *SBFactory = StarBlockFactory::Instance();
+    savedBudget                 = SBFactory->getBudget();
+
+    // Two slabs per shard, so that the lists compete for blocks
+    const quint64 large = quint64(1) << 30;
+    SBFactory->setBudget(large);
+    const quint64 blockBytes = large / SBFactory->getCacheSize();
+
+    budgetBlocks = 256;
+    SBFactory->setBudget(budgetBlocks * blockBytes);
+}
+
+void TestStarBlockFactory::cleanupTestCase()
+{
+    StarBlockFactory::Instance()->setBudget(savedBudget);
+}
+
+void TestStarBlockFactory::init()
+{
+    for (int trixel = 0; trixel < TRIXELS; ++trixel)
+        lists.append(std::shared_ptr<StarBlockList>(new StarBlockList(trixel, nullptr)));
+}
+
+void TestStarBlockFactory::cleanup()
+{
+    // The lists give their blocks back to the factory
+    lists.clear();
+
+    QCOMPARE(StarBlockFactory::Instance()->statistics().usedBlocks, 0);
+}
+
+bool TestStarBlockFactory::grow(StarBlockList *list)
+{
+    if (list->getBlockCount() >= MAX_BLOCKS)
+        return false;
+
+    std::shared_ptr<StarBlock> block = StarBlockFactory::Instance()->getBlock(list->getTrixel());
+    if (!block)
+        return false;
+
+    // Getting the block may have recycled the end of the list itself
+    const long first = list->getStarCount();
+    for (long index = first; !block->isFull(); ++index)
+    {
+        DeepStarData data;
+        data.RA = list->getTrixel() * TRIXEL_STRIDE + index;
+        data.V  = index * 10;
+        data.B  = data.V;
+        block->addStar(data);
+    }
+
+    return list->appendBlocks(first, 0, QList<std::shared_ptr<StarBlock>>() << block);
+}
+
+int TestStarBlockFactory::verify(StarBlockList *list, const QVector<std::shared_ptr<StarBlock>> &blocks)
+{
+    int failures = 0;
+    long index   = 0;
+
+    for (const auto &block : blocks)
+    {
+        if (block->parent != list || block->pins.load() <= 0)
+            ++failures;
+
+        for (int i = 0; i < block->getStarCount(); ++i, ++index)
+        {
+            const qint32 ra = qRound(block->star(i)->ra0().Hours() * 1000000.0);
+            if (ra != qint32(list->getTrixel() * TRIXEL_STRIDE + index))
+                ++failures;
+        }
+    }
+
+    return failures;
+}
+
+void TestStarBlockFactory::testRecycleUnpinned()
+{
+    StarBlockFactory *SBFactory = StarBlockFactory::Instance();
+    StarBlockList *pinnedList   = lists.at(0).get();
+
+    for (int i = 0; i < 4; ++i)
+        QVERIFY(grow(pinnedList));
+
+    const quint64 evictions = SBFactory->statistics().evictions;
+
+    {
+        StarBlockFactory::Pins pins;
+        const QVector<std::shared_ptr<StarBlock>> pinned = pins.pin(pinnedList);
+        QCOMPARE(pinned.size(), 4);
+
+        // Fill the other lists of the same shard well beyond its budget
+        for (int round = 0; round < 4 * MAX_BLOCKS; ++round)
+        {
+            for (int trixel = 8; trixel < TRIXELS; trixel += 8)
+                grow(lists.at(trixel).get());
+        }
+
+        QVERIFY(SBFactory->statistics().evictions > evictions);
+        QCOMPARE(pinnedList->getBlockCount(), 4);
+        QCOMPARE(verify(pinnedList, pinned), 0);
+    }
+
+    // Once released, the blocks of the list go the way of the others
+    for (int round = 0; round < 4 * MAX_BLOCKS; ++round)
+    {
+        for (int trixel = 8; trixel < TRIXELS; trixel += 8)
+            grow(lists.at(trixel).get());
+    }
+
+    QVERIFY(pinnedList->getBlockCount() < 4);
+}
+
+void TestStarBlockFactory::testConcurrentReaders_data()
+{
+    QTest::addColumn<int>("readers");
+    QTest::addColumn<int>("rounds");
+
+    QTest::newRow("one reader") << 1 << 4000;
+    QTest::newRow("four readers") << 4 << 4000;
+    QTest::newRow("eight readers") << 8 << 8000;
+}
+
+void TestStarBlockFactory::testConcurrentReaders()
+{
+    QFETCH(int, readers);
+    QFETCH(int, rounds);
+
+    StarBlockFactory *SBFactory = StarBlockFactory::Instance();
+    const quint64 evictions     = SBFactory->statistics().evictions;
+    const auto &constLists      = lists;
+
+    QAtomicInt stop(0);
+    QAtomicInt failures(0);
+    QAtomicInt reads(0);
+    QList<QFuture<void>> futures;
+
+    // The readers pin random lists and check that their blocks hold on while the lists are filled and recycled
+    for (int reader = 0; reader < readers; ++reader)
+    {
+        futures << QtConcurrent::run([&, reader]()
+        {
+            std::mt19937 generator(reader);
+            std::uniform_int_distribution<int> distribution(0, TRIXELS - 1);
+
+            while (!stop.load())
+            {
+                StarBlockList *list = constLists.at(distribution(generator)).get();
+
+                StarBlockFactory::Pins pins;
+                const QVector<std::shared_ptr<StarBlock>> pinned = pins.pin(list);
+
+                int failed = verify(list, pinned);
+                QThread::yieldCurrentThread();
+                failed += verify(list, pinned);
+
+                if (failed > 0)
+                    failures.fetchAndAddRelaxed(failed);
+                reads.ref();
+            }
+        });
+    }
+
+    // This thread fills the lists, like the GUI thread publishing the blocks of StarBlockLoader
+    std::mt19937 generator(readers);
+    std::uniform_int_distribution<int> distribution(0, TRIXELS - 1);
+    for (int round = 0; round < rounds; ++round)
+    {
+        grow(lists.at(distribution(generator)).get());
+        if (round % 64 == 0)
+            SBFactory->trim();
+    }
+
+    stop.store(1);
+    for (auto &future : futures)
+        future.waitForFinished();
+
+    const StarBlockFactory::Statistics stats = SBFactory->statistics();
+
+    QCOMPARE(failures.load(), 0);
+    QVERIFY(reads.load() > 0);
+    QVERIFY(stats.evictions > evictions);
+    QCOMPARE(stats.pinnedBlocks, 0);
+    // Slabs beyond the budget are only allocated while every block of a shard is pinned
+    QVERIFY(stats.blocks <= 2 * budgetBlocks);
+    QVERIFY(stats.bytes <= 2 * stats.budget);
+}
+
+QTEST_GUILESS_MAIN(TestStarBlockFactory)
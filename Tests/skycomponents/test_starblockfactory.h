@@ -0,0 +1,61 @@
+/***************************************************************************
+                  test_starblockfactory.h  -  KStars Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#pragma once
+
+#include "typedef.h"
+
+#include <QObject>
+#include <QVector>
+
+#include <memory>
+
+class StarBlock;
+class StarBlockList;
+
+/**
+ * @class TestStarBlockFactory
+ * @short Stress tests for the cache of StarBlocks, with threads reading pinned blocks while the lists are filled
+ */
+class TestStarBlockFactory : public QObject
+{
+    Q_OBJECT
+
+  public:
+    TestStarBlockFactory();
+    ~TestStarBlockFactory() override = default;
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+    void testRecycleUnpinned();
+
+    void testConcurrentReaders_data();
+    void testConcurrentReaders();
+
+  private:
+    /** Append a block of synthetic stars to a list, as the loader does, @return false if the list is full */
+    bool grow(StarBlockList *list);
+
+    /** @return the number of pinned blocks and stars of a list that are not the expected ones */
+    static int verify(StarBlockList *list, const QVector<std::shared_ptr<StarBlock>> &blocks);
+
+    QVector<std::shared_ptr<StarBlockList>> lists;
+    quint64 savedBudget { 0 };
+    /** Budget of the tests, in blocks */
+    int budgetBlocks { 0 };
+};
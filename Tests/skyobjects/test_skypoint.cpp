@@ -21,6 +21,11 @@
 #include "time/kstarsdatetime.h"
 #include "auxiliary/dms.h"
 #include "Options.h"
+#include "kstarsdata.h"
+#include "skycomponents/starblock.h"
+#include "skycomponents/starcoordinateengine.h"
+#include "skyobjects/stardata.h"
+#include "skyobjects/starobject.h"
 #include <libnova/libnova.h>
 TestSkyPoint::TestSkyPoint() : QObject()
 {
@@ -477,6 +482,104 @@ void TestSkyPoint::compareSkyPointLibNova()
     compare("original", Ra, Dec, sp.RA0.Hours(), sp.Dec0.Degrees());
 }
 
+void TestSkyPoint::testStarCoordinateEngine_data()
+{
+    QTest::addColumn<double>("Epoch");
+    QTest::addColumn<double>("Ra");
+    QTest::addColumn<double>("Dec");
+    QTest::addColumn<double>("PmRa");
+    QTest::addColumn<double>("PmDec");
+
+    QTest::newRow("no proper motion") << 2021.5 << 4.0 << 20.0 << 0.0 << 0.0;
+    QTest::newRow("south") << 2021.5 << 10.0 << -55.0 << 12.5 << -30.0;
+    QTest::newRow("near Pole") << 2021.5 << 22.0 << 85.0 << 40.0 << 40.0;
+    QTest::newRow("near S Pole") << 2021.5 << 15.0 << -85.0 << -25.0 << 10.0;
+    QTest::newRow("Barnard's star") << 2021.5 << 17.963472 << 4.693391 << -798.58 << 10328.12;
+    QTest::newRow("Barnard's star, far epoch") << 4500.0 << 17.963472 << 4.693391 << -798.58 << 10328.12;
+}
+
+void TestSkyPoint::testStarCoordinateEngine()
+{
+    QFETCH(double, Epoch);
+    QFETCH(double, Ra);
+    QFETCH(double, Dec);
+    QFETCH(double, PmRa);
+    QFETCH(double, PmDec);
+
+    Options::setUseRelativistic(false);
+
+    // StarObject::JITupdate() takes the time and place from KStarsData
+    KStarsData *kd = KStarsData::Instance() ? KStarsData::Instance() : KStarsData::Create();
+    // Changing the update IDs resets the numbers, so set them afterwards
+    kd->incUpdateID();
+    *kd->updateNum() = KSNumbers(KStarsDateTime::epochToJd(Epoch));
+    kd->lst()->setD(Ra * 15.0 + 37.0);
+    kd->geo()->setLat(dms(43.5));
+
+    // A full chunk of the engine and a partial one, spread around the position of the row
+    const int count = 67;
+    StarBlock block(count);
+    for (int i = 0; i < count; ++i)
+    {
+        StarData data;
+        data.RA           = qRound(fmod(Ra + 0.37 * i, 24.0) * 1000000.0);
+        data.Dec          = qRound((Dec + 0.3 * (i % 11 - 5)) * 100000.0);
+        data.dRA          = qRound(PmRa * (1.0 + 0.1 * (i % 7)) * 10.0);
+        data.dDec         = qRound(PmDec * (1.0 - 0.1 * (i % 5)) * 10.0);
+        data.mag          = 500 + 10 * i;
+        data.spec_type[0] = 'G';
+        data.spec_type[1] = '2';
+        QVERIFY(block.addStar(data) != nullptr);
+    }
+    QCOMPARE(block.getStarCount(), count);
+
+    // Reference: the star by star update done by StarObject::JITupdate()
+    QVector<StarObject> reference;
+    for (int i = 0; i < count; ++i)
+        reference.append(StarObject(*block.star(i)));
+
+    auto compareStars = [&](const QString &msg)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            StarObject *star = block.star(i);
+            reference[i].JITupdate();
+
+            QCOMPARE(star->updateID, reference[i].updateID);
+            QCOMPARE(star->updateNumID, reference[i].updateNumID);
+            QCOMPARE(star->getLastPrecessJD(), reference[i].getLastPrecessJD());
+
+            // Within an arcsecond of the reference, which uses the full nutation series of libnova
+            compare(QString("%1 star %2").arg(msg).arg(i), reference[i].ra().Degrees(), reference[i].dec().Degrees(),
+                    star->ra().Degrees(), star->dec().Degrees(), 1.0 / 3600.0);
+            QVERIFY(fabs(star->ra().sin() - sin(star->ra().radians())) < 1e-12);
+            QVERIFY(fabs(star->dec().cos() - cos(star->dec().radians())) < 1e-12);
+
+            const double dAlt = star->alt().Degrees() - reference[i].alt().Degrees();
+            const double dAz  = std::remainder(star->az().Degrees() - reference[i].az().Degrees(), 360.0);
+            QVERIFY2(fabs(dAlt) < 1.0 / 3600.0, qPrintable(QString("%1 star %2 Alt error %3 secs").arg(msg).arg(i).arg(dAlt * 3600.0)));
+            QVERIFY2(fabs(dAz) * cos(reference[i].alt().radians()) < 1.0 / 3600.0,
+                     qPrintable(QString("%1 star %2 Az error %3 secs").arg(msg).arg(i).arg(dAz * 3600.0)));
+        }
+    };
+
+    StarCoordinateEngine(kd->updateNum(), kd->lst(), kd->geo()->lat())
+        .update(&block, 99.0, kd->updateID(), kd->updateNumID());
+    compareStars("engine");
+    if (QTest::currentTestFailed())
+        return;
+
+    // A second update at the same time of the next sidereal hour only refreshes the horizontal coordinates
+    kd->incUpdateID();
+    *kd->updateNum() = KSNumbers(KStarsDateTime::epochToJd(Epoch));
+    kd->lst()->setD(kd->lst()->Degrees() + 15.0);
+    StarCoordinateEngine(kd->updateNum(), kd->lst(), kd->geo()->lat())
+        .update(&block, 99.0, kd->updateID(), kd->updateNumID());
+    compareStars("second update");
+
+    Options::setUseRelativistic(useRelativistic);
+}
+
 void TestSkyPoint::compare(QString msg, SkyPoint *sp, SkyPoint *sp1)
 {
     compare(msg, sp->ra0().Degrees(), sp->dec0().Degrees(), sp1->ra().Degrees(), sp1->dec().Degrees());
@@ -70,6 +70,9 @@ class TestSkyPoint : public QObject
         void compareSkyPointLibNova_data();
         void compareSkyPointLibNova();
 
+        void testStarCoordinateEngine_data();
+        void testStarCoordinateEngine();
+
     private:
         bool useRelativistic {false};
 };
@@ -24,14 +24,30 @@
 #include "starobject.h"
 #include "deepskyobject.h"
 #include "skycomponent.h"
+#include "htmesh/HTMesh.h"
 
 #include <QSqlField>
 #include <QSqlQuery>
 #include <QSqlRecord>
 #include <QSqlTableModel>
+#include <QThread>
 
 #include <catalog_debug.h>
 
+namespace
+{
+// Rows added to the database per transaction when importing a catalog
+const int BATCH_SIZE = 10000;
+
+// Entries closer than this in RA and Dec, in degrees, and in magnitude, are taken as the same object
+const double FUZZ_POSITION  = 0.0016;
+const double FUZZ_MAGNITUDE = 0.1;
+}
+
+CatalogDB::CatalogDB() : mesh_(new HTMesh(TRIXEL_LEVEL, TRIXEL_LEVEL))
+{
+}
+
 bool CatalogDB::Initialize()
 {
     skydb_ = QSqlDatabase::addDatabase("QSQLITE", "skydb");
@@ -52,6 +68,7 @@ bool CatalogDB::Initialize()
         qCWarning(KSTARS_CATALOG) << "DSO DB does not exist!";
         first_run = true;
     }
+    dbfile_ = dbfile;
     skydb_.setDatabaseName(dbfile);
     if (!skydb_.open())
     {
@@ -65,6 +82,7 @@ bool CatalogDB::Initialize()
         {
             FirstRun();
         }
+        UpgradeSchema();
     }
     skydb_.close();
     return true;
@@ -113,7 +131,8 @@ void CatalogDB::FirstRun()
                   "Add1 VARCHAR DEFAULT NULL,"
                   "Add2 INTEGER DEFAULT NULL,"
                   "Add3 INTEGER DEFAULT NULL,"
-                  "Add4 INTEGER DEFAULT NULL)");
+                  "Add4 INTEGER DEFAULT NULL,"
+                  "Trixel INTEGER DEFAULT NULL)");
 
     for (int i = 0; i < tables.count(); ++i)
     {
@@ -126,6 +145,65 @@ void CatalogDB::FirstRun()
     qCWarning(KSTARS_CATALOG) << "Additional Sky Catalog Database rebuilt.";
 }
 
+void CatalogDB::UpgradeSchema()
+{
+    QSqlQuery query(skydb_);
+
+    bool has_trixel = false;
+    if (query.exec("PRAGMA table_info(DSO)"))
+    {
+        while (query.next() && !has_trixel)
+            has_trixel = (query.value(1).toString() == "Trixel");
+    }
+
+    if (!has_trixel)
+    {
+        qCInfo(KSTARS_CATALOG) << "Adding the trixels of the objects to the DSO database";
+        if (!query.exec("ALTER TABLE DSO ADD COLUMN Trixel INTEGER DEFAULT NULL"))
+            qCWarning(KSTARS_CATALOG) << query.lastError();
+    }
+
+    // Rows of older databases, or rows added by older versions
+    QVector<QPair<int, Trixel>> trixels;
+    if (query.exec("SELECT UID, RA, Dec FROM DSO WHERE Trixel IS NULL"))
+    {
+        while (query.next())
+            trixels.append(qMakePair(query.value(0).toInt(), FindTrixel(query.value(1).toDouble(), query.value(2).toDouble())));
+    }
+
+    if (!trixels.isEmpty())
+    {
+        skydb_.transaction();
+        QSqlQuery update_query(skydb_);
+        update_query.prepare("UPDATE DSO SET Trixel = :trixel WHERE UID = :uid");
+        for (const auto &trixel : trixels)
+        {
+            update_query.bindValue(":trixel", trixel.second);
+            update_query.bindValue(":uid", trixel.first);
+            if (!update_query.exec())
+                qCWarning(KSTARS_CATALOG) << update_query.lastError();
+        }
+        skydb_.commit();
+        qCInfo(KSTARS_CATALOG) << "Indexed" << trixels.size() << "objects of the DSO database by trixel";
+    }
+
+    QStringList indexes;
+    indexes.append("CREATE INDEX IF NOT EXISTS DSO_Trixel ON DSO (Trixel, RA, Dec)");
+    indexes.append("CREATE INDEX IF NOT EXISTS ObjectDesignation_Catalog ON ObjectDesignation (id_Catalog, UID_DSO)");
+    indexes.append("CREATE INDEX IF NOT EXISTS ObjectDesignation_DSO ON ObjectDesignation (UID_DSO)");
+
+    for (const auto &index : indexes)
+    {
+        if (!query.exec(index))
+            qCWarning(KSTARS_CATALOG) << query.lastError();
+    }
+}
+
+Trixel CatalogDB::FindTrixel(const double ra, const double dec) const
+{
+    return mesh_->index(ra, dec);
+}
+
 CatalogDB::~CatalogDB()
 {
     skydb_.close();
@@ -260,38 +338,71 @@ void CatalogDB::ClearDSOEntries(int catalog_id)
     skydb_.close();
 }
 
+CatalogDB::EntryQueries::EntryQueries(const QSqlDatabase &db)
+    : find_fuzzy(db), add_dso(db), add_designation(db), add_designation_next_id(db)
+{
+    find_fuzzy.prepare("SELECT UID FROM DSO WHERE Trixel = :trixel AND"
+                       " RA BETWEEN :ra_min AND :ra_max AND Dec BETWEEN :dec_min AND :dec_max AND"
+                       " Magnitude BETWEEN :mag_min AND :mag_max LIMIT 1");
+    add_dso.prepare("INSERT INTO DSO (RA, Dec, Type, Magnitude, PositionAngle,"
+                    " MajorAxis, MinorAxis, Flux, Trixel) VALUES (:RA, :Dec, :Type,"
+                    " :Magnitude, :PositionAngle, :MajorAxis, :MinorAxis,"
+                    " :Flux, :Trixel)");
+    add_designation.prepare("INSERT INTO ObjectDesignation (id_Catalog, UID_DSO, LongName"
+                            ", IDNumber) VALUES (:catid, :rowuid, :longname, :id)");
+    add_designation_next_id.prepare("INSERT INTO ObjectDesignation (id_Catalog, UID_DSO, LongName"
+                                    ", IDNumber) VALUES (:catid, :rowuid, :longname,"
+                                    "(SELECT MAX(ISNULL(IDNumber,1))+1 FROM ObjectDesignation WHERE id_Catalog = :catid) )");
+}
+
 int CatalogDB::FindFuzzyEntry(const double ra, const double dec, const double magnitude)
+{
+    EntryQueries queries(skydb_);
+    return FindFuzzyEntry(ra, dec, magnitude, queries.find_fuzzy);
+}
+
+int CatalogDB::FindFuzzyEntry(const double ra, const double dec, const double magnitude, QSqlQuery &find_fuzzy)
 {
     /*
      * FIXME (spacetime): Match the incoming entry with the ones from the db
      * with certain fuzz. If found, store it in rowuid
      * This Fuzz has not been established after due discussion
     */
-    //skydb_.open();
-    QSqlTableModel dsoentries(nullptr, skydb_);
-
-    QString filter = "((RA - " + QString().setNum(ra) +
-                     ") between -0.0016 and 0.0016) and "
-                     "((Dec - " +
-                     QString().setNum(dec) +
-                     ") between -0.0016 and 0.0016) and"
-                     "((Magnitude - " +
-                     QString().setNum(magnitude) + ") between -0.1 and 0.1)";
-    //   qDebug() << filter;
-    dsoentries.setTable("DSO");
-    dsoentries.setFilter(filter);
-    dsoentries.select();
-
-    int entry_count   = dsoentries.rowCount();
-    QSqlRecord record = dsoentries.record(0);
+
+    // The fuzz box is much smaller than a trixel, so that it overlaps a few trixels at most
+    QVector<Trixel> trixels;
+    const double corners[4][2] = { { ra - FUZZ_POSITION, dec - FUZZ_POSITION },
+                                   { ra - FUZZ_POSITION, dec + FUZZ_POSITION },
+                                   { ra + FUZZ_POSITION, dec - FUZZ_POSITION },
+                                   { ra + FUZZ_POSITION, dec + FUZZ_POSITION } };
+    for (const auto &corner : corners)
+    {
+        const Trixel trixel = FindTrixel(corner[0], qBound(-90.0, corner[1], 90.0));
+        if (!trixels.contains(trixel))
+            trixels.append(trixel);
+    }
+
+    find_fuzzy.bindValue(":ra_min", ra - FUZZ_POSITION);
+    find_fuzzy.bindValue(":ra_max", ra + FUZZ_POSITION);
+    find_fuzzy.bindValue(":dec_min", dec - FUZZ_POSITION);
+    find_fuzzy.bindValue(":dec_max", dec + FUZZ_POSITION);
+    find_fuzzy.bindValue(":mag_min", magnitude - FUZZ_MAGNITUDE);
+    find_fuzzy.bindValue(":mag_max", magnitude + FUZZ_MAGNITUDE);
 
     int returnval = -1;
-    if (entry_count > 0)
-        returnval = record.value("UID").toInt();
+    for (int i = 0; i < trixels.size() && returnval == -1; ++i)
+    {
+        find_fuzzy.bindValue(":trixel", trixels.at(i));
+        if (!find_fuzzy.exec())
+        {
+            qCWarning(KSTARS_CATALOG) << find_fuzzy.lastError();
+            break;
+        }
+        if (find_fuzzy.next())
+            returnval = find_fuzzy.value(0).toInt();
+        find_fuzzy.finish();
+    }
 
-    dsoentries.clear();
-    //skydb_.close();
-    //   qDebug() << returnval;
     return returnval;
 }
 
@@ -303,12 +414,16 @@ bool CatalogDB::AddEntry(const CatalogEntryData &catalog_entry, int catid)
         qCWarning(KSTARS_CATALOG) << LastError();
         return false;
     }
-    bool retVal = _AddEntry(catalog_entry, catid);
+    bool retVal;
+    {
+        EntryQueries queries(skydb_);
+        retVal = _AddEntry(catalog_entry, catid, queries);
+    }
     skydb_.close();
     return retVal;
 }
 
-bool CatalogDB::_AddEntry(const CatalogEntryData &catalog_entry, int catid)
+bool CatalogDB::_AddEntry(const CatalogEntryData &catalog_entry, int catid, EntryQueries &queries)
 {
     // Verification step
     // If RA, Dec are Null, it denotes an invalid object and should not be written
@@ -329,16 +444,12 @@ bool CatalogDB::_AddEntry(const CatalogEntryData &catalog_entry, int catid)
     // out the lastInsertId
 
     // Part 2: Fuzzy Match or Create New Entry
-    int rowuid = FindFuzzyEntry(catalog_entry.ra, catalog_entry.dec, catalog_entry.magnitude);
+    int rowuid = FindFuzzyEntry(catalog_entry.ra, catalog_entry.dec, catalog_entry.magnitude, queries.find_fuzzy);
     //skydb_.open();
 
     if (rowuid == -1) //i.e. No fuzzy match found. Proceed to add new entry
     {
-        QSqlQuery add_query(skydb_);
-        add_query.prepare("INSERT INTO DSO (RA, Dec, Type, Magnitude, PositionAngle,"
-                          " MajorAxis, MinorAxis, Flux) VALUES (:RA, :Dec, :Type,"
-                          " :Magnitude, :PositionAngle, :MajorAxis, :MinorAxis,"
-                          " :Flux)");
+        QSqlQuery &add_query = queries.add_dso;
         add_query.bindValue(":RA", catalog_entry.ra);
         add_query.bindValue(":Dec", catalog_entry.dec);
         add_query.bindValue(":Type", catalog_entry.type);
@@ -347,6 +458,7 @@ bool CatalogDB::_AddEntry(const CatalogEntryData &catalog_entry, int catid)
         add_query.bindValue(":MajorAxis", catalog_entry.major_axis);
         add_query.bindValue(":MinorAxis", catalog_entry.minor_axis);
         add_query.bindValue(":Flux", catalog_entry.flux);
+        add_query.bindValue(":Trixel", FindTrixel(catalog_entry.ra, catalog_entry.dec));
         if (!add_query.exec())
         {
             qCWarning(KSTARS_CATALOG) << "Custom Catalog Insert Query FAILED!";
@@ -356,7 +468,7 @@ bool CatalogDB::_AddEntry(const CatalogEntryData &catalog_entry, int catid)
 
         // Find UID of the Row just added
         rowuid = add_query.lastInsertId().toInt();
-        add_query.clear();
+        add_query.finish();
     }
     int ID = catalog_entry.ID;
 
@@ -374,20 +486,12 @@ bool CatalogDB::_AddEntry(const CatalogEntryData &catalog_entry, int catid)
 
     // Part 3: Add in Object Designation
     //skydb_.open();
-    QSqlQuery add_od(skydb_);
+    QSqlQuery &add_od = (ID >= 0) ? queries.add_designation : queries.add_designation_next_id;
     if (ID >= 0)
     {
-        add_od.prepare("INSERT INTO ObjectDesignation (id_Catalog, UID_DSO, LongName"
-                       ", IDNumber) VALUES (:catid, :rowuid, :longname, :id)");
         add_od.bindValue(":id", ID);
     }
-    else
-    {
-        //qWarning() << "FIXME: This query has not been tested!!!!";
-        add_od.prepare("INSERT INTO ObjectDesignation (id_Catalog, UID_DSO, LongName"
-                       ", IDNumber) VALUES (:catid, :rowuid, :longname,"
-                       "(SELECT MAX(ISNULL(IDNumber,1))+1 FROM ObjectDesignation WHERE id_Catalog = :catid) )");
-    }
+    //else qWarning() << "FIXME: This query has not been tested!!!!";
     add_od.bindValue(":catid", catid);
     add_od.bindValue(":rowuid", rowuid);
     add_od.bindValue(":longname", catalog_entry.long_name);
@@ -399,7 +503,7 @@ bool CatalogDB::_AddEntry(const CatalogEntryData &catalog_entry, int catid)
         qWarning() << skydb_.lastError();
         retVal = false;
     }
-    add_od.clear();
+    add_od.finish();
     //skydb_.close();
 
     return retVal;
@@ -543,39 +647,54 @@ bool CatalogDB::AddCatalogContents(const QString &fname)
         QList<QPair<QString, KSParser::DataTypes>> sequence = buildParserSequence(columns);
 
         // Part 2) Read file and store into DB
-        KSParser catalog_text_parser(filename, '#', sequence, delimiter);
-
         int catid = FindCatalog(catalog_name);
 
         skydb_.open();
         skydb_.transaction();
 
-        QHash<QString, QVariant> row_content;
-        while (catalog_text_parser.HasNextRow())
+        // The statements are prepared once, the rows are committed in batches
+        EntryQueries queries(skydb_);
+        int rows = 0;
+
+        // The file is parsed on several threads, the blocks of rows are stored here in order
+        auto store_rows = [&](const KSParser::Columns &columns)
         {
-            row_content = catalog_text_parser.ReadNextRow();
-
-            CatalogEntryData catalog_entry;
-
-            dms read_ra(row_content["RA"].toString(), false);
-            dms read_dec(row_content["Dc"].toString(), true);
-            //qDebug()<<row_content["Nm"].toString();
-            catalog_entry.catalog_name   = catalog_name;
-            catalog_entry.ID             = row_content["ID"].toInt();
-            catalog_entry.long_name      = row_content["Nm"].toString();
-            catalog_entry.ra             = read_ra.Degrees();
-            catalog_entry.dec            = read_dec.Degrees();
-            catalog_entry.type           = row_content["Tp"].toInt();
-            catalog_entry.magnitude      = row_content["Mg"].toFloat();
-            catalog_entry.position_angle = row_content["PA"].toFloat();
-            catalog_entry.major_axis     = row_content["Mj"].toFloat();
-            catalog_entry.minor_axis     = row_content["Mn"].toFloat();
-            catalog_entry.flux           = row_content["Flux"].toFloat();
-
-            _AddEntry(catalog_entry, catid);
-        }
+            const int id = columns.columnIndex("ID"), ra = columns.columnIndex("RA"), dc = columns.columnIndex("Dc"),
+                      nm = columns.columnIndex("Nm"), tp = columns.columnIndex("Tp"), mg = columns.columnIndex("Mg"),
+                      pa = columns.columnIndex("PA"), mj = columns.columnIndex("Mj"), mn = columns.columnIndex("Mn"),
+                      flux = columns.columnIndex("Flux");
+
+            for (int row = 0; row < columns.rowCount(); ++row)
+            {
+                CatalogEntryData catalog_entry;
+
+                dms read_ra(columns.stringValue(ra, row), false);
+                dms read_dec(columns.stringValue(dc, row), true);
+                catalog_entry.catalog_name   = catalog_name;
+                catalog_entry.ID             = columns.stringValue(id, row).toInt();
+                catalog_entry.long_name      = columns.stringValue(nm, row);
+                catalog_entry.ra             = read_ra.Degrees();
+                catalog_entry.dec            = read_dec.Degrees();
+                catalog_entry.type           = columns.intValue(tp, row);
+                catalog_entry.magnitude      = columns.floatValue(mg, row);
+                catalog_entry.position_angle = columns.floatValue(pa, row);
+                catalog_entry.major_axis     = columns.floatValue(mj, row);
+                catalog_entry.minor_axis     = columns.floatValue(mn, row);
+                catalog_entry.flux           = columns.floatValue(flux, row);
+
+                _AddEntry(catalog_entry, catid, queries);
+
+                if (++rows % BATCH_SIZE == 0)
+                {
+                    skydb_.commit();
+                    skydb_.transaction();
+                }
+            }
+        };
+        KSParser::ReadCSVColumns(filename, '#', sequence, store_rows, delimiter);
 
         skydb_.commit();
+        qCDebug(KSTARS_CATALOG) << "Added" << rows << "rows of catalog" << catalog_name;
         skydb_.close();
     }
     return true;
@@ -920,92 +1039,236 @@ void CatalogDB::GetAllObjects(const QString &catalog, QList<SkyObject *> &sky_li
     }
 
     while (get_query.next())
+        CreateObject(get_query, sky_list, object_names, catalog_ptr, includeCatalogDesignation);
+
+    get_query.clear();
+    skydb_.close();
+}
+
+int CatalogDB::GetObjectsInTrixels(const QString &db_file, int catalog_id, const QVector<Trixel> &trixels,
+                                   QHash<Trixel, QList<SkyObject *>> &sky_lists, CatalogComponent *catalog_ptr,
+                                   bool includeCatalogDesignation)
+{
+    // skydb_ may only be used by the thread of the CatalogDB, the calling thread reads through its own connection
+    const QString connection =
+        QString("skydb_trixels_%1").arg(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+    QList<QPair<int, QString>> object_names;
+    int count = 0;
+
     {
-        int cat_epoch       = get_query.value(0).toInt();
-        unsigned char iType = get_query.value(1).toInt();
-        dms RA(get_query.value(2).toDouble());
-        dms Dec(get_query.value(3).toDouble());
-        float mag                = get_query.value(4).toFloat();
-        QString catPrefix        = get_query.value(5).toString();
-        int id_number_in_catalog = get_query.value(6).toInt();
-        QString lname            = get_query.value(7).toString();
-        float a                  = get_query.value(8).toFloat();
-        float b                  = get_query.value(9).toFloat();
-        float PA                 = get_query.value(10).toFloat();
-        float flux               = get_query.value(11).toFloat();
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection);
+        db.setDatabaseName(db_file);
+        if (!db.open())
+        {
+            qCWarning(KSTARS_CATALOG) << "Unable to open DSO database file!";
+            qCWarning(KSTARS_CATALOG) << db.lastError();
+            count = -1;
+        }
+        else
+        {
+            QSqlQuery get_query(db);
+            get_query.prepare("SELECT Epoch, Type, RA, Dec, Magnitude, Prefix, "
+                              "IDNumber, LongName, MajorAxis, MinorAxis, "
+                              "PositionAngle, Flux FROM DSO "
+                              "JOIN ObjectDesignation ON ObjectDesignation.UID_DSO = DSO.UID "
+                              "JOIN Catalog ON ObjectDesignation.id_Catalog = Catalog.id "
+                              "WHERE DSO.Trixel = :trixel AND Catalog.id = :catID");
+            get_query.bindValue(":catID", catalog_id);
+
+            for (Trixel trixel : trixels)
+            {
+                get_query.bindValue(":trixel", trixel);
+                if (!get_query.exec())
+                {
+                    qCWarning(KSTARS_CATALOG) << get_query.lastQuery();
+                    qCWarning(KSTARS_CATALOG) << get_query.lastError();
+                    count = -1;
+                    break;
+                }
+
+                QList<SkyObject *> &sky_list = sky_lists[trixel];
+                while (get_query.next())
+                {
+                    CreateObject(get_query, sky_list, object_names, catalog_ptr, includeCatalogDesignation);
+                    ++count;
+                }
+                get_query.finish();
+            }
+
+            get_query.clear();
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connection);
+
+    return count;
+}
+
+void CatalogDB::GetObjectNames(const QString &catalog, QList<QPair<int, QString>> &object_names,
+                               QHash<QString, Trixel> &name_trixels, bool includeCatalogDesignation)
+{
+    const int catalog_id = FindCatalog(catalog);
+
+    skydb_.open();
+    QSqlQuery get_query(skydb_);
+    get_query.setForwardOnly(true);
+    get_query.prepare("SELECT Type, Prefix, IDNumber, LongName, Trixel FROM DSO "
+                      "JOIN ObjectDesignation ON ObjectDesignation.UID_DSO = DSO.UID "
+                      "JOIN Catalog ON ObjectDesignation.id_Catalog = Catalog.id "
+                      "WHERE Catalog.id = :catID");
+    get_query.bindValue(":catID", catalog_id);
+
+    if (!get_query.exec())
+    {
+        qCWarning(KSTARS_CATALOG) << get_query.lastQuery();
+        qCWarning(KSTARS_CATALOG) << get_query.lastError();
+    }
+
+    while (get_query.next())
+    {
+        const int iType     = get_query.value(0).toInt();
+        const Trixel trixel = get_query.value(4).toInt();
+        QString lname       = get_query.value(3).toString();
         QString name;
 
+        // Names as CreateObject() gives them to the objects
         if (!includeCatalogDesignation && !lname.isEmpty())
         {
             name  = lname;
             lname = QString();
         }
         else
-            name = catPrefix + ' ' + QString::number(id_number_in_catalog);
+            name = get_query.value(1).toString() + ' ' + QString::number(get_query.value(2).toInt());
 
-        SkyPoint t;
-        t.set(RA, Dec);
-
-        if (cat_epoch == 1950)
+        if (iType != 0 && !name.isEmpty())
         {
-            // Assume B1950 epoch
-            t.B1950ToJ2000(); // t.ra() and t.dec() are now J2000.0
-            // coordinates
+            object_names.append(qMakePair(iType, name));
+            name_trixels.insert(name, trixel);
         }
-        else if (cat_epoch == 2000)
+
+        if (!lname.isEmpty() && lname != name)
         {
-            // Do nothing
-            {
-            }
+            object_names.append(qMakePair(iType, lname));
+            name_trixels.insert(lname, trixel);
         }
-        else
+    }
+
+    get_query.clear();
+    skydb_.close();
+}
+
+int CatalogDB::GetObjectCount(const QString &catalog_name)
+{
+    const int catalog_id = FindCatalog(catalog_name);
+
+    skydb_.open();
+    QSqlQuery count_query(skydb_);
+    count_query.prepare("SELECT COUNT(*) FROM ObjectDesignation WHERE id_Catalog = :catID");
+    count_query.bindValue(":catID", catalog_id);
+
+    int count = 0;
+    if (count_query.exec() && count_query.next())
+        count = count_query.value(0).toInt();
+    else
+        qCWarning(KSTARS_CATALOG) << count_query.lastError();
+
+    count_query.clear();
+    skydb_.close();
+
+    return count;
+}
+
+SkyObject *CatalogDB::CreateObject(const QSqlQuery &get_query, QList<SkyObject *> &sky_list,
+                                   QList<QPair<int, QString>> &object_names, CatalogComponent *catalog_ptr,
+                                   bool includeCatalogDesignation)
+{
+    int cat_epoch       = get_query.value(0).toInt();
+    unsigned char iType = get_query.value(1).toInt();
+    dms RA(get_query.value(2).toDouble());
+    dms Dec(get_query.value(3).toDouble());
+    float mag                = get_query.value(4).toFloat();
+    QString catPrefix        = get_query.value(5).toString();
+    int id_number_in_catalog = get_query.value(6).toInt();
+    QString lname            = get_query.value(7).toString();
+    float a                  = get_query.value(8).toFloat();
+    float b                  = get_query.value(9).toFloat();
+    float PA                 = get_query.value(10).toFloat();
+    float flux               = get_query.value(11).toFloat();
+    QString name;
+
+    if (!includeCatalogDesignation && !lname.isEmpty())
+    {
+        name  = lname;
+        lname = QString();
+    }
+    else
+        name = catPrefix + ' ' + QString::number(id_number_in_catalog);
+
+    SkyPoint t;
+    t.set(RA, Dec);
+
+    if (cat_epoch == 1950)
+    {
+        // Assume B1950 epoch
+        t.B1950ToJ2000(); // t.ra() and t.dec() are now J2000.0
+        // coordinates
+    }
+    else if (cat_epoch == 2000)
+    {
+        // Do nothing
         {
-            // FIXME: What should we do?
-            // FIXME: This warning will be printed for each line in the
-            //        catalog rather than once for the entire catalog
-            qWarning() << "Unknown epoch while dealing with custom "
-                          "catalog. Will ignore the epoch and assume"
-                          " J2000.0";
         }
+    }
+    else
+    {
+        // FIXME: What should we do?
+        // FIXME: This warning will be printed for each line in the
+        //        catalog rather than once for the entire catalog
+        qWarning() << "Unknown epoch while dealing with custom "
+                      "catalog. Will ignore the epoch and assume"
+                      " J2000.0";
+    }
 
-        RA  = t.ra();
-        Dec = t.dec();
+    RA  = t.ra();
+    Dec = t.dec();
 
-        // FIXME: It is a bad idea to create objects in one class
-        // (using new) and delete them in another! The objects created
-        // here are usually deleted by CatalogComponent! See
-        // CatalogComponent::loadData for more information!
+    SkyObject *object = nullptr;
 
-        if (iType == 0) // Add a star
-        {
-            StarObject *o = new StarObject(RA, Dec, mag, lname);
+    // FIXME: It is a bad idea to create objects in one class
+    // (using new) and delete them in another! The objects created
+    // here are usually deleted by CatalogComponent! See
+    // CatalogComponent::loadData for more information!
 
-            sky_list.append(o);
-        }
-        else // Add a deep-sky object
-        {
-            DeepSkyObject *o = new DeepSkyObject(iType, RA, Dec, mag, name, QString(), lname, catPrefix, a, b, -PA);
+    if (iType == 0) // Add a star
+    {
+        StarObject *o = new StarObject(RA, Dec, mag, lname);
 
-            o->setFlux(flux);
-            o->setCustomCatalog(catalog_ptr);
+        sky_list.append(o);
+        object = o;
+    }
+    else // Add a deep-sky object
+    {
+        DeepSkyObject *o = new DeepSkyObject(iType, RA, Dec, mag, name, QString(), lname, catPrefix, a, b, -PA);
 
-            sky_list.append(o);
+        o->setFlux(flux);
+        o->setCustomCatalog(catalog_ptr);
 
-            // Add name to the list of object names
-            if (!name.isEmpty())
-            {
-                object_names.append(qMakePair<int, QString>(iType, name));
-            }
-        }
+        sky_list.append(o);
+        object = o;
 
-        if (!lname.isEmpty() && lname != name)
+        // Add name to the list of object names
+        if (!name.isEmpty())
         {
-            object_names.append(qMakePair<int, QString>(iType, lname));
+            object_names.append(qMakePair<int, QString>(iType, name));
         }
     }
 
-    get_query.clear();
-    skydb_.close();
+    if (!lname.isEmpty() && lname != name)
+    {
+        object_names.append(qMakePair<int, QString>(iType, lname));
+    }
+
+    return object;
 }
 
 QList<QPair<QString, KSParser::DataTypes>> CatalogDB::buildParserSequence(const QStringList &Columns)
@@ -18,6 +18,7 @@
 #pragma once
 
 #include "ksparser.h"
+#include "typedef.h"
 
 #include <KLocalizedString>
 #if !defined(ANDROID)
@@ -26,7 +27,11 @@
 
 #include <QSqlDatabase>
 #include <QSqlError>
+#include <QSqlQuery>
 
+#include <memory>
+
+class HTMesh;
 class SkyObject;
 class CatalogComponent;
 class CatalogData;
@@ -38,11 +43,20 @@ class CatalogEntryData;
  *    hence, the uid is a qint64 i.e. a 64 bit signed integer. Coincidentally,
  *    this is the max limit of an int in Sqlite3.
  *    Hence, the db is compatible with the uid, but doesn't use it as of now.
+ * 2) Each DSO row holds the HTM trixel of its position, at the level of the
+ *    SkyMesh of SkyMapComposite, so that the objects of a region of the sky
+ *    can be selected through an index. Older databases get the column, and
+ *    the trixels of their rows, the first time they are opened.
  */
 
 class CatalogDB
 {
   public:
+    /** @brief Level of the HTM mesh of the trixels of the DSO table, the one of the SkyMesh of SkyMapComposite */
+    static const int TRIXEL_LEVEL = 3;
+
+    CatalogDB();
+
     /**
      * @brief Initializes the database and sets up pointers to Catalog DB
      * Performs the following actions:
@@ -105,6 +119,15 @@ class CatalogDB
      **/
     int FindFuzzyEntry(const double ra, const double dec, const double magnitude);
 
+    /**
+     * @brief Returns the trixel of a position in the DSO table
+     *
+     * @param ra Right Ascension in degrees
+     * @param dec Declination in degrees
+     * @return Trixel
+     **/
+    Trixel FindTrixel(const double ra, const double dec) const;
+
     /**
      * @brief Removes the catalog from the database and refreshes the listing.
      *
@@ -133,6 +156,57 @@ class CatalogDB
                        QList<QPair<int, QString>> &object_names, CatalogComponent *catalog_pointer,
                        bool includeCatalogDesignation = true);
 
+    /**
+     * @brief Creates the objects of a catalog in the given trixels, like GetAllObjects()
+     *
+     * Only the rows of the trixels are read, through the index of the DSO table. This
+     * lets large catalogs be loaded piecewise, as their regions of the sky are drawn.
+     *
+     * @note This method may be called from any thread, independently of the lifetime of the
+     * CatalogDB: the rows are read through a database connection of the calling thread.
+     *
+     * @param db_file Path of the database file, see DatabaseFile()
+     * @param catalog_id Database ID of the catalog whose objects are needed, see FindCatalog()
+     * @param trixels Trixels to load, at level TRIXEL_LEVEL
+     * @param sky_lists Objects of each trixel read (assigns, appending to existing lists)
+     * @param catalog_pointer pointer to the catalogcomponent objects
+     * @param includeCatalogDesignation See GetAllObjects()
+     * @return the number of objects created, or -1 if the database could not be read. The trixels
+     * not read are missing from sky_lists.
+     **/
+    static int GetObjectsInTrixels(const QString &db_file, int catalog_id, const QVector<Trixel> &trixels,
+                                   QHash<Trixel, QList<SkyObject *>> &sky_lists, CatalogComponent *catalog_pointer,
+                                   bool includeCatalogDesignation = true);
+
+    /**
+     * @brief Path of the database file, set by Initialize()
+     *
+     * @return QString
+     **/
+    inline QString DatabaseFile() const { return dbfile_; }
+
+    /**
+     * @brief Returns the names of the objects of a catalog, without creating the objects
+     *
+     * The names are those GetAllObjects() lists for the objects it creates.
+     *
+     * @param catalog_name Name of the catalog
+     * @param object_names List of named objects in database (appends)
+     * @param name_trixels Trixel of the object of each name (assigns)
+     * @param includeCatalogDesignation See GetAllObjects()
+     * @return void
+     **/
+    void GetObjectNames(const QString &catalog_name, QList<QPair<int, QString>> &object_names,
+                        QHash<QString, Trixel> &name_trixels, bool includeCatalogDesignation = true);
+
+    /**
+     * @brief Returns the number of objects of a catalog
+     *
+     * @param catalog_name Name of the catalog
+     * @return int
+     **/
+    int GetObjectCount(const QString &catalog_name);
+
     /**
      * @brief Get information about the catalog like Prefix etc
      *
@@ -193,6 +267,19 @@ class CatalogDB
     void AddCatalog(const CatalogData &catalog_data);
 
   private:
+    /**
+     * @brief Statements adding entries, prepared once for all the entries of a catalog
+     **/
+    struct EntryQueries
+    {
+        explicit EntryQueries(const QSqlDatabase &db);
+
+        QSqlQuery find_fuzzy;
+        QSqlQuery add_dso;
+        QSqlQuery add_designation;
+        QSqlQuery add_designation_next_id;
+    };
+
     /**
      * @brief Used to add a cross referenced entry into the database
      *
@@ -201,15 +288,47 @@ class CatalogDB
      *
      * @param catalog_entry Data structure with entry details
      * @param catid Category ID in the database
+     * @param queries Prepared statements of the opened DB
      * @return false if adding was unsuccessful
      **/
-    bool _AddEntry(const CatalogEntryData &catalog_entry, int catid);
+    bool _AddEntry(const CatalogEntryData &catalog_entry, int catid, EntryQueries &queries);
+
+    /**
+     * @brief FindFuzzyEntry() with the prepared statement of an opened DB
+     **/
+    int FindFuzzyEntry(const double ra, const double dec, const double magnitude, QSqlQuery &find_fuzzy);
+
+    /**
+     * @brief Creates the SkyObject of a row of the queries of GetAllObjects()
+     *
+     * @return the object, also appended to sky_list
+     **/
+    static SkyObject *CreateObject(const QSqlQuery &query, QList<SkyObject *> &sky_list,
+                                   QList<QPair<int, QString>> &object_names, CatalogComponent *catalog_pointer,
+                                   bool includeCatalogDesignation);
+
+    /**
+     * @brief Adds the Trixel column to older databases, fills it, and creates the indexes
+     *
+     * @return void
+     **/
+    void UpgradeSchema();
+
+    /**
+     * @brief Mesh computing the trixels of the DSO table
+     **/
+    std::unique_ptr<HTMesh> mesh_;
 
     /**
      * @brief Database object for the sky object. Assigned and Initialized by Initialize()
      **/
     QSqlDatabase skydb_;
 
+    /**
+     * @brief Path of the database file, for the connections of other threads
+     **/
+    QString dbfile_;
+
     /**
      * @brief Returns the last error the database encountered
      *
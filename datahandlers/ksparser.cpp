@@ -18,6 +18,91 @@
 #include "ksparser.h"
 
 #include <QDebug>
+#include <QFile>
+#include <QFuture>
+#include <QQueue>
+#include <QThreadPool>
+#include <QVarLengthArray>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+// Size of the blocks of lines parsed at once by a thread
+const qint64 BLOCK_SIZE = 4 * 1024 * 1024;
+
+struct Span
+{
+    const char *begin;
+    const char *end;
+};
+
+inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+// Remove the white space around a field, like QString::trimmed()
+inline Span trimmed(Span field)
+{
+    while (field.begin < field.end && isSpace(*field.begin))
+        ++field.begin;
+    while (field.end > field.begin && isSpace(field.end[-1]))
+        --field.end;
+    return field;
+}
+
+// Number of UTF-16 units of the UTF-8 character starting with c, 0 for a continuation byte
+inline int utf16Units(char c)
+{
+    const uchar u = uchar(c);
+    if ((u & 0xC0) == 0x80)
+        return 0;
+    return u >= 0xF0 ? 2 : 1;
+}
+
+// Advance p by the given number of UTF-16 units, like QString::mid() counts them, at most to end
+const char *advanceUnits(const char *p, const char *end, int units)
+{
+    while (p < end && units > 0)
+    {
+        units -= utf16Units(*p);
+        ++p;
+        while (p < end && utf16Units(*p) == 0)
+            ++p;
+    }
+    return p;
+}
+
+int lengthInUnits(const char *begin, const char *end)
+{
+    int length = 0;
+    for (const char *p = begin; p < end; ++p)
+        length += utf16Units(*p);
+    return length;
+}
+
+// Call f with each line between begin and end, without its end-of-line characters
+template <typename Function>
+void forEachLine(const char *begin, const char *end, Function f)
+{
+    for (const char *line = begin; line < end;)
+    {
+        const char *line_end = static_cast<const char *>(std::memchr(line, '\n', end - line));
+        const char *next     = line_end ? line_end + 1 : end;
+
+        if (!line_end)
+            line_end = end;
+        if (line_end > line && line_end[-1] == '\r')
+            --line_end;
+
+        f(line, line_end);
+        line = next;
+    }
+}
+}
 
 const int KSParser::EBROKEN_INT         = 0;
 const double KSParser::EBROKEN_DOUBLE   = 0.0;
@@ -340,3 +425,294 @@ QVariant KSParser::ConvertToQVariant(const QString &input_string, const KSParser
     }
     return converted_object;
 }
+
+KSParser::Columns::Columns(const QList<QPair<QString, DataTypes>> &sequence)
+{
+    columns_.resize(sequence.size());
+    for (int i = 0; i < sequence.size(); ++i)
+    {
+        columns_[i].name = sequence.at(i).first;
+        columns_[i].type = sequence.at(i).second;
+    }
+}
+
+int KSParser::Columns::columnIndex(const QString &name) const
+{
+    for (int i = 0; i < columns_.size(); ++i)
+    {
+        if (columns_.at(i).name == name)
+            return i;
+    }
+    return -1;
+}
+
+const KSParser::Columns::Column *KSParser::Columns::column(int column, DataTypes type) const
+{
+    if (column < 0 || column >= columns_.size() || columns_.at(column).type != type)
+        return nullptr;
+    return &columns_.at(column);
+}
+
+QString KSParser::Columns::stringValue(int column, int row) const
+{
+    const Column *c = this->column(column, D_QSTRING);
+    if (!c)
+        return QString();
+
+    const int begin = row > 0 ? c->ends.at(row - 1) : 0;
+    return QString::fromUtf8(c->text.constData() + begin, c->ends.at(row) - begin);
+}
+
+int KSParser::Columns::intValue(int column, int row) const
+{
+    const Column *c = this->column(column, D_INT);
+    return c ? c->ints.at(row) : EBROKEN_INT;
+}
+
+float KSParser::Columns::floatValue(int column, int row) const
+{
+    const Column *c = this->column(column, D_FLOAT);
+    return c ? c->floats.at(row) : EBROKEN_FLOAT;
+}
+
+double KSParser::Columns::doubleValue(int column, int row) const
+{
+    const Column *c = this->column(column, D_DOUBLE);
+    return c ? c->doubles.at(row) : EBROKEN_DOUBLE;
+}
+
+QVariant KSParser::Columns::value(int column, int row) const
+{
+    if (column < 0 || column >= columns_.size())
+        return QVariant();
+
+    switch (columns_.at(column).type)
+    {
+        case D_QSTRING:
+            return stringValue(column, row);
+        case D_INT:
+            return intValue(column, row);
+        case D_FLOAT:
+            return floatValue(column, row);
+        case D_DOUBLE:
+            return doubleValue(column, row);
+        case D_SKIP:
+        default:
+            return QVariant();
+    }
+}
+
+bool KSParser::ReadCSVColumns(const QString &filename, const char comment_char,
+                              const QList<QPair<QString, DataTypes>> &sequence, const ColumnsConsumer &consumer,
+                              const char delimiter)
+{
+    return ReadColumns(filename, sequence,
+                       [comment_char, delimiter](const char *begin, const char *end, Columns &columns)
+                       {
+                           ParseCSVBlock(begin, end, comment_char, delimiter, columns);
+                       },
+                       consumer);
+}
+
+bool KSParser::ReadFixedWidthColumns(const QString &filename, const char comment_char,
+                                     const QList<QPair<QString, DataTypes>> &sequence, const QList<int> &widths,
+                                     const ColumnsConsumer &consumer)
+{
+    if (sequence.length() != (widths.length() + 1))
+    {
+        qWarning() << "Unequal fields and widths! Unable to read: " << filename;
+        return false;
+    }
+
+    return ReadColumns(filename, sequence,
+                       [comment_char, widths](const char *begin, const char *end, Columns &columns)
+                       {
+                           ParseFixedWidthBlock(begin, end, comment_char, widths, columns);
+                       },
+                       consumer);
+}
+
+bool KSParser::ReadColumns(const QString &filename, const QList<QPair<QString, DataTypes>> &sequence,
+                           const BlockParser &parser, const ColumnsConsumer &consumer)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qWarning() << "Unable to open file: " << filename;
+        return false;
+    }
+
+    // The file is mapped if possible, and read at once otherwise
+    QByteArray contents;
+    qint64 size      = file.size();
+    const char *data = size > 0 ? reinterpret_cast<const char *>(file.map(0, size)) : nullptr;
+    if (!data)
+    {
+        contents = file.readAll();
+        data     = contents.constData();
+        size     = contents.size();
+    }
+
+    const char *end = data + size;
+    // Skip the byte order mark, like KSFileReader does
+    if (size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+        data += 3;
+
+    // Blocks of whole lines are parsed on the threads of the pool, a few blocks ahead of the consumer
+    const int ahead = 2 * std::max(1, QThreadPool::globalInstance()->maxThreadCount());
+    QQueue<QFuture<Columns>> pending;
+    const char *next = data;
+    int rows         = 0;
+
+    while (next < end || !pending.isEmpty())
+    {
+        while (next < end && pending.size() < ahead)
+        {
+            const char *block_begin = next;
+            const char *block_end   = block_begin + std::min(BLOCK_SIZE, qint64(end - block_begin));
+
+            block_end = std::find(block_end, end, '\n');
+            if (block_end < end)
+                ++block_end;
+            next = block_end;
+
+            pending.enqueue(QtConcurrent::run([=]()
+            {
+                Columns columns(sequence);
+                parser(block_begin, block_end, columns);
+                return columns;
+            }));
+        }
+
+        const Columns columns = pending.dequeue().result();
+        rows += columns.rowCount();
+        consumer(columns);
+    }
+
+    qDebug() << "Read" << rows << "rows from file: " << filename;
+    return true;
+}
+
+void KSParser::ParseCSVBlock(const char *begin, const char *end, const char comment_char, const char delimiter,
+                             Columns &columns)
+{
+    QString number;
+    QVarLengthArray<Span, 32> separated;
+    QVarLengthArray<Span, 32> combined;
+
+    forEachLine(begin, end, [&](const char *line, const char *line_end)
+    {
+        if (line < line_end && *line == comment_char)
+            return;
+
+        separated.clear();
+        for (const char *field = line;;)
+        {
+            const char *field_end = std::find(field, line_end, delimiter);
+            separated.append({ field, field_end });
+            if (field_end == line_end)
+                break;
+            field = field_end + 1;
+        }
+        if (separated.size() == 1)
+            return; // No delimiter
+
+        // Combine the parts in quotes, exactly like CombineQuoteParts() does
+        combined.clear();
+        for (int i = 0; i < separated.size(); ++i)
+        {
+            Span part = separated[i];
+            if (part.begin == part.end || *part.begin != '"')
+            {
+                combined.append(part);
+                continue;
+            }
+
+            const char *field = ++part.begin;
+            while ((part.begin < part.end && part.end[-1] != '"') && i + 1 < separated.size())
+                part = separated[++i];
+            combined.append({ field, part.begin < part.end ? part.end - 1 : part.end });
+        }
+
+        // Skip incomplete rows
+        if (combined.size() != columns.columns_.size())
+            return;
+
+        for (int i = 0; i < combined.size(); ++i)
+            AppendField(columns.columns_[i], combined[i].begin, combined[i].end, number);
+        ++columns.rows_;
+    });
+}
+
+void KSParser::ParseFixedWidthBlock(const char *begin, const char *end, const char comment_char,
+                                    const QList<int> &widths, Columns &columns)
+{
+    QString number;
+    int total_min_length = 0;
+
+    for (int width : widths)
+        total_min_length += width;
+
+    forEachLine(begin, end, [&](const char *line, const char *line_end)
+    {
+        if (line < line_end && *line == comment_char)
+            return;
+        if (lengthInUnits(line, line_end) < total_min_length)
+            return;
+
+        const char *field = line;
+        for (int i = 0; i < widths.size(); ++i)
+        {
+            const char *field_end = advanceUnits(field, line_end, widths.at(i));
+            const Span trimmed_field = trimmed({ field, field_end });
+            AppendField(columns.columns_[i], trimmed_field.begin, trimmed_field.end, number);
+            field = field_end;
+        }
+        const Span last = trimmed({ field, line_end });
+        AppendField(columns.columns_[widths.size()], last.begin, last.end, number);
+        ++columns.rows_;
+    });
+}
+
+void KSParser::AppendField(Columns::Column &column, const char *begin, const char *end, QString &number)
+{
+    if (column.type == D_SKIP)
+        return;
+
+    if (column.type == D_QSTRING)
+    {
+        column.text.append(begin, int(end - begin));
+        column.ends.append(column.text.size());
+        return;
+    }
+
+    // Numbers are converted through a buffer that keeps its capacity, so that no memory is allocated
+    const Span field = trimmed({ begin, end });
+    number.resize(0);
+    number.append(QLatin1String(field.begin, int(field.end - field.begin)));
+
+    bool ok;
+    switch (column.type)
+    {
+        case D_INT:
+        {
+            const int value = number.toInt(&ok);
+            column.ints.append(ok ? value : EBROKEN_INT);
+            break;
+        }
+        case D_FLOAT:
+        {
+            const float value = number.toFloat(&ok);
+            column.floats.append(ok ? value : EBROKEN_FLOAT);
+            break;
+        }
+        case D_DOUBLE:
+        {
+            const double value = number.toDouble(&ok);
+            column.doubles.append(ok ? value : EBROKEN_DOUBLE);
+            break;
+        }
+        default:
+            break;
+    }
+}
@@ -17,9 +17,13 @@
 
 #pragma once
 
+#include <QByteArray>
 #include <QHash>
 #include <QList>
 #include <QVariant>
+#include <QVector>
+
+#include <functional>
 
 #include "ksfilereader.h"
 
@@ -43,6 +47,10 @@
  * In case of failure, the parser returns a Dummy Row. So if you see the
  * string "Null" in the returned QHash, it signifies the parserencountered an
  * unexpected error.
+ *
+ * Large files are better read in columns with ReadCSVColumns() or
+ * ReadFixedWidthColumns(), which parse blocks of rows on several threads
+ * into typed columns, without allocating anything per row.
  **/
 class KSParser
 {
@@ -72,6 +80,58 @@ class KSParser
         D_SKIP
     };
 
+    /**
+     * @brief Typed columns of a block of rows, see ReadCSVColumns()
+     *
+     * There is one column per field of the sequence, in the same order.
+     * Fields of type D_SKIP are not stored. Values are converted like
+     * those of ReadNextRow(), and are 0, 0.0 or an empty string for a
+     * column that does not exist.
+     **/
+    class Columns
+    {
+      public:
+        explicit Columns(const QList<QPair<QString, DataTypes>> &sequence = QList<QPair<QString, DataTypes>>());
+
+        /** @return the number of rows */
+        inline int rowCount() const { return rows_; }
+
+        /** @return the index of the column of a field, -1 if there is none */
+        int columnIndex(const QString &name) const;
+
+        QString stringValue(int column, int row) const;
+        int intValue(int column, int row) const;
+        float floatValue(int column, int row) const;
+        double doubleValue(int column, int row) const;
+
+        /** @return the value of a field, as it would be in the row returned by ReadNextRow() */
+        QVariant value(int column, int row) const;
+
+      private:
+        friend class KSParser;
+
+        struct Column
+        {
+            QString name;
+            DataTypes type { D_SKIP };
+            QVector<int> ints;
+            QVector<float> floats;
+            QVector<double> doubles;
+            /** UTF-8 text of the strings, one after the other */
+            QByteArray text;
+            /** End of each string in text */
+            QVector<int> ends;
+        };
+
+        const Column *column(int column, DataTypes type) const;
+
+        QVector<Column> columns_;
+        int rows_ { 0 };
+    };
+
+    /** Function called with the columns of each block of rows, in the order of the file */
+    typedef std::function<void(const Columns &)> ColumnsConsumer;
+
     /**
      * @brief Returns a CSV parsing instance of a KSParser type object.
      *
@@ -155,6 +215,43 @@ class KSParser
      **/
     void ShowProgress();
 
+    /**
+     * @brief Reads a whole CSV file in columns, parsing blocks of rows on
+     * several threads.
+     *
+     * Rows are read like with ReadCSVRow(): comments, incomplete rows and
+     * lines without delimiter are skipped. The consumer is called in the
+     * calling thread, with the blocks of rows in the order of the file, while
+     * the next blocks are parsed.
+     *
+     * @param filename Full Path (Dir + Filename) of source file
+     * @param comment_char Character signifying a comment line
+     * @param sequence QList of QPairs of the form "field name,data type"
+     * @param consumer function called with each block of rows
+     * @param delimiter separate on which character. default ','
+     * @return false if the file cannot be read
+     **/
+    static bool ReadCSVColumns(const QString &filename, const char comment_char,
+                               const QList<QPair<QString, DataTypes>> &sequence, const ColumnsConsumer &consumer,
+                               const char delimiter = ',');
+
+    /**
+     * @brief Reads a whole Fixed Width file in columns, parsing blocks of
+     * rows on several threads.
+     *
+     * Rows are read like with ReadFixedWidthRow(), see ReadCSVColumns().
+     *
+     * @param filename Full Path (Dir + Filename) of source file
+     * @param comment_char Character signifying a comment line
+     * @param sequence QList of QPairs of the form "field name,data type"
+     * @param widths width sequence, one less than the fields
+     * @param consumer function called with each block of rows
+     * @return false if the file cannot be read
+     **/
+    static bool ReadFixedWidthColumns(const QString &filename, const char comment_char,
+                                      const QList<QPair<QString, DataTypes>> &sequence, const QList<int> &widths,
+                                      const ColumnsConsumer &consumer);
+
   private:
     /**
      * @brief Function Pointer used by ReadNextRow
@@ -208,6 +305,30 @@ class KSParser
      **/
     QVariant ConvertToQVariant(const QString &input_string, const DataTypes &data_type, bool &ok);
 
+    /** Function parsing the rows of a block of whole lines into columns */
+    typedef std::function<void(const char *, const char *, Columns &)> BlockParser;
+
+    /**
+     * @brief Splits a file in blocks of whole lines, parses them on the
+     * threads of the global pool and passes them to the consumer in order
+     **/
+    static bool ReadColumns(const QString &filename, const QList<QPair<QString, DataTypes>> &sequence,
+                            const BlockParser &parser, const ColumnsConsumer &consumer);
+
+    /** @brief Parses the CSV lines between begin and end, see ReadCSVRow() */
+    static void ParseCSVBlock(const char *begin, const char *end, const char comment_char, const char delimiter,
+                              Columns &columns);
+
+    /** @brief Parses the Fixed Width lines between begin and end, see ReadFixedWidthRow() */
+    static void ParseFixedWidthBlock(const char *begin, const char *end, const char comment_char,
+                                     const QList<int> &widths, Columns &columns);
+
+    /**
+     * @brief Appends a field to a column, converted like by ConvertToQVariant()
+     * @param number buffer for the conversion of numbers, reused for all the fields
+     **/
+    static void AppendField(Columns::Column &column, const char *begin, const char *end, QString &number);
+
     static const bool parser_debug_mode_;
 
     KSFileReader file_reader_;
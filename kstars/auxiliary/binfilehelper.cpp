@@ -21,6 +21,7 @@
 #include "byteorder.h"
 #include "auxiliary/kspaths.h"
 
+#include <QFile>
 #include <QStandardPaths>
 
 class BinFileHelper;
@@ -36,10 +37,12 @@ BinFileHelper::~BinFileHelper()
     fields.clear();
     if (fileHandle)
         closeFile();
+    unmapFile();
 }
 
 void BinFileHelper::init()
 {
+    unmapFile();
     if (fileHandle)
         fclose(fileHandle);
 
@@ -85,6 +88,7 @@ FILE *BinFileHelper::openFile(const QString &fileName)
 {
     QString FilePath = KSPaths::locate(QStandardPaths::GenericDataLocation, fileName);
     init();
+    filePath             = FilePath;
     QByteArray b         = FilePath.toLatin1();
     const char *filepath = b.data();
 
@@ -287,10 +291,63 @@ bool BinFileHelper::readHeader()
 
 void BinFileHelper::closeFile()
 {
+    unmapFile();
     fclose(fileHandle);
     fileHandle = nullptr;
 }
 
+bool BinFileHelper::mapFile()
+{
+    if (mappedData)
+        return true;
+
+    if (!fileHandle || !indexUpdated)
+        return false;
+
+    mappedFile = new QFile(filePath);
+    if (mappedFile->open(QIODevice::ReadOnly))
+    {
+        mappedSize = mappedFile->size();
+        mappedData = reinterpret_cast<const char *>(mappedFile->map(0, mappedSize));
+    }
+
+    if (!mappedData)
+    {
+        unmapFile();
+        return false;
+    }
+
+    // Readers trust the spans of the index table, so do not map a file whose data is truncated
+    for (int id = 0; id < indexOffset.size(); ++id)
+    {
+        if (indexOffset.at(id) + static_cast<quint64>(indexCount.at(id)) * recordSize >
+                static_cast<quint64>(mappedSize))
+        {
+            errorMessage = QString::asprintf("Records of index entry %d end beyond the end of the file", id);
+            unmapFile();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void BinFileHelper::unmapFile()
+{
+    // Destroying the file also unmaps it
+    delete mappedFile;
+    mappedFile = nullptr;
+    mappedData = nullptr;
+    mappedSize = 0;
+}
+
+const char *BinFileHelper::getMappedData(qint64 offset, qint64 size) const
+{
+    if (!mappedData || offset < 0 || size < 0 || offset + size > mappedSize)
+        return nullptr;
+    return mappedData + offset;
+}
+
 int BinFileHelper::getErrorNumber()
 {
     int err = errnum;
@@ -23,6 +23,7 @@
 
 #include <cstdio>
 
+class QFile;
 class QString;
 
 /**
@@ -81,6 +82,57 @@ class BinFileHelper
      */
     void closeFile();
 
+    /**
+     * @short  Map the open file in memory, read-only, for getRecords()
+     * @note   To be called after readHeader(). The file handle stays open and usable. Mapping fails, for instance,
+     *         when the file does not fit in the address space; readers should then fall back to the file handle.
+     * @return True if the file is mapped and all the records listed by the index table lie within it
+     */
+    bool mapFile();
+
+    /**
+     * @short  Release the memory map of the file, if any. Pointers from getRecords() become invalid.
+     */
+    void unmapFile();
+
+    /**
+     * @short  Whether the file is mapped in memory, see mapFile()
+     */
+    inline bool isMapped() const { return mappedData != nullptr; }
+
+    /**
+     * @short A span of consecutive records in a mapped file
+     */
+    struct RecordSpan
+    {
+        /** First record, with no alignment guarantee; records are byte-swapped if getByteSwap() is true */
+        const char *data { nullptr };
+        /** Number of records in the span */
+        quint32 count { 0 };
+    };
+
+    /**
+     * @short  Returns the records under the given index ID in the mapped file
+     * @param  id  ID of the index entry, usually a trixel
+     * @return The records, or an empty span if the file is not mapped
+     */
+    inline RecordSpan getRecords(int id) const
+    {
+        RecordSpan span;
+        if (mappedData && indexUpdated)
+        {
+            span.data  = mappedData + indexOffset.at(id);
+            span.count = indexCount.at(id);
+        }
+        return span;
+    }
+
+    /**
+     * @short  Returns the mapped bytes at the given offset in the file
+     * @return A pointer to the bytes, or nullptr if the file is not mapped or is shorter than offset + size
+     */
+    const char *getMappedData(qint64 offset, qint64 size) const;
+
     /**
      * @short   Get error number
      * @return  A number corresponding to the error
@@ -120,6 +172,11 @@ class BinFileHelper
      */
     inline FILE *getFileHandle() const { return fileHandle; }
 
+    /**
+     * @short  Returns the path of the currently open file, for readers that need a handle of their own
+     */
+    inline const QString &getFilePath() const { return filePath; }
+
     /**
      * @short  Returns the offset in the file corresponding to the given index ID
      * @param  id  ID of the index entry whose offset is required
@@ -241,6 +298,14 @@ class BinFileHelper
 
     /// Handle to the file.
     FILE *fileHandle { nullptr};
+    /// Path of the open file, used to map it
+    QString filePath;
+    /// The file mapped by mapFile()
+    QFile *mappedFile { nullptr };
+    /// Contents of the mapped file
+    const char *mappedData { nullptr };
+    /// Size of the mapped file in bytes
+    qint64 mappedSize { 0 };
     /// Stores offsets corresponding to each index table entry
     QVector<unsigned long> indexOffset;
     /// Stores number of records under each index table entry
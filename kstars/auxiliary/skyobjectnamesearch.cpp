@@ -0,0 +1,308 @@
+/***************************************************************************
+                skyobjectnamesearch.cpp  -  K Desktop Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "skyobjectnamesearch.h"
+
+#include "skycomponents/skyobjectnameindex.h"
+
+#include <QVarLengthArray>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace
+{
+// Fuzzy candidates checked at most by a search, the ones sharing the most trigrams with the text first
+const int MAX_FUZZY_CANDIDATES = 20000;
+
+struct Candidate
+{
+    int rank;
+    int length;
+    quint32 index;
+
+    bool operator<(const Candidate &other) const
+    {
+        if (rank != other.rank)
+            return rank < other.rank;
+        if (length != other.length)
+            return length < other.length;
+        return index < other.index;
+    }
+};
+
+// Sort the best candidates, up to count of them, to the front
+void sortBest(std::vector<Candidate> &candidates, int count)
+{
+    const auto middle = candidates.begin() + std::min<size_t>(std::max(count, 0), candidates.size());
+    std::partial_sort(candidates.begin(), middle, candidates.end());
+    candidates.erase(middle, candidates.end());
+}
+}
+
+void SkyObjectNameSearch::add(const QString &name, const SkyObject *object, int type)
+{
+    Entry entry;
+    entry.key = SkyObjectNameIndex::key(name);
+
+    if (entry.key.isEmpty())
+        return;
+
+    entry.name   = name;
+    entry.object = object;
+    entry.type   = type;
+    m_Entries.append(entry);
+}
+
+void SkyObjectNameSearch::build()
+{
+    std::sort(m_Entries.begin(), m_Entries.end(), [](const Entry &a, const Entry &b)
+    {
+        const int order = QString::compare(a.key, b.key);
+        return order < 0 || (order == 0 && a.name < b.name);
+    });
+
+    for (int length = 1; length <= MAX_GRAM_LENGTH; ++length)
+    {
+        QHash<quint64, QVector<quint32>> &lists = m_Grams[length - 1];
+
+        lists.clear();
+        for (int i = 0; i < m_Entries.size(); ++i)
+        {
+            for (quint64 g : grams(m_Entries.at(i).key, length))
+                lists[g].append(i);
+        }
+
+        for (auto list = lists.begin(); list != lists.end(); ++list)
+            list->squeeze();
+    }
+}
+
+QVector<SkyObjectNameSearch::Match> SkyObjectNameSearch::search(const QString &text, int limit, quint32 types) const
+{
+    QVector<Match> matches;
+    const QString key = SkyObjectNameIndex::key(text);
+
+    if (key.isEmpty() || limit <= 0)
+        return matches;
+
+    // Names equal to the text sort first among the names starting with it
+    auto entry = std::lower_bound(m_Entries.constBegin(), m_Entries.constEnd(), key,
+                                  [](const Entry &e, const QString &k) { return QString::compare(e.key, k) < 0; });
+    for (; entry != m_Entries.constEnd() && matches.size() < limit && entry->key.startsWith(key); ++entry)
+    {
+        if (types & typeMask(entry->type))
+            matches.append(match(*entry, entry->key.size() == key.size() ? EXACT_MATCH : PREFIX_MATCH));
+    }
+
+    if (matches.size() < limit)
+        searchSubstrings(key, limit, types, matches);
+
+    if (matches.size() < limit)
+        searchFuzzy(key, limit, types, matches);
+
+    return matches;
+}
+
+quint32 SkyObjectNameSearch::typeMask(int type)
+{
+    return (type >= 0 && type < 31) ? (1u << type) : (1u << 31);
+}
+
+int SkyObjectNameSearch::distance(const QString &text, const QString &name)
+{
+    // Edit distance of text to the best substring of name: a match may start anywhere in name for free
+    const int length = text.size();
+    QVarLengthArray<int, 64> column(length + 1);
+
+    for (int i = 0; i <= length; ++i)
+        column[i] = i;
+
+    int best = column[length];
+    for (const QChar &c : name)
+    {
+        int diagonal = column[0];
+        for (int i = 1; i <= length; ++i)
+        {
+            const int left = column[i];
+            column[i]      = std::min(std::min(left, column[i - 1]) + 1, diagonal + (text.at(i - 1) == c ? 0 : 1));
+            diagonal       = left;
+        }
+        best = std::min(best, column[length]);
+    }
+
+    return best;
+}
+
+int SkyObjectNameSearch::maxDistance(int length)
+{
+    // Each error spoils up to three trigrams of the text, which must keep at least two in common with the name
+    if (length >= 11)
+        return 2;
+    if (length >= 7)
+        return 1;
+    return 0;
+}
+
+QVector<quint64> SkyObjectNameSearch::grams(const QString &key, int length)
+{
+    QVector<quint64> result;
+
+    for (int i = 0; i + length <= key.size(); ++i)
+        result.append(gram(key, i, length));
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+QVector<const QVector<quint32> *> SkyObjectNameSearch::postings(const QVector<quint64> &grams, int length) const
+{
+    const QHash<quint64, QVector<quint32>> &index = m_Grams[length - 1];
+    QVector<const QVector<quint32> *> lists;
+
+    for (quint64 g : grams)
+    {
+        auto list = index.constFind(g);
+        if (list != index.constEnd())
+            lists.append(&list.value());
+    }
+
+    std::sort(lists.begin(), lists.end(),
+              [](const QVector<quint32> *a, const QVector<quint32> *b) { return a->size() < b->size(); });
+    return lists;
+}
+
+void SkyObjectNameSearch::searchSubstrings(const QString &key, int limit, quint32 types, QVector<Match> &matches) const
+{
+    // Texts shorter than a trigram are found through their letters or pair of letters
+    const int length                              = std::min(int(key.size()), int(MAX_GRAM_LENGTH));
+    const QVector<quint64> keyGrams               = grams(key, length);
+    const QVector<const QVector<quint32> *> lists = postings(keyGrams, length);
+
+    // Every sequence of the text must appear in the name
+    if (lists.size() < keyGrams.size())
+        return;
+
+    std::vector<Candidate> candidates;
+    for (quint32 index : *lists.first())
+    {
+        bool inAll = true;
+        for (int i = 1; i < lists.size() && inAll; ++i)
+            inAll = std::binary_search(lists.at(i)->constBegin(), lists.at(i)->constEnd(), index);
+
+        const Entry &entry = m_Entries.at(index);
+        if (!inAll || !(types & typeMask(entry.type)))
+            continue;
+
+        // Names starting with the text were found already
+        const int position = entry.key.indexOf(key);
+        if (position > 0)
+            candidates.push_back({ position, entry.key.size(), index });
+    }
+
+    sortBest(candidates, limit - matches.size());
+    for (const Candidate &candidate : candidates)
+        matches.append(match(m_Entries.at(candidate.index), SUBSTRING_MATCH));
+}
+
+void SkyObjectNameSearch::searchFuzzy(const QString &key, int limit, quint32 types, QVector<Match> &matches) const
+{
+    const int maxErrors = maxDistance(key.size());
+    if (maxErrors == 0)
+        return;
+
+    const QVector<quint64> keyGrams               = grams(key);
+    const QVector<const QVector<quint32> *> lists = postings(keyGrams);
+    const int needed = keyGrams.size() - 3 * maxErrors;
+
+    if (needed < 2 || lists.size() < needed)
+        return;
+
+    // A name sharing needed trigrams with the text appears in at least one of the shortest lists but needed - 1,
+    // which are merged to find the candidates. The other lists are only searched for these candidates.
+    const int merged = lists.size() - needed + 1;
+    QVarLengthArray<int, 16> heads(merged);
+    std::fill(heads.begin(), heads.end(), 0);
+
+    std::vector<std::vector<quint32>> byShared(lists.size() + 1);
+    while (true)
+    {
+        quint32 index = std::numeric_limits<quint32>::max();
+        for (int i = 0; i < merged; ++i)
+        {
+            if (heads[i] < lists.at(i)->size())
+                index = std::min(index, lists.at(i)->at(heads[i]));
+        }
+        if (index == std::numeric_limits<quint32>::max())
+            break;
+
+        int shared = 0;
+        for (int i = 0; i < merged; ++i)
+        {
+            if (heads[i] < lists.at(i)->size() && lists.at(i)->at(heads[i]) == index)
+            {
+                ++shared;
+                ++heads[i];
+            }
+        }
+        for (int i = merged; i < lists.size(); ++i)
+        {
+            if (std::binary_search(lists.at(i)->constBegin(), lists.at(i)->constEnd(), index))
+                ++shared;
+        }
+
+        if (shared >= needed && (types & typeMask(m_Entries.at(index).type)))
+            byShared[shared].push_back(index);
+    }
+
+    // Check the candidates sharing the most trigrams first, until enough names are found
+    std::vector<Candidate> candidates;
+    const int wanted = limit - matches.size();
+    int checked      = 0;
+    for (int shared = lists.size(); shared >= needed; --shared)
+    {
+        if (int(candidates.size()) >= wanted || checked >= MAX_FUZZY_CANDIDATES)
+            break;
+
+        for (quint32 index : byShared[shared])
+        {
+            const Entry &entry = m_Entries.at(index);
+            const int errors   = distance(key, entry.key);
+
+            // Names containing the text were found already
+            if (errors > 0 && errors <= maxErrors)
+                candidates.push_back({ errors, entry.key.size(), index });
+
+            if (++checked >= MAX_FUZZY_CANDIDATES)
+                break;
+        }
+    }
+
+    sortBest(candidates, wanted);
+    for (const Candidate &candidate : candidates)
+        matches.append(match(m_Entries.at(candidate.index), FUZZY_MATCH, candidate.rank));
+}
+
+SkyObjectNameSearch::Match SkyObjectNameSearch::match(const Entry &entry, MatchType type, int distance)
+{
+    Match m;
+    m.name     = entry.name;
+    m.object   = entry.object;
+    m.type     = entry.type;
+    m.match    = type;
+    m.distance = distance;
+    return m;
+}
@@ -0,0 +1,139 @@
+/***************************************************************************
+                 skyobjectnamesearch.h  -  K Desktop Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+class SkyObject;
+
+/**
+ * @class SkyObjectNameSearch
+ *
+ * @short Ranked search of object names as they are typed, for the Find Object dialog
+ *
+ * Names are added with add() and indexed once with build(), typically in a background thread. The index is then
+ * read-only and may be searched from any thread.
+ *
+ * Names are compared like in SkyObjectNameIndex, case folded and without white space. A search returns the names
+ * equal to the text first, then the names starting with the text, in alphabetical order, then the names containing
+ * the text, and last the names containing the text with a few typing errors, closest first.
+ *
+ * Names starting with the text are found by binary search in the sorted names. Names containing the text, exactly
+ * or not, are found through the trigrams of the text, the three-letter sequences of the names, which are indexed
+ * with the list of the names they appear in. The letters and pairs of letters of the names are indexed the same
+ * way for texts of one or two letters, so that "31" still finds "M 31".
+ */
+class SkyObjectNameSearch
+{
+  public:
+    /** @short How a name matches the searched text, best first */
+    enum MatchType
+    {
+        EXACT_MATCH,
+        PREFIX_MATCH,
+        SUBSTRING_MATCH,
+        FUZZY_MATCH
+    };
+
+    struct Match
+    {
+        /** The name, as displayed */
+        QString name;
+        const SkyObject *object { nullptr };
+        int type { 0 };
+        MatchType match { EXACT_MATCH };
+        /** Number of typing errors of the text in the name, for fuzzy matches */
+        int distance { 0 };
+    };
+
+    /** Mask of all the object types, see typeMask() */
+    static const quint32 ALL_TYPES = 0xffffffff;
+
+    SkyObjectNameSearch() = default;
+
+    /**
+     * @short Add a name of an object, before build()
+     * @param name the name, as displayed
+     * @param object the object, never dereferenced
+     * @param type the SkyObject::TYPE of the object
+     */
+    void add(const QString &name, const SkyObject *object, int type);
+
+    /** @short Sort and index the names added */
+    void build();
+
+    /**
+     * @short Search the names matching a text
+     * @param text the text typed
+     * @param limit the maximum number of matches
+     * @param types the mask of the object types to search, see typeMask()
+     * @return the matches, best first
+     */
+    QVector<Match> search(const QString &text, int limit, quint32 types = ALL_TYPES) const;
+
+    /** @return the number of names */
+    inline int size() const { return m_Entries.size(); }
+
+    /** @return the bit of an object type in type masks */
+    static quint32 typeMask(int type);
+
+    /** @return the least number of typing errors of text in any part of name: letters added, missing or wrong */
+    static int distance(const QString &text, const QString &name);
+
+  private:
+    struct Entry
+    {
+        QString name;
+        QString key;
+        const SkyObject *object { nullptr };
+        int type { 0 };
+    };
+
+    /** Maximum number of typing errors allowed in a text of the given length */
+    static int maxDistance(int length);
+
+    /** Length of the longest letter sequences indexed, the trigrams */
+    static const int MAX_GRAM_LENGTH = 3;
+
+    /** @return the sequence of length letters of key at position i, length being at most MAX_GRAM_LENGTH */
+    static inline quint64 gram(const QString &key, int i, int length)
+    {
+        quint64 g = 0;
+        for (int j = 0; j < length; ++j)
+            g = (g << 16) | quint64(key.at(i + j).unicode());
+        return g;
+    }
+
+    /** @return the distinct sequences of length letters of a key */
+    static QVector<quint64> grams(const QString &key, int length = MAX_GRAM_LENGTH);
+
+    /** @return the lists of names of the sequences of length letters that appear in any name, shortest first */
+    QVector<const QVector<quint32> *> postings(const QVector<quint64> &grams, int length = MAX_GRAM_LENGTH) const;
+
+    /** Append the names containing key, beyond their start, to matches */
+    void searchSubstrings(const QString &key, int limit, quint32 types, QVector<Match> &matches) const;
+
+    /** Append the names containing key with a few typing errors to matches */
+    void searchFuzzy(const QString &key, int limit, quint32 types, QVector<Match> &matches) const;
+
+    static Match match(const Entry &entry, MatchType type, int distance = 0);
+
+    /** Names, sorted by key */
+    QVector<Entry> m_Entries;
+    /** Indices in m_Entries of the names containing each sequence of one, two and three letters, in increasing order */
+    QHash<quint64, QVector<quint32>> m_Grams[MAX_GRAM_LENGTH];
+};
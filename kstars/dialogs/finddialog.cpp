@@ -19,6 +19,7 @@
 
 #include "kstars.h"
 #include "kstarsdata.h"
+#include "kstars_debug.h"
 #include "ksnotification.h"
 #include "Options.h"
 #include "detaildialog.h"
@@ -30,6 +31,7 @@
 #include "skycomponents/skymapcomposite.h"
 #include "tools/nameresolver.h"
 #include "skyobjectlistmodel.h"
+#include "skyobjectnamesearch.h"
 
 #include <KMessageBox>
 
@@ -38,6 +40,13 @@
 #include <QTimer>
 #include <QComboBox>
 #include <QLineEdit>
+#include <QtConcurrent>
+
+namespace
+{
+// Names listed at most for a search text
+const int SEARCH_LIMIT = 500;
+}
 
 FindDialog * FindDialog::m_Instance = nullptr;
 
@@ -144,6 +153,8 @@ FindDialog::FindDialog(QWidget *parent) : QDialog(parent), timer(nullptr), m_tar
     connect(ui->SearchBox, &QLineEdit::returnPressed, this, &FindDialog::slotOk);
     connect(ui->FilterType, &QComboBox::currentTextChanged, this, &FindDialog::enqueueSearch);
     connect(ui->SearchList, SIGNAL(doubleClicked(QModelIndex)), SLOT(slotOk()));
+    connect(&m_SearchWatcher, &QFutureWatcher<std::shared_ptr<const SkyObjectNameSearch>>::finished, this,
+            &FindDialog::searchBuilt);
 
     // Set focus to object name edit
     ui->SearchBox->setFocus();
@@ -157,6 +168,7 @@ FindDialog::FindDialog(QWidget *parent) : QDialog(parent), timer(nullptr), m_tar
 
 void FindDialog::init()
 {
+    buildSearch();
     ui->SearchBox->clear();
     filterByType();
     sortModel->sort(0);
@@ -166,6 +178,7 @@ void FindDialog::init()
 
 void FindDialog::showEvent(QShowEvent *e)
 {
+    buildSearch();
     ui->SearchBox->setFocus();
     e->accept();
 }
@@ -229,77 +242,124 @@ void FindDialog::initSelection()
 
 void FindDialog::filterByType()
 {
-    KStarsData *data = KStarsData::Instance();
+    const QVector<int> types = filterTypes(ui->FilterType->currentIndex());
+    const auto &objectLists  = KStarsData::Instance()->skyComposite()->objectLists();
+    QVector<QPair<QString, const SkyObject *>> objects;
 
-    switch (ui->FilterType->currentIndex())
+    if (types.isEmpty())
+    {
+        for (const auto &list : objectLists)
+            objects.append(list);
+    }
+    else
+    {
+        for (int type : types)
+            objects.append(objectLists.value(type));
+    }
+
+    fModel->setSkyObjectsList(objects);
+}
+
+QVector<int> FindDialog::filterTypes(int filterIndex)
+{
+    switch (filterIndex)
     {
-        case 0: // All object types
-        {
-            QVector<QPair<QString, const SkyObject *>> allObjects;
-            foreach (int type, data->skyComposite()->objectLists().keys())
-            {
-                allObjects.append(data->skyComposite()->objectLists(SkyObject::TYPE(type)));
-            }
-            fModel->setSkyObjectsList(allObjects);
-            break;
-        }
         case 1: //Stars
-        {
-            QVector<QPair<QString, const SkyObject *>> starObjects;
-            starObjects.append(data->skyComposite()->objectLists(SkyObject::STAR));
-            starObjects.append(data->skyComposite()->objectLists(SkyObject::CATALOG_STAR));
-            fModel->setSkyObjectsList(starObjects);
-            break;
-        }
+            return QVector<int>() << SkyObject::STAR << SkyObject::CATALOG_STAR;
         case 2: //Solar system
-        {
-            QVector<QPair<QString, const SkyObject *>> ssObjects;
-            ssObjects.append(data->skyComposite()->objectLists(SkyObject::PLANET));
-            ssObjects.append(data->skyComposite()->objectLists(SkyObject::COMET));
-            ssObjects.append(data->skyComposite()->objectLists(SkyObject::ASTEROID));
-            ssObjects.append(data->skyComposite()->objectLists(SkyObject::MOON));
-
-            fModel->setSkyObjectsList(ssObjects);
-            break;
-        }
+            return QVector<int>() << SkyObject::PLANET << SkyObject::COMET << SkyObject::ASTEROID << SkyObject::MOON;
         case 3: //Open Clusters
-            fModel->setSkyObjectsList(data->skyComposite()->objectLists(SkyObject::OPEN_CLUSTER));
-            break;
+            return QVector<int>() << SkyObject::OPEN_CLUSTER;
         case 4: //Globular Clusters
-            fModel->setSkyObjectsList(data->skyComposite()->objectLists(SkyObject::GLOBULAR_CLUSTER));
-            break;
+            return QVector<int>() << SkyObject::GLOBULAR_CLUSTER;
         case 5: //Gaseous nebulae
-            fModel->setSkyObjectsList(data->skyComposite()->objectLists(SkyObject::GASEOUS_NEBULA));
-            break;
+            return QVector<int>() << SkyObject::GASEOUS_NEBULA;
         case 6: //Planetary nebula
-            fModel->setSkyObjectsList(data->skyComposite()->objectLists(SkyObject::PLANETARY_NEBULA));
-            break;
+            return QVector<int>() << SkyObject::PLANETARY_NEBULA;
         case 7: //Galaxies
-            fModel->setSkyObjectsList(data->skyComposite()->objectLists(SkyObject::GALAXY));
-            break;
+            return QVector<int>() << SkyObject::GALAXY;
         case 8: //Comets
-            fModel->setSkyObjectsList(data->skyComposite()->objectLists(SkyObject::COMET));
-            break;
+            return QVector<int>() << SkyObject::COMET;
         case 9: //Asteroids
-            fModel->setSkyObjectsList(data->skyComposite()->objectLists(SkyObject::ASTEROID));
-            break;
+            return QVector<int>() << SkyObject::ASTEROID;
         case 10: //Constellations
-            fModel->setSkyObjectsList(data->skyComposite()->objectLists(SkyObject::CONSTELLATION));
-            break;
+            return QVector<int>() << SkyObject::CONSTELLATION;
         case 11: //Supernovae
-            fModel->setSkyObjectsList(data->skyComposite()->objectLists(SkyObject::SUPERNOVA));
-            break;
+            return QVector<int>() << SkyObject::SUPERNOVA;
         case 12: //Satellites
-            fModel->setSkyObjectsList(data->skyComposite()->objectLists(SkyObject::SATELLITE));
-            break;
+            return QVector<int>() << SkyObject::SATELLITE;
+        default: // All object types
+            return QVector<int>();
     }
 }
 
+void FindDialog::buildSearch()
+{
+    if (m_SearchWatcher.isRunning() || isSearchCurrent())
+        return;
+
+    // The copy shares the lists of SkyMapComposite, which detach from it when they are modified
+    m_PendingLists = KStarsData::Instance()->skyComposite()->objectLists();
+
+    const QHash<int, QVector<QPair<QString, const SkyObject *>>> lists = m_PendingLists;
+    m_SearchWatcher.setFuture(QtConcurrent::run([lists]()
+    {
+        SkyObjectNameSearch *search = new SkyObjectNameSearch();
+        for (auto list = lists.constBegin(); list != lists.constEnd(); ++list)
+        {
+            for (const auto &name : list.value())
+                search->add(name.first, name.second, list.key());
+        }
+        search->build();
+        return std::shared_ptr<const SkyObjectNameSearch>(search);
+    }));
+}
+
+void FindDialog::searchBuilt()
+{
+    m_Search      = m_SearchWatcher.result();
+    m_SearchLists = m_PendingLists;
+    m_PendingLists.clear();
+
+    qCDebug(KSTARS) << "Indexed" << m_Search->size() << "object names for the Find dialog";
+
+    // Objects may have been added or removed in the meantime
+    buildSearch();
+}
+
+bool FindDialog::isSearchCurrent() const
+{
+    if (!m_Search)
+        return false;
+
+    const auto &lists = KStarsData::Instance()->skyComposite()->objectLists();
+    if (lists.size() != m_SearchLists.size())
+        return false;
+
+    for (auto list = lists.constBegin(); list != lists.constEnd(); ++list)
+    {
+        if (!list.value().isSharedWith(m_SearchLists.value(list.key())))
+            return false;
+    }
+
+    return true;
+}
+
 void FindDialog::filterList()
 {
     QString SearchText = processSearchText();
-    sortModel->setFilterFixedString(SearchText);
     ui->InternetSearchButton->setText(i18n("or search the Internet for %1", SearchText));
+
+    if (!SearchText.isEmpty() && isSearchCurrent())
+    {
+        searchList(SearchText);
+        return;
+    }
+
+    buildSearch();
+
+    sortModel->setFilterFixedString(SearchText);
+    sortModel->sort(0);
     filterByType();
     initSelection();
 
@@ -332,12 +392,53 @@ void FindDialog::filterList()
     listFiltered = true;
 }
 
+void FindDialog::searchList(const QString &searchText)
+{
+    quint32 types = 0;
+    for (int type : filterTypes(ui->FilterType->currentIndex()))
+        types |= SkyObjectNameSearch::typeMask(type);
+
+    const QVector<SkyObjectNameSearch::Match> matches =
+        m_Search->search(searchText, SEARCH_LIMIT, types ? types : SkyObjectNameSearch::ALL_TYPES);
+
+    QVector<QPair<QString, const SkyObject *>> objects;
+    bool exactMatch = false;
+    for (const auto &match : matches)
+    {
+        objects.append(qMakePair(match.name, match.object));
+        exactMatch |= (match.match == SkyObjectNameSearch::EXACT_MATCH);
+    }
+
+    // The matches are listed as ranked by the search
+    sortModel->setFilterFixedString(QString());
+    sortModel->sort(-1);
+    fModel->setSkyObjectsList(objects);
+
+    okB->setEnabled(!objects.isEmpty());
+    if (!objects.isEmpty())
+    {
+        QModelIndex selectItem = sortModel->index(0, 0);
+        ui->SearchList->selectionModel()->select(selectItem, QItemSelectionModel::ClearAndSelect);
+        ui->SearchList->scrollTo(selectItem);
+        ui->SearchList->setCurrentIndex(selectItem);
+    }
+
+    // Disable searching the internet when an exact match for searchText exists in KStars
+    ui->InternetSearchButton->setEnabled(!exactMatch);
+    listFiltered = true;
+}
+
 SkyObject *FindDialog::selectedObject() const
 {
     QModelIndex i = ui->SearchList->currentIndex();
     QVariant sObj = sortModel->data(sortModel->index(i.row(), 0), SkyObjectListModel::SkyObjectRole);
+    SkyObject *obj = reinterpret_cast<SkyObject*>(sObj.value<void *>());
+
+    // Large custom catalogs list the names of objects they have not loaded yet, which are loaded by name
+    if (!obj && i.isValid())
+        obj = KStarsData::Instance()->skyComposite()->findByName(sortModel->data(sortModel->index(i.row(), 0)).toString());
 
-    return reinterpret_cast<SkyObject*>(sObj.value<void *>());
+    return obj;
 }
 
 void FindDialog::enqueueSearch()
@@ -353,7 +454,8 @@ void FindDialog::enqueueSearch()
         timer->setSingleShot(true);
         connect(timer, SIGNAL(timeout()), this, SLOT(filterList()));
     }
-    timer->start(500);
+    // Without an up to date index, filtering the lists is too slow to follow typing
+    timer->start(isSearchCurrent() ? 100 : 500);
 }
 
 // Process the search box text to replace equivalent names like "m93" with "m 93"
@@ -20,13 +20,17 @@
 #include "ui_finddialog.h"
 
 #include <QDialog>
+#include <QFutureWatcher>
 #include <QKeyEvent>
 
+#include <memory>
+
 class QTimer;
 class QComboBox;
 class QStringListModel;
 class QSortFilterProxyModel;
 class SkyObjectListModel;
+class SkyObjectNameSearch;
 class SkyObject;
 
 class FindDialogUI : public QFrame, public Ui::FindDialog
@@ -43,6 +47,10 @@ class FindDialogUI : public QFrame, public Ui::FindDialog
  * the list by name, and a QCombobox for filtering the list by object type.
  *
  * 2018-12 JM: The dialog is a singleton since we need a single instance in KStars.
+ *
+ * The names are searched with a SkyObjectNameSearch, indexed in the background when the dialog is created and
+ * again once the objects changed. Until the index is up to date, the list is filtered by the names containing
+ * the text.
  * @short Find Object Dialog
  * @author Jason Harris
  * @author Jasem Mutlaq
@@ -93,6 +101,9 @@ class FindDialog : public QDialog
 
     void slotDetails();
 
+    /** Use the search index built in the background */
+    void searchBuilt();
+
   protected:
     /**
      * Process Keystrokes.  The Up and Down arrow keys are used to select the
@@ -127,6 +138,18 @@ class FindDialog : public QDialog
     /** @short pre-filter the list of objects according to the selected object type. */
     void filterByType();
 
+    /** @return the object types of an entry of the type filter, none for all the types */
+    static QVector<int> filterTypes(int filterIndex);
+
+    /** @short List the names matching the search text, as ranked by the search index */
+    void searchList(const QString &searchText);
+
+    /** @short Index the names of the objects in the background, unless they are indexed already */
+    void buildSearch();
+
+    /** @return true if the search index holds the current names of the objects */
+    bool isSearchCurrent() const;
+
     FindDialogUI *ui { nullptr };
     SkyObjectListModel *fModel { nullptr };
     QSortFilterProxyModel *sortModel { nullptr };
@@ -135,6 +158,13 @@ class FindDialog : public QDialog
     QPushButton *okB { nullptr };
     SkyObject *m_targetObject { nullptr };
 
+    // Search index, and the lists of names it was built from. The lists are shared with those of SkyMapComposite
+    // until they are modified there.
+    std::shared_ptr<const SkyObjectNameSearch> m_Search;
+    QHash<int, QVector<QPair<QString, const SkyObject *>>> m_SearchLists;
+    QHash<int, QVector<QPair<QString, const SkyObject *>>> m_PendingLists;
+    QFutureWatcher<std::shared_ptr<const SkyObjectNameSearch>> m_SearchWatcher;
+
     // History
     QComboBox *m_HistoryCombo { nullptr};
     QList<SkyObject*> m_HistoryList;
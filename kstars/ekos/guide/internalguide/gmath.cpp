@@ -13,7 +13,9 @@
 
 #include "imageautoguiding.h"
 #include "Options.h"
+#include "fitsviewer/fitsbufferarena.h"
 #include "fitsviewer/fitsdata.h"
+#include "fitsviewer/fitssepdetector.h"
 #include "fitsviewer/fitsview.h"
 #include "auxiliary/kspaths.h"
 #include "../guideview.h"
@@ -341,7 +343,7 @@ float *cgmath::createFloatImage(FITSData *target) const
     // #1 Convert to float array
     // We only process 1st plane if it is a color image
     uint32_t imgSize = imageData->width() * imageData->height();
-    float *imgFloat  = new float[imgSize];
+    float *imgFloat  = FITSBufferArena::Instance()->acquire<float>(imgSize);
 
     if (imgFloat == nullptr)
     {
@@ -349,75 +351,10 @@ float *cgmath::createFloatImage(FITSData *target) const
         return nullptr;
     }
 
-    switch (imageData->property("dataType").toInt())
+    if (!FITSSEPDetector::convertView(FITSSEPDetector::imageView(imageData), imgFloat))
     {
-        case TBYTE:
-        {
-            uint8_t const *buffer = imageData->getImageBuffer();
-            for (uint32_t i = 0; i < imgSize; i++)
-                imgFloat[i] = buffer[i];
-        }
-        break;
-
-        case TSHORT:
-        {
-            int16_t const *buffer = reinterpret_cast<int16_t const *>(imageData->getImageBuffer());
-            for (uint32_t i = 0; i < imgSize; i++)
-                imgFloat[i] = buffer[i];
-        }
-        break;
-
-        case TUSHORT:
-        {
-            uint16_t const *buffer = reinterpret_cast<uint16_t const*>(imageData->getImageBuffer());
-            for (uint32_t i = 0; i < imgSize; i++)
-                imgFloat[i] = buffer[i];
-        }
-        break;
-
-        case TLONG:
-        {
-            int32_t const *buffer = reinterpret_cast<int32_t const*>(imageData->getImageBuffer());
-            for (uint32_t i = 0; i < imgSize; i++)
-                imgFloat[i] = buffer[i];
-        }
-        break;
-
-        case TULONG:
-        {
-            uint32_t const *buffer = reinterpret_cast<uint32_t const*>(imageData->getImageBuffer());
-            for (uint32_t i = 0; i < imgSize; i++)
-                imgFloat[i] = buffer[i];
-        }
-        break;
-
-        case TFLOAT:
-        {
-            float const *buffer = reinterpret_cast<float const*>(imageData->getImageBuffer());
-            for (uint32_t i = 0; i < imgSize; i++)
-                imgFloat[i] = buffer[i];
-        }
-        break;
-
-        case TLONGLONG:
-        {
-            int64_t const *buffer = reinterpret_cast<int64_t const*>(imageData->getImageBuffer());
-            for (uint32_t i = 0; i < imgSize; i++)
-                imgFloat[i] = buffer[i];
-        }
-        break;
-
-        case TDOUBLE:
-        {
-            double const *buffer = reinterpret_cast<double const*>(imageData->getImageBuffer());
-            for (uint32_t i = 0; i < imgSize; i++)
-                imgFloat[i] = buffer[i];
-        }
-        break;
-
-        default:
-            delete[] imgFloat;
-            return nullptr;
+        FITSBufferArena::Instance()->release(imgFloat);
+        return nullptr;
     }
 
     return imgFloat;
@@ -469,7 +406,7 @@ QVector<float *> cgmath::partitionImage() const
     }
 
     // We're done with imgFloat
-    delete[] imgFloat;
+    FITSBufferArena::Instance()->release(imgFloat);
 
     return regions;
 }
@@ -1464,7 +1401,7 @@ QList<Edge*> cgmath::PSFAutoFind(int extraEdgeAllowance)
         float *tmp = new float[size];
         memset(tmp, 0, size * sizeof(float));
         psf_conv(tmp, conv, subW, subH);
-        delete [] conv;
+        FITSBufferArena::Instance()->release(conv);
         // Swap
         conv = tmp;
     }
@@ -206,7 +206,8 @@ class cgmath : public QObject
         template <typename T>
         Vector findLocalStarPosition(void) const;
 
-        // Creates a new float image from the guideView image data. The returned image MUST be deleted later or memory will leak.
+        // Creates a new float image from the guideView image data. The returned image MUST be released to the
+        // FITSBufferArena later, so that the next frame reuses it.
         float *createFloatImage(FITSData *target = nullptr) const;
 
         void do_ticks(void);
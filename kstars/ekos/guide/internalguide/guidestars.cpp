@@ -12,6 +12,7 @@
 #include <math.h>
 #include "ekos_guide_debug.h"
 #include "../guideview.h"
+#include "fitsviewer/fitsworkerpool.h"
 #include <QTime>
 
 // Keeps at most this many reference "neighbor" stars
@@ -37,7 +38,7 @@
  be successful.
  */
 
-GuideStars::GuideStars()
+GuideStars::GuideStars() : sepDetector(new FITSSEPDetector(nullptr))
 {
 }
 
@@ -310,17 +311,29 @@ Vector GuideStars::findGuideStar(FITSData *imageData, const QRect &trackingBox,
 }
 
 // This is the interface to star detection.
-int GuideStars::findAllSEPStars(FITSData *imageData, QList<Edge*> *sepStars)
+int GuideStars::findAllSEPStars(FITSData *imageData, QList<Edge*> *sepStars, const QRect *roi)
 {
     qDeleteAll(*sepStars);
     sepStars->clear();
 
-    QRect nullBox;
-    int count = FITSSEPDetector(imageData)
-                .configure("numStars", 100)
+    FITSWorkerPool::StageTimer stageTimer(FITSWorkerPool::STAGE_STAR_DETECTION);
+
+    // Only the region of interest is converted and searched, directly from the guide frame.
+    // The sky background of a box around the guide star is biased by the star, so the SNR of the stars
+    // keeps using the background of the last full frame, once there is one.
+    const QRect box = roi != nullptr ? *roi : QRect();
+    SkyBackground roiBackground;
+    SkyBackground *background = (roi != nullptr && skyBackground.numPixelsInSkyEstimate > 0) ? &roiBackground : &skyBackground;
+
+    // Guide frames are searched as a whole, so that the detections do not depend on tiles and thread count.
+    int count = sepDetector->configure("numStars", 100)
                 .configure("fractionRemoved", 0.0)
                 .configure("deblendMincont", 0.005)
-                .findSourcesAndBackground(*sepStars, nullBox, &skyBackground);
+                .configure("radiusIsBoundary", false)
+                .configure("tiledExtraction", false)
+                .findSourcesInView(FITSSEPDetector::imageView(imageData, box), *sepStars, background);
+    qCDebug(KSTARS_EKOS_GUIDE) << QString("Multistar: SEP detection took %1 ms")
+                               .arg(sepDetector->lastDetectionTime(), 0, 'f', 1);
     return count;
 }
 
@@ -359,7 +372,7 @@ void GuideStars::findTopStars(FITSData *imageData, int num, QList<Edge> *stars,
     QTime timer;
     timer.restart();
     QList<Edge*> sepStars;
-    int count = findAllSEPStars(imageData, &sepStars);
+    int count = findAllSEPStars(imageData, &sepStars, roi);
     if (count == 0)
         return;
 
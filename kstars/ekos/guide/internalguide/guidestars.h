@@ -13,6 +13,8 @@
 #include <QList>
 #include <QVector3D>
 
+#include <memory>
+
 #include "fitsviewer/fitsdata.h"
 #include "fitsviewer/fitssepdetector.h"
 #include "starcorrespondence.h"
@@ -101,7 +103,9 @@ class GuideStars
                           QList<double> *outputScores = nullptr,
                           QList<double> *minDistances = nullptr);
         // The interface to the SEP star detection algoritms.
-        int findAllSEPStars(FITSData *imageData, QList<Edge*> *sepStars);
+        // If roi is not null, only that part of the image is processed, and the sky background of the
+        // last full frame is kept.
+        int findAllSEPStars(FITSData *imageData, QList<Edge*> *sepStars, const QRect *roi = nullptr);
 
         // Convert from input image coordinates to output RA and DEC coordinates.
         Vector point2arcsec(const Vector &p) const;
@@ -144,6 +148,9 @@ class GuideStars
         // Used to calculate star SNR values.
         SkyBackground skyBackground;
 
+        // Kept from frame to frame so that its conversion buffer is reused.
+        std::unique_ptr<FITSSEPDetector> sepDetector;
+
         // Used to find the guide star in a new set of image detections.
         StarCorrespondence starCorrespondence;
 
@@ -31,6 +31,9 @@
 #include <KNotifications/KNotification>
 #include <KConfigDialog>
 
+#include <QDataStream>
+#include <QtConcurrent>
+
 #include <fitsio.h>
 #include <ekos_scheduler_debug.h>
 
@@ -38,6 +41,7 @@
 #define MAX_FAILURE_ATTEMPTS      5
 #define UPDATE_PERIOD_MS          1000
 #define RESTART_GUIDING_DELAY_MS  5000
+#define MAX_MOON_RESTARTS         5
 
 #define DEFAULT_CULMINATION_TIME    -60
 #define DEFAULT_MIN_ALTITUDE        15
@@ -93,6 +97,8 @@ Scheduler::Scheduler()
 
     connect(&schedulerTimer, &QTimer::timeout, this, &Scheduler::checkStatus);
     connect(&jobTimer, &QTimer::timeout, this, &Scheduler::checkJobStage);
+    connect(&jobEvaluationWatcher, &QFutureWatcher<std::shared_ptr<JobEvaluation>>::finished, this,
+            &Scheduler::applyJobEvaluation);
 
     restartGuidingTimer.setSingleShot(true);
     restartGuidingTimer.setInterval(RESTART_GUIDING_DELAY_MS);
@@ -747,7 +753,7 @@ void Scheduler::saveJob()
     if (SchedulerJob::START_AT == job->getFileStartupCondition())
     {
         /* Warn if appending a job which startup time doesn't allow proper score */
-        if (calculateJobScore(job, job->getStartupTime()) < 0)
+        if (calculateJobScore(job, Dawn, Dusk, job->getStartupTime()) < 0)
             appendLogText(
                 i18n("Warning: job '%1' has startup time %2 resulting in a negative score, and will be marked invalid when processed.",
                      job->getName(), job->getStartupTime().toString(job->getDateTimeDisplayFormat())));
@@ -1284,7 +1290,8 @@ void Scheduler::removeJob()
     if (jobUnderEdit >= 0)
         resetJobEdit();
 
-    /* And remove the job object */
+    /* And remove the job object, after dropping any evaluation that references it */
+    cancelJobEvaluation();
     jobs.removeOne(job);
     delete (job);
 
@@ -1535,6 +1542,9 @@ void Scheduler::setCurrentJob(SchedulerJob *job)
 
 void Scheduler::evaluateJobs()
 {
+    /* Drop the evaluation in progress, this one supersedes it */
+    cancelJobEvaluation();
+
     /* Don't evaluate if list is empty */
     if (jobs.isEmpty())
         return;
@@ -1733,6 +1743,75 @@ void Scheduler::evaluateJobs()
     /* The first reordered job has no lead time - this could also be the delay from now to startup */
     sortedJobs.first()->setLeadTime(0);
 
+    /* Schedule detached copies of the jobs in a worker thread, see applyJobEvaluation() for the result */
+    /* The worker only uses the location, time and options captured here */
+    std::shared_ptr<JobEvaluation> const evaluation = std::make_shared<JobEvaluation>();
+    evaluation->jobs                   = sortedJobs;
+    evaluation->selectJob              = !jobEvaluationOnly;
+    evaluation->conditions             = SchedulerJob::currentConditions();
+    evaluation->now                    = evaluation->conditions->now;
+    evaluation->dawn                   = Dawn;
+    evaluation->dusk                   = Dusk;
+    evaluation->leadTime               = evaluation->conditions->leadTime;
+    evaluation->preDawnTime            = evaluation->conditions->preDawnTime;
+    evaluation->settingAltitudeCutoff  = evaluation->conditions->settingAltitudeCutoff;
+    evaluation->altitudeDecimals       = minAltitude->decimals();
+    evaluation->moonSeparationDecimals = minMoonSeparation->decimals();
+
+    evaluation->inputs.reserve(sortedJobs.size());
+    for (SchedulerJob const * const job : sortedJobs)
+        evaluation->inputs.push_back(job->detached(evaluation->conditions));
+
+    /* Jobs whose inputs did not change since the last evaluation keep their schedule */
+    if (lastJobEvaluation)
+        evaluation->previousSchedules = lastJobEvaluation->schedules;
+
+    jobEvaluationOnly = false;
+
+    /* Positions of the Moon are only computed in the GUI thread, so prepare those of the next day, the others will be computed on demand */
+    KStarsDateTime const ut = KStarsData::Instance()->ut();
+    evaluation->moonFrom = ut;
+    evaluation->moonTo   = ut.addDays(1);
+    SchedulerJob::updateMoonEphemeris(evaluation->moonFrom, evaluation->moonTo);
+
+    startJobScheduling(evaluation);
+}
+
+void Scheduler::startJobScheduling(std::shared_ptr<JobEvaluation> const &evaluation)
+{
+    jobEvaluation = evaluation;
+
+    jobEvaluationWatcher.setFuture(QtConcurrent::run([evaluation]()
+    {
+        scheduleJobs(*evaluation);
+        return evaluation;
+    }));
+}
+
+void Scheduler::cancelJobEvaluation()
+{
+    if (jobEvaluation)
+    {
+        jobEvaluation->cancelled.store(1);
+        jobEvaluation.reset();
+    }
+}
+
+void Scheduler::scheduleJobs(JobEvaluation &evaluation)
+{
+    QDateTime const &now = evaluation.now;
+
+    /* Schedule copies of the input jobs, so that the evaluation may be done again */
+    evaluation.results = evaluation.inputs;
+    evaluation.schedules.clear();
+    evaluation.messages.clear();
+    evaluation.missingMoonFrom = QDateTime();
+    evaluation.missingMoonTo   = QDateTime();
+
+    QList<SchedulerJob *> sortedJobs;
+    for (SchedulerJob &job : evaluation.results)
+        sortedJobs.append(&job);
+
     /* The objective of the following block is to make sure jobs are sequential in the list filtered previously.
      *
      * The algorithm manages overlap between jobs by stating that scheduled jobs that start sooner are non-movable.
@@ -1771,14 +1850,14 @@ void Scheduler::evaluateJobs()
     {
         SchedulerJob * const currentJob = sortedJobs.at(index);
 
+        // Stop there if the evaluation was cancelled
+        if (evaluation.cancelled.load())
+            return;
+
         // Bypass jobs that are not marked for evaluation - we did not remove them to preserve schedule order
         if (SchedulerJob::JOB_EVALUATION != currentJob->getState())
             continue;
 
-        // At this point, a job with no valid start date is a problem, so consider invalid startup time is now
-        if (!currentJob->getStartupTime().isValid())
-            currentJob->setStartupTime(now);
-
         // Locate the previous scheduled job, so that a full schedule plan may be actually consolidated
         SchedulerJob const * previousJob = nullptr;
         for (int i = index - 1; 0 <= i; i--)
@@ -1802,410 +1881,545 @@ void Scheduler::evaluateJobs()
         Q_ASSERT_X(nullptr == nextJob
                    || nextJob != currentJob, __FUNCTION__, "Next job considered for schedule is either undefined or not equal to current.");
 
-        // We're attempting to schedule the job 10 times before making it invalid
-        for (int attempt = 1; attempt < 11; attempt++)
+        // If the job, its siblings and the conditions did not change since the previous evaluation, reuse its schedule
+        QByteArray const key = scheduleKey(evaluation, currentJob, previousJob, nextJob);
+        QStringList messages;
+        QDateTime evaluatedAt = now;
+
+        auto const previousSchedule = evaluation.previousSchedules.constFind(key);
+        if (previousSchedule != evaluation.previousSchedules.constEnd() && isScheduleValid(*previousSchedule, now))
         {
-            qCDebug(KSTARS_EKOS_SCHEDULER) <<
-                                           QString("Schedule attempt #%1 for %2-second job '%3' on row #%4 starting at %5, completing at %6.")
-                                           .arg(attempt)
-                                           .arg(static_cast<int>(currentJob->getEstimatedTime()))
+            currentJob->setStartupTime(previousSchedule->startupTime);
+            currentJob->setLeadTime(previousSchedule->leadTime);
+            if (SchedulerJob::JOB_SCHEDULED == previousSchedule->state)
+                currentJob->setScore(calculateJobScore(currentJob, evaluation.dawn, evaluation.dusk, evaluation.preDawnTime, now));
+            currentJob->setState(previousSchedule->state);
+            messages    = previousSchedule->messages;
+            evaluatedAt = previousSchedule->evaluatedAt;
+
+            qCDebug(KSTARS_EKOS_SCHEDULER) << QString("Job '%1' on row #%2 keeps its schedule from the previous evaluation.")
                                            .arg(currentJob->getName())
-                                           .arg(index + 1)
-                                           .arg(currentJob->getStartupTime().toString(currentJob->getDateTimeDisplayFormat()))
-                                           .arg(currentJob->getCompletionTime().toString(currentJob->getDateTimeDisplayFormat()));
+                                           .arg(index + 1);
+        }
+        else
+        {
+            // At this point, a job with no valid start date is a problem, so consider invalid startup time is now
+            if (!currentJob->getStartupTime().isValid())
+                currentJob->setStartupTime(now);
+
+            // We're attempting to schedule the job 10 times before making it invalid
+            for (int attempt = 1; attempt < 11; attempt++)
+            {
+                qCDebug(KSTARS_EKOS_SCHEDULER) <<
+                                               QString("Schedule attempt #%1 for %2-second job '%3' on row #%4 starting at %5, completing at %6.")
+                                               .arg(attempt)
+                                               .arg(static_cast<int>(currentJob->getEstimatedTime()))
+                                               .arg(currentJob->getName())
+                                               .arg(index + 1)
+                                               .arg(currentJob->getStartupTime().toString(currentJob->getDateTimeDisplayFormat()))
+                                               .arg(currentJob->getCompletionTime().toString(currentJob->getDateTimeDisplayFormat()));
 
 
-            // ----- #1 Should we reject the current job because of its fixed startup time?
-            //
-            // A job with fixed startup time must be processed at the time of startup, and may be late up to leadTime.
-            // When such a job repeats, its startup time is reinitialized to prevent abort - see completion algorithm.
-            // If such a job requires night time, minimum altitude or Moon separation, the consolidated startup time is checked for errors.
-            // If all restrictions are complied with, we bypass the rest of the verifications as the job cannot be moved.
+                // ----- #1 Should we reject the current job because of its fixed startup time?
+                //
+                // A job with fixed startup time must be processed at the time of startup, and may be late up to leadTime.
+                // When such a job repeats, its startup time is reinitialized to prevent abort - see completion algorithm.
+                // If such a job requires night time, minimum altitude or Moon separation, the consolidated startup time is checked for errors.
+                // If all restrictions are complied with, we bypass the rest of the verifications as the job cannot be moved.
 
-            if (SchedulerJob::START_AT == currentJob->getFileStartupCondition())
-            {
-                // Check whether the current job is too far in the past to be processed - if job is repeating, its startup time is already now
-                if (currentJob->getStartupTime().addSecs(static_cast <int> (ceil(Options::leadTime() * 60))) < now)
+                if (SchedulerJob::START_AT == currentJob->getFileStartupCondition())
                 {
-                    currentJob->setState(SchedulerJob::JOB_INVALID);
+                    // Check whether the current job is too far in the past to be processed - if job is repeating, its startup time is already now
+                    if (currentJob->getStartupTime().addSecs(static_cast <int> (ceil(evaluation.leadTime * 60))) < now)
+                    {
+                        currentJob->setState(SchedulerJob::JOB_INVALID);
 
 
-                    appendLogText(i18n("Warning: job '%1' has fixed startup time %2 set in the past, marking invalid.",
-                                       currentJob->getName(), currentJob->getStartupTime().toString(currentJob->getDateTimeDisplayFormat())));
+                        messages << i18n("Warning: job '%1' has fixed startup time %2 set in the past, marking invalid.",
+                                         currentJob->getName(), currentJob->getStartupTime().toString(currentJob->getDateTimeDisplayFormat()));
 
-                    break;
-                }
-                // Check whether the current job has a positive dark sky score at the time of startup
-                else if (true == currentJob->getEnforceTwilight() && getDarkSkyScore(currentJob->getStartupTime()) < 0)
-                {
-                    currentJob->setState(SchedulerJob::JOB_INVALID);
+                        break;
+                    }
+                    // Check whether the current job has a positive dark sky score at the time of startup
+                    else if (true == currentJob->getEnforceTwilight() && getDarkSkyScore(evaluation.dawn, evaluation.dusk, evaluation.preDawnTime, currentJob->getStartupTime()) < 0)
+                    {
+                        currentJob->setState(SchedulerJob::JOB_INVALID);
 
-                    appendLogText(i18n("Warning: job '%1' has a fixed start time incompatible with its twilight restriction, marking invalid.",
-                                       currentJob->getName()));
+                        messages << i18n("Warning: job '%1' has a fixed start time incompatible with its twilight restriction, marking invalid.",
+                                         currentJob->getName());
 
-                    break;
-                }
-                // Check whether the current job has a positive altitude score at the time of startup
-                else if (-90 < currentJob->getMinAltitude() && currentJob->getAltitudeScore(currentJob->getStartupTime()) < 0)
-                {
-                    currentJob->setState(SchedulerJob::JOB_INVALID);
+                        break;
+                    }
+                    // Check whether the current job has a positive altitude score at the time of startup
+                    else if (-90 < currentJob->getMinAltitude() && currentJob->getAltitudeScore(currentJob->getStartupTime()) < 0)
+                    {
+                        currentJob->setState(SchedulerJob::JOB_INVALID);
 
-                    appendLogText(i18n("Warning: job '%1' has a fixed start time incompatible with its altitude restriction, marking invalid.",
-                                       currentJob->getName()));
+                        messages << i18n("Warning: job '%1' has a fixed start time incompatible with its altitude restriction, marking invalid.",
+                                         currentJob->getName());
 
-                    break;
-                }
-                // Check whether the current job has a positive Moon separation score at the time of startup
-                else if (0 < currentJob->getMinMoonSeparation() && currentJob->getMoonSeparationScore(currentJob->getStartupTime()) < 0)
-                {
-                    currentJob->setState(SchedulerJob::JOB_INVALID);
+                        break;
+                    }
+                    // Check whether the current job has a positive Moon separation score at the time of startup
+                    else if (0 < currentJob->getMinMoonSeparation() && currentJob->getMoonSeparationScore(currentJob->getStartupTime()) < 0)
+                    {
+                        currentJob->setState(SchedulerJob::JOB_INVALID);
 
-                    appendLogText(
-                        i18n("Warning: job '%1' has a fixed start time incompatible with its Moon separation restriction, marking invalid.",
-                             currentJob->getName()));
+                        messages << i18n("Warning: job '%1' has a fixed start time incompatible with its Moon separation restriction, marking invalid.",
+                                         currentJob->getName());
+
+                        break;
+                    }
+
+                    // Check whether a previous job overlaps the current job
+                    if (nullptr != previousJob && previousJob->getCompletionTime().isValid())
+                    {
+                        // Calculate time we should be at after finishing the previous job
+                        QDateTime const previousCompletionTime = previousJob->getCompletionTime().addSecs(static_cast <int> (ceil(
+                                    evaluation.leadTime * 60.0)));
+
+                        // Make this job invalid if startup time is not achievable because a START_AT job is non-movable
+                        if (currentJob->getStartupTime() < previousCompletionTime)
+                        {
+                            currentJob->setState(SchedulerJob::JOB_INVALID);
+
+                            messages << i18n("Warning: job '%1' has fixed startup time %2 unachievable due to the completion time of its previous sibling, marking invalid.",
+                                             currentJob->getName(), currentJob->getStartupTime().toString(currentJob->getDateTimeDisplayFormat()));
+
+                            break;
+                        }
+
+                        currentJob->setLeadTime(previousJob->getCompletionTime().secsTo(currentJob->getStartupTime()));
+                    }
+
+                    // This job is non-movable, we're done
+                    currentJob->setScore(calculateJobScore(currentJob, evaluation.dawn, evaluation.dusk, evaluation.preDawnTime, now));
+                    currentJob->setState(SchedulerJob::JOB_SCHEDULED);
+                    qCDebug(KSTARS_EKOS_SCHEDULER) <<
+                                                   QString("Job '%1' is scheduled to start at %2, in compliance with fixed startup time requirement.")
+                                                   .arg(currentJob->getName())
+                                                   .arg(currentJob->getStartupTime().toString(currentJob->getDateTimeDisplayFormat()));
 
                     break;
                 }
 
-                // Check whether a previous job overlaps the current job
-                if (nullptr != previousJob && previousJob->getCompletionTime().isValid())
+                // ----- #2 Should we delay the current job because it overlaps the previous job?
+                //
+                // The previous job is considered non-movable, and its completion, plus lead time, is the origin for the current job.
+                // If no previous job exists, or if all prior jobs in the list are rejected, there is no overlap.
+                // If there is a previous job, the current job is simply delayed to avoid an eventual overlap.
+                // IF there is a previous job but it never finishes, the current job is rejected.
+                // This scheduling obviously relies on imaging time estimation: because errors stack up, future startup times are less and less reliable.
+
+                if (nullptr != previousJob)
                 {
-                    // Calculate time we should be at after finishing the previous job
-                    QDateTime const previousCompletionTime = previousJob->getCompletionTime().addSecs(static_cast <int> (ceil(
-                                Options::leadTime() * 60.0)));
+                    if (previousJob->getCompletionTime().isValid())
+                    {
+                        // Calculate time we should be at after finishing the previous job
+                        QDateTime const previousCompletionTime = previousJob->getCompletionTime().addSecs(static_cast <int> (ceil(
+                                    evaluation.leadTime * 60.0)));
 
-                    // Make this job invalid if startup time is not achievable because a START_AT job is non-movable
-                    if (currentJob->getStartupTime() < previousCompletionTime)
+                        // Delay the current job to completion of its previous sibling if needed - this updates the completion time automatically
+                        if (currentJob->getStartupTime() < previousCompletionTime)
+                        {
+                            currentJob->setStartupTime(previousCompletionTime);
+
+                            qCDebug(KSTARS_EKOS_SCHEDULER) <<
+                                                           QString("Job '%1' is scheduled to start at %2, %3 seconds after %4, in compliance with previous job completion requirement.")
+                                                           .arg(currentJob->getName())
+                                                           .arg(currentJob->getStartupTime().toString(currentJob->getDateTimeDisplayFormat()))
+                                                           .arg(previousJob->getCompletionTime().secsTo(currentJob->getStartupTime()))
+                                                           .arg(previousJob->getCompletionTime().toString(previousJob->getDateTimeDisplayFormat()));
+
+                            // If the job has a fixed completion, re-estimate imaging duration - other durations don't depend on startup
+                            if (SchedulerJob::FINISH_AT == currentJob->getCompletionCondition())
+                                currentJob->setEstimatedTime(currentJob->getStartupTime().secsTo(currentJob->getCompletionTime()));
+
+                            continue;
+                        }
+                    }
+                    else
                     {
                         currentJob->setState(SchedulerJob::JOB_INVALID);
 
-                        appendLogText(
-                            i18n("Warning: job '%1' has fixed startup time %2 unachievable due to the completion time of its previous sibling, marking invalid.",
-                                 currentJob->getName(), currentJob->getStartupTime().toString(currentJob->getDateTimeDisplayFormat())));
+                        messages << i18n("Warning: Job '%1' cannot start because its previous sibling has no completion time, marking invalid.",
+                                         currentJob->getName());
 
                         break;
                     }
 
                     currentJob->setLeadTime(previousJob->getCompletionTime().secsTo(currentJob->getStartupTime()));
-                }
 
-                // This job is non-movable, we're done
-                currentJob->setScore(calculateJobScore(currentJob, now));
-                currentJob->setState(SchedulerJob::JOB_SCHEDULED);
-                qCDebug(KSTARS_EKOS_SCHEDULER) <<
-                                               QString("Job '%1' is scheduled to start at %2, in compliance with fixed startup time requirement.")
-                                               .arg(currentJob->getName())
-                                               .arg(currentJob->getStartupTime().toString(currentJob->getDateTimeDisplayFormat()));
+                    // Lead time can be zero, so completion may equal startup
+                    Q_ASSERT_X(previousJob->getCompletionTime() <= currentJob->getStartupTime(), __FUNCTION__,
+                               "Previous and current jobs do not overlap.");
+                }
 
-                break;
-            }
 
-            // ----- #2 Should we delay the current job because it overlaps the previous job?
-            //
-            // The previous job is considered non-movable, and its completion, plus lead time, is the origin for the current job.
-            // If no previous job exists, or if all prior jobs in the list are rejected, there is no overlap.
-            // If there is a previous job, the current job is simply delayed to avoid an eventual overlap.
-            // IF there is a previous job but it never finishes, the current job is rejected.
-            // This scheduling obviously relies on imaging time estimation: because errors stack up, future startup times are less and less reliable.
+                // ----- #3 Should we delay the current job because it overlaps daylight?
+                //
+                // Pre-dawn time rules whether a job may be started before dawn, or delayed to next night.
+                // Note that the case of START_AT jobs is considered earlier in the algorithm, thus may be omitted here.
+                // In addition to be hardcoded currently, the imaging duration is not reliable enough to start a short job during pre-dawn.
+                // However, completion time during daylight only causes a warning, as this case will be processed as the job runs.
 
-            if (nullptr != previousJob)
-            {
-                if (previousJob->getCompletionTime().isValid())
+                if (currentJob->getEnforceTwilight())
                 {
-                    // Calculate time we should be at after finishing the previous job
-                    QDateTime const previousCompletionTime = previousJob->getCompletionTime().addSecs(static_cast <int> (ceil(
-                                Options::leadTime() * 60.0)));
+                    // During that check, we don't verify the current job can actually complete before dawn.
+                    // If the job is interrupted while running, it will be aborted and rescheduled at a later time.
 
-                    // Delay the current job to completion of its previous sibling if needed - this updates the completion time automatically
-                    if (currentJob->getStartupTime() < previousCompletionTime)
-                    {
-                        currentJob->setStartupTime(previousCompletionTime);
+                    // We wouldn't start observation 30 mins (default) before dawn.
+                    // FIXME: Refactor duplicated dawn/dusk calculations
+                    double const earlyDawn = evaluation.dawn - evaluation.preDawnTime / (60.0 * 24.0);
 
-                        qCDebug(KSTARS_EKOS_SCHEDULER) <<
-                                                       QString("Job '%1' is scheduled to start at %2, %3 seconds after %4, in compliance with previous job completion requirement.")
-                                                       .arg(currentJob->getName())
-                                                       .arg(currentJob->getStartupTime().toString(currentJob->getDateTimeDisplayFormat()))
-                                                       .arg(previousJob->getCompletionTime().secsTo(currentJob->getStartupTime()))
-                                                       .arg(previousJob->getCompletionTime().toString(previousJob->getDateTimeDisplayFormat()));
+                    // Compute dawn time for the startup date of the job
+                    // FIXME: Use KAlmanac to find the real dawn/dusk time for the day the job is supposed to be processed
+                    QDateTime const dawnDateTime(currentJob->getStartupTime().date(), QTime(0, 0).addSecs(earlyDawn * 24 * 3600));
 
-                        // If the job is repeating or looping, re-estimate imaging duration - error case may be a bug
-                        if (SchedulerJob::FINISH_SEQUENCE != currentJob->getCompletionCondition())
-                            if (false == estimateJobTime(currentJob))
-                                currentJob->setState(SchedulerJob::JOB_INVALID);
+                    // Check if the job starts after dawn
+                    if (dawnDateTime < currentJob->getStartupTime())
+                    {
+                        // Compute dusk time for the startup date of the job - no lead time on dusk
+                        QDateTime duskDateTime(currentJob->getStartupTime().date(), QTime(0, 0).addSecs(evaluation.dusk * 24 * 3600));
 
-                        continue;
-                    }
-                }
-                else
-                {
-                    currentJob->setState(SchedulerJob::JOB_INVALID);
+                        // Near summer solstice, dusk may happen before dawn on the same day, shift dusk by one day in that case
+                        if (duskDateTime < dawnDateTime)
+                            duskDateTime = duskDateTime.addDays(1);
 
-                    appendLogText(i18n("Warning: Job '%1' cannot start because its previous sibling has no completion time, marking invalid.",
-                                       currentJob->getName()));
+                        // Check if the job starts before dusk
+                        if (currentJob->getStartupTime() < duskDateTime)
+                        {
+                            // Delay job to next dusk - we will check other requirements later on
+                            currentJob->setStartupTime(duskDateTime);
 
-                    break;
-                }
+                            qCDebug(KSTARS_EKOS_SCHEDULER) <<
+                                                           QString("Job '%1' is scheduled to start at %2, in compliance with night time requirement.")
+                                                           .arg(currentJob->getName())
+                                                           .arg(currentJob->getStartupTime().toString(currentJob->getDateTimeDisplayFormat()));
 
-                currentJob->setLeadTime(previousJob->getCompletionTime().secsTo(currentJob->getStartupTime()));
+                            continue;
+                        }
+                    }
 
-                // Lead time can be zero, so completion may equal startup
-                Q_ASSERT_X(previousJob->getCompletionTime() <= currentJob->getStartupTime(), __FUNCTION__,
-                           "Previous and current jobs do not overlap.");
-            }
+                    // Compute dawn time for the day following the startup time, but disregard the pre-dawn offset as we'll consider completion
+                    // FIXME: Use KAlmanac to find the real dawn/dusk time for the day next to the day the job is supposed to be processed
+                    QDateTime const nextDawnDateTime(currentJob->getStartupTime().date().addDays(1), QTime(0, 0).addSecs(evaluation.dawn * 24 * 3600));
 
+                    // Check if the completion date overlaps the next dawn, and issue a warning if so
+                    if (nextDawnDateTime < currentJob->getCompletionTime())
+                    {
+                        messages << i18n("Warning: job '%1' execution overlaps daylight, it will be interrupted at dawn and rescheduled on next night time.",
+                                         currentJob->getName());
+                    }
 
-            // ----- #3 Should we delay the current job because it overlaps daylight?
-            //
-            // Pre-dawn time rules whether a job may be started before dawn, or delayed to next night.
-            // Note that the case of START_AT jobs is considered earlier in the algorithm, thus may be omitted here.
-            // In addition to be hardcoded currently, the imaging duration is not reliable enough to start a short job during pre-dawn.
-            // However, completion time during daylight only causes a warning, as this case will be processed as the job runs.
 
-            if (currentJob->getEnforceTwilight())
-            {
-                // During that check, we don't verify the current job can actually complete before dawn.
-                // If the job is interrupted while running, it will be aborted and rescheduled at a later time.
+                    Q_ASSERT_X(0 <= getDarkSkyScore(evaluation.dawn, evaluation.dusk, evaluation.preDawnTime, currentJob->getStartupTime()), __FUNCTION__,
+                               "Consolidated startup time results in a positive dark sky score.");
+                }
 
-                // We wouldn't start observation 30 mins (default) before dawn.
-                // FIXME: Refactor duplicated dawn/dusk calculations
-                double const earlyDawn = Dawn - Options::preDawnTime() / (60.0 * 24.0);
 
-                // Compute dawn time for the startup date of the job
-                // FIXME: Use KAlmanac to find the real dawn/dusk time for the day the job is supposed to be processed
-                QDateTime const dawnDateTime(currentJob->getStartupTime().date(), QTime(0, 0).addSecs(earlyDawn * 24 * 3600));
+                // ----- #4 Should we delay the current job because of its target culmination?
+                //
+                // Culmination uses the transit time, and fixes the startup time of the job to a particular offset around this transit time.
+                // This restriction may be used to start a job at the least air mass, or after a meridian flip.
+                // Culmination is scheduled before altitude restriction because it is normally more restrictive for the resulting startup time.
+                // It may happen that a target cannot rise enough to comply with the altitude restriction, but a culmination time is always valid.
 
-                // Check if the job starts after dawn
-                if (dawnDateTime < currentJob->getStartupTime())
+                if (SchedulerJob::START_CULMINATION == currentJob->getFileStartupCondition())
                 {
-                    // Compute dusk time for the startup date of the job - no lead time on dusk
-                    QDateTime duskDateTime(currentJob->getStartupTime().date(), QTime(0, 0).addSecs(Dusk * 24 * 3600));
+                    // Consolidate the culmination time, with offset, of the current job
+                    QDateTime const nextCulminationTime = currentJob->calculateCulmination(currentJob->getStartupTime());
 
-                    // Near summer solstice, dusk may happen before dawn on the same day, shift dusk by one day in that case
-                    if (duskDateTime < dawnDateTime)
-                        duskDateTime = duskDateTime.addDays(1);
-
-                    // Check if the job starts before dusk
-                    if (currentJob->getStartupTime() < duskDateTime)
+                    if (nextCulminationTime.isValid()) // Guaranteed
                     {
-                        // Delay job to next dusk - we will check other requirements later on
-                        currentJob->setStartupTime(duskDateTime);
+                        if (currentJob->getStartupTime() < nextCulminationTime)
+                        {
+                            currentJob->setStartupTime(nextCulminationTime);
 
-                        qCDebug(KSTARS_EKOS_SCHEDULER) <<
-                                                       QString("Job '%1' is scheduled to start at %2, in compliance with night time requirement.")
-                                                       .arg(currentJob->getName())
-                                                       .arg(currentJob->getStartupTime().toString(currentJob->getDateTimeDisplayFormat()));
+                            qCDebug(KSTARS_EKOS_SCHEDULER) <<
+                                                           QString("Job '%1' is scheduled to start at %2, in compliance with culmination requirements.")
+                                                           .arg(currentJob->getName())
+                                                           .arg(currentJob->getStartupTime().toString(currentJob->getDateTimeDisplayFormat()));
 
-                        continue;
+                            continue;
+                        }
                     }
-                }
+                    else
+                    {
+                        currentJob->setState(SchedulerJob::JOB_INVALID);
 
-                // Compute dawn time for the day following the startup time, but disregard the pre-dawn offset as we'll consider completion
-                // FIXME: Use KAlmanac to find the real dawn/dusk time for the day next to the day the job is supposed to be processed
-                QDateTime const nextDawnDateTime(currentJob->getStartupTime().date().addDays(1), QTime(0, 0).addSecs(Dawn * 24 * 3600));
+                        messages << i18n("Warning: job '%1' requires culmination offset of %2 minutes, not achievable, marking invalid.",
+                                         currentJob->getName(),
+                                         QString("%L1").arg(currentJob->getCulminationOffset()));
 
-                // Check if the completion date overlaps the next dawn, and issue a warning if so
-                if (nextDawnDateTime < currentJob->getCompletionTime())
-                {
-                    appendLogText(
-                        i18n("Warning: job '%1' execution overlaps daylight, it will be interrupted at dawn and rescheduled on next night time.",
-                             currentJob->getName()));
+                        break;
+                    }
+
+                    // Don't test altitude here, because we will push the job during the next check step
+                    // Q_ASSERT_X(0 <= getAltitudeScore(currentJob, currentJob->getStartupTime()), __FUNCTION__, "Consolidated altitude time results in a positive altitude score.");
                 }
 
 
-                Q_ASSERT_X(0 <= getDarkSkyScore(currentJob->getStartupTime()), __FUNCTION__,
-                           "Consolidated startup time results in a positive dark sky score.");
-            }
+                // ----- #5 Should we delay the current job because its altitude is incorrect?
+                //
+                // Altitude time ensures the job is assigned a startup time when its target is high enough.
+                // As other restrictions, the altitude is only considered for startup time, completion time is managed while the job is running.
+                // Because a target setting down is a problem for the schedule, a cutoff altitude is added in the case the job target is past the meridian at startup time.
+                // FIXME: though arguable, Moon separation is also considered in that restriction check - move it to a separate case.
 
+                if (-90 < currentJob->getMinAltitude())
+                {
+                    // Consolidate a new altitude time from the startup time of the current job
+                    QDateTime const nextAltitudeTime = currentJob->calculateAltitudeTime(currentJob->getStartupTime());
 
-            // ----- #4 Should we delay the current job because of its target culmination?
-            //
-            // Culmination uses the transit time, and fixes the startup time of the job to a particular offset around this transit time.
-            // This restriction may be used to start a job at the least air mass, or after a meridian flip.
-            // Culmination is scheduled before altitude restriction because it is normally more restrictive for the resulting startup time.
-            // It may happen that a target cannot rise enough to comply with the altitude restriction, but a culmination time is always valid.
+                    if (nextAltitudeTime.isValid())
+                    {
+                        if (currentJob->getStartupTime() < nextAltitudeTime)
+                        {
+                            currentJob->setStartupTime(nextAltitudeTime);
 
-            if (SchedulerJob::START_CULMINATION == currentJob->getFileStartupCondition())
-            {
-                // Consolidate the culmination time, with offset, of the current job
-                QDateTime const nextCulminationTime = currentJob->calculateCulmination(currentJob->getStartupTime());
+                            qCDebug(KSTARS_EKOS_SCHEDULER) <<
+                                                           QString("Job '%1' is scheduled to start at %2, in compliance with altitude and Moon separation requirements.")
+                                                           .arg(currentJob->getName())
+                                                           .arg(currentJob->getStartupTime().toString(currentJob->getDateTimeDisplayFormat()));
 
-                if (nextCulminationTime.isValid()) // Guaranteed
-                {
-                    if (currentJob->getStartupTime() < nextCulminationTime)
+                            continue;
+                        }
+                    }
+                    else
                     {
-                        currentJob->setStartupTime(nextCulminationTime);
+                        currentJob->setState(SchedulerJob::JOB_INVALID);
 
-                        qCDebug(KSTARS_EKOS_SCHEDULER) <<
-                                                       QString("Job '%1' is scheduled to start at %2, in compliance with culmination requirements.")
-                                                       .arg(currentJob->getName())
-                                                       .arg(currentJob->getStartupTime().toString(currentJob->getDateTimeDisplayFormat()));
+                        messages << i18n("Warning: job '%1' requires minimum altitude %2 and Moon separation %3, not achievable, marking invalid.",
+                                         currentJob->getName(),
+                                         QString("%L1").arg(static_cast<double>(currentJob->getMinAltitude()), 0, 'f', evaluation.altitudeDecimals),
+                                         0.0 < currentJob->getMinMoonSeparation() ?
+                                         QString("%L1").arg(static_cast<double>(currentJob->getMinMoonSeparation()), 0, 'f', evaluation.moonSeparationDecimals) :
+                                         QString("-"));
 
-                        continue;
+                        break;
                     }
-                }
-                else
-                {
-                    currentJob->setState(SchedulerJob::JOB_INVALID);
-
-                    appendLogText(i18n("Warning: job '%1' requires culmination offset of %2 minutes, not achievable, marking invalid.",
-                                       currentJob->getName(),
-                                       QString("%L1").arg(currentJob->getCulminationOffset())));
 
-                    break;
+                    Q_ASSERT_X(0 <= currentJob->getAltitudeScore(currentJob->getStartupTime()), __FUNCTION__,
+                               "Consolidated altitude time results in a positive altitude score.");
                 }
 
-                // Don't test altitude here, because we will push the job during the next check step
-                // Q_ASSERT_X(0 <= getAltitudeScore(currentJob, currentJob->getStartupTime()), __FUNCTION__, "Consolidated altitude time results in a positive altitude score.");
-            }
 
+                // ----- #6 Should we reject the current job because it overlaps the next job and that next job is not movable?
+                //
+                // If we have a blocker next to the current job, we compare the completion time of the current job and the startup time of this next job, taking lead time into account.
+                // This verification obviously relies on the imaging time to be reliable, but there's not much we can do at this stage of the implementation.
 
-            // ----- #5 Should we delay the current job because its altitude is incorrect?
-            //
-            // Altitude time ensures the job is assigned a startup time when its target is high enough.
-            // As other restrictions, the altitude is only considered for startup time, completion time is managed while the job is running.
-            // Because a target setting down is a problem for the schedule, a cutoff altitude is added in the case the job target is past the meridian at startup time.
-            // FIXME: though arguable, Moon separation is also considered in that restriction check - move it to a separate case.
+                if (nullptr != nextJob && SchedulerJob::START_AT == nextJob->getFileStartupCondition())
+                {
+                    // In the current implementation, it is not possible to abort a running job when the next job is supposed to start.
+                    // Movable jobs after this one will be delayed, but non-movable jobs are considered blockers.
 
-            if (-90 < currentJob->getMinAltitude())
-            {
-                // Consolidate a new altitude time from the startup time of the current job
-                QDateTime const nextAltitudeTime = currentJob->calculateAltitudeTime(currentJob->getStartupTime());
+                    // Calculate time we have between the end of the current job and the next job
+                    double const timeToNext = static_cast<double> (currentJob->getCompletionTime().secsTo(nextJob->getStartupTime()));
 
-                if (nextAltitudeTime.isValid())
-                {
-                    if (currentJob->getStartupTime() < nextAltitudeTime)
+                    // If that time is overlapping the next job, abort the current job
+                    if (timeToNext < evaluation.leadTime * 60)
                     {
-                        currentJob->setStartupTime(nextAltitudeTime);
+                        currentJob->setState(SchedulerJob::JOB_ABORTED);
 
-                        qCDebug(KSTARS_EKOS_SCHEDULER) <<
-                                                       QString("Job '%1' is scheduled to start at %2, in compliance with altitude and Moon separation requirements.")
-                                                       .arg(currentJob->getName())
-                                                       .arg(currentJob->getStartupTime().toString(currentJob->getDateTimeDisplayFormat()));
+                        messages << i18n("Warning: job '%1' is constrained by the start time of the next job, and cannot finish in time, marking aborted.",
+                                         currentJob->getName());
 
-                        continue;
+                        break;
                     }
+
+                    Q_ASSERT_X(currentJob->getCompletionTime().addSecs(evaluation.leadTime * 60) < nextJob->getStartupTime(), __FUNCTION__,
+                               "No overlap ");
                 }
-                else
+
+
+                // ----- #7 Should we reject the current job because it exceeded its fixed completion time?
+                //
+                // This verification simply checks that because of previous jobs, the startup time of the current job doesn't exceed its fixed completion time.
+                // Its main objective is to catch wrong dates in the FINISH_AT configuration.
+
+                if (SchedulerJob::FINISH_AT == currentJob->getCompletionCondition())
                 {
-                    currentJob->setState(SchedulerJob::JOB_INVALID);
+                    if (currentJob->getCompletionTime() < currentJob->getStartupTime())
+                    {
+                        messages << i18n("Job '%1' completion time (%2) could not be achieved before start up time (%3)",
+                                         currentJob->getName(),
+                                         currentJob->getCompletionTime().toString(currentJob->getDateTimeDisplayFormat()),
+                                         currentJob->getStartupTime().toString(currentJob->getDateTimeDisplayFormat()));
 
-                    appendLogText(
-                        i18n("Warning: job '%1' requires minimum altitude %2 and Moon separation %3, not achievable, marking invalid.",
-                             currentJob->getName(),
-                             QString("%L1").arg(static_cast<double>(currentJob->getMinAltitude()), 0, 'f', minAltitude->decimals()),
-                             0.0 < currentJob->getMinMoonSeparation() ?
-                             QString("%L1").arg(static_cast<double>(currentJob->getMinMoonSeparation()), 0, 'f', minMoonSeparation->decimals()) :
-                             QString("-")));
+                        currentJob->setState(SchedulerJob::JOB_INVALID);
 
-                    break;
+                        break;
+                    }
                 }
 
-                Q_ASSERT_X(0 <= currentJob->getAltitudeScore(currentJob->getStartupTime()), __FUNCTION__,
-                           "Consolidated altitude time results in a positive altitude score.");
-            }
 
+                // ----- #8 Should we reject the current job because of weather?
+                //
+                // That verification is left for runtime
+                //
+                // if (false == isWeatherOK(currentJob))
+                //{
+                //    currentJob->setState(SchedulerJob::JOB_ABORTED);
+                //
+                //    appendLogText(i18n("Job '%1' cannot run now because of bad weather, marking aborted.", currentJob->getName()));
+                //}
 
-            // ----- #6 Should we reject the current job because it overlaps the next job and that next job is not movable?
-            //
-            // If we have a blocker next to the current job, we compare the completion time of the current job and the startup time of this next job, taking lead time into account.
-            // This verification obviously relies on the imaging time to be reliable, but there's not much we can do at this stage of the implementation.
 
-            if (nullptr != nextJob && SchedulerJob::START_AT == nextJob->getFileStartupCondition())
-            {
-                // In the current implementation, it is not possible to abort a running job when the next job is supposed to start.
-                // Movable jobs after this one will be delayed, but non-movable jobs are considered blockers.
+                // ----- #9 Update score for current time and mark evaluating jobs as scheduled
 
-                // Calculate time we have between the end of the current job and the next job
-                double const timeToNext = static_cast<double> (currentJob->getCompletionTime().secsTo(nextJob->getStartupTime()));
+                currentJob->setScore(calculateJobScore(currentJob, evaluation.dawn, evaluation.dusk, evaluation.preDawnTime, now));
+                currentJob->setState(SchedulerJob::JOB_SCHEDULED);
 
-                // If that time is overlapping the next job, abort the current job
-                if (timeToNext < Options::leadTime() * 60)
-                {
-                    currentJob->setState(SchedulerJob::JOB_ABORTED);
+                qCDebug(KSTARS_EKOS_SCHEDULER) <<
+                                               QString("Job '%1' on row #%2 passed all checks after %3 attempts, will proceed at %4 for approximately %5 seconds, marking scheduled")
+                                               .arg(currentJob->getName())
+                                               .arg(index + 1)
+                                               .arg(attempt)
+                                               .arg(currentJob->getStartupTime().toString(currentJob->getDateTimeDisplayFormat()))
+                                               .arg(currentJob->getEstimatedTime());
 
-                    appendLogText(
-                        i18n("Warning: job '%1' is constrained by the start time of the next job, and cannot finish in time, marking aborted.",
-                             currentJob->getName()));
+                break;
+            }
 
-                    break;
-                }
+            // Check if job was successfully scheduled, else reject it
+            if (SchedulerJob::JOB_EVALUATION == currentJob->getState())
+            {
+                currentJob->setState(SchedulerJob::JOB_INVALID);
+
+                //appendLogText(i18n("Warning: job '%1' on row #%2 could not be scheduled during evaluation and is marked invalid, please review your plan.",
+                //            currentJob->getName(),
+                //            index + 1));
 
-                Q_ASSERT_X(currentJob->getCompletionTime().addSecs(Options::leadTime() * 60) < nextJob->getStartupTime(), __FUNCTION__,
-                           "No overlap ");
             }
+        }
 
+        // A detached job cannot compute the positions of the Moon, so let the GUI thread compute them and evaluate again
+        if (!evaluation.ignoreMissingMoon && currentJob->getMissingMoonEphemeris(evaluation.missingMoonFrom, evaluation.missingMoonTo))
+            return;
 
-            // ----- #7 Should we reject the current job because it exceeded its fixed completion time?
-            //
-            // This verification simply checks that because of previous jobs, the startup time of the current job doesn't exceed its fixed completion time.
-            // Its main objective is to catch wrong dates in the FINISH_AT configuration.
+        JobSchedule schedule;
+        schedule.state       = currentJob->getState();
+        schedule.startupTime = currentJob->getStartupTime();
+        schedule.leadTime    = currentJob->getLeadTime();
+        schedule.evaluatedAt = evaluatedAt;
+        schedule.messages    = messages;
+        evaluation.schedules.insert(key, schedule);
+        evaluation.messages.append(messages);
+    }
+}
 
-            if (SchedulerJob::FINISH_AT == currentJob->getCompletionCondition())
-            {
-                if (currentJob->getCompletionTime() < currentJob->getStartupTime())
-                {
-                    appendLogText(i18n("Job '%1' completion time (%2) could not be achieved before start up time (%3)",
-                                       currentJob->getName(),
-                                       currentJob->getCompletionTime().toString(currentJob->getDateTimeDisplayFormat()),
-                                       currentJob->getStartupTime().toString(currentJob->getDateTimeDisplayFormat())));
+QByteArray Scheduler::scheduleKey(JobEvaluation const &evaluation, SchedulerJob const *job, SchedulerJob const *previousJob,
+                                  SchedulerJob const *nextJob)
+{
+    QByteArray key;
+    QDataStream stream(&key, QIODevice::WriteOnly);
+    GeoLocation const &geo = evaluation.conditions->geo;
+
+    // Conditions of the evaluation - the current time is not part of them, see isScheduleValid()
+    stream << evaluation.dawn << evaluation.dusk << evaluation.leadTime
+           << evaluation.preDawnTime << evaluation.settingAltitudeCutoff << evaluation.altitudeDecimals
+           << evaluation.moonSeparationDecimals << geo.lat()->Degrees() << geo.lng()->Degrees() << geo.TZ();
+
+    // Job, as it is before scheduling
+    stream << job->getName() << job->getDateTimeDisplayFormat() << job->getTargetCoords().ra0().Hours()
+           << job->getTargetCoords().dec0().Degrees() << static_cast<int>(job->getFileStartupCondition())
+           << static_cast<int>(job->getStartupCondition()) << job->getFileStartupTime() << job->getStartupTime()
+           << static_cast<int>(job->getCompletionCondition()) << job->getCompletionTime()
+           << static_cast<qint64>(job->getEstimatedTime()) << static_cast<qint64>(job->getLeadTime())
+           << job->getMinAltitude() << job->getMinMoonSeparation() << job->getEnforceTwilight()
+           << job->getCulminationOffset() << job->getLightFramesRequired();
+
+    // Siblings the job is scheduled against
+    stream << (nullptr != previousJob) << (previousJob ? previousJob->getCompletionTime() : QDateTime());
+    stream << (nullptr != nextJob) << (nextJob ? static_cast<int>(nextJob->getFileStartupCondition()) : 0)
+           << (nextJob ? nextJob->getStartupTime() : QDateTime());
+
+    return key;
+}
 
-                    currentJob->setState(SchedulerJob::JOB_INVALID);
+bool Scheduler::isScheduleValid(JobSchedule const &schedule, QDateTime const &now)
+{
+    // A schedule computed in the future of the evaluation, as when the clock of KStars is set back, is not valid
+    if (!schedule.evaluatedAt.isValid() || now < schedule.evaluatedAt)
+        return false;
 
-                    break;
-                }
-            }
+    // A scheduled job whose startup time passed must be scheduled again from now
+    if (SchedulerJob::JOB_SCHEDULED == schedule.state && schedule.startupTime < now)
+        return false;
 
+    return true;
+}
 
-            // ----- #8 Should we reject the current job because of weather?
-            //
-            // That verification is left for runtime
-            //
-            // if (false == isWeatherOK(currentJob))
-            //{
-            //    currentJob->setState(SchedulerJob::JOB_ABORTED);
-            //
-            //    appendLogText(i18n("Job '%1' cannot run now because of bad weather, marking aborted.", currentJob->getName()));
-            //}
+void Scheduler::applyJobEvaluation()
+{
+    std::shared_ptr<JobEvaluation> const evaluation = jobEvaluationWatcher.result();
 
+    /* Drop the result of an evaluation that was cancelled meanwhile */
+    if (evaluation != jobEvaluation || evaluation->cancelled.load())
+        return;
 
-            // ----- #9 Update score for current time and mark evaluating jobs as scheduled
+    /* If the worker missed positions of the Moon, compute them with a margin and schedule again */
+    /* The positions already computed for this evaluation are kept, so each restart covers a wider interval */
+    if (evaluation->missingMoonFrom.isValid())
+    {
+        evaluation->moonFrom = std::min(evaluation->moonFrom, evaluation->missingMoonFrom);
+        evaluation->moonTo   = std::max(evaluation->moonTo, evaluation->missingMoonTo.addDays(1));
 
-            currentJob->setScore(calculateJobScore(currentJob, now));
-            currentJob->setState(SchedulerJob::JOB_SCHEDULED);
+        qCDebug(KSTARS_EKOS_SCHEDULER) << QString("Computing Moon positions from %1 to %2 for job evaluation.")
+                                       .arg(evaluation->moonFrom.toString(Qt::ISODate))
+                                       .arg(evaluation->moonTo.toString(Qt::ISODate));
 
-            qCDebug(KSTARS_EKOS_SCHEDULER) <<
-                                           QString("Job '%1' on row #%2 passed all checks after %3 attempts, will proceed at %4 for approximately %5 seconds, marking scheduled")
-                                           .arg(currentJob->getName())
-                                           .arg(index + 1)
-                                           .arg(attempt)
-                                           .arg(currentJob->getStartupTime().toString(currentJob->getDateTimeDisplayFormat()))
-                                           .arg(currentJob->getEstimatedTime());
+        SchedulerJob::updateMoonEphemeris(evaluation->moonFrom, evaluation->moonTo);
 
-            break;
+        /* Don't restart endlessly, consider the Moon below the horizon where its position is still missing */
+        if (MAX_MOON_RESTARTS <= ++evaluation->moonRestarts)
+        {
+            qCWarning(KSTARS_EKOS_SCHEDULER) << "Job evaluation still misses Moon positions after" << evaluation->moonRestarts
+                                             << "attempts, ignoring those.";
+            evaluation->ignoreMissingMoon = true;
         }
 
-        // Check if job was successfully scheduled, else reject it
-        if (SchedulerJob::JOB_EVALUATION == currentJob->getState())
-        {
-            currentJob->setState(SchedulerJob::JOB_INVALID);
+        startJobScheduling(evaluation);
+        return;
+    }
 
-            //appendLogText(i18n("Warning: job '%1' on row #%2 could not be scheduled during evaluation and is marked invalid, please review your plan.",
-            //            currentJob->getName(),
-            //            index + 1));
+    jobEvaluation.reset();
+    lastJobEvaluation = evaluation;
 
-        }
+    /* Apply the schedule of the jobs that were evaluated, unless they changed meanwhile */
+    QList<SchedulerJob *> const sortedJobs = evaluation->jobs;
+    for (int index = 0; index < sortedJobs.size(); index++)
+    {
+        if (SchedulerJob::JOB_EVALUATION == evaluation->inputs.at(index).getState() &&
+                SchedulerJob::JOB_EVALUATION == sortedJobs.at(index)->getState())
+            sortedJobs.at(index)->setSchedule(evaluation->results.at(index));
     }
 
+    for (QString const &message : evaluation->messages)
+        appendLogText(message);
+
     /* Apply sorting to queue table, and mark it for saving if it changes */
     mDirty = reorderJobs(sortedJobs) | mDirty;
 
-    if (jobEvaluationOnly || state != SCHEDULER_RUNNING)
+    if (!evaluation->selectJob || state != SCHEDULER_RUNNING)
     {
         qCInfo(KSTARS_EKOS_SCHEDULER) << "Ekos finished evaluating jobs, no job selection required.";
-        jobEvaluationOnly = false;
         return;
     }
 
+    selectNextJob(sortedJobs);
+
+    /* If there is no current job after evaluation, shutdown */
+    if (nullptr == currentJob)
+        checkShutdownState();
+}
+
+void Scheduler::selectNextJob(QList<SchedulerJob *> sortedJobs)
+{
+    QDateTime const now = KStarsData::Instance()->lt();
+
     /*
      * At this step, we finished evaluating jobs.
      * We select the first job that has to be run, per schedule.
@@ -2218,12 +2432,18 @@ void Scheduler::evaluateJobs()
         return SchedulerJob::JOB_SCHEDULED != s && SchedulerJob::JOB_ABORTED != s;
     };
 
+    /* This predicate matches jobs that aborted, or completed for whatever reason */
+    auto finished_or_aborted = [](SchedulerJob const * const job)
+    {
+        SchedulerJob::JOBStatus const s = job->getState();
+        return SchedulerJob::JOB_ERROR <= s || SchedulerJob::JOB_ABORTED == s;
+    };
+
     /* If there are no jobs left to run in the filtered list, stop evaluation */
     if (sortedJobs.isEmpty() || std::all_of(sortedJobs.begin(), sortedJobs.end(), neither_scheduled_nor_aborted))
     {
         appendLogText(i18n("No jobs left in the scheduler queue after evaluating."));
         setCurrentJob(nullptr);
-        jobEvaluationOnly = false;
         return;
     }
     /* If there are only aborted jobs that can run, reschedule those and let Scheduler restart one loop */
@@ -2237,7 +2457,6 @@ void Scheduler::evaluateJobs()
                 job->setState(SchedulerJob::JOB_EVALUATION);
         });
 
-        jobEvaluationOnly = false;
         return;
     }
 
@@ -2253,14 +2472,13 @@ void Scheduler::evaluateJobs()
     {
         appendLogText(i18n("No jobs left in the scheduler queue after schedule cleanup."));
         setCurrentJob(nullptr);
-        jobEvaluationOnly = false;
         return;
     }
 
     /* Check if job can be processed right now */
     SchedulerJob * const job_to_execute = *job_to_execute_iterator;
     if (job_to_execute->getFileStartupCondition() == SchedulerJob::START_ASAP)
-        if( 0 <= calculateJobScore(job_to_execute, now))
+        if( 0 <= calculateJobScore(job_to_execute, Dawn, Dusk, now))
             job_to_execute->setStartupTime(now);
 
     qCDebug(KSTARS_EKOS_SCHEDULER) << QString("Job '%1' is selected for next observation with priority #%2 and score %3.")
@@ -2307,7 +2525,12 @@ int16_t Scheduler::getWeatherScore() const
     return 0;
 }
 
-int16_t Scheduler::getDarkSkyScore(QDateTime const &when) const
+int16_t Scheduler::getDarkSkyScore(double dawn, double dusk, QDateTime const &when)
+{
+    return getDarkSkyScore(dawn, dusk, Options::preDawnTime(), when.isValid() ? when : KStarsData::Instance()->lt());
+}
+
+int16_t Scheduler::getDarkSkyScore(double dawn, double dusk, double preDawnTime, QDateTime const &when)
 {
     double const secsPerDay = 24.0 * 3600.0;
     double const minsPerDay = 24.0 * 60.0;
@@ -2319,17 +2542,16 @@ int16_t Scheduler::getDarkSkyScore(QDateTime const &when) const
     // - If observation is after dusk, score is fraction of the day from dusk to beginning of observation, as percentage.
     // - If observation is between dawn and dusk, score is BAD_SCORE.
     //
-    // If observation time is invalid, the score is calculated for the current day time.
+    // If observation time is invalid, the overload without pre-dawn time calculates the score for the current day time.
     // Note exact dusk time is considered valid in terms of night time, and will return a positive, albeit null, score.
 
     // FIXME: Dark sky score should consider the middle of the local night as best value.
     // FIXME: Current algorithm uses the dawn and dusk of today, instead of the day of the observation.
 
-    int const earlyDawnSecs = static_cast <int> ((Dawn - static_cast <double> (Options::preDawnTime()) / minsPerDay) *
-                              secsPerDay);
-    int const dawnSecs = static_cast <int> (Dawn * secsPerDay);
-    int const duskSecs = static_cast <int> (Dusk * secsPerDay);
-    int const obsSecs = (when.isValid() ? when : KStarsData::Instance()->lt()).time().msecsSinceStartOfDay() / 1000;
+    int const earlyDawnSecs = static_cast <int> ((dawn - preDawnTime / minsPerDay) * secsPerDay);
+    int const dawnSecs = static_cast <int> (dawn * secsPerDay);
+    int const duskSecs = static_cast <int> (dusk * secsPerDay);
+    int const obsSecs = when.time().msecsSinceStartOfDay() / 1000;
 
     int16_t score = 0;
 
@@ -2369,7 +2591,13 @@ int16_t Scheduler::getDarkSkyScore(QDateTime const &when) const
     return score;
 }
 
-int16_t Scheduler::calculateJobScore(SchedulerJob const *job, QDateTime const &when) const
+int16_t Scheduler::calculateJobScore(SchedulerJob const *job, double dawn, double dusk, QDateTime const &when)
+{
+    return calculateJobScore(job, dawn, dusk, Options::preDawnTime(), when);
+}
+
+int16_t Scheduler::calculateJobScore(SchedulerJob const *job, double dawn, double dusk, double preDawnTime,
+                                     QDateTime const &when)
 {
     if (nullptr == job)
         return BAD_SCORE;
@@ -2384,7 +2612,8 @@ int16_t Scheduler::calculateJobScore(SchedulerJob const *job, QDateTime const &w
 
     if (job->getEnforceTwilight())
     {
-        int16_t const darkSkyScore = getDarkSkyScore(when);
+        int16_t const darkSkyScore = when.isValid() ? getDarkSkyScore(dawn, dusk, preDawnTime, when) :
+                                     getDarkSkyScore(dawn, dusk, when);
 
         qCDebug(KSTARS_EKOS_SCHEDULER) << QString("Job '%1' dark sky score is %2 at %3")
                                        .arg(job->getName())
@@ -3185,13 +3414,17 @@ bool Scheduler::checkStatus()
         if (checkParkWaitState() == false)
             return false;
 
-        // #2.4 If not in shutdown state, evaluate the jobs
+        // #2.4 If not in shutdown state, evaluate the jobs - wait for an evaluation in progress to complete
+        if (jobEvaluation)
+            return false;
+
         evaluateJobs();
 
-        // #2.5 If there is no current job after evaluation, shutdown
+        // #2.5 If there is no current job after evaluation, wait for the evaluation to complete or shutdown
         if (nullptr == currentJob)
         {
-            checkShutdownState();
+            if (!jobEvaluation)
+                checkShutdownState();
             return false;
         }
     }
@@ -3742,6 +3975,7 @@ bool Scheduler::loadScheduler(const QString &fileURL)
     while (queueTable->rowCount() > 0)
         queueTable->removeRow(0);
 
+    cancelJobEvaluation();
     qDeleteAll(jobs);
     jobs.clear();
 
@@ -6055,6 +6289,7 @@ void Scheduler::startMosaicTool()
             if (KMessageBox::questionYesNo(nullptr,
                                            i18n("Do you want to keep the existing jobs in the mosaic schedule?")) == KMessageBox::No)
             {
+                cancelJobEvaluation();
                 qDeleteAll(jobs);
                 jobs.clear();
                 while (queueTable->rowCount() > 0)
@@ -6441,6 +6676,7 @@ bool Scheduler::loadSequenceQueue(const QString &fileURL, SchedulerJob *schedJob
         {
             appendLogText(QString(errmsg));
             delLilXML(xmlParser);
+            cancelJobEvaluation();
             qDeleteAll(jobs);
             return false;
         }
@@ -12,11 +12,13 @@
 #pragma once
 
 #include "ui_scheduler.h"
+#include "schedulerjob.h"
 #include "ekos/align/align.h"
 #include "indi/indiweather.h"
 
 #include <lilxml.h>
 
+#include <QFutureWatcher>
 #include <QProcess>
 #include <QTime>
 #include <QTimer>
@@ -24,13 +26,14 @@
 #include <QtDBus>
 
 #include <cstdint>
+#include <memory>
 
 class QProgressIndicator;
 
 class GeoLocation;
-class SchedulerJob;
 class SkyObject;
 class KConfigDialog;
+class TestSchedulerEvaluation;
 
 namespace Ekos
 {
@@ -485,12 +488,111 @@ class Scheduler : public QWidget, public Ui::Scheduler
         void newTarget(const QString &);
 
     private:
+        friend class ::TestSchedulerEvaluation;
+
+        /** @internal Schedule of a job in an evaluation, reused by the next evaluation while the job and its conditions don't change. */
+        struct JobSchedule
+        {
+            SchedulerJob::JOBStatus state { SchedulerJob::JOB_EVALUATION };
+            QDateTime startupTime;
+            int64_t leadTime { 0 };
+            /// Local time of the evaluation the schedule was computed in
+            QDateTime evaluatedAt;
+            /// Messages logged while scheduling the job
+            QStringList messages;
+        };
+
+        /** @internal Pass of job evaluation: copies of the jobs and of the conditions to schedule them with, and the result, see evaluateJobs(). */
+        struct JobEvaluation
+        {
+            /// Jobs evaluated, in schedule order - only used in the GUI thread
+            QList<SchedulerJob *> jobs;
+            /// Whether to select the next job once the jobs are scheduled
+            bool selectJob { false };
+
+            /// Detached copies of the jobs, before and after scheduling
+            std::vector<SchedulerJob> inputs;
+            std::vector<SchedulerJob> results;
+
+            /// Conditions the jobs are scheduled with, captured from the GUI thread
+            std::shared_ptr<SchedulerJob::Conditions const> conditions;
+            QDateTime now;
+            double dawn { -1 };
+            double dusk { -1 };
+            double leadTime { 0 };
+            double preDawnTime { 0 };
+            double settingAltitudeCutoff { 0 };
+            int altitudeDecimals { 0 };
+            int moonSeparationDecimals { 0 };
+
+            /// Schedules of the previous evaluation, and of this one, by job inputs - see scheduleKey()
+            QHash<QByteArray, JobSchedule> previousSchedules;
+            QHash<QByteArray, JobSchedule> schedules;
+            /// Messages to log when the evaluation is applied
+            QStringList messages;
+            /// UTC interval of the positions of the Moon the evaluation missed, if valid
+            QDateTime missingMoonFrom;
+            QDateTime missingMoonTo;
+            /// UTC interval of the positions of the Moon computed for the evaluation so far
+            QDateTime moonFrom;
+            QDateTime moonTo;
+            /// Number of times the evaluation was restarted to compute missing positions of the Moon
+            int moonRestarts { 0 };
+            /// Whether to consider missing positions of the Moon below the horizon instead of stopping
+            bool ignoreMissingMoon { false };
+
+            /// Set from the GUI thread when the evaluation is superseded
+            QAtomicInt cancelled { 0 };
+        };
+
         /**
              * @brief evaluateJobs evaluates the current state of each objects and gives each one a score based on the constraints.
              * Given that score, the scheduler will decide which is the best job that needs to be executed.
+             * Jobs are scheduled in a worker thread, on copies of the jobs, and the result is applied when the worker is done.
+             * Evaluating again while a worker runs cancels that worker.
              */
         void evaluateJobs();
 
+        /**
+             * @brief startJobScheduling Schedule the jobs of an evaluation pass in a worker thread.
+             */
+        void startJobScheduling(std::shared_ptr<JobEvaluation> const &evaluation);
+
+        /**
+             * @brief applyJobEvaluation Apply the schedule computed by the worker thread to the jobs, and select the next job if required.
+             */
+        void applyJobEvaluation();
+
+        /**
+             * @brief selectNextJob Select the first scheduled job to execute, after evaluation.
+             * @param sortedJobs the evaluated jobs, in schedule order.
+             */
+        void selectNextJob(QList<SchedulerJob *> sortedJobs);
+
+        /**
+             * @brief cancelJobEvaluation Drop the evaluation in progress, if any, before the jobs change.
+             */
+        void cancelJobEvaluation();
+
+        /**
+             * @brief scheduleJobs Schedule the detached copies of the jobs of an evaluation, one after the other.
+             * This runs in a worker thread: only the evaluation is used, and the jobs whose inputs did not change since the
+             * previous evaluation reuse their previous schedule.
+             */
+        static void scheduleJobs(JobEvaluation &evaluation);
+
+        /**
+             * @brief scheduleKey Get the values the schedule of a job depends on, in an evaluation.
+             */
+        static QByteArray scheduleKey(JobEvaluation const &evaluation, SchedulerJob const *job, SchedulerJob const *previousJob,
+                                      SchedulerJob const *nextJob);
+
+        /**
+             * @brief isScheduleValid Check whether a schedule of a previous evaluation is still valid at a later time.
+             * Schedules don't depend on the current time, except when a scheduled startup time passes.
+             */
+        static bool isScheduleValid(JobSchedule const &schedule, QDateTime const &now);
+
         /**
              * @brief executeJob After the best job is selected, we call this in order to start the process that will execute the job.
              * checkJobStatus slot will be connected in order to figure the exact state of the current job each second
@@ -502,18 +604,37 @@ class Scheduler : public QWidget, public Ui::Scheduler
 
         /**
              * @brief getDarkSkyScore Get the dark sky score of a date and time. The further from dawn the better.
+             * @param dawn day fraction of dawn
+             * @param dusk day fraction of dusk
              * @param when date and time to check the dark sky score, now if omitted
              * @return Dark sky score. Daylight get bad score, as well as pre-dawn to dawn.
              */
-        int16_t getDarkSkyScore(QDateTime const &when = QDateTime()) const;
+        static int16_t getDarkSkyScore(double dawn, double dusk, QDateTime const &when = QDateTime());
+
+        /**
+             * @brief getDarkSkyScore Get the dark sky score of a date and time, with an explicit pre-dawn time.
+             * @param preDawnTime minutes before dawn during which observation is not started
+             * @see getDarkSkyScore(double, double, QDateTime const &)
+             */
+        static int16_t getDarkSkyScore(double dawn, double dusk, double preDawnTime, QDateTime const &when);
 
         /**
              * @brief calculateJobScore Calculate job dark sky score, altitude score, and moon separation scores and returns the sum.
              * @param job Target
+             * @param dawn day fraction of dawn
+             * @param dusk day fraction of dusk
              * @param when date and time to evaluate constraints, now if omitted.
              * @return Total score
              */
-        int16_t calculateJobScore(SchedulerJob const *job, QDateTime const &when = QDateTime()) const;
+        static int16_t calculateJobScore(SchedulerJob const *job, double dawn, double dusk, QDateTime const &when = QDateTime());
+
+        /**
+             * @brief calculateJobScore Calculate job score with an explicit pre-dawn time, as the scheduling worker does.
+             * @param preDawnTime minutes before dawn during which observation is not started
+             * @see calculateJobScore(SchedulerJob const *, double, double, QDateTime const &)
+             */
+        static int16_t calculateJobScore(SchedulerJob const *job, double dawn, double dusk, double preDawnTime,
+                                         QDateTime const &when);
 
         /**
              * @brief getWeatherScore Get current weather condition score.
@@ -748,6 +869,11 @@ class Scheduler : public QWidget, public Ui::Scheduler
         bool preemptiveShutdown { false };
         /// Only run job evaluation
         bool jobEvaluationOnly { false };
+        /// Job evaluation in progress, and last job evaluation applied
+        std::shared_ptr<JobEvaluation> jobEvaluation;
+        std::shared_ptr<JobEvaluation> lastJobEvaluation;
+        /// Worker thread scheduling the jobs of the job evaluation in progress
+        QFutureWatcher<std::shared_ptr<JobEvaluation>> jobEvaluationWatcher;
         /// Keep track of Load & Slew operation
         bool loadAndSlewProgress { false };
         /// Check if initial autofocus is completed and do not run autofocus until there is a change is telescope position/alignment.
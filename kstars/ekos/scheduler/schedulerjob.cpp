@@ -19,14 +19,31 @@
 
 #include <QTableWidgetItem>
 
+#include <algorithm>
+
 #include <ekos_scheduler_debug.h>
 
 #define BAD_SCORE -1000
 #define MIN_ALTITUDE 15.0
 
+// Ephemeris cache: seconds between samples, number of samples, and samples before the date that fills the cache
+#define EPHEMERIS_STEP (5 * 60)
+#define EPHEMERIS_SAMPLES (48 * 60 * 60 / EPHEMERIS_STEP)
+#define EPHEMERIS_BEFORE (6 * 60 * 60 / EPHEMERIS_STEP)
+// Positions of the Moon kept in addition to the last requested interval before the others are dropped: a week of samples
+#define MOON_SAMPLES_MAX (7 * 24 * 60 * 60 / EPHEMERIS_STEP)
+
+QHash<qint64, SchedulerJob::MoonSample> SchedulerJob::moonSamples;
+QVector<double> SchedulerJob::moonSamplesLocation;
+qint64 SchedulerJob::moonSamplesFirst { 0 };
+qint64 SchedulerJob::moonSamplesLast { -1 };
+QReadWriteLock SchedulerJob::moonSamplesLock;
+
 SchedulerJob::SchedulerJob()
 {
-    moon = dynamic_cast<KSMoon *>(KStarsData::Instance()->skyComposite()->findByName(i18n("Moon")));
+    KStarsData * const data = KStarsData::Instance();
+    if (data && data->skyComposite())
+        moon = dynamic_cast<KSMoon *>(data->skyComposite()->findByName(i18n("Moon")));
 }
 
 void SchedulerJob::setName(const QString &value)
@@ -58,7 +75,7 @@ void SchedulerJob::setStartupTime(const QDateTime &value)
         startupCondition = fileStartupCondition;
 
     // Refresh altitude - invalid date/time is taken care of when rendering
-    altitudeAtStartup = findAltitude(targetCoords, startupTime, &isSettingAtStartup);
+    altitudeAtStartup = getAltitude(startupTime, &isSettingAtStartup);
 
     /* Refresh estimated time - which update job cells */
     setEstimatedTime(estimatedTime);
@@ -96,21 +113,21 @@ void SchedulerJob::setCompletionTime(const QDateTime &value)
     {
         setCompletionCondition(FINISH_AT);
         completionTime = value;
-        altitudeAtCompletion = findAltitude(targetCoords, completionTime, &isSettingAtCompletion);
+        altitudeAtCompletion = getAltitude(completionTime, &isSettingAtCompletion);
         setEstimatedTime(-1);
     }
     /* If completion time is invalid, and job is looping, keep completion time undefined */
     else if (FINISH_LOOP == completionCondition)
     {
         completionTime = QDateTime();
-        altitudeAtCompletion = findAltitude(targetCoords, completionTime, &isSettingAtCompletion);
+        altitudeAtCompletion = getAltitude(completionTime, &isSettingAtCompletion);
         setEstimatedTime(-1);
     }
     /* If completion time is invalid, deduce completion from startup and duration */
     else if (startupTime.isValid())
     {
         completionTime = startupTime.addSecs(estimatedTime);
-        altitudeAtCompletion = findAltitude(targetCoords, completionTime, &isSettingAtCompletion);
+        altitudeAtCompletion = getAltitude(completionTime, &isSettingAtCompletion);
         updateJobCells();
     }
     /* Else just refresh estimated time - which update job cells */
@@ -344,7 +361,7 @@ void SchedulerJob::setEstimatedTime(const int64_t &value)
     {
         estimatedTime = value;
         completionTime = startupTime.addSecs(value);
-        altitudeAtCompletion = findAltitude(targetCoords, completionTime, &isSettingAtCompletion);
+        altitudeAtCompletion = getAltitude(completionTime, &isSettingAtCompletion);
     }
     /* Else estimated time is simply stored as is - covers FINISH_LOOP from setCompletionTime */
     else estimatedTime = value;
@@ -538,9 +555,8 @@ void SchedulerJob::updateJobCells()
 
     if (nullptr != altitudeCell)
     {
-        // FIXME: Cache altitude calculations
         bool is_setting = false;
-        double const alt = findAltitude(targetCoords, QDateTime(), &is_setting);
+        double const alt = getAltitude(QDateTime(), &is_setting);
 
         altitudeCell->setText(QString("%1%L2°")
                               .arg(QChar(is_setting ? 0x2193 : 0x2191))
@@ -681,6 +697,73 @@ void SchedulerJob::reset()
     updateJobCells();
 }
 
+std::shared_ptr<SchedulerJob::Conditions const> SchedulerJob::currentConditions()
+{
+    GeoLocation const * const geo = KStarsData::Instance()->geo();
+
+    // Freeze the time zone offset in effect, the daylight saving rule is shared with the GUI thread
+    std::shared_ptr<Conditions> conditions = std::make_shared<Conditions>(
+                GeoLocation(*geo->lng(), *geo->lat(), geo->name(), geo->province(), geo->country(), geo->TZ(), nullptr,
+                            geo->elevation(), true, geo->ellipsoid()));
+    conditions->now                   = KStarsData::Instance()->lt();
+    conditions->settingAltitudeCutoff = Options::settingAltitudeCutoff();
+    conditions->leadTime              = Options::leadTime();
+    conditions->preDawnTime           = Options::preDawnTime();
+
+    return conditions;
+}
+
+SchedulerJob SchedulerJob::detached(std::shared_ptr<Conditions const> const &conditions) const
+{
+    SchedulerJob job(*this);
+
+    job.nameCell          = nullptr;
+    job.nameLabel         = nullptr;
+    job.statusCell        = nullptr;
+    job.stageCell         = nullptr;
+    job.stageLabel        = nullptr;
+    job.altitudeCell      = nullptr;
+    job.startupCell       = nullptr;
+    job.completionCell    = nullptr;
+    job.estimatedTimeCell = nullptr;
+    job.captureCountCell  = nullptr;
+    job.scoreCell         = nullptr;
+    job.leadTimeCell      = nullptr;
+
+    // The Moon of the sky map is only updated from the GUI thread
+    job.moon = nullptr;
+
+    // Neither is the location, nor the options
+    job.conditions = conditions;
+
+    return job;
+}
+
+void SchedulerJob::setSchedule(SchedulerJob const &evaluated)
+{
+    state                 = evaluated.state;
+    startupCondition      = evaluated.startupCondition;
+    startupTime           = evaluated.startupTime;
+    completionTime        = evaluated.completionTime;
+    estimatedTime         = evaluated.estimatedTime;
+    leadTime              = evaluated.leadTime;
+    score                 = evaluated.score;
+    altitudeAtStartup     = evaluated.altitudeAtStartup;
+    altitudeAtCompletion  = evaluated.altitudeAtCompletion;
+    isSettingAtStartup    = evaluated.isSettingAtStartup;
+    isSettingAtCompletion = evaluated.isSettingAtCompletion;
+
+    // Keep the positions the evaluation computed, unless the location or the target changed meanwhile
+    if (evaluated.ephemerisCacheKey == ephemerisKey())
+    {
+        ephemerisSamples  = evaluated.ephemerisSamples;
+        ephemerisCacheKey = evaluated.ephemerisCacheKey;
+        ephemerisOrigin   = evaluated.ephemerisOrigin;
+    }
+
+    updateJobCells();
+}
+
 bool SchedulerJob::decreasingScoreOrder(SchedulerJob const *job1, SchedulerJob const *job2)
 {
     return job1->getScore() > job2->getScore();
@@ -695,12 +778,12 @@ bool SchedulerJob::decreasingAltitudeOrder(SchedulerJob const *job1, SchedulerJo
 {
     bool A_is_setting = job1->isSettingAtStartup;
     double const altA = when.isValid() ?
-                        findAltitude(job1->getTargetCoords(), when, &A_is_setting) :
+                        job1->getAltitude(when, &A_is_setting) :
                         job1->altitudeAtStartup;
 
     bool B_is_setting = job2->isSettingAtStartup;
     double const altB = when.isValid() ?
-                        findAltitude(job2->getTargetCoords(), when, &B_is_setting) :
+                        job2->getAltitude(when, &B_is_setting) :
                         job2->altitudeAtStartup;
 
     // Sort with the setting target first
@@ -720,30 +803,11 @@ bool SchedulerJob::increasingStartupTimeOrder(SchedulerJob const *job1, Schedule
 
 int16_t SchedulerJob::getAltitudeScore(QDateTime const &when) const
 {
-    // FIXME: block calculating target coordinates at a particular time is duplicated in several places
-    GeoLocation *geo = KStarsData::Instance()->geo();
-
-    // Retrieve the argument date/time, or fall back to current time - don't use QDateTime's timezone!
-    KStarsDateTime ltWhen(when.isValid() ?
-                          Qt::UTC == when.timeSpec() ? geo->UTtoLT(KStarsDateTime(when)) : when :
-                          KStarsData::Instance()->lt());
-
-    // Create a sky object with the target catalog coordinates
-    SkyPoint const target = getTargetCoords();
-    SkyObject o;
-    o.setRA0(target.ra0());
-    o.setDec0(target.dec0());
-
-    // Update RA/DEC of the target for the current fraction of the day
-    KSNumbers numbers(ltWhen.djd());
-    o.updateCoordsNow(&numbers);
-
-    // Compute local sidereal time for the current fraction of the day, calculate altitude
-    CachingDms const LST = geo->GSTtoLST(geo->LTtoUT(ltWhen).gst());
-    o.EquatorialToHorizontal(&LST, geo->lat());
-    double const altitude = o.alt().Degrees();
+    // Interpolate the altitude of the target in the ephemeris cache
+    Ephemeris const target = ephemeris(when);
+    double const altitude = target.altitude;
 
-    double const SETTING_ALTITUDE_CUTOFF = Options::settingAltitudeCutoff();
+    double const SETTING_ALTITUDE_CUTOFF = optionSettingAltitudeCutoff();
     int16_t score = BAD_SCORE - 1;
 
     // If altitude is negative, bad score
@@ -759,16 +823,10 @@ int16_t SchedulerJob::getAltitudeScore(QDateTime const &when) const
             score = BAD_SCORE;
         // Else if setting and under altitude cutoff, job would end soon after starting, bad score
         // FIXME: half bad score when under altitude cutoff risk getting positive again
-        else
+        else if (target.hourAngle < 12.0)
         {
-            double offset = LST.Hours() - o.ra().Hours();
-            if (24.0 <= offset)
-                offset -= 24.0;
-            else if (offset < 0.0)
-                offset += 24.0;
-            if (0.0 <= offset && offset < 12.0)
-                if (altitude - SETTING_ALTITUDE_CUTOFF < getMinAltitude())
-                    score = BAD_SCORE / 2;
+            if (altitude - SETTING_ALTITUDE_CUTOFF < getMinAltitude())
+                score = BAD_SCORE / 2;
         }
     }
     // If not constrained but below minimum hard altitude, set score to 10% of altitude value
@@ -792,43 +850,21 @@ int16_t SchedulerJob::getAltitudeScore(QDateTime const &when) const
 
 int16_t SchedulerJob::getMoonSeparationScore(QDateTime const &when) const
 {
-    // FIXME: block calculating target coordinates at a particular time is duplicated in several places
-    GeoLocation *geo = KStarsData::Instance()->geo();
-
-    // Retrieve the argument date/time, or fall back to current time - don't use QDateTime's timezone!
-    KStarsDateTime ltWhen(when.isValid() ?
-                          Qt::UTC == when.timeSpec() ? geo->UTtoLT(KStarsDateTime(when)) : when :
-                          KStarsData::Instance()->lt());
-
-    // Create a sky object with the target catalog coordinates
-    SkyPoint const target = getTargetCoords();
-    SkyObject o;
-    o.setRA0(target.ra0());
-    o.setDec0(target.dec0());
-
-    // Update RA/DEC of the target for the current fraction of the day
-    KSNumbers numbers(ltWhen.djd());
-    o.updateCoordsNow(&numbers);
-
-    // Update moon
-    //ut = geo->LTtoUT(ltWhen);
-    //KSNumbers ksnum(ut.djd()); // BUG: possibly LT.djd() != UT.djd() because of translation
-    //LST = geo->GSTtoLST(ut.gst());
-    CachingDms LST = geo->GSTtoLST(geo->LTtoUT(ltWhen).gst());
-    moon->updateCoords(&numbers, true, geo->lat(), &LST, true);
+    // Interpolate the positions of the target and of the Moon in the ephemeris cache
+    Ephemeris const target = ephemeris(when);
 
-    double const moonAltitude = moon->alt().Degrees();
+    double const moonAltitude = target.moonAltitude;
 
     // Lunar illumination %
-    double const illum = moon->illum() * 100.0;
+    double const illum = target.moonIllumination;
 
     // Moon/Sky separation p
-    double const separation = moon->angularDistanceTo(&o).Degrees();
+    double const separation = target.moonSeparation;
 
     // Zenith distance of the moon
     double const zMoon = (90 - moonAltitude);
     // Zenith distance of target
-    double const zTarget = (90 - o.alt().Degrees());
+    double const zTarget = (90 - target.altitude);
 
     int16_t score = 0;
 
@@ -868,67 +904,28 @@ int16_t SchedulerJob::getMoonSeparationScore(QDateTime const &when) const
 
 double SchedulerJob::getCurrentMoonSeparation() const
 {
-    // FIXME: block calculating target coordinates at a particular time is duplicated in several places
-    GeoLocation *geo = KStarsData::Instance()->geo();
-
-    // Retrieve the argument date/time, or fall back to current time - don't use QDateTime's timezone!
-    KStarsDateTime ltWhen(KStarsData::Instance()->lt());
-
-    // Create a sky object with the target catalog coordinates
-    SkyPoint const target = getTargetCoords();
-    SkyObject o;
-    o.setRA0(target.ra0());
-    o.setDec0(target.dec0());
-
-    // Update RA/DEC of the target for the current fraction of the day
-    KSNumbers numbers(ltWhen.djd());
-    o.updateCoordsNow(&numbers);
-
-    // Update moon
-    //ut = geo->LTtoUT(ltWhen);
-    //KSNumbers ksnum(ut.djd()); // BUG: possibly LT.djd() != UT.djd() because of translation
-    //LST = geo->GSTtoLST(ut.gst());
-    CachingDms LST = geo->GSTtoLST(geo->LTtoUT(ltWhen).gst());
-    moon->updateCoords(&numbers, true, geo->lat(), &LST, true);
-
     // Moon/Sky separation p
-    return moon->angularDistanceTo(&o).Degrees();
+    return ephemeris(QDateTime()).moonSeparation;
 }
 
 QDateTime SchedulerJob::calculateAltitudeTime(QDateTime const &when) const
 {
-    // FIXME: block calculating target coordinates at a particular time is duplicated in several places
-    GeoLocation *geo = KStarsData::Instance()->geo();
+    GeoLocation const * const geo = location();
 
     // Retrieve the argument date/time, or fall back to current time - don't use QDateTime's timezone!
     KStarsDateTime ltWhen(when.isValid() ?
                           Qt::UTC == when.timeSpec() ? geo->UTtoLT(KStarsDateTime(when)) : when :
-                          KStarsData::Instance()->lt());
-
-    // Create a sky object with the target catalog coordinates
-    SkyPoint const target = getTargetCoords();
-    SkyObject o;
-    o.setRA0(target.ra0());
-    o.setDec0(target.dec0());
-
-    // Calculate the UT at the argument time
-    KStarsDateTime const ut = geo->LTtoUT(ltWhen);
+                          localTime());
 
-    double const SETTING_ALTITUDE_CUTOFF = Options::settingAltitudeCutoff();
+    double const SETTING_ALTITUDE_CUTOFF = optionSettingAltitudeCutoff();
 
     // Within the next 24 hours, search when the job target matches the altitude and moon constraints
+    // Positions are interpolated in the ephemeris cache, which is filled once for the whole search
     for (unsigned int minute = 0; minute < 24 * 60; minute++)
     {
         KStarsDateTime const ltOffset(ltWhen.addSecs(minute * 60));
-
-        // Update RA/DEC of the target for the current fraction of the day
-        KSNumbers numbers(ltOffset.djd());
-        o.updateCoordsNow(&numbers);
-
-        // Compute local sidereal time for the current fraction of the day, calculate altitude
-        CachingDms const LST = geo->GSTtoLST(geo->LTtoUT(ltOffset).gst());
-        o.EquatorialToHorizontal(&LST, geo->lat());
-        double const altitude = o.alt().Degrees();
+        Ephemeris const target = ephemeris(ltOffset);
+        double const altitude = target.altitude;
 
         if (getMinAltitude() <= altitude)
         {
@@ -939,12 +936,7 @@ QDateTime SchedulerJob::calculateAltitudeTime(QDateTime const &when) const
                 continue;
 
             // Continue searching if target is setting and under the cutoff
-            double offset = LST.Hours() - o.ra().Hours();
-            if (24.0 <= offset)
-                offset -= 24.0;
-            else if (offset < 0.0)
-                offset += 24.0;
-            if (0.0 <= offset && offset < 12.0)
+            if (target.hourAngle < 12.0)
                 if (altitude - SETTING_ALTITUDE_CUTOFF < getMinAltitude())
                     continue;
 
@@ -958,14 +950,15 @@ QDateTime SchedulerJob::calculateAltitudeTime(QDateTime const &when) const
 QDateTime SchedulerJob::calculateCulmination(QDateTime const &when) const
 {
     // FIXME: culmination calculation is a min altitude requirement, should be an interval altitude requirement
-    GeoLocation *geo = KStarsData::Instance()->geo();
+    GeoLocation const * const geo = location();
     // FIXME: block calculating target coordinates at a particular time is duplicated in calculateCulmination
 
     // Retrieve the argument date/time, or fall back to current time - don't use QDateTime's timezone!
     KStarsDateTime ltWhen(when.isValid() ?
                           Qt::UTC == when.timeSpec() ? geo->UTtoLT(KStarsDateTime(when)) : when :
-                          KStarsData::Instance()->lt());
+                          localTime());
 
+    // The transit time is computed once per call from the coordinates of the target, there is no search to interpolate in the ephemeris cache
     // Create a sky object with the target catalog coordinates
     SkyPoint const target = getTargetCoords();
     SkyObject o;
@@ -983,7 +976,7 @@ QDateTime SchedulerJob::calculateCulmination(QDateTime const &when) const
     KStarsDateTime observationDateTime = transitDateTime.addSecs(getCulminationOffset() * 60);
 
     // Relax observation time, culmination calculation is stable at minute only
-    KStarsDateTime relaxedDateTime = observationDateTime.addSecs(Options::leadTime() * 60);
+    KStarsDateTime relaxedDateTime = observationDateTime.addSecs(optionLeadTime() * 60);
 
     // Verify resulting observation time is under lead time vs. argument time
     // If sooner, delay by 8 hours to get to the next transit - perhaps in a third call
@@ -1054,3 +1047,256 @@ double SchedulerJob::findAltitude(const SkyPoint &target, const QDateTime &when,
 
     return o.alt().Degrees();
 }
+
+double SchedulerJob::getAltitude(QDateTime const &when, bool *is_setting) const
+{
+    Ephemeris const target = ephemeris(when);
+
+    if (is_setting)
+        *is_setting = target.hourAngle < 12.0;
+
+    return target.altitude;
+}
+
+SchedulerJob::Ephemeris SchedulerJob::ephemeris(QDateTime const &when) const
+{
+    GeoLocation const * const geo = location();
+
+    // Retrieve the argument date/time, or fall back to current time - don't use QDateTime's timezone!
+    KStarsDateTime ltWhen(when.isValid() ?
+                          Qt::UTC == when.timeSpec() ? geo->UTtoLT(KStarsDateTime(when)) : when :
+                          localTime());
+    qint64 const utWhen = geo->LTtoUT(ltWhen).toMSecsSinceEpoch();
+
+    // Drop the samples if the location or the target changed, or if the date is out of the cached interval
+    QVector<double> const key = ephemerisKey();
+    if (key != ephemerisCacheKey || utWhen < 1000 * ephemerisOrigin ||
+            1000 * (ephemerisOrigin + (EPHEMERIS_SAMPLES - 1) * EPHEMERIS_STEP) <= utWhen)
+    {
+        ephemerisCacheKey = key;
+        ephemerisOrigin   = (utWhen / 1000 / EPHEMERIS_STEP - EPHEMERIS_BEFORE) * EPHEMERIS_STEP;
+        ephemerisSamples.fill(Ephemeris(), EPHEMERIS_SAMPLES);
+    }
+
+    double const position = (utWhen - 1000 * ephemerisOrigin) / (1000.0 * EPHEMERIS_STEP);
+    int const index       = static_cast<int>(position);
+    double const fraction = position - index;
+
+    Ephemeris const a = ephemerisSample(index);
+    if (fraction <= 0)
+        return a;
+    Ephemeris const b = ephemerisSample(index + 1);
+
+    // Hour angle is interpolated across 24h
+    double hourAngleChange = b.hourAngle - a.hourAngle;
+    if (12.0 <= hourAngleChange)
+        hourAngleChange -= 24.0;
+    else if (hourAngleChange < -12.0)
+        hourAngleChange += 24.0;
+
+    Ephemeris result;
+    result.altitude  = a.altitude + fraction * (b.altitude - a.altitude);
+    result.hourAngle = a.hourAngle + fraction * hourAngleChange;
+    if (24.0 <= result.hourAngle)
+        result.hourAngle -= 24.0;
+    else if (result.hourAngle < 0.0)
+        result.hourAngle += 24.0;
+    result.moonAltitude     = a.moonAltitude + fraction * (b.moonAltitude - a.moonAltitude);
+    result.moonIllumination = a.moonIllumination + fraction * (b.moonIllumination - a.moonIllumination);
+    result.moonSeparation   = a.moonSeparation + fraction * (b.moonSeparation - a.moonSeparation);
+    result.valid            = true;
+
+    return result;
+}
+
+SchedulerJob::Ephemeris const &SchedulerJob::ephemerisSample(int index) const
+{
+    Ephemeris &sample = ephemerisSamples[index];
+    if (sample.valid)
+        return sample;
+
+    GeoLocation const * const geo = location();
+    KStarsDateTime const ut(QDateTime::fromMSecsSinceEpoch(1000 * (ephemerisOrigin + index * EPHEMERIS_STEP), Qt::UTC));
+
+    // Create a sky object with the target catalog coordinates
+    SkyObject o;
+    o.setRA0(targetCoords.ra0());
+    o.setDec0(targetCoords.dec0());
+
+    // Update RA/DEC of the target for the sample date/time
+    KSNumbers numbers(ut.djd());
+    o.updateCoordsNow(&numbers);
+
+    // Compute local sidereal time, calculate altitude
+    CachingDms const LST = geo->GSTtoLST(ut.gst());
+    o.EquatorialToHorizontal(&LST, geo->lat());
+    sample.altitude = o.alt().Degrees();
+
+    // Hours are reduced to [0,24[, meridian being at 0
+    sample.hourAngle = LST.Hours() - o.ra().Hours();
+    if (24.0 <= sample.hourAngle)
+        sample.hourAngle -= 24.0;
+    else if (sample.hourAngle < 0.0)
+        sample.hourAngle += 24.0;
+
+    // Positions of the Moon are shared by all jobs, and only computed from the GUI thread
+    qint64 const moonIndex = ephemerisOrigin / EPHEMERIS_STEP + index;
+    MoonSample moonSample;
+    if (!findMoonSample(moonSamplesKey(geo), moonIndex, moonSample))
+    {
+        if (nullptr == moon)
+        {
+            // Note the missing position for the caller, and leave the sample to compute again
+            if (missingMoonTo < missingMoonFrom)
+            {
+                missingMoonFrom = moonIndex;
+                missingMoonTo   = moonIndex;
+            }
+            else
+            {
+                missingMoonFrom = std::min(missingMoonFrom, moonIndex);
+                missingMoonTo   = std::max(missingMoonTo, moonIndex);
+            }
+
+            // Consider the Moon below the horizon meanwhile
+            sample.moonAltitude     = -90;
+            sample.moonIllumination = 0;
+            sample.moonSeparation   = 180;
+            return sample;
+        }
+
+        moonSample = computeMoonSample(moon, moonIndex);
+    }
+
+    SkyPoint const moonCoords(moonSample.ra, moonSample.dec);
+    sample.moonAltitude     = moonSample.altitude;
+    sample.moonIllumination = moonSample.illumination;
+    sample.moonSeparation   = moonCoords.angularDistanceTo(&o).Degrees();
+
+    sample.valid = true;
+    return sample;
+}
+
+QVector<double> SchedulerJob::ephemerisKey() const
+{
+    GeoLocation const * const geo = location();
+
+    return QVector<double>() << geo->lat()->Degrees() << geo->lng()->Degrees() << geo->TZ()
+                             << targetCoords.ra0().Hours() << targetCoords.dec0().Degrees();
+}
+
+GeoLocation const *SchedulerJob::location() const
+{
+    return conditions ? &conditions->geo : KStarsData::Instance()->geo();
+}
+
+KStarsDateTime SchedulerJob::localTime() const
+{
+    return conditions ? conditions->now : KStarsData::Instance()->lt();
+}
+
+double SchedulerJob::optionSettingAltitudeCutoff() const
+{
+    return conditions ? conditions->settingAltitudeCutoff : Options::settingAltitudeCutoff();
+}
+
+double SchedulerJob::optionLeadTime() const
+{
+    return conditions ? conditions->leadTime : Options::leadTime();
+}
+
+bool SchedulerJob::getMissingMoonEphemeris(QDateTime &from, QDateTime &to) const
+{
+    if (missingMoonTo < missingMoonFrom)
+        return false;
+
+    from = QDateTime::fromMSecsSinceEpoch(1000 * missingMoonFrom * EPHEMERIS_STEP, Qt::UTC);
+    to   = QDateTime::fromMSecsSinceEpoch(1000 * missingMoonTo * EPHEMERIS_STEP, Qt::UTC);
+    return true;
+}
+
+void SchedulerJob::updateMoonEphemeris(QDateTime const &from, QDateTime const &to)
+{
+    KSMoon * const moon = dynamic_cast<KSMoon *>(KStarsData::Instance()->skyComposite()->findByName(i18n("Moon")));
+    if (nullptr == moon)
+        return;
+
+    qint64 const first = from.toMSecsSinceEpoch() / 1000 / EPHEMERIS_STEP;
+    qint64 const last  = (to.toMSecsSinceEpoch() / 1000 + EPHEMERIS_STEP - 1) / EPHEMERIS_STEP;
+    QVector<double> const key = moonSamplesKey(KStarsData::Instance()->geo());
+
+    // Protect the requested interval from being dropped while it is filled
+    {
+        QWriteLocker locker(&moonSamplesLock);
+        moonSamplesFirst = first;
+        moonSamplesLast  = last;
+    }
+
+    MoonSample sample;
+    for (qint64 index = first; index <= last; index++)
+        if (!findMoonSample(key, index, sample))
+            computeMoonSample(moon, index);
+}
+
+bool SchedulerJob::findMoonSample(QVector<double> const &key, qint64 index, MoonSample &sample)
+{
+    QReadLocker locker(&moonSamplesLock);
+    if (key != moonSamplesLocation)
+        return false;
+
+    auto const found = moonSamples.constFind(index);
+    if (found == moonSamples.constEnd())
+        return false;
+
+    sample = found.value();
+    return true;
+}
+
+SchedulerJob::MoonSample SchedulerJob::computeMoonSample(KSMoon *moon, qint64 index)
+{
+    GeoLocation * const geo = KStarsData::Instance()->geo();
+    KStarsDateTime const ut(QDateTime::fromMSecsSinceEpoch(1000 * index * EPHEMERIS_STEP, Qt::UTC));
+
+    // Update the Moon for the sample date/time, and calculate its altitude without altering the one of the sky map
+    KSNumbers numbers(ut.djd());
+    CachingDms const LST = geo->GSTtoLST(ut.gst());
+    moon->updateCoords(&numbers, true, geo->lat(), &LST, true);
+
+    SkyPoint coords(moon->ra(), moon->dec());
+    coords.EquatorialToHorizontal(&LST, geo->lat());
+
+    MoonSample sample;
+    sample.altitude     = coords.alt().Degrees();
+    sample.illumination = moon->illum() * 100.0;
+    sample.ra           = moon->ra().Hours();
+    sample.dec          = moon->dec().Degrees();
+
+    // Drop all positions if the location changed, or those outside the last requested interval if too many accumulated
+    // Dropping the positions a pending evaluation requested would make it miss them again, so that interval may exceed the limit
+    QVector<double> const key = moonSamplesKey(geo);
+
+    QWriteLocker locker(&moonSamplesLock);
+    if (key != moonSamplesLocation)
+    {
+        moonSamples.clear();
+        moonSamplesLocation = key;
+    }
+    else if (MOON_SAMPLES_MAX + std::max<qint64>(0, moonSamplesLast - moonSamplesFirst + 1) <= moonSamples.size())
+    {
+        for (auto it = moonSamples.begin(); it != moonSamples.end();)
+        {
+            if (it.key() < moonSamplesFirst || moonSamplesLast < it.key())
+                it = moonSamples.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    moonSamples.insert(index, sample);
+    return sample;
+}
+
+QVector<double> SchedulerJob::moonSamplesKey(GeoLocation const *geo)
+{
+    return QVector<double>() << geo->lat()->Degrees() << geo->lng()->Degrees();
+}
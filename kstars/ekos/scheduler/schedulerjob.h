@@ -9,12 +9,19 @@
 
 #pragma once
 
+#include "geolocation.h"
+#include "kstarsdatetime.h"
 #include "skypoint.h"
 
 #include <QUrl>
+#include <QHash>
 #include <QMap>
+#include <QReadWriteLock>
+#include <QVector>
 #include "ksmoon.h"
 
+#include <memory>
+
 class QTableWidgetItem;
 class QLabel;
 class KSMoon;
@@ -342,6 +349,48 @@ class SchedulerJob
      */
     void reset();
 
+    /** @brief Location, time and options a job is evaluated with. */
+    struct Conditions
+    {
+        explicit Conditions(GeoLocation const &location) : geo(location) {}
+
+        /** Location, with the time zone offset in effect at capture and no daylight saving rule */
+        GeoLocation geo;
+        /** Local time at capture, used when no date and time is specified */
+        KStarsDateTime now;
+        /** Options, in degrees and minutes */
+        double settingAltitudeCutoff { 0 };
+        double leadTime { 0 };
+        double preDawnTime { 0 };
+    };
+
+    /** @brief Capture the current location, time and options, from the GUI thread. */
+    static std::shared_ptr<Conditions const> currentConditions();
+
+    /** @brief Copy of this job without its widget cells and labels, which may be evaluated in another thread.
+     * A detached job does not compute the positions of the Moon, it uses the ones updateMoonEphemeris() computed.
+     * @arg conditions are used by the copy instead of the location, time and options of KStars.
+     * @see getMissingMoonEphemeris
+     */
+    SchedulerJob detached(std::shared_ptr<Conditions const> const &conditions) const;
+
+    /** @brief Take the schedule of a detached copy of this job: state, startup and completion, estimated and lead times, and score.
+     * @arg evaluated is the copy, detached before its evaluation.
+     */
+    void setSchedule(SchedulerJob const &evaluated);
+
+    /** @brief Compute the positions of the Moon that all jobs share, from the GUI thread.
+     * Positions outside that interval may be dropped to make room, but the ones inside are kept until the next call.
+     * @arg from, to are the UTC date and time interval to cover.
+     */
+    static void updateMoonEphemeris(QDateTime const &from, QDateTime const &to);
+
+    /** @brief Interval of the positions of the Moon a detached job needed, but that were not computed yet.
+     * @arg from, to receive the UTC date and time interval.
+     * @return false if no position of the Moon was missing.
+     */
+    bool getMissingMoonEphemeris(QDateTime &from, QDateTime &to) const;
+
     /** @brief Determining whether a SchedulerJob is a duplicate of another.
      * @param a_job is the other SchedulerJob to test duplication against.
      * @return True if objects are different, but name and sequence file are identical, else false.
@@ -433,7 +482,74 @@ class SchedulerJob
          */
     static double findAltitude(const SkyPoint &target, const QDateTime &when, bool *is_setting = nullptr, bool debug = false);
 
+    /**
+         * @brief getAltitude Get the altitude of the target of this job, interpolated in the ephemeris cache
+         * @param when date and time to find altitude, now if omitted.
+         * @param is_setting whether target is setting at the argument time (optional).
+         * @return Altitude of the target at the specific date and time given.
+         * @see findAltitude
+         */
+    double getAltitude(QDateTime const &when = QDateTime(), bool *is_setting = nullptr) const;
+
 private:
+    /** @internal Positions of the target and of the Moon at a date and time, see ephemeris(). */
+    struct Ephemeris
+    {
+        /** Altitude of the target, in degrees */
+        double altitude { 0 };
+        /** Hour angle of the target reduced to [0,24[, in hours - the target is setting below 12 */
+        double hourAngle { 0 };
+        /** Altitude of the Moon, in degrees */
+        double moonAltitude { 0 };
+        /** Illumination of the Moon, in percent */
+        double moonIllumination { 0 };
+        /** Separation of the target and the Moon, in degrees */
+        double moonSeparation { 0 };
+        bool valid { false };
+    };
+
+    /**
+     * @internal Positions of the target and of the Moon at a date and time, now if invalid.
+     * Positions are sampled on a fixed grid of times, and interpolated linearly. Samples are computed when first
+     * needed, and dropped when the geographic location or the target changes.
+     */
+    Ephemeris ephemeris(QDateTime const &when) const;
+
+    /** @internal Sample of the ephemeris cache, at ephemerisOrigin plus index steps. */
+    Ephemeris const &ephemerisSample(int index) const;
+
+    /** @internal Values the ephemeris cache depends on: location, time zone and target. */
+    QVector<double> ephemerisKey() const;
+
+    /** @internal Location, local time and options of the job: the captured conditions if detached, else those of KStars. */
+    /** @{ */
+    GeoLocation const *location() const;
+    KStarsDateTime localTime() const;
+    double optionSettingAltitudeCutoff() const;
+    double optionLeadTime() const;
+    /** @} */
+
+    /** @internal Position of the Moon at a sample time, shared by all jobs. */
+    struct MoonSample
+    {
+        /** Altitude of the Moon, in degrees */
+        double altitude { 0 };
+        /** Illumination of the Moon, in percent */
+        double illumination { 0 };
+        /** Coordinates of the Moon, in hours and degrees */
+        double ra { 0 };
+        double dec { 0 };
+    };
+
+    /** @internal Find the position of the Moon at sample time index times EPHEMERIS_STEP, @return false if not computed yet. */
+    static bool findMoonSample(QVector<double> const &key, qint64 index, MoonSample &sample);
+
+    /** @internal Compute and store the position of the Moon at a sample time, from the GUI thread only. */
+    static MoonSample computeMoonSample(KSMoon *moon, qint64 index);
+
+    /** @internal Values the positions of the Moon depend on: location. */
+    static QVector<double> moonSamplesKey(GeoLocation const *geo);
+
     QString name;
     SkyPoint targetCoords;
     JOBStatus state { JOB_IDLE };
@@ -502,4 +618,28 @@ private:
 
     /// Pointer to Moon object
     KSMoon *moon { nullptr };
+
+    /// Conditions of the evaluation of a detached job, see detached()
+    std::shared_ptr<Conditions const> conditions;
+
+    /** @internal Ephemeris cache, see ephemeris(). */
+    /** @{ */
+    mutable QVector<Ephemeris> ephemerisSamples;
+    mutable QVector<double> ephemerisCacheKey;
+    /** Date and time of the first sample, in UTC seconds since epoch */
+    mutable qint64 ephemerisOrigin { 0 };
+    /** Samples of the positions of the Moon a detached job missed, in multiples of EPHEMERIS_STEP */
+    mutable qint64 missingMoonFrom { 0 };
+    mutable qint64 missingMoonTo { -1 };
+    /** @} */
+
+    /** @internal Positions of the Moon by sample time, see computeMoonSample(). */
+    /** @{ */
+    static QHash<qint64, MoonSample> moonSamples;
+    static QVector<double> moonSamplesLocation;
+    /** Sample interval updateMoonEphemeris() was last called with, kept when dropping positions */
+    static qint64 moonSamplesFirst;
+    static qint64 moonSamplesLast;
+    static QReadWriteLock moonSamplesLock;
+    /** @} */
 };
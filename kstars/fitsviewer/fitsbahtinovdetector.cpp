@@ -22,6 +22,7 @@
 
 #include "fits_debug.h"
 #include "fitsbahtinovdetector.h"
+#include "fitsbufferarena.h"
 #include "hough/houghline.h"
 
 #include <QElapsedTimer>
@@ -112,7 +113,7 @@ int FITSBahtinovDetector::findBahtinovStar(QList<Edge*> &starCenters, const QRec
     uint32_t offset = subX + subY * dataWidth;
 
     // #2 Create new buffer
-    auto * buffer = new uint8_t[size * BBP];
+    auto * buffer = FITSBufferArena::Instance()->acquire(size * BBP);
     // If there is no offset, copy whole buffer in one go
     if (offset == 0)
     {
@@ -304,7 +305,7 @@ BahtinovLineAverage FITSBahtinovDetector::calculateMaxAverage(const FITSData *da
     int numChannels = data->channels();
 
     BahtinovLineAverage lineAverage;
-    auto * rotimage = new T[size * BBP];
+    auto * rotimage = FITSBufferArena::Instance()->acquire<T>(size * BBP);
 
     rotateImage(data, angle, rotimage);
 
@@ -361,7 +362,7 @@ BahtinovLineAverage FITSBahtinovDetector::calculateMaxAverage(const FITSData *da
     //    fflush(stdout);
 
     rotBuffer = nullptr;
-    delete[] rotimage;
+    FITSBufferArena::Instance()->release(rotimage);
     rotimage = nullptr;
 
     return lineAverage;
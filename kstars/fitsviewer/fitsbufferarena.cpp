@@ -0,0 +1,172 @@
+/*  FITS Buffer Arena
+
+    This application is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+*/
+
+#include "fitsbufferarena.h"
+
+#include "Options.h"
+
+#include <QtAlgorithms>
+
+#include <new>
+
+#include <fits_debug.h>
+
+FITSBufferArena *FITSBufferArena::_FITSBufferArena = nullptr;
+
+FITSBufferArena *FITSBufferArena::Instance()
+{
+    static QMutex instanceMutex;
+    QMutexLocker locker(&instanceMutex);
+
+    if (_FITSBufferArena == nullptr)
+        _FITSBufferArena = new FITSBufferArena();
+
+    return _FITSBufferArena;
+}
+
+FITSBufferArena::FITSBufferArena()
+{
+    m_Budget = static_cast<uint64_t>(Options::fITSBufferCacheSize()) * 1024 * 1024;
+}
+
+FITSBufferArena::~FITSBufferArena()
+{
+    clear();
+}
+
+uint64_t FITSBufferArena::sizeClass(uint64_t size)
+{
+    constexpr uint64_t smallestClass = 4096;
+    if (size <= smallestClass)
+        return smallestClass;
+
+    // Four size classes per power of two, so a buffer wastes at most a quarter of its size
+    const int log2 = 63 - qCountLeadingZeroBits(size - 1);
+    const uint64_t granule = 1ULL << (log2 - 2);
+    return (size + granule - 1) & ~(granule - 1);
+}
+
+uint8_t *FITSBufferArena::acquire(uint64_t size)
+{
+    const uint64_t bytes = sizeClass(size);
+
+    {
+        QMutexLocker locker(&m_Mutex);
+
+        auto released = m_Released.find(bytes);
+        if (released != m_Released.end() && !released->buffers.isEmpty())
+        {
+            uint8_t *buffer = released->buffers.takeLast();
+            released->lastUse = ++m_UseCounter;
+            m_Acquired.insert(buffer, bytes);
+            m_Statistics.hits++;
+            m_Statistics.cachedBytes -= bytes;
+            m_Statistics.acquiredBytes += bytes;
+            return buffer;
+        }
+    }
+
+    // Allocate outside of the lock, this may take a while for large buffers
+    uint8_t *buffer = new (std::nothrow) uint8_t[bytes];
+    if (buffer == nullptr)
+    {
+        qCWarning(KSTARS_FITS) << "FITSBufferArena: Not enough memory for buffer. Requested:" << size << "bytes.";
+        return nullptr;
+    }
+
+    QMutexLocker locker(&m_Mutex);
+    m_Acquired.insert(buffer, bytes);
+    m_Statistics.misses++;
+    m_Statistics.acquiredBytes += bytes;
+    return buffer;
+}
+
+void FITSBufferArena::release(void *buffer)
+{
+    if (buffer == nullptr)
+        return;
+
+    auto *bytePointer = static_cast<uint8_t *>(buffer);
+
+    QMutexLocker locker(&m_Mutex);
+
+    auto acquired = m_Acquired.find(bytePointer);
+    if (acquired == m_Acquired.end())
+    {
+        // Not one of ours, or released twice: how it was allocated is unknown, so it is left alone
+        qCWarning(KSTARS_FITS) << "FITSBufferArena: Ignoring release of a buffer that was not acquired from the arena.";
+        return;
+    }
+
+    const uint64_t bytes = acquired.value();
+    m_Acquired.erase(acquired);
+    m_Statistics.acquiredBytes -= bytes;
+
+    if (bytes > m_Budget)
+    {
+        delete[] bytePointer;
+        return;
+    }
+
+    SizeClass &released = m_Released[bytes];
+    released.buffers.append(bytePointer);
+    released.lastUse = ++m_UseCounter;
+    m_Statistics.cachedBytes += bytes;
+
+    trim();
+}
+
+void FITSBufferArena::trim()
+{
+    // Free buffers of the least recently used size classes until the released buffers fit in the budget
+    while (m_Statistics.cachedBytes > m_Budget)
+    {
+        auto oldest = m_Released.end();
+        for (auto sizeClass = m_Released.begin(); sizeClass != m_Released.end(); ++sizeClass)
+        {
+            if (!sizeClass->buffers.isEmpty() && (oldest == m_Released.end() || sizeClass->lastUse < oldest->lastUse))
+                oldest = sizeClass;
+        }
+
+        if (oldest == m_Released.end())
+            break;
+
+        uint8_t *buffer = oldest->buffers.takeFirst();
+        m_Statistics.cachedBytes -= oldest.key();
+        delete[] buffer;
+
+        if (oldest->buffers.isEmpty())
+            m_Released.erase(oldest);
+    }
+}
+
+void FITSBufferArena::setBudget(uint64_t bytes)
+{
+    QMutexLocker locker(&m_Mutex);
+    m_Budget = bytes;
+    trim();
+}
+
+void FITSBufferArena::clear()
+{
+    QMutexLocker locker(&m_Mutex);
+
+    for (auto &sizeClass : m_Released)
+    {
+        for (uint8_t *buffer : sizeClass.buffers)
+            delete[] buffer;
+    }
+    m_Released.clear();
+    m_Statistics.cachedBytes = 0;
+}
+
+FITSBufferArena::Statistics FITSBufferArena::statistics() const
+{
+    QMutexLocker locker(&m_Mutex);
+    return m_Statistics;
+}
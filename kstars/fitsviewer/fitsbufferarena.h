@@ -0,0 +1,102 @@
+/*  FITS Buffer Arena
+
+    This application is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QVector>
+
+#include <cstdint>
+
+/**
+ * @class FITSBufferArena
+ * Recycles the large image and scratch buffers of the FITS pipeline.
+ *
+ * Buffers are grouped in size classes spaced by a quarter of a power of two, so a released buffer
+ * can serve any later request of about the same size. A stream of frames of the same geometry,
+ * as produced by guiding or focusing, then reuses the same few buffers instead of going through
+ * the system allocator for every frame.
+ *
+ * Released buffers are kept up to a byte budget, after which the least recently used size class is freed.
+ * The arena is thread-safe.
+ */
+class FITSBufferArena
+{
+    public:
+        static FITSBufferArena *Instance();
+
+        /**
+         * @brief acquire Get a buffer of at least size bytes. Its content is undefined.
+         * @return the buffer, or nullptr if it could not be allocated.
+         */
+        uint8_t *acquire(uint64_t size);
+
+        /**
+         * @brief acquire Typed variant of acquire() for count elements of type T.
+         */
+        template <typename T>
+        T *acquire(uint64_t count)
+        {
+            return reinterpret_cast<T *>(acquire(count * sizeof(T)));
+        }
+
+        /**
+         * @brief release Give a buffer back to the arena.
+         * @param buffer a buffer returned by acquire() and not released yet. Other pointers are ignored with a warning.
+         */
+        void release(void *buffer);
+
+        /**
+         * @brief setBudget Set the maximum number of bytes kept in released buffers.
+         */
+        void setBudget(uint64_t bytes);
+
+        /**
+         * @brief clear Free all released buffers.
+         */
+        void clear();
+
+        typedef struct
+        {
+            /// Requests served with a released buffer
+            uint64_t hits { 0 };
+            /// Requests that needed a new allocation
+            uint64_t misses { 0 };
+            /// Bytes held in buffers that were acquired and not released yet
+            uint64_t acquiredBytes { 0 };
+            /// Bytes held in released buffers waiting for reuse
+            uint64_t cachedBytes { 0 };
+        } Statistics;
+
+        Statistics statistics() const;
+
+    private:
+        FITSBufferArena();
+        ~FITSBufferArena();
+
+        static uint64_t sizeClass(uint64_t size);
+        void trim();
+
+        static FITSBufferArena *_FITSBufferArena;
+
+        typedef struct
+        {
+            QVector<uint8_t *> buffers;
+            uint64_t lastUse { 0 };
+        } SizeClass;
+
+        mutable QMutex m_Mutex;
+        /// Released buffers by size class
+        QHash<uint64_t, SizeClass> m_Released;
+        /// Size class of the buffers currently acquired
+        QHash<uint8_t *, uint64_t> m_Acquired;
+        uint64_t m_Budget { 0 };
+        uint64_t m_UseCounter { 0 };
+        Statistics m_Statistics;
+};
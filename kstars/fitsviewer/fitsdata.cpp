@@ -18,6 +18,10 @@
  ***************************************************************************/
 
 #include "fitsdata.h"
+#include "fitsbufferarena.h"
+#include "fitsdemosaic.h"
+#include "fitskernels.h"
+#include "fitsworkerpool.h"
 #include "fitsbahtinovdetector.h"
 #include "fitsthresholddetector.h"
 #include "fitsgradientdetector.h"
@@ -35,8 +39,10 @@
 
 #include <KFormat>
 #include <QApplication>
+#include <QElapsedTimer>
 #include <QImage>
 #include <QtConcurrent>
+#include <QtEndian>
 #include <QImageReader>
 
 #if !defined(KSTARS_LITE) && defined(HAVE_WCSLIB)
@@ -48,8 +54,10 @@
 #include "fitshistogram.h"
 #endif
 
+#include <algorithm>
 #include <cfloat>
 #include <cmath>
+#include <type_traits>
 
 #include <fits_debug.h>
 
@@ -84,7 +92,7 @@ FITSData::FITSData(const FITSData * other)
     this->m_DataType = other->m_DataType;
     this->m_Channels = other->m_Channels;
     memcpy(&stats, &(other->stats), sizeof(stats));
-    m_ImageBuffer = new uint8_t[stats.samples_per_channel * m_Channels * stats.bytesPerPixel];
+    m_ImageBuffer = FITSBufferArena::Instance()->acquire(stats.samples_per_channel * m_Channels * stats.bytesPerPixel);
     memcpy(m_ImageBuffer, other->m_ImageBuffer, stats.samples_per_channel * m_Channels * stats.bytesPerPixel);
 }
 
@@ -138,7 +146,12 @@ void FITSData::loadCommon(const QString &inFilename)
         // THen remove it. We have to check for name since we cannot delete
         // the same filename and try to open it below!
         if (m_isTemporary && autoRemoveTemporaryFITS && inFilename != m_Filename)
+        {
+            // Mapped files cannot be removed on all platforms, so release the mapping first.
+            if (m_MappedFile != nullptr)
+                clearImageBuffers();
             QFile::remove(m_Filename);
+        }
     }
 
     m_Filename = inFilename;
@@ -177,6 +190,235 @@ bool fitsOpenError(int status, const QString &message, bool silent)
     qCCritical(KSTARS_FITS) << errMessage;
     return false;
 }
+
+// Converts big-endian samples from a file mapping into native samples, in parallel chunks on the FITS worker pool.
+// Samples are handled as unsigned words whose sign bit is flipped when BZERO offsets them to the unsigned type.
+// Returns false if a sample has the sign bit set while rejectNegative is set, which CFITSIO reports as an overflow.
+template <typename Word>
+bool convertMappedSamples(const uchar *source, uint8_t *destination, size_t count, Word flip, bool rejectNegative)
+{
+    const Word signBit = static_cast<Word>(Word(1) << (8 * sizeof(Word) - 1));
+    const size_t nChunks = static_cast<size_t>(std::max(1, FITSWorkerPool::threadPool()->maxThreadCount()));
+    const size_t chunkSize = (count + nChunks - 1) / nChunks;
+
+    QList<QFuture<bool>> futures;
+    for (size_t first = 0; first < count; first += chunkSize)
+    {
+        const size_t last = std::min(count, first + chunkSize);
+        futures.append(QtConcurrent::run(FITSWorkerPool::threadPool(), [ = ]()
+        {
+            Word *output = reinterpret_cast<Word *>(destination);
+            Word negative = 0;
+            for (size_t i = first; i < last; i++)
+            {
+                const Word sample = qFromBigEndian<Word>(source + i * sizeof(Word));
+                negative |= sample;
+                output[i] = sample ^ flip;
+            }
+            return !rejectNegative || (negative & signBit) == 0;
+        }));
+    }
+
+    bool converted = true;
+    for (auto &future : futures)
+        converted = future.result() && converted;
+    return converted;
+}
+}
+
+int FITSData::readCompressedImage(long nelements)
+{
+    int status = 0, hdu = 0, naxis = 0, anynull = 0;
+    long naxes[3] = {1, 1, 1};
+    long tileSize[3] = {1, 1, 1};
+
+    fits_get_hdu_num(fptr, &hdu);
+    fits_get_img_dim(fptr, &naxis, &status);
+    fits_get_img_size(fptr, qMin(naxis, 3), naxes, &status);
+    if (fits_get_tile_dim(fptr, qMin(naxis, 3), tileSize, &status))
+        return status;
+
+    const long planeElements = naxes[0] * naxes[1];
+    const long planes = nelements / planeElements;
+
+    // Tiles spanning several planes of a cube cannot be split between threads
+    if (naxis < 2 || (planes > 1 && tileSize[2] > 1))
+        return fits_read_img(fptr, m_DataType, 1, nelements, nullptr, m_ImageBuffer, &anynull, &status);
+
+    // Each CFITSIO handle needs its own view of the compressed data.
+    // Opening the same disk file again would share the underlying buffers between threads, memory files do not.
+    // The file is mapped read-only, so the memory files read it from the page cache without a copy.
+    QFile compressedFile(m_Filename);
+    uchar *compressedData = compressedFile.open(QIODevice::ReadOnly) ? compressedFile.map(0, compressedFile.size()) : nullptr;
+    if (compressedData == nullptr)
+        return fits_read_img(fptr, m_DataType, 1, nelements, nullptr, m_ImageBuffer, &anynull, &status);
+    const size_t compressedSize = compressedFile.size();
+
+    // Partition on whole rows of tiles, ZTILE2 image rows high, so that no tile is decompressed twice.
+    // Rows of tiles start again at each plane of a cube.
+    const long tileRows = qMax(1L, tileSize[1]);
+    QVector<long> bandStarts;
+    for (long plane = 0; plane < planes; plane++)
+        for (long row = 0; row < naxes[1]; row += tileRows)
+            bandStarts.append(plane * planeElements + row * naxes[0]);
+    bandStarts.append(nelements);
+
+    const int nBands = bandStarts.size() - 1;
+    const int nThreads = qBound(1, FITSWorkerPool::threadPool()->maxThreadCount(), nBands);
+    const int bandsPerThread = (nBands + nThreads - 1) / nThreads;
+
+    QList<QFuture<int>> futures;
+
+    for (int band = 0; band < nBands; band += bandsPerThread)
+    {
+        const long first = bandStarts[band];
+        const long count = bandStarts[qMin(band + bandsPerThread, nBands)] - first;
+        uint8_t *destination = m_ImageBuffer + first * stats.bytesPerPixel;
+
+        futures.append(QtConcurrent::run(FITSWorkerPool::threadPool(), [compressedData, compressedSize, hdu, first, count, destination, this]()
+        {
+            int threadStatus = 0, anynull = 0;
+            fitsfile *tilePtr = nullptr;
+            void *buffer = compressedData;
+            size_t size = compressedSize;
+
+            if (fits_open_memfile(&tilePtr, m_Filename.toLatin1().data(), READONLY, &buffer, &size, 0, nullptr, &threadStatus) == 0)
+            {
+                fits_movabs_hdu(tilePtr, hdu, nullptr, &threadStatus);
+                fits_read_img(tilePtr, m_DataType, first + 1, count, nullptr, destination, &anynull, &threadStatus);
+                int closeStatus = 0;
+                fits_close_file(tilePtr, &closeStatus);
+            }
+
+            return threadStatus;
+        }));
+    }
+
+    for (auto &oneFuture : futures)
+    {
+        if (oneFuture.result() != 0)
+            status = oneFuture.result();
+    }
+
+    return status;
+}
+
+bool FITSData::loadMappedImage()
+{
+    int status = 0;
+
+    // Tile-compressed data must be decompressed by CFITSIO
+    if (fits_is_compressed_image(fptr, &status) || status)
+        return false;
+
+    double bscale = 1, bzero = 0;
+    fits_read_key_dbl(fptr, "BSCALE", &bscale, nullptr, &status);
+    status = 0;
+    fits_read_key_dbl(fptr, "BZERO", &bzero, nullptr, &status);
+    status = 0;
+
+    if (bscale != 1)
+        return false;
+
+    // Samples usable as they are on disk are used from the mapping. The others are big-endian, and signed integers
+    // are read as unsigned: they are converted from the mapping into a buffer, as CFITSIO would read them.
+    bool inPlace = false;
+    uint32_t flip = 0;
+    bool rejectNegative = false;
+    switch (stats.bitpix)
+    {
+        case BYTE_IMG:
+            if (bzero != 0)
+                return false;
+            inPlace = true;
+            break;
+
+        case SHORT_IMG:
+        case LONG_IMG:
+            // Either BZERO offsets samples to the unsigned type, or samples must not be negative
+            if (bzero == (stats.bitpix == SHORT_IMG ? 32768.0 : 2147483648.0))
+                flip = stats.bitpix == SHORT_IMG ? 0x8000 : 0x80000000;
+            else if (bzero == 0)
+                rejectNegative = true;
+            else
+                return false;
+            break;
+
+        case FLOAT_IMG:
+        case DOUBLE_IMG:
+            if (bzero != 0)
+                return false;
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+            inPlace = true;
+#endif
+            break;
+
+        default:
+            return false;
+    }
+
+    LONGLONG headStart = 0, dataStart = 0, dataEnd = 0;
+    if (fits_get_hduaddrll(fptr, &headStart, &dataStart, &dataEnd, &status))
+        return false;
+
+    if (dataStart + m_ImageBufferSize > dataEnd)
+        return false;
+
+    m_MappedFile = new QFile(m_Filename);
+    // Samples used from the mapping are changed in place by filters, so they are mapped privately: pages are shared
+    // with the page cache until they are modified, then they are copied on write. The file on disk is never altered.
+    uchar *data = m_MappedFile->open(QIODevice::ReadOnly) ?
+                  m_MappedFile->map(dataStart, m_ImageBufferSize,
+                                    inPlace ? QFileDevice::MapPrivateOption : QFileDevice::NoOptions) : nullptr;
+    if (data == nullptr)
+    {
+        qCDebug(KSTARS_FITS) << "Failed to map" << m_Filename << m_MappedFile->errorString();
+        delete m_MappedFile;
+        m_MappedFile = nullptr;
+        return false;
+    }
+
+    if (inPlace)
+    {
+        m_ImageBuffer = data;
+        m_MemoryMapped = true;
+        return true;
+    }
+
+    // The mapping is only read once, by the conversion
+    m_ImageBuffer = FITSBufferArena::Instance()->acquire(m_ImageBufferSize);
+    const size_t samples = m_ImageBufferSize / stats.bytesPerPixel;
+    bool converted = m_ImageBuffer != nullptr;
+    if (converted)
+    {
+        switch (stats.bytesPerPixel)
+        {
+            case 2:
+                converted = convertMappedSamples<uint16_t>(data, m_ImageBuffer, samples, static_cast<uint16_t>(flip),
+                                                                rejectNegative);
+                break;
+            case 4:
+                converted = convertMappedSamples<uint32_t>(data, m_ImageBuffer, samples, flip, rejectNegative);
+                break;
+            default:
+                converted = convertMappedSamples<uint64_t>(data, m_ImageBuffer, samples, 0, rejectNegative);
+                break;
+        }
+    }
+
+    m_MappedFile->unmap(data);
+    delete m_MappedFile;
+    m_MappedFile = nullptr;
+
+    if (!converted)
+    {
+        FITSBufferArena::Instance()->release(m_ImageBuffer);
+        m_ImageBuffer = nullptr;
+        return false;
+    }
+
+    m_MemoryMapped = true;
+    return true;
 }
 
 bool FITSData::privateLoad(void *fits_buffer, size_t fits_buffer_size, bool silent)
@@ -184,10 +426,21 @@ bool FITSData::privateLoad(void *fits_buffer, size_t fits_buffer_size, bool sile
     int status = 0, anynull = 0;
     long naxes[3];
     QString errMessage;
+    QElapsedTimer loadTimer;
+    loadTimer.start();
 
     m_isTemporary = m_Filename.startsWith(m_TemporaryPath);
 
-    if (fits_buffer == nullptr && m_Filename.endsWith(".fz"))
+    // Decompress tiles straight into the image buffer instead of unpacking to a temporary file
+    bool streamCompressed = false;
+
+    if (fits_buffer == nullptr && m_Filename.endsWith(".fz") && Options::streamCompressedFITS())
+    {
+        m_compressedFilename = m_Filename;
+        m_isCompressed = true;
+        streamCompressed = true;
+    }
+    else if (fits_buffer == nullptr && m_Filename.endsWith(".fz"))
     {
         // Store so we don't lose.
         m_compressedFilename = m_Filename;
@@ -235,9 +488,19 @@ bool FITSData::privateLoad(void *fits_buffer, size_t fits_buffer_size, bool sile
             stats.size = fits_buffer_size;
     }
 
-    if (fits_movabs_hdu(fptr, 1, IMAGE_HDU, &status))
+    if (fits_movabs_hdu(fptr, 1, nullptr, &status))
         return fitsOpenError(status, i18n("Could not locate image HDU."), silent);
 
+    // The image of a .fz file is the first compressed image extension, which usually follows an empty primary HDU
+    if (streamCompressed)
+    {
+        while (!fits_is_compressed_image(fptr, &status) && status == 0)
+            fits_movrel_hdu(fptr, 1, nullptr, &status);
+
+        if (status)
+            return fitsOpenError(status, i18n("Could not locate image HDU."), silent);
+    }
+
     if (fits_get_img_param(fptr, 3, &(stats.bitpix), &(stats.ndim), naxes, &status))
         return fitsOpenError(status, i18n("FITS file open error (fits_get_img_param)."), silent);
 
@@ -311,6 +574,7 @@ bool FITSData::privateLoad(void *fits_buffer, size_t fits_buffer_size, bool sile
     stats.samples_per_channel = stats.width * stats.height;
 
     clearImageBuffers();
+    m_MemoryMapped = false;
 
     m_Channels = naxes[2];
 
@@ -320,22 +584,39 @@ bool FITSData::privateLoad(void *fits_buffer, size_t fits_buffer_size, bool sile
         m_Channels = 1;
 
     m_ImageBufferSize = stats.samples_per_channel * m_Channels * stats.bytesPerPixel;
-    m_ImageBuffer = new uint8_t[m_ImageBufferSize];
-    if (m_ImageBuffer == nullptr)
-    {
-        qCWarning(KSTARS_FITS) << "FITSData: Not enough memory for image_buffer channel. Requested: "
-                               << m_ImageBufferSize << " bytes.";
-        clearImageBuffers();
-        return false;
-    }
 
     rotCounter     = 0;
     flipHCounter   = 0;
     flipVCounter   = 0;
     long nelements = stats.samples_per_channel * m_Channels;
 
-    if (fits_read_img(fptr, m_DataType, 1, nelements, nullptr, m_ImageBuffer, &anynull, &status))
-        return fitsOpenError(status, i18n("Error reading image."), silent);
+    // Uncompressed files on disk are read from a mapping, otherwise CFITSIO reads them into a new buffer.
+    if (fits_buffer != nullptr || !Options::memoryMappedFITS() || !loadMappedImage())
+    {
+        m_ImageBuffer = FITSBufferArena::Instance()->acquire(m_ImageBufferSize);
+        if (m_ImageBuffer == nullptr)
+        {
+            qCWarning(KSTARS_FITS) << "FITSData: Not enough memory for image_buffer channel. Requested: "
+                                   << m_ImageBufferSize << " bytes.";
+            clearImageBuffers();
+            return false;
+        }
+
+        if (streamCompressed && Options::parallelFITSDecompression() && fits_is_reentrant())
+        {
+            if ((status = readCompressedImage(nelements)))
+                return fitsOpenError(status, i18n("Error reading image."), silent);
+        }
+        else if (fits_read_img(fptr, m_DataType, 1, nelements, nullptr, m_ImageBuffer, &anynull, &status))
+            return fitsOpenError(status, i18n("Error reading image."), silent);
+    }
+
+    FITSWorkerPool::addStageTime(FITSWorkerPool::STAGE_LOAD, loadTimer.nsecsElapsed());
+
+    qCDebug(KSTARS_FITS) << "Read" << KFormat().formatByteSize(m_ImageBufferSize)
+                         << (m_MemoryMapped ? "by memory mapping" : "with CFITSIO")
+                         << "in" << loadTimer.elapsed() << "ms, peak RSS"
+                         << KFormat().formatByteSize(FITSWorkerPool::peakResidentSetSize());
 
     parseHeader();
 
@@ -620,49 +901,71 @@ bool FITSData::saveImage(const QString &newFilename)
 
 void FITSData::clearImageBuffers()
 {
-    delete[] m_ImageBuffer;
+    // Tiles may still be rendered from the buffer about to be freed
+    if (m_ImageBuffer != nullptr)
+        emit bufferAboutToChange();
+
+    if (m_MappedFile != nullptr)
+    {
+        m_MappedFile->unmap(m_ImageBuffer);
+        delete m_MappedFile;
+        m_MappedFile = nullptr;
+    }
+    else
+        FITSBufferArena::Instance()->release(m_ImageBuffer);
     m_ImageBuffer = nullptr;
     //m_BayerBuffer = nullptr;
 }
 
 void FITSData::calculateStats(bool refresh)
 {
-    // Calculate min max
-    calculateMinMax(refresh);
+    FITSWorkerPool::StageTimer stageTimer(FITSWorkerPool::STAGE_STATISTICS);
+
+    // Min and max may be provided in the header, unless we are asked to refresh them
+    bool updateMinMax = refresh || !readMinMaxKeywords();
 
-    // Get standard deviation and mean in one run
+    if (updateMinMax)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            stats.min[i] = 1.0E30;
+            stats.max[i] = -1.0E30;
+        }
+    }
+
+    // Get min, max, standard deviation and mean in one run
     switch (m_DataType)
     {
         case TBYTE:
-            runningAverageStdDev<uint8_t>();
+            calculateMoments<uint8_t>(updateMinMax);
             break;
 
         case TSHORT:
-            runningAverageStdDev<int16_t>();
+            calculateMoments<int16_t>(updateMinMax);
             break;
 
         case TUSHORT:
-            runningAverageStdDev<uint16_t>();
+            calculateMoments<uint16_t>(updateMinMax);
             break;
 
         case TLONG:
-            runningAverageStdDev<int32_t>();
+            calculateMoments<int32_t>(updateMinMax);
             break;
 
         case TULONG:
-            runningAverageStdDev<uint32_t>();
+            calculateMoments<uint32_t>(updateMinMax);
             break;
 
         case TFLOAT:
-            runningAverageStdDev<float>();
+            calculateMoments<float>(updateMinMax);
             break;
 
         case TLONGLONG:
-            runningAverageStdDev<int64_t>();
+            calculateMoments<int64_t>(updateMinMax);
             break;
 
         case TDOUBLE:
-            runningAverageStdDev<double>();
+            calculateMoments<double>(updateMinMax);
             break;
 
         default:
@@ -673,105 +976,42 @@ void FITSData::calculateStats(bool refresh)
     stats.SNR = stats.mean[0] / stats.stddev[0];
 }
 
-int FITSData::calculateMinMax(bool refresh)
+bool FITSData::readMinMaxKeywords()
 {
-    int status, nfound = 0;
-
-    status = 0;
-
-    if ((fptr != nullptr) && !refresh)
-    {
-        if (fits_read_key_dbl(fptr, "DATAMIN", &(stats.min[0]), nullptr, &status) == 0)
-            nfound++;
-
-        if (fits_read_key_dbl(fptr, "DATAMAX", &(stats.max[0]), nullptr, &status) == 0)
-            nfound++;
-
-        // If we found both keywords, no need to calculate them, unless they are both zeros
-        if (nfound == 2 && !(stats.min[0] == 0 && stats.max[0] == 0))
-            return 0;
-    }
-
-    stats.min[0] = 1.0E30;
-    stats.max[0] = -1.0E30;
-
-    stats.min[1] = 1.0E30;
-    stats.max[1] = -1.0E30;
-
-    stats.min[2] = 1.0E30;
-    stats.max[2] = -1.0E30;
+    int status = 0, nfound = 0;
 
-    switch (m_DataType)
-    {
-        case TBYTE:
-            calculateMinMax<uint8_t>();
-            break;
-
-        case TSHORT:
-            calculateMinMax<int16_t>();
-            break;
-
-        case TUSHORT:
-            calculateMinMax<uint16_t>();
-            break;
-
-        case TLONG:
-            calculateMinMax<int32_t>();
-            break;
-
-        case TULONG:
-            calculateMinMax<uint32_t>();
-            break;
-
-        case TFLOAT:
-            calculateMinMax<float>();
-            break;
+    if (fptr == nullptr)
+        return false;
 
-        case TLONGLONG:
-            calculateMinMax<int64_t>();
-            break;
+    if (fits_read_key_dbl(fptr, "DATAMIN", &(stats.min[0]), nullptr, &status) == 0)
+        nfound++;
 
-        case TDOUBLE:
-            calculateMinMax<double>();
-            break;
+    if (fits_read_key_dbl(fptr, "DATAMAX", &(stats.max[0]), nullptr, &status) == 0)
+        nfound++;
 
-        default:
-            break;
-    }
-
-    //qDebug() << "DATAMIN: " << stats.min << " - DATAMAX: " << stats.max;
-    return 0;
+    // If we found both keywords, no need to calculate them, unless they are both zeros
+    return (nfound == 2 && !(stats.min[0] == 0 && stats.max[0] == 0));
 }
 
 template <typename T>
-QPair<T, T> FITSData::getParitionMinMax(uint32_t start, uint32_t stride)
+void FITSData::calculateMoments(bool updateMinMax)
 {
     auto * buffer = reinterpret_cast<T *>(m_ImageBuffer);
-    T min = std::numeric_limits<T>::max();
-    T max = std::numeric_limits<T>::min();
-
-    uint32_t end = start + stride;
-
-    for (uint32_t i = start; i < end; i++)
-    {
-        if (buffer[i] < min)
-            min = buffer[i];
-        else if (buffer[i] > max)
-            max = buffer[i];
-    }
-
-    return qMakePair(min, max);
-}
-
-template <typename T>
-void FITSData::calculateMinMax()
-{
-    T min = std::numeric_limits<T>::max();
-    T max = std::numeric_limits<T>::min();
 
     // Create N threads
     const uint8_t nThreads = 16;
 
+    // Integer samples of up to 16 bits get one bin per value, so the median is exact and counted with the moments.
+    // Wider and floating point samples are binned over their actual range, which is only known after the first pass.
+    const bool exactBins = std::is_integral<T>::value && sizeof(T) <= 2;
+    const uint32_t binCount = exactBins ? (1u << (8 * std::min<size_t>(sizeof(T), 2))) : 65536;
+
+    // Each thread counts into its own histogram, merged below. The 4 MB of partial histograms come from the arena,
+    // so a stream of frames reuses them, and each thread clears its own.
+    uint32_t *partialFrequency = FITSBufferArena::Instance()->acquire<uint32_t>(nThreads * binCount);
+    if (partialFrequency == nullptr)
+        return;
+
     for (int n = 0; n < m_Channels; n++)
     {
         uint32_t cStart = n * stats.samples_per_channel;
@@ -785,98 +1025,87 @@ void FITSData::calculateMinMax()
         // Start location for inspecting elements
         uint32_t tStart = cStart;
 
+        Histogram &histogram = m_Histogram[n];
+        histogram.origin = exactBins ? std::numeric_limits<T>::min() : 0;
+        histogram.binWidth = 1;
+
         // List of futures
-        QList<QFuture<QPair<T, T>>> futures;
+        QList<QFuture<FITSKernels::Moments>> futures;
 
         for (int i = 0; i < nThreads; i++)
         {
+            const T *partition = buffer + tStart;
+            const uint32_t count = (i == (nThreads - 1)) ? fStride : tStride;
+            uint32_t *frequency = exactBins ? partialFrequency + i * binCount : nullptr;
+            const double origin = histogram.origin;
+
             // Run threads
-            futures.append(QtConcurrent::run(this, &FITSData::getParitionMinMax<T>, tStart, (i == (nThreads - 1)) ? fStride : tStride));
+            futures.append(QtConcurrent::run(FITSWorkerPool::threadPool(), [ = ]()
+            {
+                if (frequency != nullptr)
+                    std::fill(frequency, frequency + binCount, 0);
+                return FITSKernels::computeMomentsAndHistogram<T>(partition, count, origin, 1, frequency, binCount);
+            }));
             tStart += tStride;
         }
 
-        // Now wait for results
+        // Now wait for results and merge them
+        FITSKernels::Moments moments;
         for (int i = 0; i < nThreads; i++)
+            moments.merge(futures[i].result());
+
+        if (updateMinMax)
         {
-            QPair<T, T> result = futures[i].result();
-            if (result.first < min)
-                min = result.first;
-            if (result.second > max)
-                max = result.second;
+            stats.min[n] = moments.min;
+            stats.max[n] = moments.max;
         }
 
-        stats.min[n] = min;
-        stats.max[n] = max;
-    }
-}
-
-template <typename T>
-QPair<double, double> FITSData::getSquaredSumAndMean(uint32_t start, uint32_t stride)
-{
-    uint32_t m_n       = 2;
-    double m_oldM = 0, m_newM = 0, m_oldS = 0, m_newS = 0;
-
-    auto * buffer = reinterpret_cast<T *>(m_ImageBuffer);
-    uint32_t end = start + stride;
-
-    for (uint32_t i = start; i < end; i++)
-    {
-        m_newM = m_oldM + (buffer[i] - m_oldM) / m_n;
-        m_newS = m_oldS + (buffer[i] - m_oldM) * (buffer[i] - m_newM);
-
-        m_oldM = m_newM;
-        m_oldS = m_newS;
-        m_n++;
-    }
-
-    return qMakePair<double, double>(m_newM, m_newS);
-}
-
-template <typename T>
-void FITSData::runningAverageStdDev()
-{
-    // Create N threads
-    const uint8_t nThreads = 16;
-
-    for (int n = 0; n < m_Channels; n++)
-    {
-        uint32_t cStart = n * stats.samples_per_channel;
-
-        // Calculate how many elements we process per thread
-        uint32_t tStride = stats.samples_per_channel / nThreads;
+        stats.mean[n]   = moments.mean;
+        stats.stddev[n] = sqrt(moments.variance());
 
-        // Calculate the final stride since we can have some left over due to division above
-        uint32_t fStride = tStride + (stats.samples_per_channel - (tStride * nThreads));
+        if (!exactBins)
+        {
+            histogram.origin = moments.min;
+            if (moments.max > moments.min)
+                histogram.binWidth = (moments.max - moments.min) / binCount;
 
-        // Start location for inspecting elements
-        uint32_t tStart = cStart;
+            QList<QFuture<void>> histogramFutures;
+            tStart = cStart;
+            for (int i = 0; i < nThreads; i++)
+            {
+                const T *partition = buffer + tStart;
+                const uint32_t count = (i == (nThreads - 1)) ? fStride : tStride;
+                uint32_t *frequency = partialFrequency + i * binCount;
+                const double origin = histogram.origin, binWidth = histogram.binWidth;
 
-        // List of futures
-        QList<QFuture<QPair<double, double>>> futures;
+                histogramFutures.append(QtConcurrent::run(FITSWorkerPool::threadPool(), [ = ]()
+                {
+                    std::fill(frequency, frequency + binCount, 0);
+                    FITSKernels::accumulateHistogram<T>(partition, count, origin, binWidth, frequency, binCount);
+                }));
+                tStart += tStride;
+            }
 
-        for (int i = 0; i < nThreads; i++)
-        {
-            // Run threads
-            futures.append(QtConcurrent::run(this, &FITSData::getSquaredSumAndMean<T>, tStart,
-                                             (i == (nThreads - 1)) ? fStride : tStride));
-            tStart += tStride;
+            for (int i = 0; i < nThreads; i++)
+                histogramFutures[i].waitForFinished();
         }
 
-        double mean = 0, squared_sum = 0;
-
-        // Now wait for results
-        for (int i = 0; i < nThreads; i++)
+        histogram.frequency.resize(binCount);
+        uint32_t *frequency = histogram.frequency.data();
+        std::copy(partialFrequency, partialFrequency + binCount, frequency);
+        for (int i = 1; i < nThreads; i++)
         {
-            QPair<double, double> result = futures[i].result();
-            mean += result.first;
-            squared_sum += result.second;
+            const uint32_t *partial = partialFrequency + i * binCount;
+            for (uint32_t j = 0; j < binCount; j++)
+                frequency[j] += partial[j];
         }
 
-        double variance = squared_sum / stats.samples_per_channel;
-
-        stats.mean[n]   = mean / nThreads;
-        stats.stddev[n] = sqrt(variance);
+        stats.median[n] = FITSKernels::histogramMedian(frequency, binCount, histogram.origin, histogram.binWidth, exactBins);
+        stats.mad[n]    = FITSKernels::histogramMAD(frequency, binCount, histogram.origin, histogram.binWidth,
+                          stats.median[n]);
     }
+
+    FITSBufferArena::Instance()->release(partialFrequency);
 }
 
 QVector<double> FITSData::createGaussianKernel(int size, double sigma)
@@ -1053,6 +1282,8 @@ bool FITSData::getRecordValue(const QString &key, QVariant &value) const
 
 int FITSData::findStars(StarAlgorithm algorithm, const QRect &trackingBox)
 {
+    FITSWorkerPool::StageTimer stageTimer(FITSWorkerPool::STAGE_STAR_DETECTION);
+
     int count = 0;
     starAlgorithm = algorithm;
 
@@ -1237,6 +1468,11 @@ void FITSData::applyFilter(FITSScale type, uint8_t * image, QVector<double> * mi
     if (type == FITS_NONE)
         return;
 
+    if (image == nullptr)
+        emit bufferAboutToChange();
+
+    FITSWorkerPool::StageTimer stageTimer(FITSWorkerPool::STAGE_FILTER);
+
     QVector<double> dataMin(3);
     QVector<double> dataMax(3);
 
@@ -1453,46 +1689,39 @@ void FITSData::applyFilter(FITSScale type, uint8_t * targetImage, QVector<double
 
                 T * runningBuffer = image + cStart;
 
-                if (type == FITS_LOG)
+                for (int i = 0; i < nThreads; i++)
                 {
-                    for (int i = 0; i < nThreads; i++)
+                    T * const runningEnd = runningBuffer + ((i == (nThreads - 1)) ? fStride : tStride);
+
+                    // Run threads
+                    if (type == FITS_LOG)
                     {
-                        // Run threads
-                        futures.append(QtConcurrent::map(runningBuffer, (runningBuffer + ((i == (nThreads - 1)) ? fStride : tStride)), [min, max,
-                                                              coeff, n](T & a)
+                        futures.append(QtConcurrent::run(FITSWorkerPool::threadPool(), [min, max, coeff, n, runningBuffer,
+                                                              runningEnd]()
                         {
-                            a = qBound(min[n], static_cast<T>(round(coeff[n] * std::log(1 + qBound(min[n], a, max[n])))), max[n]);
+                            for (T * a = runningBuffer; a < runningEnd; a++)
+                                *a = qBound(min[n], static_cast<T>(round(coeff[n] * std::log(1 + qBound(min[n], *a, max[n])))), max[n]);
                         }));
-
-                        runningBuffer += tStride;
                     }
-                }
-                else if (type == FITS_SQRT)
-                {
-                    for (int i = 0; i < nThreads; i++)
+                    else if (type == FITS_SQRT)
                     {
-                        // Run threads
-                        futures.append(QtConcurrent::map(runningBuffer, (runningBuffer + ((i == (nThreads - 1)) ? fStride : tStride)), [min, max,
-                                                              coeff, n](T & a)
+                        futures.append(QtConcurrent::run(FITSWorkerPool::threadPool(), [min, max, coeff, n, runningBuffer,
+                                                              runningEnd]()
                         {
-                            a = qBound(min[n], static_cast<T>(round(coeff[n] * a)), max[n]);
+                            for (T * a = runningBuffer; a < runningEnd; a++)
+                                *a = qBound(min[n], static_cast<T>(round(coeff[n] * *a)), max[n]);
                         }));
                     }
-
-                    runningBuffer += tStride;
-                }
-                else
-                {
-                    for (int i = 0; i < nThreads; i++)
+                    else
                     {
-                        // Run threads
-                        futures.append(QtConcurrent::map(runningBuffer, (runningBuffer + ((i == (nThreads - 1)) ? fStride : tStride)), [min, max,
-                                                              n](T & a)
+                        futures.append(QtConcurrent::run(FITSWorkerPool::threadPool(), [min, max, n, runningBuffer, runningEnd]()
                         {
-                            a = qBound(min[n], a, max[n]);
+                            for (T * a = runningBuffer; a < runningEnd; a++)
+                                *a = qBound(min[n], *a, max[n]);
                         }));
-                        runningBuffer += tStride;
                     }
+
+                    runningBuffer += tStride;
                 }
             }
 
@@ -1507,8 +1736,7 @@ void FITSData::applyFilter(FITSScale type, uint8_t * targetImage, QVector<double
                     stats.max[i] = max[i];
                 }
                 //if (type != FITS_AUTO && type != FITS_LINEAR)
-                runningAverageStdDev<T>();
-                //QtConcurrent::run(this, &FITSData::runningAverageStdDev<T>);
+                calculateMoments<T>(false);
             }
         }
         break;
@@ -1557,7 +1785,7 @@ void FITSData::applyFilter(FITSScale type, uint8_t * targetImage, QVector<double
         case FITS_MEDIAN:
         {
             uint8_t BBP      = stats.bytesPerPixel;
-            auto * extension = new T[(width + 2) * (height + 2)];
+            auto * extension = FITSBufferArena::Instance()->acquire<T>((width + 2) * (height + 2));
             //   Check memory allocation
             if (!extension)
                 return;
@@ -1613,10 +1841,10 @@ void FITSData::applyFilter(FITSScale type, uint8_t * targetImage, QVector<double
             }
 
             //   Free memory
-            delete[] extension;
+            FITSBufferArena::Instance()->release(extension);
 
             if (calcStats)
-                runningAverageStdDev<T>();
+                calculateMoments<T>(false);
         }
         break;
 
@@ -2058,7 +2286,7 @@ bool FITSData::rotFITS(int rotate, int mirror)
     int BBP = stats.bytesPerPixel;
 
     /* Allocate buffer for rotated image */
-    rotimage = new uint8_t[stats.samples_per_channel * m_Channels * BBP];
+    rotimage = FITSBufferArena::Instance()->acquire(stats.samples_per_channel * m_Channels * BBP);
 
     if (rotimage == nullptr)
     {
@@ -2281,7 +2509,7 @@ bool FITSData::rotFITS(int rotate, int mirror)
         }
     }
 
-    delete[] m_ImageBuffer;
+    clearImageBuffers();
     m_ImageBuffer = rotimage;
 
     return true;
@@ -2582,7 +2810,7 @@ uint8_t const * FITSData::getImageBuffer() const
 
 void FITSData::setImageBuffer(uint8_t * buffer)
 {
-    delete[] m_ImageBuffer;
+    clearImageBuffers();
     m_ImageBuffer = buffer;
 }
 
@@ -2691,6 +2919,10 @@ void FITSData::setBayerParams(BayerParams * param)
 
 bool FITSData::debayer()
 {
+    FITSWorkerPool::StageTimer stageTimer(FITSWorkerPool::STAGE_DEBAYER);
+
+    emit bufferAboutToChange();
+
     //    if (m_ImageBuffer == nullptr)
     //    {
     //        int anynull = 0, status = 0;
@@ -2719,12 +2951,61 @@ bool FITSData::debayer()
     }
 }
 
+template <typename T>
+bool FITSData::debayer()
+{
+    const uint32_t rgb_size = stats.samples_per_channel * 3 * stats.bytesPerPixel;
+    auto * planar = reinterpret_cast<T *>(FITSBufferArena::Instance()->acquire(rgb_size));
+
+    if (planar == nullptr)
+    {
+        KSNotification::error(i18n("Unable to allocate memory for temporary bayer buffer."), i18n("Debayer error"));
+        return false;
+    }
+
+    int height = stats.height;
+    auto * source = reinterpret_cast<const T *>(m_ImageBuffer);
+
+    if (debayerParams.offsetY == 1)
+    {
+        source += stats.width;
+        height--;
+
+        // The last row has no bayer data
+        for (int channel = 0; channel < 3; channel++)
+            memset(planar + channel * stats.samples_per_channel + height * stats.width, 0, stats.width * sizeof(T));
+    }
+    // offsetX == 1 is handled in checkDebayer() and should be 0 here.
+
+    dc1394error_t error_code = FITSDemosaic::demosaic(source, stats.width, height, debayerParams.filter,
+                               debayerParams.method, planar, stats.samples_per_channel);
+
+    if (error_code != DC1394_SUCCESS)
+    {
+        KSNotification::error(i18n("Debayer failed (%1)", error_code), i18n("Debayer error"));
+        m_Channels = 1;
+        FITSBufferArena::Instance()->release(planar);
+        return false;
+    }
+
+    clearImageBuffers();
+    m_ImageBuffer = reinterpret_cast<uint8_t *>(planar);
+    m_ImageBufferSize = rgb_size;
+
+    m_Channels = (m_Mode == FITS_NORMAL) ? 3 : 1;
+    return true;
+}
+
 bool FITSData::debayer_8bit()
 {
+    // The parallel methods write the planar layout directly
+    if (FITSDemosaic::supports(debayerParams.method))
+        return debayer<uint8_t>();
+
     dc1394error_t error_code;
 
     uint32_t rgb_size = stats.samples_per_channel * 3 * stats.bytesPerPixel;
-    auto * destinationBuffer = new uint8_t[rgb_size];
+    auto * destinationBuffer = FITSBufferArena::Instance()->acquire(rgb_size);
 
     auto * bayer_source_buffer      = reinterpret_cast<uint8_t *>(m_ImageBuffer);
     auto * bayer_destination_buffer = reinterpret_cast<uint8_t *>(destinationBuffer);
@@ -2753,18 +3034,18 @@ bool FITSData::debayer_8bit()
     {
         KSNotification::error(i18n("Debayer failed (%1)", error_code), i18n("Debayer error"));
         m_Channels = 1;
-        delete[] destinationBuffer;
+        FITSBufferArena::Instance()->release(destinationBuffer);
         return false;
     }
 
     if (m_ImageBufferSize != rgb_size)
     {
-        delete[] m_ImageBuffer;
-        m_ImageBuffer = new uint8_t[rgb_size];
+        clearImageBuffers();
+        m_ImageBuffer = FITSBufferArena::Instance()->acquire(rgb_size);
 
         if (m_ImageBuffer == nullptr)
         {
-            delete[] destinationBuffer;
+            FITSBufferArena::Instance()->release(destinationBuffer);
             KSNotification::error(i18n("Unable to allocate memory for temporary bayer buffer."), i18n("Debayer error"));
             return false;
         }
@@ -2789,16 +3070,20 @@ bool FITSData::debayer_8bit()
     }
 
     m_Channels = (m_Mode == FITS_NORMAL) ? 3 : 1;
-    delete[] destinationBuffer;
+    FITSBufferArena::Instance()->release(destinationBuffer);
     return true;
 }
 
 bool FITSData::debayer_16bit()
 {
+    // The parallel methods write the planar layout directly
+    if (FITSDemosaic::supports(debayerParams.method))
+        return debayer<uint16_t>();
+
     dc1394error_t error_code;
 
     uint32_t rgb_size = stats.samples_per_channel * 3 * stats.bytesPerPixel;
-    auto * destinationBuffer = new uint8_t[rgb_size];
+    auto * destinationBuffer = FITSBufferArena::Instance()->acquire(rgb_size);
 
     auto * bayer_source_buffer      = reinterpret_cast<uint16_t *>(m_ImageBuffer);
     auto * bayer_destination_buffer = reinterpret_cast<uint16_t *>(destinationBuffer);
@@ -2827,18 +3112,18 @@ bool FITSData::debayer_16bit()
     {
         KSNotification::error(i18n("Debayer failed (%1)", error_code), i18n("Debayer error"));
         m_Channels = 1;
-        delete[] destinationBuffer;
+        FITSBufferArena::Instance()->release(destinationBuffer);
         return false;
     }
 
     if (m_ImageBufferSize != rgb_size)
     {
-        delete[] m_ImageBuffer;
-        m_ImageBuffer = new uint8_t[rgb_size];
+        clearImageBuffers();
+        m_ImageBuffer = FITSBufferArena::Instance()->acquire(rgb_size);
 
         if (m_ImageBuffer == nullptr)
         {
-            delete[] destinationBuffer;
+            FITSBufferArena::Instance()->release(destinationBuffer);
             KSNotification::error(i18n("Unable to allocate memory for temporary bayer buffer."), i18n("Debayer error"));
             return false;
         }
@@ -2863,7 +3148,7 @@ bool FITSData::debayer_16bit()
     }
 
     m_Channels = (m_Mode == FITS_NORMAL) ? 3 : 1;
-    delete[] destinationBuffer;
+    FITSBufferArena::Instance()->release(destinationBuffer);
     return true;
 }
 
@@ -47,6 +47,7 @@
 
 #include "fitsskyobject.h"
 
+class QFile;
 class QProgressDialog;
 
 class SkyPoint;
@@ -105,6 +106,8 @@ class FITSData : public QObject
             double mean[3] = {0};
             double stddev[3] = {0};
             double median[3] = {0};
+            /// Median absolute deviation from the median
+            double mad[3] = {0};
             double SNR { 0 };
             int bitpix { 8 };
             int bytesPerPixel { 1 };
@@ -115,6 +118,16 @@ class FITSData : public QObject
             uint16_t height { 0 };
         } Statistic;
 
+        /// Full resolution histogram of a channel, counted in the same pass as the statistics
+        typedef struct
+        {
+            /// Sample value of the first bin
+            double origin { 0 };
+            /// Width of a bin in sample units. 1 for integer samples of up to 16 bits, one bin per value.
+            double binWidth { 1 };
+            QVector<uint32_t> frequency;
+        } Histogram;
+
         /**
          * @brief loadFITS Loading FITS file asynchronously.
          * @param inFilename Path to FITS file (or compressed fits.gz)
@@ -144,6 +157,7 @@ class FITSData : public QObject
 
         // Access functions
         void clearImageBuffers();
+        // The buffer must come from FITSBufferArena, it is released to it once replaced
         void setImageBuffer(uint8_t *buffer);
         uint8_t const *getImageBuffer() const;
         uint8_t *getWritableImageBuffer();
@@ -210,6 +224,14 @@ class FITSData : public QObject
         {
             return stats.median[channel];
         }
+        double getMAD(uint8_t channel = 0) const
+        {
+            return stats.mad[channel];
+        }
+        const Histogram &getHistogram(uint8_t channel = 0) const
+        {
+            return m_Histogram[channel];
+        }
 
         int getBytesPerPixel() const
         {
@@ -378,6 +400,10 @@ class FITSData : public QObject
         {
             return m_isCompressed;
         }
+        bool isMemoryMapped() const
+        {
+            return m_MemoryMapped;
+        }
 
         // Horizontal flip counter. We keep count to rotate WCS keywords on save
         int getFlipHCounter() const;
@@ -414,12 +440,16 @@ class FITSData : public QObject
 
     signals:
         void converted(QImage);
+        /// Emitted before the image buffer is changed in place by a filter or a debayering, or is freed or replaced
+        void bufferAboutToChange();
 
     private:
         void loadCommon(const QString &inFilename);
         bool privateLoad(void *fits_buffer, size_t fits_buffer_size, bool silent);
+        bool loadMappedImage();
+        int readCompressedImage(long nelements);
         void rotWCSFITS(int angle, int mirror);
-        int calculateMinMax(bool refresh = false);
+        bool readMinMaxKeywords();
         bool checkDebayer();
         void readWCSKeys();
 
@@ -428,6 +458,7 @@ class FITSData : public QObject
         //int getFITSRecord(QString &recordList, int &nkeys);
 
         // Templated functions
+        // Debayer with FITSDemosaic, straight into the planar buffer
         template <typename T>
         bool debayer();
 
@@ -438,12 +469,6 @@ class FITSData : public QObject
         template <typename T>
         void applyFilter(FITSScale type, uint8_t *targetImage, QVector<double> * min = nullptr, QVector<double> * max = nullptr);
 
-        template <typename T>
-        void calculateMinMax();
-
-        template <typename T>
-        QPair<T, T> getParitionMinMax(uint32_t start, uint32_t stride);
-
         /* Calculate the Gaussian blur matrix and apply it to the image using the convolution filter */
         QVector<double> createGaussianKernel(int size, double sigma);
         template <typename T>
@@ -451,11 +476,10 @@ class FITSData : public QObject
         template <typename T>
         void gaussianBlur(int kernelSize, double sigma);
 
-        /* Calculate running average & standard deviation using Welford’s method for computing variance */
-        template <typename T>
-        void runningAverageStdDev();
+        /* Calculate min, max, mean, standard deviation and the histogram in a single pass, merging partitions with Chan's method for computing variance.
+           Median and median absolute deviation are then read from the histogram. */
         template <typename T>
-        QPair<double, double> getSquaredSumAndMean(uint32_t start, uint32_t stride);
+        void calculateMoments(bool updateMinMax = true);
 
         template <typename T>
         void convertToQImage(double dataMin, double dataMax, double scale, double zero, QImage &image);
@@ -474,6 +498,12 @@ class FITSData : public QObject
         uint8_t *m_ImageBuffer { nullptr };
         /// Above buffer size in bytes
         uint32_t m_ImageBufferSize { 0 };
+        /// Histogram of each channel, updated with the statistics
+        Histogram m_Histogram[3];
+        /// File backing m_ImageBuffer when the image data is memory-mapped instead of read by CFITSIO
+        QFile *m_MappedFile { nullptr };
+        /// Was the image data read from a mapping of the file, used in place or converted, instead of by CFITSIO?
+        bool m_MemoryMapped { false };
         /// Is this a temporary file or one loaded from disk?
         bool m_isTemporary { false };
         /// is this file compress (.fits.fz)?
@@ -0,0 +1,511 @@
+/*  FITS Demosaic
+
+    This application is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+*/
+
+#include "fitsdemosaic.h"
+
+#include "fitsworkerpool.h"
+
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace
+{
+// Planes of the output
+enum
+{
+    RED,
+    GREEN,
+    BLUE
+};
+
+// Bands should be large enough for the rows they read around them to be a small overhead
+constexpr int minimumBandRows = 32;
+
+// The color filter, which repeats every two rows and two columns
+class FilterPattern
+{
+    public:
+        explicit FilterPattern(dc1394color_filter_t filter)
+        {
+            // Top left, top right, bottom left and bottom right colors of the filter
+            switch (filter)
+            {
+                case DC1394_COLOR_FILTER_RGGB:
+                    set(RED, GREEN, GREEN, BLUE);
+                    break;
+                case DC1394_COLOR_FILTER_GBRG:
+                    set(GREEN, BLUE, RED, GREEN);
+                    break;
+                case DC1394_COLOR_FILTER_GRBG:
+                    set(GREEN, RED, BLUE, GREEN);
+                    break;
+                case DC1394_COLOR_FILTER_BGGR:
+                    set(BLUE, GREEN, GREEN, RED);
+                    break;
+            }
+        }
+
+        // Color of a pixel. Negative rows and columns are fine, the pattern extends across the edges.
+        int at(int row, int col) const
+        {
+            return m_Colors[row & 1][col & 1];
+        }
+
+    private:
+        void set(int topLeft, int topRight, int bottomLeft, int bottomRight)
+        {
+            m_Colors[0][0] = topLeft;
+            m_Colors[0][1] = topRight;
+            m_Colors[1][0] = bottomLeft;
+            m_Colors[1][1] = bottomRight;
+        }
+
+        int m_Colors[2][2];
+};
+
+int bandCount(int rows)
+{
+    return qBound(1, rows / minimumBandRows, 2 * FITSWorkerPool::threadPool()->maxThreadCount());
+}
+
+// Runs bandFunction(band, firstRow, lastRow) for bands of the rows [first, last) on the worker pool.
+// Blocks until all bands are done.
+template <typename F>
+void forEachBand(int first, int last, int bands, F bandFunction)
+{
+    const int rows = last - first;
+    if (rows <= 0)
+        return;
+
+    QList<QFuture<void>> futures;
+    for (int band = 0; band < bands; band++)
+    {
+        const int bandFirst = first + static_cast<int>(static_cast<int64_t>(rows) * band / bands);
+        const int bandLast  = first + static_cast<int>(static_cast<int64_t>(rows) * (band + 1) / bands);
+        futures.append(QtConcurrent::run(FITSWorkerPool::threadPool(), [ = ]()
+        {
+            bandFunction(band, bandFirst, bandLast);
+        }));
+    }
+
+    for (auto &future : futures)
+        future.waitForFinished();
+}
+
+// Sets a row of all planes to black
+template <typename T>
+void clearRow(T *planar, size_t planeStride, int width, int row)
+{
+    for (int c = 0; c < 3; c++)
+        memset(planar + c * planeStride + static_cast<size_t>(row) * width, 0, width * sizeof(T));
+}
+
+// Nearest neighbour, as dc1394_bayer_NearestNeighbor(): each pixel takes the red and blue samples of the
+// 2x2 block it is the top left of, and the green sample of the right column of that block.
+// The last row and column are black.
+template <typename T>
+void nearestNeighbor(const T *bayer, int width, int height, const FilterPattern &pattern, T *planar,
+                     size_t planeStride)
+{
+    // Offsets of the samples of each color from the top left of the block, for each position in the filter
+    int offsets[2][2][3];
+    for (int pr = 0; pr < 2; pr++)
+    {
+        for (int pc = 0; pc < 2; pc++)
+        {
+            for (int dy = 0; dy < 2; dy++)
+            {
+                for (int dx = 0; dx < 2; dx++)
+                {
+                    const int color = pattern.at(pr + dy, pc + dx);
+                    if (color != GREEN || dx == 1)
+                        offsets[pr][pc][color] = dy * width + dx;
+                }
+            }
+        }
+    }
+
+    T *red   = planar;
+    T *green = planar + planeStride;
+    T *blue  = planar + 2 * planeStride;
+
+    forEachBand(0, height - 1, bandCount(height - 1), [ = ](int, int first, int last)
+    {
+        for (int row = first; row < last; row++)
+        {
+            const size_t rowStart = static_cast<size_t>(row) * width;
+            const T *source = bayer + rowStart;
+            // Local copies, as stores to 8 bit samples may alias anything
+            const int evenRed = offsets[row & 1][0][RED], evenGreen = offsets[row & 1][0][GREEN],
+                      evenBlue = offsets[row & 1][0][BLUE];
+            const int oddRed = offsets[row & 1][1][RED] + 1, oddGreen = offsets[row & 1][1][GREEN] + 1,
+                      oddBlue = offsets[row & 1][1][BLUE] + 1;
+            const int last = width - 1;
+            T *r = red + rowStart;
+            T *g = green + rowStart;
+            T *b = blue + rowStart;
+
+            int col = 0;
+            for (; col + 1 < last; col += 2)
+            {
+                r[col]     = source[col + evenRed];
+                g[col]     = source[col + evenGreen];
+                b[col]     = source[col + evenBlue];
+                r[col + 1] = source[col + oddRed];
+                g[col + 1] = source[col + oddGreen];
+                b[col + 1] = source[col + oddBlue];
+            }
+            if (col < last)
+            {
+                r[col] = source[col + evenRed];
+                g[col] = source[col + evenGreen];
+                b[col] = source[col + evenBlue];
+            }
+
+            r[last] = g[last] = b[last] = 0;
+        }
+    });
+
+    clearRow(planar, planeStride, width, height - 1);
+}
+
+// Bilinear rows [first, last), as dc1394_bayer_Bilinear(): each missing color is the rounded average of the
+// neighbours of that color. The first and last columns are black.
+template <typename T>
+void bilinearRows(const T *bayer, int width, const FilterPattern &pattern, T *planar, size_t planeStride,
+                  int first, int last)
+{
+    for (int row = first; row < last; row++)
+    {
+        const size_t rowStart = static_cast<size_t>(row) * width;
+        const T *source = bayer + rowStart;
+        T *output[3] = { planar + rowStart, planar + planeStride + rowStart, planar + 2 * planeStride + rowStart };
+
+        // Each row alternates green with one other color, the remaining color is on the rows above and below
+        const bool greenFirst = pattern.at(row, 0) == GREEN;
+        const int rowColor = greenFirst ? pattern.at(row, 1) : pattern.at(row, 0);
+        T *own   = output[rowColor];
+        T *other = output[2 - rowColor];
+        T *green = output[GREEN];
+
+        auto colorPixel = [ = ](int col)
+        {
+            const T *p  = source + col;
+            own[col]   = p[0];
+            green[col] = (p[-1] + p[1] + p[-width] + p[width] + 2) >> 2;
+            other[col] = (p[-width - 1] + p[-width + 1] + p[width - 1] + p[width + 1] + 2) >> 2;
+        };
+        auto greenPixel = [ = ](int col)
+        {
+            const T *p  = source + col;
+            green[col] = p[0];
+            own[col]   = (p[-1] + p[1] + 1) >> 1;
+            other[col] = (p[-width] + p[width] + 1) >> 1;
+        };
+
+        // Pixels are handled in pairs starting from the odd column 1
+        int col = 1;
+        if (greenFirst)
+        {
+            for (; col + 1 < width - 1; col += 2)
+            {
+                colorPixel(col);
+                greenPixel(col + 1);
+            }
+            if (col < width - 1)
+                colorPixel(col);
+        }
+        else
+        {
+            for (; col + 1 < width - 1; col += 2)
+            {
+                greenPixel(col);
+                colorPixel(col + 1);
+            }
+            if (col < width - 1)
+                greenPixel(col);
+        }
+
+        for (int c = 0; c < 3; c++)
+            output[c][0] = output[c][width - 1] = 0;
+    }
+}
+
+template <typename T>
+void bilinear(const T *bayer, int width, int height, const FilterPattern &pattern, T *planar, size_t planeStride)
+{
+    clearRow(planar, planeStride, width, 0);
+    forEachBand(1, height - 1, bandCount(height - 2), [ = ](int, int first, int last)
+    {
+        bilinearRows(bayer, width, pattern, planar, planeStride, first, last);
+    });
+    clearRow(planar, planeStride, width, height - 1);
+}
+
+/*
+   Variable Number of Gradients, as dc1394_bayer_VNG(), on the planar result of bilinear().
+   The terms and neighbourhood are those of bayer.c, from dcraw.
+   Gradients are numbered clockwise from NW=0 to W=7.
+ */
+const int vngTerms[] =
+{
+    -2, -2, +0, -1, 0, 0x01, -2, -2, +0, +0, 1, 0x01, -2, -1, -1, +0, 0, 0x01, -2, -1, +0, -1, 0, 0x02,
+    -2, -1, +0, +0, 0, 0x03, -2, -1, +0, +1, 1, 0x01, -2, +0, +0, -1, 0, 0x06, -2, +0, +0, +0, 1, 0x02,
+    -2, +0, +0, +1, 0, 0x03, -2, +1, -1, +0, 0, 0x04, -2, +1, +0, -1, 1, 0x04, -2, +1, +0, +0, 0, 0x06,
+    -2, +1, +0, +1, 0, 0x02, -2, +2, +0, +0, 1, 0x04, -2, +2, +0, +1, 0, 0x04, -1, -2, -1, +0, 0, 0x80,
+    -1, -2, +0, -1, 0, 0x01, -1, -2, +1, -1, 0, 0x01, -1, -2, +1, +0, 1, 0x01, -1, -1, -1, +1, 0, 0x88,
+    -1, -1, +1, -2, 0, 0x40, -1, -1, +1, -1, 0, 0x22, -1, -1, +1, +0, 0, 0x33, -1, -1, +1, +1, 1, 0x11,
+    -1, +0, -1, +2, 0, 0x08, -1, +0, +0, -1, 0, 0x44, -1, +0, +0, +1, 0, 0x11, -1, +0, +1, -2, 1, 0x40,
+    -1, +0, +1, -1, 0, 0x66, -1, +0, +1, +0, 1, 0x22, -1, +0, +1, +1, 0, 0x33, -1, +0, +1, +2, 1, 0x10,
+    -1, +1, +1, -1, 1, 0x44, -1, +1, +1, +0, 0, 0x66, -1, +1, +1, +1, 0, 0x22, -1, +1, +1, +2, 0, 0x10,
+    -1, +2, +0, +1, 0, 0x04, -1, +2, +1, +0, 1, 0x04, -1, +2, +1, +1, 0, 0x04, +0, -2, +0, +0, 1, 0x80,
+    +0, -1, +0, +1, 1, 0x88, +0, -1, +1, -2, 0, 0x40, +0, -1, +1, +0, 0, 0x11, +0, -1, +2, -2, 0, 0x40,
+    +0, -1, +2, -1, 0, 0x20, +0, -1, +2, +0, 0, 0x30, +0, -1, +2, +1, 1, 0x10, +0, +0, +0, +2, 1, 0x08,
+    +0, +0, +2, -2, 1, 0x40, +0, +0, +2, -1, 0, 0x60, +0, +0, +2, +0, 1, 0x20, +0, +0, +2, +1, 0, 0x30,
+    +0, +0, +2, +2, 1, 0x10, +0, +1, +1, +0, 0, 0x44, +0, +1, +1, +2, 0, 0x10, +0, +1, +2, -1, 1, 0x40,
+    +0, +1, +2, +0, 0, 0x60, +0, +1, +2, +1, 0, 0x20, +0, +1, +2, +2, 0, 0x10, +1, -2, +1, +0, 0, 0x80,
+    +1, -1, +1, +1, 0, 0x88, +1, +0, +1, +2, 0, 0x08, +1, +0, +2, -1, 0, 0x40, +1, +0, +2, +1, 0, 0x10
+};
+const int vngNeighbourhood[] = { -1, -1, -1, 0, -1, +1, 0, +1, +1, +1, +1, 0, +1, -1, 0, -1 };
+
+// Gradient terms and neighbours of each position in the filter, as offsets into the planar image
+struct VNGCode
+{
+    int code[2][2][320];
+};
+
+void buildVNGCode(const FilterPattern &pattern, int width, int planeStride, VNGCode *vng)
+{
+    for (int row = 0; row < 2; row++)
+    {
+        for (int col = 0; col < 2; col++)
+        {
+            int *ip = vng->code[row][col];
+            const int *cp = vngTerms;
+            for (int t = 0; t < 64; t++)
+            {
+                const int y1 = *cp++, x1 = *cp++, y2 = *cp++, x2 = *cp++, weight = *cp++, grads = *cp++;
+                const int color = pattern.at(row + y1, col + x1);
+                if (pattern.at(row + y2, col + x2) != color)
+                    continue;
+                const int diag = (pattern.at(row, col + 1) == color && pattern.at(row + 1, col) == color) ? 2 : 1;
+                if (abs(y1 - y2) == diag && abs(x1 - x2) == diag)
+                    continue;
+                *ip++ = y1 * width + x1 + color * planeStride;
+                *ip++ = y2 * width + x2 + color * planeStride;
+                *ip++ = weight;
+                for (int g = 0; g < 8; g++)
+                    if (grads & 1 << g)
+                        *ip++ = g;
+                *ip++ = -1;
+            }
+            *ip++ = INT_MAX;
+
+            cp = vngNeighbourhood;
+            const int color = pattern.at(row, col);
+            for (int g = 0; g < 8; g++)
+            {
+                const int y = *cp++, x = *cp++;
+                *ip++ = y * width + x;
+                if (pattern.at(row + y, col + x) != color && pattern.at(row + y * 2, col + x * 2) == color)
+                    *ip++ = 2 * (y * width + x) + color * planeStride;
+                else
+                    *ip++ = 0;
+            }
+        }
+    }
+}
+
+// Interpolates one pixel of the bilinear image into output[0], output[width] and output[2 * width]
+template <typename T>
+void vngPixel(const T *pix, int color, const int *ip, int planeStride, T *output, int width)
+{
+    int gval[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    int g;
+
+    // Calculate gradients
+    while ((g = ip[0]) != INT_MAX)
+    {
+        const int diff = abs(pix[g] - pix[ip[1]]) << ip[2];
+        gval[ip[3]] += diff;
+        ip += 5;
+        if ((g = ip[-1]) == -1)
+            continue;
+        gval[g] += diff;
+        while ((g = *ip++) != -1)
+            gval[g] += diff;
+    }
+    ip++;
+
+    // Choose a threshold
+    int gmin = gval[0], gmax = gval[0];
+    for (g = 1; g < 8; g++)
+    {
+        if (gmin > gval[g])
+            gmin = gval[g];
+        if (gmax < gval[g])
+            gmax = gval[g];
+    }
+    if (gmax == 0)
+    {
+        for (int c = 0; c < 3; c++)
+            output[c * width] = pix[c * planeStride];
+        return;
+    }
+    const int thold = gmin + (gmax >> 1);
+
+    // Average the neighbors
+    int sum[3] = { 0, 0, 0 };
+    int num = 0;
+    for (g = 0; g < 8; g++, ip += 2)
+    {
+        if (gval[g] <= thold)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                if (c == color && ip[1])
+                    sum[c] += (pix[c * planeStride] + pix[ip[1]]) >> 1;
+                else
+                    sum[c] += pix[ip[0] + c * planeStride];
+            }
+            num++;
+        }
+    }
+
+    constexpr int maximum = std::numeric_limits<T>::max();
+    for (int c = 0; c < 3; c++)
+    {
+        int t = pix[color * planeStride];
+        if (c != color)
+            t += (sum[c] - sum[color]) / num;
+        output[c * width] = t < 0 ? 0 : (t > maximum ? maximum : t);
+    }
+}
+
+template <typename T>
+void vng(const T *bayer, int width, int height, const FilterPattern &pattern, T *planar, size_t planeStride)
+{
+    bilinear(bayer, width, height, pattern, planar, planeStride);
+
+    // Rows and columns closer than 2 pixels to the edges keep their bilinear values
+    if (width < 5 || height < 5)
+        return;
+
+    VNGCode vngCode;
+    buildVNGCode(pattern, width, static_cast<int>(planeStride), &vngCode);
+    const VNGCode *code = &vngCode;
+
+    // A row is interpolated from the bilinear values of the two rows above and below it. Within a band, rows
+    // are written back two rows late, as in bayer.c. The first and last two rows of a band are read by the
+    // neighbouring bands though, so they are only written back once all bands are done.
+    const int bands = bandCount(height - 4);
+    std::vector<std::vector<T>> deferred(bands);
+    std::vector<std::vector<int>> deferredRows(bands);
+    const int stride = static_cast<int>(planeStride);
+
+    forEachBand(2, height - 2, bands, [ =, &deferred, &deferredRows](int band, int first, int last)
+    {
+        // Three rows of results, with the three planes of a row one after another
+        std::vector<T> ring(3 * 3 * width);
+        std::vector<T> &edgeRows = deferred[band];
+        std::vector<int> &edgeRowNumbers = deferredRows[band];
+
+        auto storeRow = [&](int row)
+        {
+            const T *result = ring.data() + (row % 3) * 3 * width;
+            if (row < first + 2 || row >= last - 2)
+            {
+                edgeRows.insert(edgeRows.end(), result, result + 3 * width);
+                edgeRowNumbers.push_back(row);
+                return;
+            }
+            for (int c = 0; c < 3; c++)
+                memcpy(planar + c * planeStride + static_cast<size_t>(row) * width + 2, result + c * width + 2,
+                       (width - 4) * sizeof(T));
+        };
+
+        for (int row = first; row < last; row++)
+        {
+            T *result = ring.data() + (row % 3) * 3 * width;
+            const T *pixRow = planar + static_cast<size_t>(row) * width;
+            for (int col = 2; col < width - 2; col++)
+                vngPixel(pixRow + col, pattern.at(row, col), code->code[row & 1][col & 1], stride, result + col,
+                         width);
+
+            if (row - 2 >= first)
+                storeRow(row - 2);
+        }
+        for (int row = qMax(first, last - 2); row < last; row++)
+            storeRow(row);
+    });
+
+    for (int band = 0; band < bands; band++)
+    {
+        for (size_t i = 0; i < deferredRows[band].size(); i++)
+        {
+            const T *result = deferred[band].data() + i * 3 * width;
+            const size_t rowStart = static_cast<size_t>(deferredRows[band][i]) * width;
+            for (int c = 0; c < 3; c++)
+                memcpy(planar + c * planeStride + rowStart + 2, result + c * width + 2, (width - 4) * sizeof(T));
+        }
+    }
+}
+}
+
+namespace FITSDemosaic
+{
+bool supports(dc1394bayer_method_t method)
+{
+    return method == DC1394_BAYER_METHOD_NEAREST || method == DC1394_BAYER_METHOD_BILINEAR ||
+           method == DC1394_BAYER_METHOD_VNG;
+}
+
+template <typename T>
+dc1394error_t demosaic(const T *bayer, int width, int height, dc1394color_filter_t filter,
+                       dc1394bayer_method_t method, T *planar, size_t planeStride)
+{
+    if ((filter > DC1394_COLOR_FILTER_MAX) || (filter < DC1394_COLOR_FILTER_MIN))
+        return DC1394_INVALID_COLOR_FILTER;
+    if (width < 2 || height < 2 || planeStride < static_cast<size_t>(width) * height)
+        return DC1394_FAILURE;
+
+    const FilterPattern pattern(filter);
+
+    switch (method)
+    {
+        case DC1394_BAYER_METHOD_NEAREST:
+            nearestNeighbor(bayer, width, height, pattern, planar, planeStride);
+            return DC1394_SUCCESS;
+
+        case DC1394_BAYER_METHOD_BILINEAR:
+            bilinear(bayer, width, height, pattern, planar, planeStride);
+            return DC1394_SUCCESS;
+
+        case DC1394_BAYER_METHOD_VNG:
+            // The gradient terms are offsets across planes
+            if (2 * planeStride + 2 * static_cast<size_t>(width) + 2 >= static_cast<size_t>(INT_MAX))
+                return DC1394_FAILURE;
+            vng(bayer, width, height, pattern, planar, planeStride);
+            return DC1394_SUCCESS;
+
+        default:
+            return DC1394_INVALID_BAYER_METHOD;
+    }
+}
+
+template dc1394error_t demosaic<uint8_t>(const uint8_t *, int, int, dc1394color_filter_t, dc1394bayer_method_t,
+        uint8_t *, size_t);
+template dc1394error_t demosaic<uint16_t>(const uint16_t *, int, int, dc1394color_filter_t, dc1394bayer_method_t,
+        uint16_t *, size_t);
+}
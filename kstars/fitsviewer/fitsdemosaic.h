@@ -0,0 +1,49 @@
+/*  FITS Demosaic
+
+    This application is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include "bayer.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @namespace FITSDemosaic
+ * Debayering of raw color frames straight into the planar R, G, B layout of FITS images.
+ *
+ * The frame is split into bands of rows that are interpolated in parallel on the FITS worker pool. Each band
+ * reads the rows around it from the shared bayer frame, so bands need no copy of their neighbours. The
+ * results are the same as those of the bayer.c methods, without an interleaved RGB intermediate buffer.
+ *
+ * Only the nearest neighbour, bilinear and VNG methods are implemented here. Other methods should use
+ * dc1394_bayer_decoding_8bit() or dc1394_bayer_decoding_16bit().
+ */
+namespace FITSDemosaic
+{
+/**
+ * @brief supports Whether a debayering method is implemented by demosaic().
+ */
+bool supports(dc1394bayer_method_t method);
+
+/**
+ * @brief demosaic Debayer a raw frame into three color planes.
+ * @param bayer raw frame of width x height samples.
+ * @param width width of the frame.
+ * @param height height of the frame.
+ * @param filter color filter of the first two rows and columns of the frame.
+ * @param method debayering method, see supports().
+ * @param planar output, the red plane followed by the green and blue planes.
+ * @param planeStride distance between the first samples of consecutive planes, at least width x height.
+ * @return DC1394_SUCCESS, or the reason the frame could not be debayered.
+ * @note Like bayer.c, pixels along the edges that cannot be interpolated are black.
+ */
+template <typename T>
+dc1394error_t demosaic(const T *bayer, int width, int height, dc1394color_filter_t filter,
+                       dc1394bayer_method_t method, T *planar, size_t planeStride);
+}
@@ -22,6 +22,7 @@
 
 #include "fits_debug.h"
 #include "fitsgradientdetector.h"
+#include "fitsbufferarena.h"
 
 FITSStarDetector& FITSGradientDetector::configure(const QString &, const QVariant &)
 {
@@ -85,7 +86,7 @@ int FITSGradientDetector::findSources(QList<Edge*> &starCenters, const QRect &bo
     uint32_t offset = subX + subY * dataWidth;
 
     // #2 Create new buffer
-    auto * buffer = new uint8_t[size * BBP];
+    auto * buffer = FITSBufferArena::Instance()->acquire(size * BBP);
     // If there is no offset, copy whole buffer in one go
     if (offset == 0)
         memcpy(buffer, data->getImageBuffer(), size * BBP);
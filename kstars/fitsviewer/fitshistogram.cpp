@@ -13,6 +13,7 @@
 #include "fits_debug.h"
 
 #include "Options.h"
+#include "fitsbufferarena.h"
 #include "fitsdata.h"
 #include "fitstab.h"
 #include "fitsview.h"
@@ -136,59 +137,9 @@ void FITSHistogram::showEvent(QShowEvent * event)
 void FITSHistogram::constructHistogram()
 {
     FITSData * imageData = tab->getView()->getImageData();
-
-    isGUISynced = false;
-
-    switch (imageData->property("dataType").toInt())
-    {
-        case TBYTE:
-            constructHistogram<uint8_t>();
-            break;
-
-        case TSHORT:
-            constructHistogram<int16_t>();
-            break;
-
-        case TUSHORT:
-            constructHistogram<uint16_t>();
-            break;
-
-        case TLONG:
-            constructHistogram<int32_t>();
-            break;
-
-        case TULONG:
-            constructHistogram<uint32_t>();
-            break;
-
-        case TFLOAT:
-            constructHistogram<float>();
-            break;
-
-        case TLONGLONG:
-            constructHistogram<int64_t>();
-            break;
-
-        case TDOUBLE:
-            constructHistogram<double>();
-            break;
-
-        default:
-            break;
-    }
-
-    m_Constructed = true;
-    if (isVisible())
-        syncGUI();
-}
-
-template <typename T> void FITSHistogram::constructHistogram()
-{
-    FITSData * imageData = tab->getView()->getImageData();
-    uint16_t width = imageData->width(), height = imageData->height();
     uint8_t channels = imageData->channels();
 
-    auto * const buffer = reinterpret_cast<T const *>(imageData->getImageBuffer());
+    isGUISynced = false;
 
     double min, max;
     for (int i = 0 ; i < 3; i++)
@@ -198,9 +149,6 @@ template <typename T> void FITSHistogram::constructHistogram()
         FITSMax[i] = max;
     }
 
-    uint32_t samples = width * height;
-    const uint32_t sampleBy = samples > 1000000 ? samples / 1000000 : 1;
-
     //binCount = static_cast<uint16_t>(sqrt(samples));
     binCount = qMin(FITSMax[0] - FITSMin[0], 400.0);
     if (binCount <= 0)
@@ -212,8 +160,6 @@ template <typename T> void FITSHistogram::constructHistogram()
         frequency[n].fill(0, binCount);
         cumulativeFrequency[n].fill(0, binCount);
         binWidth[n] = (FITSMax[n] - FITSMin[n]) / (binCount - 1);
-        // Initialize the median to 0 in case the computation below fails.
-        imageData->setMedian(0, n);
     }
 
     QVector<QFuture<void>> futures;
@@ -227,20 +173,29 @@ template <typename T> void FITSHistogram::constructHistogram()
         }));
     }
 
+    // The image data already counted every sample into a full resolution histogram along with its statistics,
+    // so the display bins are filled by merging its bins instead of scanning the image again.
     for (int n = 0; n < channels; n++)
     {
         futures.append(QtConcurrent::run([ = ]()
         {
-            uint32_t offset = n * samples;
+            const FITSData::Histogram &source = imageData->getHistogram(n);
+            const uint32_t *sourceFrequency = source.frequency.constData();
+            const int sourceCount = source.frequency.size();
 
-            for (uint32_t i = 0; i < samples; i += sampleBy)
+            for (int i = 0; i < sourceCount; i++)
             {
-                int32_t id = rint((buffer[i + offset] - FITSMin[n]) / binWidth[n]);
+                if (sourceFrequency[i] == 0)
+                    continue;
+
+                int32_t id = rint((source.origin + i * source.binWidth - FITSMin[n]) / binWidth[n]);
                 if (id < 0)
                     id = 0;
-                frequency[n][id] += sampleBy;
+                else if (id >= binCount)
+                    id = binCount - 1;
+                frequency[n][id] += sourceFrequency[i];
             }
-         }));
+        }));
     }
 
     for (QFuture<void> future : futures)
@@ -266,65 +221,11 @@ template <typename T> void FITSHistogram::constructHistogram()
 
     futures.clear();
 
-    for (int n = 0; n < channels; n++)
+    if (ui->hideSaturated->isChecked())
     {
-        futures.append(QtConcurrent::run([ = ]()
+        for (int n = 0; n < channels; n++)
         {
-            double median[3] = {0};
-            const bool cutoffSpikes = ui->hideSaturated->isChecked();
-            const uint32_t halfCumulative = cumulativeFrequency[n][binCount - 1] / 2;
-
-            // Find which bin contains the median.
-            int median_bin = -1;
-            for (int i = 0; i < binCount; i++)
-            {
-                if (cumulativeFrequency[n][i] > halfCumulative)
-                {
-                    median_bin = i;
-                    break;
-                }
-            }
-
-            if (median_bin >= 0)
-            {
-                // The number of items in the median bin
-                const uint32_t median_bin_size = frequency[n][median_bin] / sampleBy;
-                if (median_bin_size > 0)
-                {
-                    // The median is this element inside the sorted median_bin;
-                    const uint32_t samples_before_median_bin = median_bin == 0 ? 0 : cumulativeFrequency[n][median_bin - 1];
-                    uint32_t median_position = (halfCumulative - samples_before_median_bin) / sampleBy;
-
-                    if (median_position >= median_bin_size)
-                        median_position = median_bin_size - 1;
-                    if (median_position >= 0 && median_position < median_bin_size)
-                    {
-                        // Fill a vector with the values in the median bin (sampled by sampleBy).
-                        std::vector<T> median_bin_samples(median_bin_size);
-                        uint32_t upto = 0;
-                        const uint32_t offset = n * samples;
-                        for (uint32_t i = 0; i < samples; i += sampleBy)
-                        {
-                            if (upto >= median_bin_size) break;
-                            const int32_t id = rint((buffer[i + offset] - FITSMin[n]) / binWidth[n]);
-                            if (id == median_bin)
-                                median_bin_samples[upto++] = buffer[i + offset];
-                        }
-                        // Get the Nth value using N = the median position.
-                        if (upto > 0)
-                        {
-                            if (median_position >= upto) median_position = upto - 1;
-                            std::nth_element(median_bin_samples.begin(), median_bin_samples.begin() + median_position,
-                                             median_bin_samples.begin() + upto);
-                            median[n] = median_bin_samples[median_position];
-                        }
-                    }
-                }
-            }
-
-            imageData->setMedian(median[n], n);
-
-            if (cutoffSpikes)
+            futures.append(QtConcurrent::run([ = ]()
             {
                 QVector<double> sortedFreq = frequency[n];
                 std::sort(sortedFreq.begin(), sortedFreq.end());
@@ -334,9 +235,8 @@ template <typename T> void FITSHistogram::constructHistogram()
                     if (frequency[n][i] >= cutoff)
                         frequency[n][i] = cutoff;
                 }
-            }
-
-        }));
+            }));
+        }
     }
 
     for (QFuture<void> future : futures)
@@ -356,6 +256,10 @@ template <typename T> void FITSHistogram::constructHistogram()
         sliderTick  << fabs(FITSMax[n] - FITSMin[n]) / 99.0;
         sliderScale << 99.0 / (FITSMax[n] - FITSMin[n] - sliderTick[n]);
     }
+
+    m_Constructed = true;
+    if (isVisible())
+        syncGUI();
 }
 
 void FITSHistogram::syncGUI()
@@ -584,7 +488,8 @@ bool FITSHistogramCommand::reverseDelta()
         imageData->width() * imageData->height() * imageData->channels();
     unsigned long totalBytes = totalPixels * imageData->getBytesPerPixel();
 
-    auto * output_image = new uint8_t[totalBytes];
+    // The image buffer is released to the arena once replaced
+    auto * output_image = FITSBufferArena::Instance()->acquire(totalBytes);
 
     if (output_image == nullptr)
     {
@@ -596,7 +501,7 @@ bool FITSHistogramCommand::reverseDelta()
 
     if (raw_delta == nullptr)
     {
-        delete[] output_image;
+        FITSBufferArena::Instance()->release(output_image);
         qWarning() << "Error! not enough memory to create image delta" << endl;
         return false;
     }
@@ -606,7 +511,7 @@ bool FITSHistogramCommand::reverseDelta()
     {
         qCCritical(KSTARS_FITS)
                 << "FITSHistogram compression error in reverseDelta()";
-        delete[] output_image;
+        FITSBufferArena::Instance()->release(output_image);
         delete[] raw_delta;
         return false;
     }
@@ -636,19 +541,12 @@ void FITSHistogramCommand::redo()
 
     if (delta != nullptr)
     {
-        FITSData::Statistic prevStats;
-        imageData->saveStatistics(prevStats);
-
+        // The histogram of the statistics is binned at full resolution, recompute it along with them
         reverseDelta();
-
-        imageData->restoreStatistics(stats);
-
-        stats = prevStats;
+        imageData->calculateStats(true);
     }
     else
     {
-        imageData->saveStatistics(stats);
-
         // If it's rotation of flip, no need to calculate delta
         if (type >= FITS_ROTATE_CW && type <= FITS_FLIP_V)
         {
@@ -719,14 +617,9 @@ void FITSHistogramCommand::undo()
 
     if (delta != nullptr)
     {
-        FITSData::Statistic prevStats;
-        imageData->saveStatistics(prevStats);
-
+        // The histogram of the statistics is binned at full resolution, recompute it along with them
         reverseDelta();
-
-        imageData->restoreStatistics(stats);
-
-        stats = prevStats;
+        imageData->calculateStats(true);
     }
     else
     {
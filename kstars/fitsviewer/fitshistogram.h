@@ -73,8 +73,6 @@ class FITSHistogram : public QDialog
         void resizePlot();
 
     private:
-        template <typename T>
-        void constructHistogram();
         double cutMin;
         double cutMax;
 
@@ -119,7 +117,6 @@ class FITSHistogramCommand : public QUndoCommand
         bool calculateDelta(const uint8_t * buffer);
         bool reverseDelta();
 
-        FITSData::Statistic stats;
         FITSHistogram * histogram { nullptr };
         FITSScale type;
         QVector<double> min, max;
@@ -0,0 +1,249 @@
+/*  FITS Image Pyramid
+
+    This application is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+*/
+
+#include "fitsimagepyramid.h"
+
+#include "fitsdata.h"
+#include "fitsworkerpool.h"
+#include "Options.h"
+
+#include <QPainter>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include <cmath>
+
+FITSImagePyramid::FITSImagePyramid(QObject *parent) : QObject(parent)
+{
+    // Cost of a tile is its size in kilobytes
+    m_Tiles.setMaxCost(static_cast<int>(Options::fITSTileCacheSize()) * 1024);
+
+    // Tiles are rendered on worker threads and stored on the thread of the pyramid
+    connect(this, &FITSImagePyramid::tileRendered, this, &FITSImagePyramid::storeTile, Qt::QueuedConnection);
+}
+
+FITSImagePyramid::~FITSImagePyramid()
+{
+    clear();
+}
+
+void FITSImagePyramid::setImage(FITSData *data, const Stretch &stretch, const QImage &overview, int overviewSampling)
+{
+    clear();
+
+    m_Data = data;
+    m_Stretch.reset(new Stretch(stretch));
+    m_Overview = overview;
+    m_OverviewSampling = overviewSampling;
+    m_Width = data->width();
+    m_Height = data->height();
+    m_Channels = data->channels();
+
+    m_MaxLevel = 0;
+    while ((TILE_SIZE << m_MaxLevel) < std::max(m_Width, m_Height))
+        m_MaxLevel++;
+}
+
+void FITSImagePyramid::clear()
+{
+    // Tiles still being rendered will be dropped when they arrive
+    m_Generation.fetchAndAddOrdered(1);
+
+    for (auto &future : m_Running)
+        future.waitForFinished();
+    m_Running.clear();
+    m_Rendering = 0;
+
+    m_Pending.clear();
+    m_Queued.clear();
+    m_Tiles.clear();
+    m_Data = nullptr;
+    m_Overview = QImage();
+}
+
+quint64 FITSImagePyramid::tileKey(int level, int x, int y)
+{
+    return (static_cast<quint64>(level) << 48) | (static_cast<quint64>(y) << 24) | static_cast<quint64>(x);
+}
+
+QRect FITSImagePyramid::tileImageRect(int level, int x, int y) const
+{
+    const int span = TILE_SIZE << level;
+    return QRect(x * span, y * span, span, span).intersected(QRect(0, 0, m_Width, m_Height));
+}
+
+int FITSImagePyramid::levelForScale(double scale) const
+{
+    // Finest level that is not finer than the display, so a tile pixel covers at least one display pixel
+    int level = scale >= 1 ? 0 : static_cast<int>(std::floor(std::log2(1.0 / scale)));
+    return qBound(0, level, m_MaxLevel);
+}
+
+void FITSImagePyramid::requestTile(int level, int x, int y)
+{
+    const quint64 key = tileKey(level, x, y);
+    if (m_Pending.contains(key))
+        return;
+
+    m_Pending.insert(key);
+    m_Queued.prepend(key);
+
+    // Tiles requested long ago were most likely panned out of view, forget them so they are requested again if needed
+    const int maxQueued = 8 * FITSWorkerPool::threadPool()->maxThreadCount();
+    while (m_Queued.size() > maxQueued)
+        m_Pending.remove(m_Queued.takeLast());
+
+    startQueuedTiles();
+}
+
+void FITSImagePyramid::startQueuedTiles()
+{
+    // Forget renders that are done, and do not start more than the pool can soon handle
+    for (int i = m_Running.size() - 1; i >= 0; i--)
+    {
+        if (m_Running[i].isFinished())
+            m_Running.removeAt(i);
+    }
+
+    while (!m_Queued.isEmpty() && m_Rendering < 2 * FITSWorkerPool::threadPool()->maxThreadCount())
+        startTile(m_Queued.takeFirst());
+}
+
+void FITSImagePyramid::startTile(quint64 key)
+{
+    const int level = static_cast<int>(key >> 48);
+    const int y = static_cast<int>((key >> 24) & 0xFFFFFF);
+    const int x = static_cast<int>(key & 0xFFFFFF);
+
+    m_Rendering++;
+
+    const QRect region = tileImageRect(level, x, y);
+    const int sampling = 1 << level;
+    const int generation = m_Generation.loadAcquire();
+    const Stretch stretch = *m_Stretch;
+    const FITSData *data = m_Data;
+    const int channels = m_Channels;
+
+    m_Running.append(QtConcurrent::run(FITSWorkerPool::threadPool(), [ = ]()
+    {
+        // Skip tiles of an image or stretch that is not displayed anymore
+        if (generation != m_Generation.loadAcquire())
+            return;
+
+        QImage tile((region.width() + sampling - 1) / sampling, (region.height() + sampling - 1) / sampling,
+                    channels == 1 ? QImage::Format_Indexed8 : QImage::Format_RGB32);
+        if (channels == 1)
+        {
+            tile.setColorCount(256);
+            for (int i = 0; i < 256; i++)
+                tile.setColor(i, qRgb(i, i, i));
+        }
+
+        Stretch tileStretch = stretch;
+        tileStretch.run(data->getImageBuffer(), &tile, sampling, region);
+
+        emit tileRendered(key, generation, tile);
+    }));
+}
+
+void FITSImagePyramid::storeTile(quint64 key, int generation, const QImage &tile)
+{
+    if (generation != m_Generation.loadAcquire())
+        return;
+
+    m_Pending.remove(key);
+    m_Rendering--;
+    m_Tiles.insert(key, new QImage(tile), qMax(1, tile.bytesPerLine() * tile.height() / 1024));
+
+    // A worker is free for the next queued tile
+    startQueuedTiles();
+
+    const int level = static_cast<int>(key >> 48);
+    const int y = static_cast<int>((key >> 24) & 0xFFFFFF);
+    const int x = static_cast<int>(key & 0xFFFFFF);
+    emit tileReady(tileImageRect(level, x, y));
+}
+
+void FITSImagePyramid::drawFallback(QPainter *painter, const QRect &imageRect, double scale, int level)
+{
+    const QRectF target(imageRect.x() * scale, imageRect.y() * scale, imageRect.width() * scale,
+                        imageRect.height() * scale);
+
+    // Use the closest coarser tile already rendered
+    for (int coarser = level + 1; coarser <= m_MaxLevel; coarser++)
+    {
+        const int span = TILE_SIZE << coarser;
+        const QImage *tile = m_Tiles.object(tileKey(coarser, imageRect.x() / span, imageRect.y() / span));
+        if (tile == nullptr)
+            continue;
+
+        const int sampling = 1 << coarser;
+        const QRectF source((imageRect.x() % span) / static_cast<double>(sampling),
+                            (imageRect.y() % span) / static_cast<double>(sampling),
+                            imageRect.width() / static_cast<double>(sampling),
+                            imageRect.height() / static_cast<double>(sampling));
+        painter->drawImage(target, *tile, source);
+        return;
+    }
+
+    if (!m_Overview.isNull())
+    {
+        const QRectF source(imageRect.x() / static_cast<double>(m_OverviewSampling),
+                            imageRect.y() / static_cast<double>(m_OverviewSampling),
+                            imageRect.width() / static_cast<double>(m_OverviewSampling),
+                            imageRect.height() / static_cast<double>(m_OverviewSampling));
+        painter->drawImage(target, m_Overview, source);
+    }
+}
+
+void FITSImagePyramid::paint(QPainter *painter, const QRect &exposed, double scale)
+{
+    if (m_Data == nullptr || scale <= 0)
+        return;
+
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
+
+    // Visible part of the image, in image pixels
+    const QRect visible = QRect(static_cast<int>(std::floor(exposed.x() / scale)),
+                                static_cast<int>(std::floor(exposed.y() / scale)),
+                                static_cast<int>(std::ceil(exposed.width() / scale)) + 1,
+                                static_cast<int>(std::ceil(exposed.height() / scale)) + 1)
+                          .intersected(QRect(0, 0, m_Width, m_Height));
+    if (visible.isEmpty())
+        return;
+
+    const int level = levelForScale(scale);
+
+    // The overview is fine enough for this zoom, no need for tiles
+    if ((1 << level) >= m_OverviewSampling && !m_Overview.isNull())
+    {
+        drawFallback(painter, visible, scale, m_MaxLevel);
+        return;
+    }
+
+    const int span = TILE_SIZE << level;
+    for (int y = visible.top() / span; y <= visible.bottom() / span; y++)
+    {
+        for (int x = visible.left() / span; x <= visible.right() / span; x++)
+        {
+            const QRect imageRect = tileImageRect(level, x, y);
+            const QImage *tile = m_Tiles.object(tileKey(level, x, y));
+
+            if (tile != nullptr)
+            {
+                painter->drawImage(QRectF(imageRect.x() * scale, imageRect.y() * scale, imageRect.width() * scale,
+                                          imageRect.height() * scale), *tile, QRectF(tile->rect()));
+            }
+            else
+            {
+                drawFallback(painter, imageRect, scale, level);
+                requestTile(level, x, y);
+            }
+        }
+    }
+}
@@ -0,0 +1,113 @@
+/*  FITS Image Pyramid
+
+    This application is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include "stretch.h"
+
+#include <QAtomicInteger>
+#include <QCache>
+#include <QFuture>
+#include <QImage>
+#include <QList>
+#include <QObject>
+#include <QSet>
+
+#include <memory>
+
+class FITSData;
+class QPainter;
+
+/**
+ * @class FITSImagePyramid
+ * Stretched display tiles of a large image, at power of two resolutions, rendered on demand.
+ *
+ * Level L of the pyramid samples every 2^L pixels of the image. Painting at a given zoom only draws the tiles of the
+ * visible part of the image at the closest level that is not coarser than the display, so the cost of panning and
+ * zooming follows the size of the viewport instead of the size of the image. Missing tiles are rendered in the
+ * background and drawn from a coarser tile or from the overview image until they are ready.
+ *
+ * Tiles are kept in a least recently used cache bounded by Options::fITSTileCacheSize().
+ */
+class FITSImagePyramid : public QObject
+{
+        Q_OBJECT
+
+    public:
+        /// Edge length of a tile in tile pixels
+        static constexpr int TILE_SIZE = 256;
+
+        explicit FITSImagePyramid(QObject *parent = nullptr);
+        ~FITSImagePyramid() override;
+
+        /**
+         * @brief setImage Start displaying a new image or a new stretch of it. All existing tiles are dropped.
+         * @param data image data, which must stay valid until the next call to setImage() or clear().
+         * @param stretch stretch to render tiles with.
+         * @param overview the whole image rendered with the same stretch, used while tiles are missing.
+         * @param overviewSampling sampling of the overview image.
+         */
+        void setImage(FITSData *data, const Stretch &stretch, const QImage &overview, int overviewSampling);
+
+        /**
+         * @brief clear Drop all tiles and wait for the tiles being rendered.
+         */
+        void clear();
+
+        /**
+         * @brief paint Draw the image as displayed with a scale.
+         * @param painter painter of the display surface, where the image spans (0, 0) to its size times scale.
+         * @param exposed part of the display surface to paint.
+         * @param scale display pixels per image pixel.
+         */
+        void paint(QPainter *painter, const QRect &exposed, double scale);
+
+    signals:
+        /**
+         * @brief tileReady A tile was rendered and the part of the image it covers should be repainted.
+         * @param imageRect rectangle of the tile in image pixels.
+         */
+        void tileReady(const QRect &imageRect);
+
+        /// Internal, emitted from a worker thread when a tile is rendered
+        void tileRendered(quint64 key, int generation, const QImage &tile);
+
+    private slots:
+        void storeTile(quint64 key, int generation, const QImage &tile);
+
+    private:
+        static quint64 tileKey(int level, int x, int y);
+        QRect tileImageRect(int level, int x, int y) const;
+        int levelForScale(double scale) const;
+        void requestTile(int level, int x, int y);
+        /// Start rendering queued tiles, as long as the pool has room for them
+        void startQueuedTiles();
+        void startTile(quint64 key);
+        void drawFallback(QPainter *painter, const QRect &imageRect, double scale, int level);
+
+        FITSData *m_Data { nullptr };
+        std::unique_ptr<Stretch> m_Stretch;
+        QImage m_Overview;
+        int m_OverviewSampling { 1 };
+        int m_Width { 0 };
+        int m_Height { 0 };
+        int m_Channels { 1 };
+        /// Coarsest level, where the whole image fits in a single tile
+        int m_MaxLevel { 0 };
+
+        QCache<quint64, QImage> m_Tiles;
+        /// Tiles queued or being rendered
+        QSet<quint64> m_Pending;
+        /// Tiles waiting for a worker, most recently requested first
+        QList<quint64> m_Queued;
+        QList<QFuture<void>> m_Running;
+        /// Tiles being rendered, which are not stored yet
+        int m_Rendering { 0 };
+        /// Incremented by setImage() so tiles of a previous image or stretch are discarded
+        QAtomicInteger<int> m_Generation { 0 };
+};
@@ -0,0 +1,634 @@
+/*  FITS Kernels
+
+    This application is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+*/
+
+#include "fitskernels.h"
+
+#include <algorithm>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FITS_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+namespace FITSKernels
+{
+
+void Moments::merge(const Moments &other)
+{
+    if (other.count == 0)
+        return;
+
+    if (count == 0)
+    {
+        *this = other;
+        return;
+    }
+
+    const double total = static_cast<double>(count + other.count);
+    const double delta = other.mean - mean;
+
+    mean += delta * other.count / total;
+    m2   += other.m2 + delta * delta * (static_cast<double>(count) * other.count / total);
+    count += other.count;
+
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+namespace
+{
+// Kernels process blocks of samples small enough for their integer accumulators not to overflow.
+// Blocks are then merged, which also bounds the rounding error of the floating point sums.
+constexpr uint32_t BLOCK_SIZE = 4096;
+
+template <typename T>
+using BlockKernel = Moments (*)(const T *, uint32_t);
+
+// Moments of a block from sums of samples shifted by a constant, which does not change the variance.
+Moments blockMoments(double min, double max, double shift, double sum, double sumSquares, uint32_t count)
+{
+    Moments block;
+    block.min   = min;
+    block.max   = max;
+    block.count = count;
+    block.mean  = shift + sum / count;
+    block.m2    = std::max(0.0, sumSquares - sum * sum / count);
+    return block;
+}
+
+// Same as above for exact integer sums. The 64-bit mantissa of long double keeps sum^2 exact on x86.
+Moments blockMoments(double min, double max, double shift, int64_t sum, uint64_t sumSquares, uint32_t count)
+{
+    const long double total = sum;
+
+    Moments block;
+    block.min   = min;
+    block.max   = max;
+    block.count = count;
+    block.mean  = shift + static_cast<double>(total / count);
+    block.m2    = std::max(0.0, static_cast<double>(sumSquares - total * total / count));
+    return block;
+}
+
+template <typename T>
+Moments scalarBlock(const T *buffer, uint32_t count)
+{
+    T min = buffer[0], max = buffer[0];
+    // Shifting by the first sample keeps the sums small, so that sumSquares - sum^2/n does not cancel out.
+    const double shift = buffer[0];
+    double sum = 0, sumSquares = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const T value = buffer[i];
+        if (value < min)
+            min = value;
+        if (value > max)
+            max = value;
+
+        const double delta = value - shift;
+        sum        += delta;
+        sumSquares += delta * delta;
+    }
+
+    return blockMoments(min, max, shift, sum, sumSquares, count);
+}
+
+#ifdef FITS_KERNELS_X86
+
+bool hasAVX2()
+{
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+#ifdef __SSE2__
+
+Moments sse2BlockU8(const uint8_t *buffer, uint32_t count)
+{
+    const uint32_t vectorCount = count & ~15u;
+    const __m128i zero = _mm_setzero_si128();
+    __m128i vmin = _mm_set1_epi8(static_cast<char>(0xFF));
+    __m128i vmax = zero;
+    // psadbw sums into two 64-bit lanes, squares are summed in four 32-bit lanes
+    __m128i vsum = zero, vsq = zero;
+
+    for (uint32_t i = 0; i < vectorCount; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + i));
+        vmin = _mm_min_epu8(vmin, v);
+        vmax = _mm_max_epu8(vmax, v);
+        vsum = _mm_add_epi64(vsum, _mm_sad_epu8(v, zero));
+
+        const __m128i lo = _mm_unpacklo_epi8(v, zero);
+        const __m128i hi = _mm_unpackhi_epi8(v, zero);
+        vsq = _mm_add_epi32(vsq, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+    }
+
+    alignas(16) uint8_t mins[16], maxs[16];
+    alignas(16) uint64_t sums[2];
+    alignas(16) uint32_t squares[4];
+    _mm_store_si128(reinterpret_cast<__m128i *>(mins), vmin);
+    _mm_store_si128(reinterpret_cast<__m128i *>(maxs), vmax);
+    _mm_store_si128(reinterpret_cast<__m128i *>(sums), vsum);
+    _mm_store_si128(reinterpret_cast<__m128i *>(squares), vsq);
+
+    uint8_t min = 0xFF, max = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        min = std::min(min, mins[i]);
+        max = std::max(max, maxs[i]);
+    }
+    int64_t sum = sums[0] + sums[1];
+    uint64_t sumSquares = static_cast<uint64_t>(squares[0]) + squares[1] + squares[2] + squares[3];
+
+    for (uint32_t i = vectorCount; i < count; i++)
+    {
+        const uint8_t value = buffer[i];
+        min = std::min(min, value);
+        max = std::max(max, value);
+        sum += value;
+        sumSquares += static_cast<uint32_t>(value) * value;
+    }
+
+    return blockMoments(min, max, 0, sum, sumSquares, count);
+}
+
+Moments sse2BlockU16(const uint16_t *buffer, uint32_t count)
+{
+    // SSE2 only compares signed 16-bit integers, so samples are biased by -32768.
+    // This maps them onto int16 by flipping the sign bit and leaves the variance unchanged.
+    const uint32_t vectorCount = count & ~7u;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi16(static_cast<short>(0x8000));
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i vmin = _mm_set1_epi16(0x7FFF);
+    __m128i vmax = bias;
+    // Biased sums in four signed 32-bit lanes, squares in two 64-bit lanes
+    __m128i vsum = zero, vsq = zero;
+
+    for (uint32_t i = 0; i < vectorCount; i += 8)
+    {
+        const __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + i)), bias);
+        vmin = _mm_min_epi16(vmin, v);
+        vmax = _mm_max_epi16(vmax, v);
+        vsum = _mm_add_epi32(vsum, _mm_madd_epi16(v, ones));
+
+        // Pairs of squares are at most 2^31, which fits in an unsigned 32-bit lane
+        const __m128i squares = _mm_madd_epi16(v, v);
+        vsq = _mm_add_epi64(vsq, _mm_unpacklo_epi32(squares, zero));
+        vsq = _mm_add_epi64(vsq, _mm_unpackhi_epi32(squares, zero));
+    }
+
+    alignas(16) int16_t mins[8], maxs[8];
+    alignas(16) int32_t sums[4];
+    alignas(16) uint64_t squares[2];
+    _mm_store_si128(reinterpret_cast<__m128i *>(mins), vmin);
+    _mm_store_si128(reinterpret_cast<__m128i *>(maxs), vmax);
+    _mm_store_si128(reinterpret_cast<__m128i *>(sums), vsum);
+    _mm_store_si128(reinterpret_cast<__m128i *>(squares), vsq);
+
+    int32_t min = 0x7FFF, max = -0x8000;
+    for (int i = 0; i < 8; i++)
+    {
+        min = std::min<int32_t>(min, mins[i]);
+        max = std::max<int32_t>(max, maxs[i]);
+    }
+    int64_t sum = static_cast<int64_t>(sums[0]) + sums[1] + sums[2] + sums[3];
+    uint64_t sumSquares = squares[0] + squares[1];
+
+    for (uint32_t i = vectorCount; i < count; i++)
+    {
+        const int32_t value = static_cast<int32_t>(buffer[i]) - 0x8000;
+        min = std::min(min, value);
+        max = std::max(max, value);
+        sum += value;
+        sumSquares += static_cast<uint64_t>(static_cast<int64_t>(value) * value);
+    }
+
+    return blockMoments(min + 0x8000, max + 0x8000, 0x8000, sum, sumSquares, count);
+}
+
+Moments sse2BlockFloat(const float *buffer, uint32_t count)
+{
+    const uint32_t vectorCount = count & ~3u;
+    const double shift = buffer[0];
+    const __m128d vshift = _mm_set1_pd(shift);
+    __m128 vmin = _mm_set1_ps(buffer[0]);
+    __m128 vmax = vmin;
+    __m128d vsumLo = _mm_setzero_pd(), vsumHi = _mm_setzero_pd();
+    __m128d vsqLo = _mm_setzero_pd(), vsqHi = _mm_setzero_pd();
+
+    for (uint32_t i = 0; i < vectorCount; i += 4)
+    {
+        const __m128 v = _mm_loadu_ps(buffer + i);
+        vmin = _mm_min_ps(vmin, v);
+        vmax = _mm_max_ps(vmax, v);
+
+        const __m128d lo = _mm_sub_pd(_mm_cvtps_pd(v), vshift);
+        const __m128d hi = _mm_sub_pd(_mm_cvtps_pd(_mm_movehl_ps(v, v)), vshift);
+        vsumLo = _mm_add_pd(vsumLo, lo);
+        vsumHi = _mm_add_pd(vsumHi, hi);
+        vsqLo  = _mm_add_pd(vsqLo, _mm_mul_pd(lo, lo));
+        vsqHi  = _mm_add_pd(vsqHi, _mm_mul_pd(hi, hi));
+    }
+
+    alignas(16) float mins[4], maxs[4];
+    alignas(16) double sums[2], squares[2];
+    _mm_store_ps(mins, vmin);
+    _mm_store_ps(maxs, vmax);
+    _mm_store_pd(sums, _mm_add_pd(vsumLo, vsumHi));
+    _mm_store_pd(squares, _mm_add_pd(vsqLo, vsqHi));
+
+    float min = mins[0], max = maxs[0];
+    for (int i = 1; i < 4; i++)
+    {
+        min = std::min(min, mins[i]);
+        max = std::max(max, maxs[i]);
+    }
+    double sum = sums[0] + sums[1];
+    double sumSquares = squares[0] + squares[1];
+
+    for (uint32_t i = vectorCount; i < count; i++)
+    {
+        const float value = buffer[i];
+        min = std::min(min, value);
+        max = std::max(max, value);
+
+        const double delta = value - shift;
+        sum        += delta;
+        sumSquares += delta * delta;
+    }
+
+    return blockMoments(min, max, shift, sum, sumSquares, count);
+}
+
+#endif // __SSE2__
+
+__attribute__((target("avx2")))
+Moments avx2BlockU8(const uint8_t *buffer, uint32_t count)
+{
+    const uint32_t vectorCount = count & ~31u;
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i vmin = _mm256_set1_epi8(static_cast<char>(0xFF));
+    __m256i vmax = zero;
+    __m256i vsum = zero, vsq = zero;
+
+    for (uint32_t i = 0; i < vectorCount; i += 32)
+    {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(buffer + i));
+        vmin = _mm256_min_epu8(vmin, v);
+        vmax = _mm256_max_epu8(vmax, v);
+        vsum = _mm256_add_epi64(vsum, _mm256_sad_epu8(v, zero));
+
+        const __m256i lo = _mm256_unpacklo_epi8(v, zero);
+        const __m256i hi = _mm256_unpackhi_epi8(v, zero);
+        vsq = _mm256_add_epi32(vsq, _mm256_add_epi32(_mm256_madd_epi16(lo, lo), _mm256_madd_epi16(hi, hi)));
+    }
+
+    alignas(32) uint8_t mins[32], maxs[32];
+    alignas(32) uint64_t sums[4];
+    alignas(32) uint32_t squares[8];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(mins), vmin);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(maxs), vmax);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(sums), vsum);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(squares), vsq);
+
+    uint8_t min = 0xFF, max = 0;
+    for (int i = 0; i < 32; i++)
+    {
+        min = std::min(min, mins[i]);
+        max = std::max(max, maxs[i]);
+    }
+    int64_t sum = sums[0] + sums[1] + sums[2] + sums[3];
+    uint64_t sumSquares = 0;
+    for (int i = 0; i < 8; i++)
+        sumSquares += squares[i];
+
+    for (uint32_t i = vectorCount; i < count; i++)
+    {
+        const uint8_t value = buffer[i];
+        min = std::min(min, value);
+        max = std::max(max, value);
+        sum += value;
+        sumSquares += static_cast<uint32_t>(value) * value;
+    }
+
+    return blockMoments(min, max, 0, sum, sumSquares, count);
+}
+
+__attribute__((target("avx2")))
+Moments avx2BlockU16(const uint16_t *buffer, uint32_t count)
+{
+    // Same sign bit bias as the SSE2 kernel, AVX2 has unsigned comparisons but no unsigned multiply-add.
+    const uint32_t vectorCount = count & ~15u;
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i bias = _mm256_set1_epi16(static_cast<short>(0x8000));
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i vmin = _mm256_set1_epi16(0x7FFF);
+    __m256i vmax = bias;
+    __m256i vsum = zero, vsq = zero;
+
+    for (uint32_t i = 0; i < vectorCount; i += 16)
+    {
+        const __m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(buffer + i)), bias);
+        vmin = _mm256_min_epi16(vmin, v);
+        vmax = _mm256_max_epi16(vmax, v);
+        vsum = _mm256_add_epi32(vsum, _mm256_madd_epi16(v, ones));
+
+        const __m256i squares = _mm256_madd_epi16(v, v);
+        vsq = _mm256_add_epi64(vsq, _mm256_unpacklo_epi32(squares, zero));
+        vsq = _mm256_add_epi64(vsq, _mm256_unpackhi_epi32(squares, zero));
+    }
+
+    alignas(32) int16_t mins[16], maxs[16];
+    alignas(32) int32_t sums[8];
+    alignas(32) uint64_t squares[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(mins), vmin);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(maxs), vmax);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(sums), vsum);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(squares), vsq);
+
+    int32_t min = 0x7FFF, max = -0x8000;
+    for (int i = 0; i < 16; i++)
+    {
+        min = std::min<int32_t>(min, mins[i]);
+        max = std::max<int32_t>(max, maxs[i]);
+    }
+    int64_t sum = 0;
+    for (int i = 0; i < 8; i++)
+        sum += sums[i];
+    uint64_t sumSquares = squares[0] + squares[1] + squares[2] + squares[3];
+
+    for (uint32_t i = vectorCount; i < count; i++)
+    {
+        const int32_t value = static_cast<int32_t>(buffer[i]) - 0x8000;
+        min = std::min(min, value);
+        max = std::max(max, value);
+        sum += value;
+        sumSquares += static_cast<uint64_t>(static_cast<int64_t>(value) * value);
+    }
+
+    return blockMoments(min + 0x8000, max + 0x8000, 0x8000, sum, sumSquares, count);
+}
+
+__attribute__((target("avx2")))
+Moments avx2BlockFloat(const float *buffer, uint32_t count)
+{
+    const uint32_t vectorCount = count & ~7u;
+    const double shift = buffer[0];
+    const __m256d vshift = _mm256_set1_pd(shift);
+    __m256 vmin = _mm256_set1_ps(buffer[0]);
+    __m256 vmax = vmin;
+    __m256d vsumLo = _mm256_setzero_pd(), vsumHi = _mm256_setzero_pd();
+    __m256d vsqLo = _mm256_setzero_pd(), vsqHi = _mm256_setzero_pd();
+
+    for (uint32_t i = 0; i < vectorCount; i += 8)
+    {
+        const __m256 v = _mm256_loadu_ps(buffer + i);
+        vmin = _mm256_min_ps(vmin, v);
+        vmax = _mm256_max_ps(vmax, v);
+
+        const __m256d lo = _mm256_sub_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(v)), vshift);
+        const __m256d hi = _mm256_sub_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)), vshift);
+        vsumLo = _mm256_add_pd(vsumLo, lo);
+        vsumHi = _mm256_add_pd(vsumHi, hi);
+        vsqLo  = _mm256_add_pd(vsqLo, _mm256_mul_pd(lo, lo));
+        vsqHi  = _mm256_add_pd(vsqHi, _mm256_mul_pd(hi, hi));
+    }
+
+    alignas(32) float mins[8], maxs[8];
+    alignas(32) double sums[4], squares[4];
+    _mm256_store_ps(mins, vmin);
+    _mm256_store_ps(maxs, vmax);
+    _mm256_store_pd(sums, _mm256_add_pd(vsumLo, vsumHi));
+    _mm256_store_pd(squares, _mm256_add_pd(vsqLo, vsqHi));
+
+    float min = mins[0], max = maxs[0];
+    for (int i = 1; i < 8; i++)
+    {
+        min = std::min(min, mins[i]);
+        max = std::max(max, maxs[i]);
+    }
+    double sum = sums[0] + sums[1] + sums[2] + sums[3];
+    double sumSquares = squares[0] + squares[1] + squares[2] + squares[3];
+
+    for (uint32_t i = vectorCount; i < count; i++)
+    {
+        const float value = buffer[i];
+        min = std::min(min, value);
+        max = std::max(max, value);
+
+        const double delta = value - shift;
+        sum        += delta;
+        sumSquares += delta * delta;
+    }
+
+    return blockMoments(min, max, shift, sum, sumSquares, count);
+}
+
+#endif // FITS_KERNELS_X86
+
+template <typename T>
+BlockKernel<T> selectKernel()
+{
+    return &scalarBlock<T>;
+}
+
+template <>
+BlockKernel<uint8_t> selectKernel<uint8_t>()
+{
+#ifdef FITS_KERNELS_X86
+    if (hasAVX2())
+        return &avx2BlockU8;
+#ifdef __SSE2__
+    return &sse2BlockU8;
+#endif
+#endif
+    return &scalarBlock<uint8_t>;
+}
+
+template <>
+BlockKernel<uint16_t> selectKernel<uint16_t>()
+{
+#ifdef FITS_KERNELS_X86
+    if (hasAVX2())
+        return &avx2BlockU16;
+#ifdef __SSE2__
+    return &sse2BlockU16;
+#endif
+#endif
+    return &scalarBlock<uint16_t>;
+}
+
+template <>
+BlockKernel<float> selectKernel<float>()
+{
+#ifdef FITS_KERNELS_X86
+    if (hasAVX2())
+        return &avx2BlockFloat;
+#ifdef __SSE2__
+    return &sse2BlockFloat;
+#endif
+#endif
+    return &scalarBlock<float>;
+}
+}
+
+template <typename T>
+Moments computeMoments(const T *buffer, uint32_t count)
+{
+    static const BlockKernel<T> kernel = selectKernel<T>();
+
+    Moments result;
+    for (uint32_t start = 0; start < count; start += BLOCK_SIZE)
+        result.merge(kernel(buffer + start, std::min(BLOCK_SIZE, count - start)));
+
+    return result;
+}
+
+template <typename T>
+void accumulateHistogram(const T *buffer, uint32_t count, double origin, double binWidth,
+                         uint32_t *frequency, uint32_t binCount)
+{
+    // Integer samples of up to 16 bits are usually counted with one bin per value, which needs no arithmetic.
+    if (std::is_integral<T>::value && sizeof(T) <= 2 && binWidth == 1 && origin == std::numeric_limits<T>::min()
+            && binCount == static_cast<double>(std::numeric_limits<T>::max()) - std::numeric_limits<T>::min() + 1)
+    {
+        for (uint32_t i = 0; i < count; i++)
+            frequency[static_cast<int32_t>(buffer[i]) - static_cast<int32_t>(origin)]++;
+        return;
+    }
+
+    const double scale = 1.0 / binWidth;
+    const int64_t lastBin = binCount - 1;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const int64_t id = static_cast<int64_t>((buffer[i] - origin) * scale);
+        frequency[std::min(std::max<int64_t>(id, 0), lastBin)]++;
+    }
+}
+
+template <typename T>
+Moments computeMomentsAndHistogram(const T *buffer, uint32_t count, double origin, double binWidth,
+                                   uint32_t *frequency, uint32_t binCount)
+{
+    static const BlockKernel<T> kernel = selectKernel<T>();
+
+    Moments result;
+    for (uint32_t start = 0; start < count; start += BLOCK_SIZE)
+    {
+        const uint32_t blockCount = std::min(BLOCK_SIZE, count - start);
+        result.merge(kernel(buffer + start, blockCount));
+        // The block is still in the L1 cache
+        if (frequency != nullptr)
+            accumulateHistogram(buffer + start, blockCount, origin, binWidth, frequency, binCount);
+    }
+
+    return result;
+}
+
+double histogramMedian(const uint32_t *frequency, uint32_t binCount, double origin, double binWidth, bool exactBins)
+{
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < binCount; i++)
+        total += frequency[i];
+
+    if (total == 0)
+        return 0;
+
+    // The median is the sample of rank total/2 in sorted order
+    const uint64_t half = total / 2;
+    uint64_t cumulative = 0;
+    for (uint32_t i = 0; i < binCount; i++)
+    {
+        if (cumulative + frequency[i] > half)
+        {
+            if (exactBins)
+                return origin + i * binWidth;
+
+            // Assume samples are evenly spread in the bin
+            const double fraction = (half - cumulative + 0.5) / frequency[i];
+            return origin + (i + fraction) * binWidth;
+        }
+        cumulative += frequency[i];
+    }
+
+    return origin + (binCount - 1) * binWidth;
+}
+
+double histogramMAD(const uint32_t *frequency, uint32_t binCount, double origin, double binWidth, double median)
+{
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < binCount; i++)
+        total += frequency[i];
+
+    if (total == 0)
+        return 0;
+
+    // Grow a window of bins around the median until it holds more than half of the samples.
+    // Its half-width is then the median of the absolute deviations.
+    const int64_t center = std::min<int64_t>(std::max<int64_t>(static_cast<int64_t>((median - origin) / binWidth), 0),
+                           binCount - 1);
+    const uint64_t half = total / 2;
+    uint64_t inside = frequency[center];
+
+    for (int64_t d = 0; d < binCount; d++)
+    {
+        if (d > 0)
+        {
+            if (center - d >= 0)
+                inside += frequency[center - d];
+            if (center + d < binCount)
+                inside += frequency[center + d];
+        }
+
+        if (inside > half)
+            return d * binWidth;
+    }
+
+    return (binCount - 1) * binWidth;
+}
+
+template Moments computeMoments<uint8_t>(const uint8_t *, uint32_t);
+template Moments computeMoments<int16_t>(const int16_t *, uint32_t);
+template Moments computeMoments<uint16_t>(const uint16_t *, uint32_t);
+template Moments computeMoments<int32_t>(const int32_t *, uint32_t);
+template Moments computeMoments<uint32_t>(const uint32_t *, uint32_t);
+template Moments computeMoments<float>(const float *, uint32_t);
+template Moments computeMoments<int64_t>(const int64_t *, uint32_t);
+template Moments computeMoments<double>(const double *, uint32_t);
+
+#define INSTANTIATE_HISTOGRAM(T) \
+    template void accumulateHistogram<T>(const T *, uint32_t, double, double, uint32_t *, uint32_t); \
+    template Moments computeMomentsAndHistogram<T>(const T *, uint32_t, double, double, uint32_t *, uint32_t);
+
+INSTANTIATE_HISTOGRAM(uint8_t)
+INSTANTIATE_HISTOGRAM(int16_t)
+INSTANTIATE_HISTOGRAM(uint16_t)
+INSTANTIATE_HISTOGRAM(int32_t)
+INSTANTIATE_HISTOGRAM(uint32_t)
+INSTANTIATE_HISTOGRAM(float)
+INSTANTIATE_HISTOGRAM(int64_t)
+INSTANTIATE_HISTOGRAM(double)
+
+const char *instructionSet()
+{
+#ifdef FITS_KERNELS_X86
+    if (hasAVX2())
+        return "AVX2";
+#ifdef __SSE2__
+    return "SSE2";
+#endif
+#endif
+    return "scalar";
+}
+
+}
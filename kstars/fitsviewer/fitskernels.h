@@ -0,0 +1,95 @@
+/*  FITS Kernels
+
+    This application is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+/**
+ * @namespace FITSKernels
+ * Low level kernels working on raw FITS sample buffers.
+ *
+ * The statistics kernels use SSE2 or AVX2 for 8-bit, 16-bit and float samples when the CPU supports them,
+ * selected at runtime, and fall back to a scalar implementation for all other types and platforms.
+ */
+namespace FITSKernels
+{
+/**
+ * @brief The Moments struct holds the minimum, maximum, mean and sum of squared deviations of a run of samples.
+ *
+ * Moments of separate partitions of an image can be merged with Chan's pairwise update, so the variance
+ * stays numerically stable however the image is split between threads.
+ */
+struct Moments
+{
+    double min { std::numeric_limits<double>::max() };
+    double max { std::numeric_limits<double>::lowest() };
+    uint64_t count { 0 };
+    double mean { 0 };
+    /// Sum of squared deviations from the mean
+    double m2 { 0 };
+
+    void merge(const Moments &other);
+
+    /// Population variance of the samples
+    double variance() const
+    {
+        return count > 0 ? m2 / count : 0;
+    }
+};
+
+/**
+ * @brief computeMoments Compute min, max, mean and variance of samples in a single pass.
+ * @param buffer first sample.
+ * @param count number of samples.
+ * @return Moments of the samples, which may be merged with those of other partitions.
+ */
+template <typename T>
+Moments computeMoments(const T *buffer, uint32_t count);
+
+/**
+ * @brief computeMomentsAndHistogram Compute moments and count samples into a histogram in the same pass.
+ * Both are computed block by block, so each sample is read from memory only once.
+ * @param buffer first sample.
+ * @param count number of samples.
+ * @param origin sample value of the first bin.
+ * @param binWidth width of a bin in sample units.
+ * @param frequency histogram to add the counts to, or nullptr to skip the histogram.
+ * @param binCount number of bins in frequency. Samples beyond the range are counted in the first or last bin.
+ */
+template <typename T>
+Moments computeMomentsAndHistogram(const T *buffer, uint32_t count, double origin, double binWidth,
+                                   uint32_t *frequency, uint32_t binCount);
+
+/**
+ * @brief accumulateHistogram Count samples into a histogram.
+ * @see computeMomentsAndHistogram()
+ */
+template <typename T>
+void accumulateHistogram(const T *buffer, uint32_t count, double origin, double binWidth,
+                         uint32_t *frequency, uint32_t binCount);
+
+/**
+ * @brief histogramMedian Median of the samples counted in a histogram.
+ * If bins hold a single value each, the median is exact, otherwise it is interpolated within its bin.
+ */
+double histogramMedian(const uint32_t *frequency, uint32_t binCount, double origin, double binWidth,
+                       bool exactBins);
+
+/**
+ * @brief histogramMAD Median absolute deviation from the median of the samples counted in a histogram.
+ * The deviation is exact for single value bins and resolved to the bin width otherwise.
+ */
+double histogramMAD(const uint32_t *frequency, uint32_t binCount, double origin, double binWidth, double median);
+
+/**
+ * @brief instructionSet Name of the instruction set selected at runtime for the statistics kernels.
+ */
+const char *instructionSet();
+}
@@ -26,6 +26,8 @@
 #include "indi/indilistener.h"
 #endif
 
+#include <QPainter>
+#include <QPaintEvent>
 #include <QScrollBar>
 #include <QToolTip>
 
@@ -316,6 +318,19 @@ void FITSLabel::mouseDoubleClickEvent(QMouseEvent *e)
     return;
 }
 
+void FITSLabel::paintEvent(QPaintEvent *e)
+{
+    // Tiled images have no pixmap, the view paints the tiles exposed by the event
+    if (view->tiledDisplay)
+    {
+        QPainter painter(this);
+        view->paintTiledImage(&painter, e->rect());
+        return;
+    }
+
+    QLabel::paintEvent(e);
+}
+
 void FITSLabel::centerTelescope(double raJ2000, double decJ2000)
 {
 #ifdef HAVE_INDI
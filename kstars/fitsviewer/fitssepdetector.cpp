@@ -22,6 +22,21 @@
 #include "sep/sep.h"
 #include "fits_debug.h"
 #include "fitssepdetector.h"
+#include "fitsbufferarena.h"
+#include "fitsworkerpool.h"
+#include "Options.h"
+
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <functional>
+
+FITSSEPDetector::FITSSEPDetector(FITSData *parent): FITSStarDetector(parent)
+{
+    tiledExtraction = Options::fITSTiledStarDetection();
+}
 
 FITSSEPDetector &FITSSEPDetector::configure(const QString &param, const QVariant &value)
 {
@@ -35,6 +50,10 @@ FITSSEPDetector &FITSSEPDetector::configure(const QString &param, const QVariant
         deblendMincont = value.toDouble();
     else if (param == "radiusIsBoundary")
         radiusIsBoundary = value.toBool();
+    else if (param == "tiledExtraction")
+        tiledExtraction = value.toBool();
+    else if (param == "tileSize")
+        tileSize = value.toInt();
     else
         qCDebug(KSTARS_FITS) << "Bad SEP Parameter!!!!! " << param;
     return *this;
@@ -53,72 +72,143 @@ int FITSSEPDetector::findSources(QList<Edge*> &starCenters, QRect const &boundar
     return findSourcesAndBackground(starCenters, boundary, nullptr);
 }
 
-int FITSSEPDetector::findSourcesAndBackground(QList<Edge*> &starCenters, QRect const &boundary,
-        SkyBackground *bg)
+FITSSEPDetector::~FITSSEPDetector()
 {
-    FITSData const * const image_data = reinterpret_cast<FITSData const *>(parent());
-    starCenters.clear();
-
-    if (image_data == nullptr)
-        return 0;
-
-    FITSData::Statistic const &stats = image_data->getStatistics();
-
-    int x = 0, y = 0, w = stats.width, h = stats.height, maxRadius = 50;
-    std::vector<std::pair<int, double>> ovals;
-    const int maxNumCenters = numStars;
-
-    // We may skip 20% of the stars (those with the largest 20% HFRs) as those are suspect
-    // to be non-stars) if we have plenty of detections.
-    int startIndex = 0;
+    FITSBufferArena::Instance()->release(m_Scratch);
+}
 
-    if (!boundary.isNull())
+float *FITSSEPDetector::scratch(uint64_t count)
+{
+    if (count > m_ScratchCount)
     {
-        x = boundary.x();
-        y = boundary.y();
-        w = boundary.width();
-        h = boundary.height();
-        if (radiusIsBoundary)
-            maxRadius = w;
+        FITSBufferArena::Instance()->release(m_Scratch);
+        m_Scratch = FITSBufferArena::Instance()->acquire<float>(count);
+        m_ScratchCount = m_Scratch == nullptr ? 0 : count;
     }
+    return m_Scratch;
+}
 
-    auto * data = new float[w * h];
+FITSSEPDetector::ImageView FITSSEPDetector::imageView(FITSData const *data, QRect const &boundary)
+{
+    ImageView view;
+    if (data == nullptr)
+        return view;
+
+    FITSData::Statistic const &stats = data->getStatistics();
+    QRect const frame(0, 0, stats.width, stats.height);
+    QRect const area = boundary.isNull() ? frame : boundary.intersected(frame);
+
+    view.data = data->getImageBuffer();
+    view.dataType = data->property("dataType").toInt();
+    view.stride = stats.width;
+    view.x = area.x();
+    view.y = area.y();
+    view.width = area.width();
+    view.height = area.height();
+    return view;
+}
 
-    switch (parent()->property("dataType").toInt())
+bool FITSSEPDetector::convertView(ImageView const &view, float *buffer)
+{
+    switch (view.dataType)
     {
         case TBYTE:
-            getFloatBuffer<uint8_t>(data, x, y, w, h, image_data);
+            getFloatBuffer<uint8_t>(buffer, view);
             break;
         case TSHORT:
-            getFloatBuffer<int16_t>(data, x, y, w, h, image_data);
+            getFloatBuffer<int16_t>(buffer, view);
             break;
         case TUSHORT:
-            getFloatBuffer<uint16_t>(data, x, y, w, h, image_data);
+            getFloatBuffer<uint16_t>(buffer, view);
             break;
         case TLONG:
-            getFloatBuffer<int32_t>(data, x, y, w, h, image_data);
+            getFloatBuffer<int32_t>(buffer, view);
             break;
         case TULONG:
-            getFloatBuffer<uint32_t>(data, x, y, w, h, image_data);
+            getFloatBuffer<uint32_t>(buffer, view);
             break;
         case TFLOAT:
-            if (boundary.isNull())
-                memcpy(data, image_data->getImageBuffer(), sizeof(float)*w * h);
-            else
-                getFloatBuffer<float>(data, x, y, w, h, image_data);
+            getFloatBuffer<float>(buffer, view);
             break;
         case TLONGLONG:
-            getFloatBuffer<int64_t>(data, x, y, w, h, image_data);
+            getFloatBuffer<int64_t>(buffer, view);
             break;
         case TDOUBLE:
-            getFloatBuffer<double>(data, x, y, w, h, image_data);
+            getFloatBuffer<double>(buffer, view);
             break;
         default:
-            delete [] data;
-            return -1;
+            return false;
     }
+    return true;
+}
+
+int FITSSEPDetector::findSourcesAndBackground(QList<Edge*> &starCenters, QRect const &boundary,
+        SkyBackground *bg)
+{
+    FITSData const * const image_data = reinterpret_cast<FITSData const *>(parent());
+    starCenters.clear();
+
+    if (image_data == nullptr)
+        return 0;
+
+    int maxRadius = 50;
+    if (!boundary.isNull() && radiusIsBoundary)
+        maxRadius = boundary.width();
+
+    return extract(imageView(image_data, boundary), maxRadius, starCenters, bg);
+}
+
+int FITSSEPDetector::findSourcesInView(ImageView const &view, QList<Edge*> &starCenters, SkyBackground *bg)
+{
+    starCenters.clear();
+
+    // A view smaller than its image is a boundary, as in findSourcesAndBackground()
+    int maxRadius = 50;
+    if (radiusIsBoundary && (view.x > 0 || view.y > 0 || view.width < view.stride))
+        maxRadius = view.width;
+
+    return extract(view, maxRadius, starCenters, bg);
+}
+
+int FITSSEPDetector::extract(ImageView const &view, int maxRadius, QList<Edge*> &starCenters, SkyBackground *bg)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    if (view.data == nullptr || view.width <= 0 || view.height <= 0)
+        return 0;
+
+    // Tiles pay off when there are several of them per thread, and several threads
+    const bool tiled = tiledExtraction && FITSWorkerPool::threadPool()->maxThreadCount() > 1 &&
+                       static_cast<int64_t>(view.width) * view.height >= 4LL * tileSize * tileSize;
+
+    const int count = tiled ? extractTiled(view, maxRadius, starCenters, bg) : extractFrame(view, maxRadius, starCenters, bg);
+    if (count < 0)
+        return count;
+
+    m_LastDetectionTime = timer.nsecsElapsed() / 1e6;
+    qCDebug(KSTARS_FITS) << QString("SEP detection in %1x%2%3 took %4 ms")
+                         .arg(view.width).arg(view.height).arg(tiled ? " by tiles" : "")
+                         .arg(QString::number(m_LastDetectionTime, 'f', 2));
+
+    return count;
+}
+
+int FITSSEPDetector::extractFrame(ImageView const &view, int maxRadius, QList<Edge*> &starCenters, SkyBackground *bg)
+{
+    const int x = view.x, y = view.y, w = view.width, h = view.height;
+    std::vector<std::pair<int, double>> ovals;
+    const int maxNumCenters = numStars;
+
+    // We may skip 20% of the stars (those with the largest 20% HFRs) as those are suspect
+    // to be non-stars) if we have plenty of detections.
+    int startIndex = 0;
+
+    // Only the samples of the view are converted, to a buffer that is kept by the detector
+    auto * data = scratch(static_cast<uint64_t>(w) * h);
+    if (data == nullptr || !convertView(view, data))
+        return -1;
 
-    float * imback = nullptr;
     double * flux = nullptr, *fluxerr = nullptr, *area = nullptr;
     short * flag = nullptr;
     short flux_flag = 0;
@@ -137,11 +227,7 @@ int FITSSEPDetector::findSourcesAndBackground(QList<Edge*> &starCenters, QRect c
     status = sep_background(&im, 64, 64, 3, 3, 0.0, &bkg);
     if (status != 0) goto exit;
 
-    // #2 Background evaluation
-    imback = (float *)malloc((w * h) * sizeof(float));
-    status = sep_bkg_array(bkg, imback, SEP_TFLOAT);
-    if (status != 0) goto exit;
-
+    // #2 Background evaluation. The full frame background map is not needed, only its global level and RMS.
     if (bg != nullptr)
         bg->initialize(bkg->global, bkg->globalrms, bkg->bh * bkg->bw);
 
@@ -215,10 +301,8 @@ int FITSSEPDetector::findSourcesAndBackground(QList<Edge*> &starCenters, QRect c
                              << starCenters[i]->numPixels << starCenters[i]->HFR;
 
 exit:
-    delete[] data;
     sep_bkg_free(bkg);
     sep_catalog_free(catalog);
-    free(imback);
     free(flux);
     free(fluxerr);
     free(area);
@@ -235,29 +319,245 @@ exit:
     return starCenters.count();
 }
 
-template <typename T>
-void FITSSEPDetector::getFloatBuffer(float * buffer, int x, int y, int w, int h, FITSData const *data) const
+int FITSSEPDetector::extractTiled(ImageView const &view, int maxRadius, QList<Edge*> &starCenters, SkyBackground *bg)
 {
-    auto * rawBuffer = reinterpret_cast<T const *>(data->getImageBuffer());
+    // Tiles are aligned on the background mesh, so that they estimate the background on the same cells as a single
+    // pass would. Their overlap is larger than the stars that are measured, so that each star is whole in the tile
+    // whose core contains its center.
+    const int mesh = 64;
+    const int core = qMax(mesh, tileSize / mesh * mesh);
+    const int margin = qMax(mesh, (maxRadius + mesh - 1) / mesh * mesh);
+    const QRect frame(0, 0, view.width, view.height);
+    const int maxNumCenters = numStars;
 
-    if (buffer == nullptr)
-        return;
+    struct Tile
+    {
+        /// Area processed, in view coordinates
+        QRect area;
+        /// Part of the area owned by the tile
+        QRect core;
+        float *data { nullptr };
+        sep_bkg *bkg { nullptr };
+        sep_catalog *catalog { nullptr };
+        int status { 0 };
+    };
+
+    std::vector<Tile> tiles;
+    for (int y = 0; y < view.height; y += core)
+    {
+        for (int x = 0; x < view.width; x += core)
+        {
+            Tile tile;
+            tile.core = QRect(x, y, qMin(core, view.width - x), qMin(core, view.height - y));
+            tile.area = tile.core.adjusted(-margin, -margin, margin, margin).intersected(frame);
+            tiles.push_back(tile);
+        }
+    }
 
-    float * floatPtr = buffer;
+    auto forEachTile = [&tiles](std::function<void(Tile &)> const &process)
+    {
+        QList<QFuture<void>> futures;
+        for (auto &tile : tiles)
+        {
+            Tile *current = &tile;
+            futures.append(QtConcurrent::run(FITSWorkerPool::threadPool(), [current, &process]()
+            {
+                process(*current);
+            }));
+        }
+        for (auto &future : futures)
+            future.waitForFinished();
+    };
 
-    int x2 = x + w;
-    int y2 = y + h;
+    auto tileImage = [](Tile const &tile) -> sep_image
+    {
+        sep_image im = {tile.data, nullptr, nullptr, SEP_TFLOAT, 0, 0, tile.area.width(), tile.area.height(), 0.0,
+                        SEP_NOISE_NONE, 1.0, 0.0
+                       };
+        return im;
+    };
 
-    FITSData::Statistic const &stats = data->getStatistics();
+    float conv[] = {1, 2, 1, 2, 4, 2, 1, 2, 1};
+    float global = 0, globalRMS = 0;
+    int status = 0;
+    int numPixels = 0;
+    std::vector<std::pair<Tile *, int>> sources;
+    std::vector<std::pair<int, double>> ovals;
+    QVector<Edge *> edges;
+    int startIndex = 0;
+
+    // #1 Background estimate and subtraction, by tile
+    forEachTile([&](Tile & tile)
+    {
+        ImageView tileView = view;
+        tileView.x += tile.area.x();
+        tileView.y += tile.area.y();
+        tileView.width = tile.area.width();
+        tileView.height = tile.area.height();
+
+        tile.data = FITSBufferArena::Instance()->acquire<float>(static_cast<uint64_t>(tileView.width) * tileView.height);
+        if (tile.data == nullptr || !convertView(tileView, tile.data))
+        {
+            tile.status = 1; // MEMORY_ALLOC_ERROR
+            return;
+        }
+
+        sep_image im = tileImage(tile);
+        tile.status = sep_background(&im, mesh, mesh, 3, 3, 0.0, &tile.bkg);
+        if (tile.status == 0)
+            tile.status = sep_bkg_subarray(tile.bkg, im.data, im.dtype);
+    });
+    for (auto &tile : tiles)
+        if (tile.status != 0 && status == 0)
+            status = tile.status;
+    if (status != 0) goto exit;
+
+    // #2 Background evaluation. As in a single pass, the global level and RMS are the medians over the cells,
+    // here the cells of the tile cores.
+    {
+        std::vector<float> levels, deviations;
+        for (auto &tile : tiles)
+        {
+            for (int j = 0; j < tile.bkg->ny; j++)
+            {
+                for (int i = 0; i < tile.bkg->nx; i++)
+                {
+                    const QPoint cellCenter(tile.area.x() + i * tile.bkg->bw + tile.bkg->bw / 2,
+                                            tile.area.y() + j * tile.bkg->bh + tile.bkg->bh / 2);
+                    if (!tile.core.contains(cellCenter))
+                        continue;
+                    levels.push_back(tile.bkg->back[j * tile.bkg->nx + i]);
+                    deviations.push_back(tile.bkg->sigma[j * tile.bkg->nx + i]);
+                }
+            }
+        }
+        if (levels.empty())
+        {
+            levels.push_back(tiles.front().bkg->global);
+            deviations.push_back(tiles.front().bkg->globalrms);
+        }
+        std::nth_element(levels.begin(), levels.begin() + levels.size() / 2, levels.end());
+        std::nth_element(deviations.begin(), deviations.begin() + deviations.size() / 2, deviations.end());
+        global = levels[levels.size() / 2];
+        globalRMS = deviations[deviations.size() / 2];
+        numPixels = tiles.front().bkg->bh * tiles.front().bkg->bw;
+    }
+    if (bg != nullptr)
+        bg->initialize(global, globalRMS, numPixels);
 
-    for (int y1 = y; y1 < y2; y1++)
+    // #3 Source extraction, by tile, with the threshold of the whole frame
+    forEachTile([&](Tile & tile)
     {
-        int offset = y1 * stats.width;
-        for (int x1 = x; x1 < x2; x1++)
+        sep_image im = tileImage(tile);
+        tile.status = sep_extract(&im, 2 * globalRMS, SEP_THRESH_ABS, 10, conv, 3, 3, SEP_FILTER_CONV,
+                                  deblendNThresh, deblendMincont, 1, 1.0, &tile.catalog);
+    });
+    for (auto &tile : tiles)
+        if (tile.status != 0 && status == 0)
+            status = tile.status;
+    if (status != 0) goto exit;
+
+    // #4 Seam merging. A source found by several tiles is only kept by the tile whose core contains its center.
+    for (auto &tile : tiles)
+    {
+        for (int i = 0; i < tile.catalog->nobj; i++)
         {
-            *floatPtr++ = rawBuffer[offset + x1];
+            const QPoint center(static_cast<int>(std::floor(tile.catalog->x[i] + tile.area.x() + 0.5)),
+                                static_cast<int>(std::floor(tile.catalog->y[i] + tile.area.y() + 0.5)));
+            if (!tile.core.contains(center))
+                continue;
+            const double ovalSizeSq = tile.catalog->a[i] * tile.catalog->a[i] + tile.catalog->b[i] * tile.catalog->b[i];
+            ovals.push_back(std::pair<int, double>(static_cast<int>(sources.size()), ovalSizeSq));
+            sources.push_back(std::pair<Tile *, int>(&tile, i));
         }
     }
+    qCDebug(KSTARS_FITS) << "SEP detected " << sources.size() << " stars in " << tiles.size() << " tiles.";
+    if (bg != nullptr)
+        bg->setStarsDetected(static_cast<int>(sources.size()));
+
+    // Skip the 20% largest stars if we have plenty, and keep the largest of the others, as in a single pass
+    if (sources.size() * (1 - fractionRemoved) > maxNumCenters)
+        startIndex = static_cast<int>(sources.size() * fractionRemoved);
+    std::sort(ovals.begin(), ovals.end(), [](const std::pair<int, double> &o1, const std::pair<int, double> &o2) -> bool { return o1.second > o2.second;});
+    if (startIndex < static_cast<int>(ovals.size()))
+        edges.resize(qMin(maxNumCenters, static_cast<int>(ovals.size()) - startIndex));
+
+    // #5 HFR of the selected stars, by tile
+    forEachTile([&](Tile & tile)
+    {
+        sep_image im = tileImage(tile);
+        double requested_frac[2] = { 0.5, 0.99 };
+
+        for (int e = 0; e < edges.size(); e++)
+        {
+            const auto &source = sources[ovals[startIndex + e].first];
+            if (source.first != &tile)
+                continue;
+
+            const int i = source.second;
+            double flux = tile.catalog->flux[i];
+            double flux_fractions[2] = {0};
+            short flux_flag = 0;
+            sep_flux_radius(&im, tile.catalog->x[i], tile.catalog->y[i], maxRadius, 5, 0, &flux, requested_frac, 2,
+                            flux_fractions, &flux_flag);
+
+            auto * center = new Edge();
+            center->x = tile.catalog->x[i] + tile.area.x() + view.x + 0.5;
+            center->y = tile.catalog->y[i] + tile.area.y() + view.y + 0.5;
+            center->val = tile.catalog->peak[i];
+            center->sum = flux;
+            center->numPixels = tile.catalog->npix[i];
+            center->HFR = center->width = flux_fractions[0];
+            if (flux_fractions[1] < maxRadius)
+                center->width = flux_fractions[1] * 2;
+            edges[e] = center;
+        }
+    });
+
+    // Let's sort edges, starting with widest
+    std::sort(edges.begin(), edges.end(), [](const Edge * edge1, const Edge * edge2) -> bool { return edge1->HFR > edge2->HFR;});
+    for (auto * edge : edges)
+        starCenters.append(edge);
+
+    qCDebug(KSTARS_FITS) << QString("Sky background: global %1 rms %2 cell ht %3 wd %4")
+                         .arg(QString::number(global, 'f', 2))
+                         .arg(QString::number(globalRMS, 'f', 2))
+                         .arg(mesh).arg(mesh);
+
+exit:
+    for (auto &tile : tiles)
+    {
+        FITSBufferArena::Instance()->release(tile.data);
+        sep_bkg_free(tile.bkg);
+        sep_catalog_free(tile.catalog);
+    }
+
+    if (status != 0)
+    {
+        char errorMessage[512];
+        sep_get_errmsg(status, errorMessage);
+        qCritical(KSTARS_FITS) << errorMessage;
+        return -1;
+    }
+
+    return starCenters.count();
+}
+
+template <typename T>
+void FITSSEPDetector::getFloatBuffer(float * buffer, ImageView const &view)
+{
+    if (buffer == nullptr)
+        return;
+
+    auto * rawBuffer = reinterpret_cast<T const *>(view.data);
+    float * floatPtr = buffer;
+
+    for (int y1 = view.y; y1 < view.y + view.height; y1++)
+    {
+        T const * row = rawBuffer + static_cast<size_t>(y1) * view.stride + view.x;
+        for (int x1 = 0; x1 < view.width; x1++)
+            *floatPtr++ = row[x1];
+    }
 }
 
 SkyBackground::SkyBackground(double mean_, double sigma_, double numPixels_)
@@ -61,7 +61,28 @@ class FITSSEPDetector : public FITSStarDetector
         Q_OBJECT
 
     public:
-        explicit FITSSEPDetector(FITSData *parent): FITSStarDetector(parent) {};
+        /** @brief A sub-frame of an image buffer, described without copying it.
+         */
+        struct ImageView
+        {
+            /// First sample of the image, not of the sub-frame
+            void const *data { nullptr };
+            /// FITS data type of the samples, e.g. TUSHORT
+            int dataType { 0 };
+            /// Number of samples between the starts of two consecutive rows of the image
+            int stride { 0 };
+            /// Position and size of the sub-frame in the image
+            int x { 0 };
+            int y { 0 };
+            int width { 0 };
+            int height { 0 };
+        };
+
+        /** @brief Detector of the sources of a FITS data file.
+         * @param parent is the FITS data to detect sources in, or nullptr for a detector only used through findSourcesInView().
+         */
+        explicit FITSSEPDetector(FITSData *parent);
+        ~FITSSEPDetector() override;
 
     public:
         /** @brief Find sources in the parent FITS data file.
@@ -74,6 +95,35 @@ class FITSSEPDetector : public FITSStarDetector
         int findSourcesAndBackground(QList<Edge*> &starCenters, QRect const &boundary = QRect(),
                                      SkyBackground *bg = nullptr);
 
+        /** @brief Find sources and background sky information in a sub-frame of an image buffer.
+         * @param view is the sub-frame to process. Only its samples are read, the rest of the image is never converted.
+         * @param starCenters receives the sources, positioned in image coordinates.
+         * @param bg optionally receives the background of the sub-frame.
+         * @return the number of sources found, or -1 on error.
+         * @note Keep the detector between frames, as a guide loop does, so that its scratch buffer is reused.
+         */
+        int findSourcesInView(ImageView const &view, QList<Edge*> &starCenters, SkyBackground *bg = nullptr);
+
+        /** @brief Describe a sub-frame of the first channel of FITS data.
+         * @param data is the FITS data.
+         * @param boundary is the sub-frame, or a null rectangle for the whole frame. It is clipped to the frame.
+         */
+        static ImageView imageView(FITSData const *data, QRect const &boundary = QRect());
+
+        /** @brief Convert the samples of a sub-frame to float.
+         * @param view is the sub-frame to convert.
+         * @param buffer receives view.width x view.height samples, row after row.
+         * @return false if the data type of the view is not supported.
+         */
+        static bool convertView(ImageView const &view, float *buffer);
+
+        /** @brief Time taken by the last detection, including the conversion of the sub-frame, in milliseconds.
+         */
+        double lastDetectionTime() const
+        {
+            return m_LastDetectionTime;
+        }
+
         /** @brief Configure the detection method.
          * @see FITSStarDetector::configure().
          * @note No parameters are currently available for configuration.
@@ -82,19 +132,47 @@ class FITSSEPDetector : public FITSStarDetector
         FITSSEPDetector &configure(const QString &setting, const QVariant &value) override;
 
     protected:
-        /** @internal Consolidate a float data buffer from FITS data.
+        /** @internal Consolidate a float data buffer from a sub-frame of an image buffer.
          * @param buffer is the destination float block.
-         * @param x, y, w, h define a (x,y)-(x+w,y+h) sub-frame to extract from the FITS data out to block 'buffer'.
-         * @param image_data is the FITS data block to extract from.
+         * @param view is the sub-frame to extract out to block 'buffer'.
          */
         template <typename T>
-        void getFloatBuffer(float * buffer, int x, int y, int w, int h, FITSData const * image_data) const;
+        static void getFloatBuffer(float * buffer, ImageView const &view);
+
+        /** @internal Scratch buffer of the detector, kept between detections and grown as needed.
+         * SEP subtracts the background in place, so samples are always converted to this copy.
+         */
+        float *scratch(uint64_t count);
+
+        /** @internal Detect sources in a sub-frame, as a whole or by tiles, and time the detection.
+         * @param maxRadius is the largest radius considered when measuring the flux of a source.
+         */
+        int extract(ImageView const &view, int maxRadius, QList<Edge*> &starCenters, SkyBackground *bg);
+
+        /** @internal Detect sources in a sub-frame in a single pass.
+         */
+        int extractFrame(ImageView const &view, int maxRadius, QList<Edge*> &starCenters, SkyBackground *bg);
+
+        /** @internal Detect sources in overlapping tiles of a sub-frame processed in parallel.
+         * Each source is kept by the tile whose core contains its center, so sources found again in the overlap of
+         * neighbouring tiles are counted once.
+         */
+        int extractTiled(ImageView const &view, int maxRadius, QList<Edge*> &starCenters, SkyBackground *bg);
 
         int numStars = 100;
         double fractionRemoved = 0.2;
         int deblendNThresh = 32;
         double deblendMincont = 0.005;
         bool radiusIsBoundary = true;
+        /// Whether large frames are processed by tiles in parallel, see Options::fITSTiledStarDetection()
+        bool tiledExtraction = true;
+        /// Size of the tiles, without their overlap, rounded to the background mesh size
+        int tileSize = 1024;
+
+    private:
+        float *m_Scratch { nullptr };
+        uint64_t m_ScratchCount { 0 };
+        double m_LastDetectionTime { 0 };
 };
 
 #endif // FITSSEPDETECTOR_H
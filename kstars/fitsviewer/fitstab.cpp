@@ -592,9 +592,6 @@ void FITSTab::evaluateStats()
         stat.statsTable->showColumn(2);
     }
 
-    if (image_data->getMedian() == 0.0 && !histogram->isConstructed())
-        histogram->constructHistogram();
-
     for (int i = 0; i < image_data->channels(); i++)
     {
         stat.statsTable->item(STAT_MIN, i)->setText(QString::number(image_data->getMin(i), 'f', 3));
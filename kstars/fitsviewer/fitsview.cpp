@@ -12,6 +12,7 @@
 #include "fitsview.h"
 
 #include "fitsdata.h"
+#include "fitsimagepyramid.h"
 #include "fitslabel.h"
 #include "kspopupmenu.h"
 #include "kstarsdata.h"
@@ -45,6 +46,8 @@
 #define ZOOM_LOW_INCR  10
 #define ZOOM_HIGH_INCR 50
 #define FONT_SIZE      14
+// Largest dimension of the overview of a tiled image
+#define OVERVIEW_SIZE  2048
 
 namespace
 {
@@ -83,6 +86,25 @@ void FITSView::doStretch(FITSData *data, QImage *outputImage)
 {
     if (outputImage->isNull())
         return;
+
+    Stretch stretch = prepareStretch(data);
+
+    if (tiledDisplay)
+    {
+        // The output is the overview, tiles are stretched as they are displayed
+        stretch.run(data->getImageBuffer(), outputImage, overviewSampling);
+        imagePyramid->setImage(data, stretch, *outputImage, overviewSampling);
+    }
+    else
+    {
+        imagePyramid->clear();
+        stretch.run(data->getImageBuffer(), outputImage, sampling);
+    }
+}
+
+// Creates a stretch of the image data with the parameters to display it with.
+Stretch FITSView::prepareStretch(FITSData *data)
+{
     Stretch stretch(static_cast<int>(data->width()),
                     static_cast<int>(data->height()),
                     data->channels(), data->property("dataType").toInt());
@@ -92,8 +114,15 @@ void FITSView::doStretch(FITSData *data, QImage *outputImage)
         tempParams = StretchParams();  // Keeping it linear
     else if (autoStretch)
     {
-        // Compute new auto-stretch params.
-        stretchParams = stretch.computeParams(data->getImageBuffer());
+        // Compute new auto-stretch params from the median and deviation found along with the image statistics.
+        double median[3], mad[3], maximum = 0;
+        for (int channel = 0; channel < 3; channel++)
+        {
+            median[channel] = data->getMedian(channel);
+            mad[channel] = data->getMAD(channel);
+            maximum = std::max(maximum, data->getMax(channel));
+        }
+        stretchParams = stretch.computeParams(median, mad, maximum);
         tempParams = stretchParams;
     }
     else
@@ -101,7 +130,7 @@ void FITSView::doStretch(FITSData *data, QImage *outputImage)
         tempParams = stretchParams;
 
     stretch.setParams(tempParams);
-    stretch.run(data->getImageBuffer(), outputImage, sampling);
+    return stretch;
 }
 
 // Store stretch parameters, and turn on stretching if it isn't already on.
@@ -183,6 +212,13 @@ FITSView::FITSView(QWidget * parent, FITSMode fitsMode, FITSScale filterType) :
     grabGesture(Qt::PinchGesture);
 
     image_frame.reset(new FITSLabel(this));
+    imagePyramid.reset(new FITSImagePyramid());
+    connect(imagePyramid.get(), &FITSImagePyramid::tileReady, this, [this](const QRect & imageRect)
+    {
+        const double scale = currentZoom / ZOOM_DEFAULT;
+        image_frame->update(QRectF(imageRect.x() * scale, imageRect.y() * scale, imageRect.width() * scale,
+                                   imageRect.height() * scale).toAlignedRect());
+    });
     filter = filterType;
     mode   = fitsMode;
 
@@ -219,6 +255,7 @@ FITSView::~FITSView()
 {
     fitsWatcher.waitForFinished();
     wcsWatcher.waitForFinished();
+    imagePyramid->clear();
     delete (imageData);
 }
 
@@ -311,6 +348,7 @@ void FITSView::loadFITS(const QString &inFilename, bool silent)
     // In case loadWCS is still running for previous image data, let's wait until it's over
     wcsWatcher.waitForFinished();
 
+    imagePyramid->clear();
     delete imageData;
     imageData = nullptr;
 
@@ -339,6 +377,7 @@ bool FITSView::loadFITSFromData(FITSData *data)
 
     if (imageData != nullptr)
     {
+        imagePyramid->clear();
         delete imageData;
         imageData = nullptr;
     }
@@ -366,6 +405,11 @@ bool FITSView::processData()
 
     image_frame->setSize(image_width, image_height);
 
+    // Tiles must not be rendered from the buffer while it is changed in place.
+    // Connected once loaded, as the buffer is only displayed from then on.
+    connect(imageData, &FITSData::bufferAboutToChange, imagePyramid.get(), &FITSImagePyramid::clear,
+            static_cast<Qt::ConnectionType>(Qt::DirectConnection | Qt::UniqueConnection));
+
     // Init the display image
     // JM 2020.01.08: Disabling as proposed by Hy
     //initDisplayImage();
@@ -444,6 +488,10 @@ bool FITSView::saveImage(const QString &newFilename)
     const QString ext = QFileInfo(newFilename).suffix();
     if (ext == "jpg" || ext == "png")
     {
+        // The display image of a tiled image is only an overview, stretch it in full for saving
+        if (tiledDisplay)
+            return renderFullImage().save(newFilename, ext.toLatin1().constData());
+
         rawImage.save(newFilename, ext.toLatin1().constData());
         return true;
     }
@@ -451,6 +499,25 @@ bool FITSView::saveImage(const QString &newFilename)
     return imageData->saveImage(newFilename);
 }
 
+QImage FITSView::getDisplayImage()
+{
+    return tiledDisplay ? renderFullImage() : rawImage;
+}
+
+QImage FITSView::renderFullImage()
+{
+    QImage fullImage(imageData->width(), imageData->height(),
+                     imageData->channels() == 1 ? QImage::Format_Indexed8 : QImage::Format_RGB32);
+    if (imageData->channels() == 1)
+    {
+        fullImage.setColorCount(256);
+        for (int i = 0; i < 256; i++)
+            fullImage.setColor(i, qRgb(i, i, i));
+    }
+    prepareStretch(imageData).run(imageData->getImageBuffer(), &fullImage);
+    return fullImage;
+}
+
 bool FITSView::rescale(FITSZoom type)
 {
     switch (imageData->property("dataType").toInt())
@@ -587,6 +654,13 @@ bool FITSView::rescale(FITSZoom type)
             break;
     }
 
+    // Very large images are displayed from tiles stretched on demand, and an overview of the whole image
+    tiledDisplay = mode == FITS_NORMAL && Options::fITSTiledDisplay() &&
+                   image_width * image_height >= tiledImageNumPixels;
+    overviewSampling = 1;
+    while (tiledDisplay && std::max(image_width, image_height) / overviewSampling > OVERVIEW_SIZE)
+        overviewSampling *= 2;
+
     initDisplayImage();
     image_frame->setScaledContents(true);
     doStretch(imageData, &rawImage);
@@ -676,6 +750,10 @@ int FITSView::filterStars()
 // See the comment below in getScale() for details.
 bool FITSView::isLargeImage()
 {
+    // Tiles are drawn at display scale, like small images
+    if (tiledDisplay)
+        return false;
+
     constexpr int largeImageNumPixels = 1000 * 1000;
     return rawImage.width() * rawImage.height() >= largeImageNumPixels;
 }
@@ -709,12 +787,36 @@ void FITSView::updateFrame()
     // and whether we need to therefore conserve memory. The small-image strategy explicitly scales up
     // the image, and writes overlays on the scaled pixmap. The large-image strategy uses a pixmap that's
     // the size of the image itself, never scaling that up.
-    if (isLargeImage())
+    if (tiledDisplay)
+        updateFrameTiledImage();
+    else if (isLargeImage())
         updateFrameLargeImage();
     else
         updateFrameSmallImage();
 }
 
+// The tiled-image strategy keeps no pixmap at all: the label paints the visible tiles and the overlays
+// at display scale in its paint event, see paintTiledImage().
+void FITSView::updateFrameTiledImage()
+{
+    displayPixmap = QPixmap();
+    image_frame->clear();
+    image_frame->resize(currentWidth, currentHeight);
+    image_frame->update();
+}
+
+void FITSView::paintTiledImage(QPainter *painter, const QRect &exposed)
+{
+    const double scale = currentZoom / ZOOM_DEFAULT;
+
+    painter->fillRect(exposed, Qt::black);
+    imagePyramid->paint(painter, exposed, scale);
+
+    painter->setClipRect(exposed);
+    drawOverlay(painter, scale);
+    drawStarFilter(painter, scale);
+}
+
 
 void FITSView::updateFrameLargeImage()
 {
@@ -1726,8 +1828,9 @@ void FITSView::initDisplayImage()
 {
     // Account for leftover when sampling. Thus a 5-wide image sampled by 2
     // would result in a width of 3 (samples 0, 2 and 4).
-    int w = (imageData->width() + sampling - 1) / sampling;
-    int h = (imageData->height() + sampling - 1) / sampling;
+    const int imageSampling = tiledDisplay ? overviewSampling : sampling;
+    int w = (imageData->width() + imageSampling - 1) / imageSampling;
+    int h = (imageData->height() + imageSampling - 1) / imageSampling;
 
     if (imageData->channels() == 1)
     {
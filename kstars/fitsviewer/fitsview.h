@@ -44,6 +44,7 @@ class QResizeEvent;
 class QToolBar;
 
 class FITSData;
+class FITSImagePyramid;
 class FITSLabel;
 
 class FITSView : public QScrollArea
@@ -84,10 +85,8 @@ class FITSView : public QScrollArea
         {
             return currentZoom;
         }
-        QImage getDisplayImage() const
-        {
-            return rawImage;
-        }
+        // Stretched image, rendered in full resolution on demand for a tiled image
+        QImage getDisplayImage();
         const QPixmap &getDisplayPixmap() const
         {
             return displayPixmap;
@@ -305,10 +304,16 @@ class FITSView : public QScrollArea
     private:
         bool processData();
         void doStretch(FITSData *data, QImage *outputImage);
+        Stretch prepareStretch(FITSData *data);
+        // Stretch the whole image in full resolution, for a tiled image which only keeps an overview
+        QImage renderFullImage();
         double scaleSize(double size);
         bool isLargeImage();
         void updateFrameLargeImage();
         void updateFrameSmallImage();
+        void updateFrameTiledImage();
+        // Called by FITSLabel to paint the exposed part of a tiled image
+        void paintTiledImage(QPainter *painter, const QRect &exposed);
         bool drawHFR(QPainter * painter, const QString &hfr, int x, int y);
 
 
@@ -326,8 +331,13 @@ class FITSView : public QScrollArea
         /// Image zoom factor
         const double zoomFactor;
 
-        // Original full-size image
+        // Original full-size image, or an overview sampled by overviewSampling of a tiled image
         QImage rawImage;
+        // Images of at least this many pixels are displayed from tiles instead of a full-size image
+        static constexpr int tiledImageNumPixels = 16 * 1000 * 1000;
+        bool tiledDisplay { false };
+        int overviewSampling { 1 };
+        std::unique_ptr<FITSImagePyramid> imagePyramid;
         // Actual pixmap after all the overlays
         QPixmap displayPixmap;
 
@@ -0,0 +1,109 @@
+/*  FITS Worker Pool
+
+    This application is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+*/
+
+#include "fitsworkerpool.h"
+
+#include "Options.h"
+
+#include <QThread>
+#include <QThreadPool>
+
+#if defined(Q_OS_LINUX) || defined(Q_OS_OSX)
+#include <sys/resource.h>
+#endif
+
+#include <fits_debug.h>
+
+QAtomicInteger<quint64> FITSWorkerPool::m_Count[STAGE_COUNT];
+QAtomicInteger<quint64> FITSWorkerPool::m_TotalNanoseconds[STAGE_COUNT];
+QAtomicInteger<quint64> FITSWorkerPool::m_MaxNanoseconds[STAGE_COUNT];
+
+QThreadPool *FITSWorkerPool::threadPool()
+{
+    static QThreadPool *pool = []()
+    {
+        auto *threadPool = new QThreadPool();
+        const int threads = Options::fITSWorkerThreads() > 0 ? static_cast<int>(Options::fITSWorkerThreads()) :
+                            QThread::idealThreadCount();
+        threadPool->setMaxThreadCount(qMax(1, threads));
+        // Keep the threads alive between frames
+        threadPool->setExpiryTimeout(-1);
+        qCDebug(KSTARS_FITS) << "FITSWorkerPool: using" << threadPool->maxThreadCount() << "threads";
+        return threadPool;
+    }();
+
+    return pool;
+}
+
+void FITSWorkerPool::addStageTime(Stage stage, quint64 nanoseconds)
+{
+    m_Count[stage].fetchAndAddRelaxed(1);
+    m_TotalNanoseconds[stage].fetchAndAddRelaxed(nanoseconds);
+
+    quint64 currentMax = m_MaxNanoseconds[stage].loadAcquire();
+    while (nanoseconds > currentMax && !m_MaxNanoseconds[stage].testAndSetOrdered(currentMax, nanoseconds, currentMax))
+        ;
+
+    qCDebug(KSTARS_FITS) << "FITS stage" << stageName(stage) << "took" << nanoseconds / 1e6 << "ms";
+}
+
+FITSWorkerPool::StageStatistics FITSWorkerPool::stageStatistics(Stage stage)
+{
+    StageStatistics statistics;
+    statistics.count = m_Count[stage].loadAcquire();
+    statistics.totalNanoseconds = m_TotalNanoseconds[stage].loadAcquire();
+    statistics.maxNanoseconds = m_MaxNanoseconds[stage].loadAcquire();
+    return statistics;
+}
+
+void FITSWorkerPool::resetStageStatistics()
+{
+    for (int i = 0; i < STAGE_COUNT; i++)
+    {
+        m_Count[i].storeRelease(0);
+        m_TotalNanoseconds[i].storeRelease(0);
+        m_MaxNanoseconds[i].storeRelease(0);
+    }
+}
+
+const char *FITSWorkerPool::stageName(Stage stage)
+{
+    switch (stage)
+    {
+        case STAGE_LOAD:
+            return "load";
+        case STAGE_STATISTICS:
+            return "statistics";
+        case STAGE_DEBAYER:
+            return "debayer";
+        case STAGE_FILTER:
+            return "filter";
+        case STAGE_STAR_DETECTION:
+            return "star detection";
+        default:
+            return "unknown";
+    }
+}
+
+qint64 FITSWorkerPool::peakResidentSetSize()
+{
+#if defined(Q_OS_LINUX) || defined(Q_OS_OSX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+#ifdef Q_OS_OSX
+    // Reported in bytes on MacOS
+    return usage.ru_maxrss;
+#else
+    // Reported in kilobytes on Linux
+    return usage.ru_maxrss * 1024LL;
+#endif
+#else
+    return -1;
+#endif
+}
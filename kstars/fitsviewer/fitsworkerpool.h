@@ -0,0 +1,95 @@
+/*  FITS Worker Pool
+
+    This application is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+
+class QThreadPool;
+
+/**
+ * @class FITSWorkerPool
+ * Threads and timing counters shared by the processing stages of FITSData.
+ *
+ * The pool is bounded to the number of processor cores, or to Options::fITSWorkerThreads(), and its threads
+ * never expire, so a stream of frames does not pay for thread creation. Pass threadPool() to
+ * QtConcurrent::run for the partitions of a stage. A thread waiting on the future of a task that was not
+ * started yet runs it itself, so stages may wait on their partitions from any thread.
+ *
+ * Only leaf partitions should be queued here: a task waiting for other tasks of this pool could starve it.
+ */
+class FITSWorkerPool
+{
+    public:
+        typedef enum
+        {
+            STAGE_LOAD,
+            STAGE_STATISTICS,
+            STAGE_DEBAYER,
+            STAGE_FILTER,
+            STAGE_STAR_DETECTION,
+            STAGE_COUNT
+        } Stage;
+
+        typedef struct
+        {
+            /// Number of times the stage ran
+            quint64 count { 0 };
+            /// Total time spent in the stage in nanoseconds
+            quint64 totalNanoseconds { 0 };
+            /// Longest run of the stage in nanoseconds
+            quint64 maxNanoseconds { 0 };
+        } StageStatistics;
+
+        /**
+         * @brief threadPool The persistent thread pool of the FITS pipeline.
+         */
+        static QThreadPool *threadPool();
+
+        /**
+         * @brief addStageTime Account for one run of a stage.
+         */
+        static void addStageTime(Stage stage, quint64 nanoseconds);
+
+        static StageStatistics stageStatistics(Stage stage);
+
+        static void resetStageStatistics();
+
+        static const char *stageName(Stage stage);
+
+        /**
+         * @brief peakResidentSetSize Peak resident set size of the process in bytes, or -1 if not available.
+         */
+        static qint64 peakResidentSetSize();
+
+        /**
+         * @brief The StageTimer class measures a stage from its construction to its destruction.
+         */
+        class StageTimer
+        {
+            public:
+                explicit StageTimer(Stage stage) : m_Stage(stage)
+                {
+                    m_Timer.start();
+                }
+                ~StageTimer()
+                {
+                    addStageTime(m_Stage, m_Timer.nsecsElapsed());
+                }
+
+            private:
+                Stage m_Stage;
+                QElapsedTimer m_Timer;
+        };
+
+    private:
+        static QAtomicInteger<quint64> m_Count[STAGE_COUNT];
+        static QAtomicInteger<quint64> m_TotalNanoseconds[STAGE_COUNT];
+        static QAtomicInteger<quint64> m_MaxNanoseconds[STAGE_COUNT];
+};
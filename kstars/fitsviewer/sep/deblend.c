@@ -41,8 +41,23 @@ int belong(int, objliststruct *, int, objliststruct *);
 int *createsubmap(objliststruct *, int, int *, int *, int *, int *);
 int gatherup(objliststruct *, objliststruct *);
 
-static objliststruct *objlist=NULL;
-static short	     *son=NULL, *ok=NULL;
+static SEP_THREAD_LOCAL objliststruct *objlist=NULL;
+static SEP_THREAD_LOCAL short	     *son=NULL, *ok=NULL;
+static SEP_THREAD_LOCAL unsigned int randstate = 1;
+
+#define	DEBLEND_RAND_MAX 0x7fff
+
+/* rand() replacement with one state per thread, see seeddeblend() */
+static int deblendrand(void)
+{
+  randstate = randstate*1103515245u + 12345u;
+  return (int)((randstate >> 16) & DEBLEND_RAND_MAX);
+}
+
+void seeddeblend(unsigned int seed)
+{
+  randstate = seed;
+}
 
 /******************************** deblend ************************************/
 /*
@@ -56,7 +71,7 @@ int deblend(objliststruct *objlistin, int l, objliststruct *objlistout,
 	    int deblend_nthresh, double deblend_mincont, int minarea)
 {
   objstruct		*obj;
-  static objliststruct	debobjlist, debobjlist2;
+  static SEP_THREAD_LOCAL objliststruct	debobjlist, debobjlist2;
   double		thresh, thresh0, value0;
   int			h,i,j,k,m,subx,suby,subh,subw,
                         xn,
@@ -337,7 +352,7 @@ int gatherup(objliststruct *objlistin, objliststruct *objlistout)
 	    }			
 	  if (p[nobj-1] > 1.0e-31)
 	    {
-	      drand = p[nobj-1]*rand()/RAND_MAX;
+	      drand = p[nobj-1]*deblendrand()/DEBLEND_RAND_MAX;
 	      for (i=1; i<nobj && p[i]<drand; i++);
 	      if (i==nobj)
 		i=iclst;
@@ -76,9 +76,9 @@ typedef struct
 
 
 /* globals */
-extern int plistexist_cdvalue, plistexist_thresh, plistexist_var;
-extern int plistoff_value, plistoff_cdvalue, plistoff_thresh, plistoff_var;
-extern int plistsize;
+extern SEP_THREAD_LOCAL int plistexist_cdvalue, plistexist_thresh, plistexist_var;
+extern SEP_THREAD_LOCAL int plistoff_value, plistoff_cdvalue, plistoff_thresh, plistoff_var;
+extern SEP_THREAD_LOCAL int plistsize;
 
 typedef struct
 {
@@ -147,6 +147,7 @@ void update(infostruct *, infostruct *, pliststruct *);
 
 int  allocdeblend(int);
 void freedeblend(void);
+void seeddeblend(unsigned int);
 int  deblend(objliststruct *, int, objliststruct *, int, double, int);
 
 /*int addobjshallow(objstruct *, objliststruct *);
@@ -36,6 +36,16 @@
 #define	PI  3.1415926535898
 #define	DEG (PI/180.0)	    /* 1 deg in radians */
 
+/* state of an extraction in progress, private to each thread so that
+   several images can be extracted at the same time */
+#if defined(_MSC_VER)
+#define SEP_THREAD_LOCAL __declspec(thread)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define SEP_THREAD_LOCAL _Thread_local
+#else
+#define SEP_THREAD_LOCAL __thread
+#endif
+
 typedef	int	      LONG;
 typedef	unsigned int  ULONG;
 typedef	unsigned char BYTE;    /* a byte */
@@ -10,8 +10,11 @@
 
 #include <fitsio.h>
 #include <math.h>
+#include <QMutex>
 #include <QtConcurrent>
 
+#include <memory>
+
 namespace {
 
 // Returns the median value of the vector.
@@ -47,161 +50,241 @@ T median(T const *values, int size, int sampleBy)
   return median(samples);
 }
 
-// This stretches one channel given the input parameters.
+// The stretch of a single sample of a channel.
 // Based on the spec in section 8.5.6
 // https://pixinsight.com/doc/docs/XISF-1.0-spec/XISF-1.0-spec.html
+template <typename T>
+struct ChannelStretch
+{
+  ChannelStretch(const StretchParams1Channel &params, int input_range)
+  {
+    // We're outputting uint8, so the max output is 255.
+    constexpr int maxOutput = 255;
+
+    // Maximum possible input value (e.g. 1024*64 - 1 for a 16 bit unsigned int).
+    const float maxInput = input_range > 1 ? input_range - 1 : input_range;
+
+    midtones = params.midtones;
+    // hightlights - shadows, protecting for divide-by-0, in a 0->1.0 scale.
+    const float hsRangeFactor = params.highlights == params.shadows ? 1.0f :
+                                1.0f / (params.highlights - params.shadows);
+    // Shadow and highlight values translated to the ADU scale.
+    nativeShadows = params.shadows * maxInput;
+    nativeHighlights = params.highlights * maxInput;
+    // Constants based on above needed for the stretch calculations.
+    k1 = (midtones - 1) * hsRangeFactor * maxOutput / maxInput;
+    k2 = ((2 * midtones) - 1) * hsRangeFactor / maxInput;
+  }
+
+  uint8_t operator()(T input) const
+  {
+    if (input < nativeShadows) return 0;
+    if (input >= nativeHighlights) return 255;
+    const T inputFloored = (input - nativeShadows);
+    return (inputFloored * k1) / (inputFloored * k2 - midtones);
+  }
+
+  T nativeShadows;
+  T nativeHighlights;
+  float k1;
+  float k2;
+  float midtones;
+};
+
+// Types with few enough values to stretch through a lookup table with an entry per value.
+// A sample of value v is at index v + offset of the table.
+template <typename T>
+struct LookupTableRange
+{
+  static constexpr bool used = false;
+  static constexpr int offset = 0;
+  static constexpr int size = 0;
+};
+
+template <>
+struct LookupTableRange<uint8_t>
+{
+  static constexpr bool used = true;
+  static constexpr int offset = 0;
+  static constexpr int size = 256;
+};
+
+template <>
+struct LookupTableRange<short>
+{
+  static constexpr bool used = true;
+  static constexpr int offset = 32768;
+  static constexpr int size = 65536;
+};
+
+template <>
+struct LookupTableRange<unsigned short>
+{
+  static constexpr bool used = true;
+  static constexpr int offset = 0;
+  static constexpr int size = 65536;
+};
+
+typedef std::shared_ptr<const QVector<uint8_t>> LookupTable;
+
+struct LookupTableKey
+{
+  int dataType;
+  int inputRange;
+  float shadows;
+  float highlights;
+  float midtones;
+
+  bool operator==(const LookupTableKey &other) const
+  {
+    return dataType == other.dataType && inputRange == other.inputRange && shadows == other.shadows &&
+           highlights == other.highlights && midtones == other.midtones;
+  }
+};
+
+// Tables of the last parameters used, so restretching an image or stretching more of it
+// with the same parameters does not rebuild them. When a slider moves only its channel's table is rebuilt.
+constexpr int maxLookupTables = 12;
+QMutex lookupTablesMutex;
+QList<QPair<LookupTableKey, LookupTable>> lookupTables;
+
+// Returns the table stretching every value of T with the channel parameters, building it if it is not cached.
+template <typename T>
+LookupTable lookupTable(const StretchParams1Channel &params, int input_range, int data_type)
+{
+  const LookupTableKey key = { data_type, input_range, params.shadows, params.highlights, params.midtones };
+
+  {
+    QMutexLocker locker(&lookupTablesMutex);
+    for (int i = 0; i < lookupTables.size(); ++i)
+    {
+      if (lookupTables[i].first == key)
+      {
+        LookupTable table = lookupTables[i].second;
+        lookupTables.move(i, 0);
+        return table;
+      }
+    }
+  }
+
+  const ChannelStretch<T> stretch(params, input_range);
+  auto *table = new QVector<uint8_t>(LookupTableRange<T>::size);
+  uint8_t *entries = table->data();
+  for (int i = 0; i < LookupTableRange<T>::size; ++i)
+    entries[i] = stretch(static_cast<T>(i - LookupTableRange<T>::offset));
+  LookupTable result(table);
+
+  QMutexLocker locker(&lookupTablesMutex);
+  lookupTables.prepend(qMakePair(key, result));
+  while (lookupTables.size() > maxLookupTables)
+    lookupTables.removeLast();
+  return result;
+}
+
+// Index of a sample in a lookup table of its type.
+template <typename T>
+inline int lookupIndex(T input)
+{
+  return static_cast<int>(input) + LookupTableRange<T>::offset;
+}
+
+// This stretches one channel given the input parameters.
 // Uses multiple threads, blocks until done.
 // The extension parameters are not used.
 // Sampling is applied to the output (that is, with sampling=2, we compute every other output
 // sample both in width and height, so the output would have about 4X fewer pixels.
+// Only the region of the input is stretched, into the top left corner of the output.
 template <typename T>
-void stretchOneChannel(T *input_buffer, QImage *output_image,
+void stretchOneChannel(T const *input_buffer, QImage *output_image,
                        const StretchParams& stretch_params, 
-                       int input_range, int image_height, int image_width, int sampling)
+                       int input_range, int data_type, int image_width, int sampling, const QRect &region)
 {
   QVector<QFuture<void>> futures;
 
-  // We're outputting uint8, so the max output is 255.
-  constexpr int maxOutput = 255;
+  const ChannelStretch<T> stretch(stretch_params.grey_red, input_range);
+
+  // Small integer types gather from a table instead of evaluating the transfer function per sample.
+  LookupTable table;
+  if (LookupTableRange<T>::used)
+    table = lookupTable<T>(stretch_params.grey_red, input_range, data_type);
 
-  // Maximum possible input value (e.g. 1024*64 - 1 for a 16 bit unsigned int).
-  const float maxInput = input_range > 1 ? input_range - 1 : input_range;
-  
-  const float midtones   = stretch_params.grey_red.midtones;
-  const float highlights = stretch_params.grey_red.highlights;
-  const float shadows    = stretch_params.grey_red.shadows;
-
-  // Precomputed expressions moved out of the loop.
-  // hightlights - shadows, protecting for divide-by-0, in a 0->1.0 scale.
-  const float hsRangeFactor = highlights == shadows ? 1.0f : 1.0f / (highlights - shadows);
-  // Shadow and highlight values translated to the ADU scale.
-  const T nativeShadows = shadows * maxInput;
-  const T nativeHighlights = highlights * maxInput;
-  // Constants based on above needed for the stretch calculations.
-  const float k1 = (midtones - 1) * hsRangeFactor * maxOutput / maxInput;
-  const float k2 = ((2 * midtones) - 1) * hsRangeFactor / maxInput;
-  
   // Increment the input index by the sampling, the output index increments by 1.
-  for (int j = 0, jout = 0; j < image_height; j+=sampling, jout++)
+  for (int j = region.top(), jout = 0; j <= region.bottom(); j+=sampling, jout++)
   {
     futures.append(QtConcurrent::run([ = ]()
     {
-        T * inputLine  = input_buffer + j * image_width;
+        T const * inputLine  = input_buffer + j * image_width;
         auto * scanLine = output_image->scanLine(jout);
-        
-    for (int i = 0, iout = 0; i < image_width; i+=sampling, iout++)
+
+        if (table)
         {
-          const T input = inputLine[i];
-          if (input < nativeShadows) scanLine[iout] = 0;
-          else if (input >= nativeHighlights) scanLine[iout] = maxOutput;
-          else 
-          {
-            const T inputFloored = (input - nativeShadows);
-            scanLine[iout] = (inputFloored * k1) / (inputFloored * k2 - midtones);
-	  }
+          const uint8_t *entries = table->constData();
+          for (int i = region.left(), iout = 0; i <= region.right(); i+=sampling, iout++)
+            scanLine[iout] = entries[lookupIndex(inputLine[i])];
+          return;
         }
+        
+    for (int i = region.left(), iout = 0; i <= region.right(); i+=sampling, iout++)
+          scanLine[iout] = stretch(inputLine[i]);
     }));
   }
   for(QFuture<void> future : futures)
     future.waitForFinished();
 }
 
-// This is like the above 1-channel stretch, but extended for 3 channels.
-// This could have been more modular, but the three channels are combined
-// into a single qRgb value at the end, so it seems the simplest thing is to
-// replicate the code. It is assume the colors are not interleaved--the red image
+// This is like the above 1-channel stretch, but extended for 3 channels,
+// which are combined into a single qRgb value at the end.
+// It is assume the colors are not interleaved--the red image
 // is stored fully, then the green, then the blue.
 // Sampling is applied to the output (that is, with sampling=2, we compute every other output
 // sample both in width and height, so the output would have about 4X fewer pixels.
+// Only the region of the input is stretched, into the top left corner of the output.
 template <typename T>
-void stretchThreeChannels(T *inputBuffer, QImage *outputImage,
+void stretchThreeChannels(T const *inputBuffer, QImage *outputImage,
                           const StretchParams& stretchParams, 
-                          int inputRange, int imageHeight, int imageWidth, int sampling)
+                          int inputRange, int dataType, int imageHeight, int imageWidth, int sampling, const QRect &region)
 {
   QVector<QFuture<void>> futures;
 
-  // We're outputting uint8, so the max output is 255.
-  constexpr int maxOutput = 255;
+  const ChannelStretch<T> stretchR(stretchParams.grey_red, inputRange);
+  const ChannelStretch<T> stretchG(stretchParams.green, inputRange);
+  const ChannelStretch<T> stretchB(stretchParams.blue, inputRange);
+
+  // Small integer types gather from tables instead of evaluating the transfer function per sample.
+  LookupTable tableR, tableG, tableB;
+  if (LookupTableRange<T>::used)
+  {
+    tableR = lookupTable<T>(stretchParams.grey_red, inputRange, dataType);
+    tableG = lookupTable<T>(stretchParams.green, inputRange, dataType);
+    tableB = lookupTable<T>(stretchParams.blue, inputRange, dataType);
+  }
 
-  // Maximum possible input value (e.g. 1024*64 - 1 for a 16 bit unsigned int).
-  const float maxInput = inputRange > 1 ? inputRange - 1 : inputRange;
-  
-  const float midtonesR   = stretchParams.grey_red.midtones;
-  const float highlightsR = stretchParams.grey_red.highlights;
-  const float shadowsR    = stretchParams.grey_red.shadows;
-  const float midtonesG   = stretchParams.green.midtones;
-  const float highlightsG = stretchParams.green.highlights;
-  const float shadowsG    = stretchParams.green.shadows;
-  const float midtonesB   = stretchParams.blue.midtones;
-  const float highlightsB = stretchParams.blue.highlights;
-  const float shadowsB    = stretchParams.blue.shadows;
-
-  // Precomputed expressions moved out of the loop.
-  // hightlights - shadows, protecting for divide-by-0, in a 0->1.0 scale.
-  const float hsRangeFactorR = highlightsR == shadowsR ? 1.0f : 1.0f / (highlightsR - shadowsR);
-  const float hsRangeFactorG = highlightsG == shadowsG ? 1.0f : 1.0f / (highlightsG - shadowsG);
-  const float hsRangeFactorB = highlightsB == shadowsB ? 1.0f : 1.0f / (highlightsB - shadowsB);
-  // Shadow and highlight values translated to the ADU scale.
-  const T nativeShadowsR = shadowsR * maxInput;
-  const T nativeShadowsG = shadowsG * maxInput;
-  const T nativeShadowsB = shadowsB * maxInput;
-  const T nativeHighlightsR = highlightsR * maxInput;
-  const T nativeHighlightsG = highlightsG * maxInput;
-  const T nativeHighlightsB = highlightsB * maxInput;
-  // Constants based on above needed for the stretch calculations.
-  const float k1R = (midtonesR - 1) * hsRangeFactorR * maxOutput / maxInput;
-  const float k1G = (midtonesG - 1) * hsRangeFactorG * maxOutput / maxInput;
-  const float k1B = (midtonesB - 1) * hsRangeFactorB * maxOutput / maxInput;
-  const float k2R = ((2 * midtonesR) - 1) * hsRangeFactorR / maxInput;
-  const float k2G = ((2 * midtonesG) - 1) * hsRangeFactorG / maxInput;
-  const float k2B = ((2 * midtonesB) - 1) * hsRangeFactorB / maxInput;
-  
   const int size = imageWidth * imageHeight;
   
-  for (int j = 0, jout = 0; j < imageHeight; j+=sampling, jout++)
+  for (int j = region.top(), jout = 0; j <= region.bottom(); j+=sampling, jout++)
   {
     futures.append(QtConcurrent::run([ = ]()
     {
         // R, G, B input images are stored one after another.
-        T * inputLineR  = inputBuffer + j * imageWidth;
-        T * inputLineG  = inputLineR + size;
-        T * inputLineB  = inputLineG + size;
+        T const * inputLineR  = inputBuffer + j * imageWidth;
+        T const * inputLineG  = inputLineR + size;
+        T const * inputLineB  = inputLineG + size;
         
         auto * scanLine = reinterpret_cast<QRgb*>(outputImage->scanLine(jout));
-        
-    for (int i = 0, iout = 0; i < imageWidth; i+=sampling, iout++)
+
+        if (tableR)
         {
-          const T inputR = inputLineR[i];
-          const T inputG = inputLineG[i];
-          const T inputB = inputLineB[i];
-
-          uint8_t red, green, blue;
-          
-          if (inputR < nativeShadowsR) red = 0;
-          else if (inputR >= nativeHighlightsR) red = maxOutput;
-          else 
-          {
-            const T inputFloored = (inputR - nativeShadowsR);
-            red = (inputFloored * k1R) / (inputFloored * k2R - midtonesR);
-	  }
-
-          if (inputG < nativeShadowsG) green = 0;
-          else if (inputG >= nativeHighlightsG) green = maxOutput;
-          else 
-          {
-            const T inputFloored = (inputG - nativeShadowsG);
-            green = (inputFloored * k1G) / (inputFloored * k2G - midtonesG);
-	  }
-
-          if (inputB < nativeShadowsB) blue = 0;
-          else if (inputB >= nativeHighlightsB) blue = maxOutput;
-          else 
-          {
-            const T inputFloored = (inputB - nativeShadowsB);
-            blue = (inputFloored * k1B) / (inputFloored * k2B - midtonesB);
-	  }
-          scanLine[iout] = qRgb(red, green, blue);
+          const uint8_t *entriesR = tableR->constData();
+          const uint8_t *entriesG = tableG->constData();
+          const uint8_t *entriesB = tableB->constData();
+          for (int i = region.left(), iout = 0; i <= region.right(); i+=sampling, iout++)
+            scanLine[iout] = qRgb(entriesR[lookupIndex(inputLineR[i])], entriesG[lookupIndex(inputLineG[i])],
+                                  entriesB[lookupIndex(inputLineB[i])]);
+          return;
         }
+        
+    for (int i = region.left(), iout = 0; i <= region.right(); i+=sampling, iout++)
+          scanLine[iout] = qRgb(stretchR(inputLineR[i]), stretchG(inputLineG[i]), stretchB(inputLineB[i]));
     }));
   }
   for(QFuture<void> future : futures)
@@ -209,18 +292,21 @@ void stretchThreeChannels(T *inputBuffer, QImage *outputImage,
 }
 
 template <typename T>
-void stretchChannels(T *input_buffer, QImage *output_image,
+void stretchChannels(T const *input_buffer, QImage *output_image,
                        const StretchParams& stretch_params, 
-                     int input_range, int image_height, int image_width, int num_channels, int sampling)
+                     int input_range, int data_type, int image_height, int image_width, int num_channels,
+                     int sampling, const QRect &region)
 {
     if (num_channels == 1)
-      stretchOneChannel(input_buffer, output_image, stretch_params, input_range,
-                        image_height, image_width, sampling);
+      stretchOneChannel(input_buffer, output_image, stretch_params, input_range, data_type,
+                        image_width, sampling, region);
     else if (num_channels == 3)
-      stretchThreeChannels(input_buffer, output_image, stretch_params, input_range,
-                           image_height, image_width, sampling);
+      stretchThreeChannels(input_buffer, output_image, stretch_params, input_range, data_type,
+                           image_height, image_width, sampling, region);
 }
   
+void computeParamsFromMedian(float medianSample, float medDev, StretchParams1Channel *params, int inputRange);
+
 // See section 8.5.7 in above link  https://pixinsight.com/doc/docs/XISF-1.0-spec/XISF-1.0-spec.html
 template <typename T>
 void computeParamsOneChannel(T const *buffer, StretchParams1Channel *params,
@@ -242,8 +328,13 @@ void computeParamsOneChannel(T const *buffer, StretchParams1Channel *params,
       deviations[i] = buffer[index] - medianSample;
   }
 
+  computeParamsFromMedian(medianSample, median(deviations), params, inputRange);
+}
+
+// Shadows, highlights and midtones from the median sample and the median deviation of a channel.
+void computeParamsFromMedian(float medianSample, float medDev, StretchParams1Channel *params, int inputRange)
+{
   // Shift everything to 0 -> 1.0.
-  const float medDev = median(deviations);
   const float normalizedMedian = medianSample / static_cast<float>(inputRange);
   const float MADN = 1.4826 * medDev / static_cast<float>(inputRange);
 
@@ -318,39 +409,44 @@ Stretch::Stretch(int width, int height, int channels, int data_type)
 
 void Stretch::run(uint8_t const *input, QImage *outputImage, int sampling)
 {
-    Q_ASSERT(outputImage->width() == (image_width + sampling - 1) / sampling);
-    Q_ASSERT(outputImage->height() == (image_height + sampling - 1) / sampling);
+    run(input, outputImage, sampling, QRect(0, 0, image_width, image_height));
+}
+
+void Stretch::run(uint8_t const *input, QImage *outputImage, int sampling, const QRect &region)
+{
+    Q_ASSERT(outputImage->width() == (region.width() + sampling - 1) / sampling);
+    Q_ASSERT(outputImage->height() == (region.height() + sampling - 1) / sampling);
     recalculateInputRange(input);
 
     switch (dataType)
     {
         case TBYTE:
             stretchChannels(reinterpret_cast<uint8_t const*>(input), outputImage, params,
-                            input_range, image_height, image_width, image_channels, sampling);
+                            input_range, dataType, image_height, image_width, image_channels, sampling, region);
             break;
         case TSHORT:
             stretchChannels(reinterpret_cast<short const*>(input), outputImage, params,
-                            input_range, image_height, image_width, image_channels, sampling);
+                            input_range, dataType, image_height, image_width, image_channels, sampling, region);
             break;
         case TUSHORT:
             stretchChannels(reinterpret_cast<unsigned short const*>(input), outputImage, params,
-                            input_range, image_height, image_width, image_channels, sampling);
+                            input_range, dataType, image_height, image_width, image_channels, sampling, region);
             break;
         case TLONG:
             stretchChannels(reinterpret_cast<long const*>(input), outputImage, params,
-                            input_range, image_height, image_width, image_channels, sampling);
+                            input_range, dataType, image_height, image_width, image_channels, sampling, region);
             break;
         case TFLOAT:
             stretchChannels(reinterpret_cast<float const*>(input), outputImage, params,
-                            input_range, image_height, image_width, image_channels, sampling);
+                            input_range, dataType, image_height, image_width, image_channels, sampling, region);
             break;
         case TLONGLONG:
             stretchChannels(reinterpret_cast<long long const*>(input), outputImage, params,
-                            input_range, image_height, image_width, image_channels, sampling);
+                            input_range, dataType, image_height, image_width, image_channels, sampling, region);
             break;
         case TDOUBLE:
             stretchChannels(reinterpret_cast<double const*>(input), outputImage, params,
-                            input_range, image_height, image_width, image_channels, sampling);
+                            input_range, dataType, image_height, image_width, image_channels, sampling, region);
             break;
         default:
         break;
@@ -361,8 +457,9 @@ void Stretch::run(uint8_t const *input, QImage *outputImage, int sampling)
 // so we set it to 64K and possibly reduce it when we see the data.
 void Stretch::recalculateInputRange(uint8_t const *input)
 {
-    if (input_range <= 1) return;
+    if (input_range <= 1 || input_range_checked) return;
     if (dataType != TFLOAT && dataType != TDOUBLE) return;
+    input_range_checked = true;
 
     float mx = 0;
     if (dataType == TFLOAT)
@@ -438,3 +535,20 @@ StretchParams Stretch::computeParams(uint8_t const *input)
   }
   return result;
 }
+
+StretchParams Stretch::computeParams(const double median[3], const double mad[3], double maximum)
+{
+  // Same guess as recalculateInputRange(), from the known maximum instead of a sampled one.
+  if (input_range > 1 && (dataType == TFLOAT || dataType == TDOUBLE) && maximum <= 1.01)
+    input_range = 1;
+  input_range_checked = true;
+
+  StretchParams result;
+  for (int channel = 0; channel < image_channels; ++channel)
+  {
+    StretchParams1Channel *params = channel == 0 ? &result.grey_red :
+      (channel == 1 ? &result.green : &result.blue);
+    computeParamsFromMedian(median[channel], mad[channel], params, input_range);
+  }
+  return result;
+}
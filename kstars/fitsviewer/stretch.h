@@ -10,6 +10,7 @@
 
 #include <memory>
 #include <QImage>
+#include <QRect>
 
 struct StretchParams1Channel
 {
@@ -71,6 +72,15 @@ class Stretch
          */
         StretchParams computeParams(const uint8_t *input);
 
+        /**
+         * @brief computeParams Generates stretch parameters from statistics already computed for the image,
+         * without scanning the image buffer.
+         * @param median the median sample of each channel.
+         * @param mad the median absolute deviation from the median of each channel.
+         * @param maximum the largest sample of the image.
+         */
+        StretchParams computeParams(const double median[3], const double mad[3], double maximum);
+
         /**
          * @brief run run the stretch algorithm according to the params given
          * placing the output in output_image.
@@ -80,9 +90,19 @@ class Stretch
          * @param sampling The sampling parameter. Applies to both width and height.
          * Sampling is applied to the output (that is, with sampling=2, we compute every other output
          * sample both in width and height, so the output would have about 4X fewer pixels.
+         * @note 8 and 16 bit images are stretched through lookup tables, which are cached for the
+         * last parameters used, so running again with the same parameters only gathers from them.
          */
         void run(uint8_t const *input, QImage *output_image, int sampling=1);
 
+        /**
+         * @brief run run the stretch algorithm on a region of the image only.
+         * @param region the part of the input to stretch, in image pixels. It is written to the top left
+         * corner of output_image, which should be the size of the region divided by sampling.
+         * @note Its top left corner should be a multiple of sampling for adjacent regions to sample the same pixels.
+         */
+        void run(uint8_t const *input, QImage *output_image, int sampling, const QRect &region);
+
  private:
         // Adjusts input_range for float and double types.
         void recalculateInputRange(const uint8_t *input);
@@ -92,6 +112,8 @@ class Stretch
         int image_height;
         int image_channels;
         int input_range;
+        // Whether the data was checked to adjust input_range, so it is done once per image.
+        bool input_range_checked { false };
         int dataType;
   
         // Parameters.
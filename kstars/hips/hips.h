@@ -28,6 +28,9 @@
 #define HIPS_FRAME_EQT          0
 #define HIPS_FRAME_GAL          1
 
+// Level of the cache key of the allsky image of a source, distinct from the HEALPix orders of its tiles
+#define HIPS_ALLSKY_LEVEL       -1
+
 typedef struct
 {
   QString cachePath;
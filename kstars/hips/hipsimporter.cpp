@@ -0,0 +1,325 @@
+/*
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "hipsimporter.h"
+
+#include "healpix.h"
+#include "hipsmanager.h"
+#include "kstars_debug.h"
+#include "pixstore.h"
+#include "skyobjects/skypoint.h"
+
+#include <KLocalizedString>
+
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QRegularExpression>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+// Requests to the source in flight at once
+#define MAX_REQUESTS            8
+// Interval between progress reports, in milliseconds
+#define PROGRESS_INTERVAL_MS    250
+
+HIPSImporter::HIPSImporter(QObject *parent) : QObject(parent)
+{
+}
+
+HIPSImporter::~HIPSImporter()
+{
+  cancel();
+  m_watcher.waitForFinished();
+}
+
+bool HIPSImporter::importDirectory(const QString &path)
+{
+  if (HIPSManager::Instance()->getCurrentSource().isEmpty())
+    return false;
+
+  return importDirectory(path, HIPSManager::Instance()->getStore(), HIPSManager::Instance()->getUID(),
+                         HIPSManager::Instance()->getCurrentFormat());
+}
+
+bool HIPSImporter::importDirectory(const QString &path, PixStore *store, qint64 uid, const QString &format)
+{
+  if (isRunning() || store == nullptr || !QDir(path).exists())
+    return false;
+
+  m_store  = store;
+  m_uid    = uid;
+  m_format = format;
+  m_cancel.store(0);
+
+  m_watcher.setFuture(QtConcurrent::run([this, path]() { run(QUrl::fromLocalFile(path), path, QVector<tile_t>()); }));
+  return true;
+}
+
+bool HIPSImporter::importRegion(const QUrl &url, const SkyPoint &center, double radius, int minOrder, int maxOrder)
+{
+  if (isRunning() || HIPSManager::Instance()->getCurrentSource().isEmpty() || !url.isValid())
+    return false;
+
+  m_store  = HIPSManager::Instance()->getStore();
+  m_uid    = HIPSManager::Instance()->getUID();
+  m_format = HIPSManager::Instance()->getCurrentFormat();
+  m_cancel.store(0);
+
+  minOrder = qMax(3, minOrder);
+  maxOrder = qMin(maxOrder, static_cast<int>(HIPSManager::Instance()->getCurrentOrder()));
+
+  // Tiles are listed here, as HEALPix computes the corners of the tiles with the current sky.
+  // Each order only checks the children of the tiles of the previous order that overlap the region.
+  QVector<tile_t> tiles;
+  HEALPix healpix;
+  SkyPoint centerPoint(center.ra0(), center.dec0());
+
+  tile_t allsky;
+  allsky.key  = { HIPS_ALLSKY_LEVEL, 0, m_uid };
+  allsky.path = HIPSManager::getPixPath(true, 0, 0, m_format);
+  tiles.append(allsky);
+
+  QVector<int> candidates;
+  for (int pix = 0; pix < 12 * 64; pix++)
+    candidates.append(pix);
+
+  for (int order = 3; order <= maxOrder && !candidates.isEmpty(); order++)
+  {
+    int centerPix = healpix.getPix(order, center.ra0().radians(), center.dec0().radians());
+    QVector<int> children;
+
+    for (int pix : candidates)
+    {
+      SkyPoint corners[4];
+      healpix.getCornerPoints(order, pix, corners);
+
+      // A tile overlaps the region if it contains its center, or if a corner is closer to it than the tile size
+      SkyPoint first(corners[0].ra0(), corners[0].dec0());
+      SkyPoint opposite(corners[2].ra0(), corners[2].dec0());
+      double size = first.angularDistanceTo(&opposite).Degrees();
+      bool overlaps = pix == centerPix;
+
+      for (int i = 0; i < 4 && !overlaps; i++)
+      {
+        SkyPoint corner(corners[i].ra0(), corners[i].dec0());
+        overlaps = corner.angularDistanceTo(&centerPoint).Degrees() < radius + size;
+      }
+
+      if (!overlaps)
+        continue;
+
+      if (order >= minOrder)
+      {
+        tile_t tile;
+        tile.key  = { order, pix, m_uid };
+        tile.path = HIPSManager::getPixPath(false, order, pix, m_format);
+        tiles.append(tile);
+      }
+
+      int childs[4];
+      healpix.getPixChilds(pix, childs);
+      for (int child : childs)
+        children.append(child);
+    }
+
+    candidates = children;
+  }
+
+  m_watcher.setFuture(QtConcurrent::run([this, url, tiles]() { run(url, QString(), tiles); }));
+  return true;
+}
+
+void HIPSImporter::cancel()
+{
+  m_cancel.store(1);
+}
+
+bool HIPSImporter::isRunning() const
+{
+  return m_watcher.isRunning();
+}
+
+QVector<HIPSImporter::tile_t> HIPSImporter::listDirectory(const QString &path) const
+{
+  QVector<tile_t> tiles;
+  QDir base(path);
+  QRegularExpression tileName(QString("^Norder(\\d+)/Dir\\d+/Npix(\\d+)\\.%1$").arg(QRegularExpression::escape(m_format)));
+  QString allskyName = HIPSManager::getPixPath(true, 0, 0, m_format).mid(1);
+
+  QDirIterator it(path, QStringList() << "Npix*." + m_format << "Allsky." + m_format, QDir::Files,
+                  QDirIterator::Subdirectories);
+  while (it.hasNext() && !m_cancel.load())
+  {
+    QString name = base.relativeFilePath(it.next());
+    tile_t tile;
+
+    QRegularExpressionMatch match = tileName.match(name);
+    if (match.hasMatch())
+      tile.key = { match.captured(1).toInt(), match.captured(2).toInt(), m_uid };
+    else if (name == allskyName)
+      tile.key = { HIPS_ALLSKY_LEVEL, 0, m_uid };
+    else
+      continue;
+
+    tile.path = '/' + name;
+    tiles.append(tile);
+  }
+
+  // Import the largest tiles first, so that the whole tree is usable at low resolution if the budget runs out
+  std::sort(tiles.begin(), tiles.end(), [](const tile_t &a, const tile_t &b)
+  {
+    return a.key.level != b.key.level ? a.key.level < b.key.level : a.key.pix < b.key.pix;
+  });
+
+  return tiles;
+}
+
+void HIPSImporter::run(const QUrl &url, const QString &path, QVector<tile_t> tiles)
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  if (!path.isEmpty())
+  {
+    emit progress(0, 0, 0, 0);
+    tiles = listDirectory(path);
+  }
+
+  int imported = 0, skipped = 0, failed = 0;
+  qint64 bytes = 0;
+  qint64 lastProgress = 0;
+  QString error;
+
+  auto storeTile = [&](const tile_t &tile, const QByteArray &data)
+  {
+    if (data.isEmpty())
+    {
+      failed++;
+    }
+    else if (m_store->write(tile.key, data))
+    {
+      imported++;
+      bytes += data.size();
+    }
+    else if (m_store->getMaximumStoreSize() > 0 &&
+             m_store->storeSize() + data.size() >= m_store->getMaximumStoreSize())
+    {
+      error = i18n("The size budget of the offline HiPS store is reached.");
+    }
+    else
+    {
+      failed++;
+    }
+
+    if (timer.elapsed() - lastProgress >= PROGRESS_INTERVAL_MS)
+    {
+      lastProgress = timer.elapsed();
+      emit progress(imported + skipped + failed, tiles.size(), bytes, lastProgress / 1000.0);
+    }
+  };
+
+  if (url.isLocalFile())
+  {
+    QString base = url.toLocalFile();
+
+    for (int i = 0; i < tiles.size() && error.isEmpty() && !m_cancel.load(); i++)
+    {
+      const tile_t &tile = tiles.at(i);
+
+      if (m_store->contains(tile.key))
+      {
+        skipped++;
+        continue;
+      }
+
+      QFile file(base + tile.path);
+      storeTile(tile, file.open(QFile::ReadOnly) ? file.readAll() : QByteArray());
+    }
+  }
+  else
+  {
+    // The manager lives in this thread, and its replies are processed while waiting for them
+    QNetworkAccessManager manager;
+    QEventLoop loop;
+    QHash<QNetworkReply *, int> pending;
+    int next = 0;
+
+    connect(&manager, &QNetworkAccessManager::finished, &loop, &QEventLoop::quit);
+
+    while (error.isEmpty() && !m_cancel.load() && (next < tiles.size() || !pending.isEmpty()))
+    {
+      while (pending.size() < MAX_REQUESTS && next < tiles.size())
+      {
+        const tile_t &tile = tiles.at(next);
+
+        if (m_store->contains(tile.key))
+        {
+          skipped++;
+          next++;
+          continue;
+        }
+
+        QUrl tileURL(url);
+        tileURL.setPath(tileURL.path() + tile.path);
+        pending.insert(manager.get(QNetworkRequest(tileURL)), next++);
+      }
+
+      if (pending.isEmpty())
+        break;
+
+      loop.exec();
+
+      for (auto it = pending.begin(); it != pending.end();)
+      {
+        QNetworkReply *reply = it.key();
+
+        if (!reply->isFinished())
+        {
+          ++it;
+          continue;
+        }
+
+        storeTile(tiles.at(it.value()), reply->error() == QNetworkReply::NoError ? reply->readAll() : QByteArray());
+        delete reply;
+        it = pending.erase(it);
+      }
+    }
+
+    for (QNetworkReply *reply : pending.keys())
+    {
+      reply->abort();
+      delete reply;
+    }
+  }
+
+  m_store->flush();
+
+  if (error.isEmpty() && m_cancel.load())
+    error = i18n("The import was canceled.");
+
+  double seconds = timer.elapsed() / 1000.0;
+
+  qCInfo(KSTARS) << "HiPS import:" << imported << "tiles," << bytes / 1024 / 1024 << "MB imported in" << seconds
+                 << "s, at" << (seconds > 0 ? imported / seconds : 0) << "tiles/s," << skipped << "already stored,"
+                 << failed << "failed";
+
+  emit finished(imported, skipped, failed, bytes, seconds, error);
+}
@@ -0,0 +1,86 @@
+/*
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#pragma once
+
+#include "hips.h"
+
+#include <QAtomicInt>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QUrl>
+#include <QVector>
+
+class PixStore;
+class SkyPoint;
+
+/**
+ * @class HIPSImporter
+ *
+ * Bulk import of the tiles of the current HiPS source into the offline store of HIPSManager, for use without network.
+ *
+ * Tiles are either imported from a local copy of the source, a HiPS directory tree with Norder and Dir folders, or
+ * fetched from the source for a region of the sky over a range of orders. The source may then be a local directory
+ * as well. Tiles are imported in a worker thread, until the size budget of the store is reached.
+ */
+class HIPSImporter : public QObject
+{
+  Q_OBJECT
+public:
+  explicit HIPSImporter(QObject *parent = nullptr);
+  ~HIPSImporter() override;
+
+  /** Import all the tiles of the current source found in a local HiPS directory tree */
+  bool importDirectory(const QString &path);
+  /** Import all the tiles of the source uid, with images in format, found in a local HiPS directory tree into store */
+  bool importDirectory(const QString &path, PixStore *store, qint64 uid, const QString &format);
+  /**
+   * Import the tiles of the current source within radius degrees of center, with the allsky image
+   * @param url the URL of the source, or of a local copy of it
+   * @param center the center of the region, in J2000 coordinates
+   * @param radius the radius of the region, in degrees
+   * @param minOrder the order of the largest tiles to import, 3 or more
+   * @param maxOrder the order of the smallest tiles to import, up to the order of the source
+   */
+  bool importRegion(const QUrl &url, const SkyPoint &center, double radius, int minOrder, int maxOrder);
+
+  void cancel();
+  bool isRunning() const;
+
+signals:
+  /** Progress of the import, with total 0 while tiles are being listed */
+  void progress(int done, int total, qint64 bytes, double seconds);
+  /** End of the import, with an error message if it stopped early */
+  void finished(int imported, int skipped, int failed, qint64 bytes, double seconds, const QString &error);
+
+private:
+  typedef struct
+  {
+    pixCacheKey_t key;
+    // Path of the tile relative to the source
+    QString path;
+  } tile_t;
+
+  /** Import tiles in a worker thread, listing those of the local tree at path first if it is not empty */
+  void run(const QUrl &url, const QString &path, QVector<tile_t> tiles);
+  QVector<tile_t> listDirectory(const QString &path) const;
+
+  PixStore *m_store { nullptr };
+  qint64 m_uid { 0 };
+  QString m_format;
+  QAtomicInt m_cancel { 0 };
+  QFutureWatcher<void> m_watcher;
+};
@@ -32,8 +32,10 @@
 
 #include <QTime>
 #include <QHash>
+#include <QFutureWatcher>
 #include <QNetworkDiskCache>
 #include <QPainter>
+#include <QtConcurrent>
 
 static QNetworkDiskCache *g_discCache = nullptr;
 static UrlFileDownload *g_download = nullptr;
@@ -81,6 +83,11 @@ HIPSManager::HIPSManager() : QObject(KStars::Instance())
     g_discCache->setMaximumCacheSize(Options::hIPSNetCache()*1024*1024);
     m_cache.setMaxCost(Options::hIPSMemoryCache()*1024*1024);
 
+    m_pixDiscCache.setCacheDirectory(KSPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "hips_tiles");
+    m_pixDiscCache.setMaximumCacheSize(static_cast<qint64>(Options::hIPSTileCache())*1024*1024);
+
+    m_pixStore.setStoreDirectory(KSPaths::writableLocation(QStandardPaths::GenericDataLocation) + "hips_store");
+    m_pixStore.setMaximumStoreSize(static_cast<qint64>(Options::hIPSStoreSize())*1024*1024);
 }
 
 void HIPSManager::showSettings()
@@ -112,6 +119,9 @@ void HIPSManager::showSettings()
 
 void HIPSManager::slotApply()
 {
+    m_pixDiscCache.setMaximumCacheSize(static_cast<qint64>(Options::hIPSTileCache())*1024*1024);
+    m_pixStore.setMaximumStoreSize(static_cast<qint64>(Options::hIPSStoreSize())*1024*1024);
+
     readSources();
     KStars::Instance()->repopulateHIPS();
     SkyMap::Instance()->forceUpdate();
@@ -119,7 +129,7 @@ void HIPSManager::slotApply()
 
 qint64 HIPSManager::getDiscCacheSize() const
 {
-    return g_discCache->cacheSize();
+    return g_discCache->cacheSize() + m_pixDiscCache.cacheSize();
 }
 
 void HIPSManager::readSources()
@@ -137,7 +147,7 @@ void HIPSManager::readSources()
   m_uid = qHash(param.url);  
 }*/
 
-QImage *HIPSManager::getPix(bool allsky, int level, int pix, bool &freeImage)
+QImage *HIPSManager::getPix(bool allsky, int level, int pix, QRect &rect)
 {
   if (m_currentSource.isEmpty())
   {
@@ -146,11 +156,10 @@ QImage *HIPSManager::getPix(bool allsky, int level, int pix, bool &freeImage)
   }
 
   int origPix = pix;  
-  freeImage = false;
 
   if (allsky)
   {
-    level = 0;
+    level = HIPS_ALLSKY_LEVEL;
     pix = 0;
   }
 
@@ -172,19 +181,17 @@ QImage *HIPSManager::getPix(bool allsky, int level, int pix, bool &freeImage)
 
     if (item != nullptr)
     {
+      // The quarter of the parent tile covering pix, rendered from the parent image without copy
       QImage *cacheImage = item->image;
-      int size = m_currentTileWidth >> 1;
-      int offset = cacheImage->width() / size;
-      QImage *image = cacheImage;
+      int size = cacheImage->width() >> 1;
 
       int index[4] = {0, 2, 1, 3};
 
-      int ox = index[pix % 4] % offset;
-      int oy = index[pix % 4] / offset;
+      int ox = index[pix % 4] % 2;
+      int oy = index[pix % 4] / 2;
 
-      QImage *newImage = new QImage(image->copy(ox * size, oy * size, size, size));
-      freeImage = true;
-      return newImage;
+      rect = QRect(ox * size, oy * size, size, size);
+      return cacheImage;
     }        
     return nullptr;
   }    
@@ -196,40 +203,34 @@ QImage *HIPSManager::getPix(bool allsky, int level, int pix, bool &freeImage)
     Q_ASSERT(!item->image->isNull());
 
     if (allsky && cacheImage != nullptr)
-    { // all sky
+    { // all sky, the tile is one of the 64 pixels wide tiles of the mosaic
       int size = 64;
       int offset = cacheImage->width() / size;
-      QImage *image = cacheImage;
 
       int ox = origPix % offset;
       int oy = origPix / offset;
 
-      QImage *newImage = new QImage(image->copy(ox * size, oy * size, size, size));
-      freeImage = true;
-      return newImage;
+      rect = QRect(ox * size, oy * size, size, size);
+      return cacheImage;
     }
 
+    rect = cacheImage->rect();
     return cacheImage;
   }
 
-  QString path;          
+  QUrl downloadURL(m_currentURL);
+  downloadURL.setPath(downloadURL.path() + getPixPath(allsky, level, pix, m_currentFormat));
+  m_downloadMap.insert(key);
 
-  if (!allsky)
-  {
-    int dir = (pix / 10000) * 10000;
+  // Look for the tile on disc in a worker thread, without blocking the paint, and download it if not found there
+  PixDiscCache *discCache = Options::hIPSTileCache() > 0 ? &m_pixDiscCache : nullptr;
+  PixStore *store = &m_pixStore;
+  const int tileWidth = m_currentTileWidth;
 
-    path = "/Norder" + QString::number(level) + "/Dir" + QString::number(dir) + "/Npix" + QString::number(pix) +
-           '.' + m_currentFormat;
-  }
-  else
+  watchPix(key, QtConcurrent::run(&m_decodePool, [key, tileWidth, discCache, store]()
   {
-    path = "/Norder3/Allsky." + m_currentFormat;
-  } 
-
-  QUrl downloadURL(m_currentURL);
-  downloadURL.setPath(downloadURL.path() + path);
-  g_download->begin(downloadURL, key);
-  m_downloadMap.insert(key);    
+    return loadPix(key, tileWidth, discCache, store);
+  }), downloadURL);
 
   return nullptr; 
 }
@@ -332,28 +333,23 @@ void HIPSManager::cancelAll()
 void HIPSManager::clearDiscCache()
 {
   g_discCache->clear();
+  m_pixDiscCache.clear();
 }
 
 void HIPSManager::slotDone(QNetworkReply::NetworkError error, QByteArray &data, pixCacheKey_t &key)
 {    
   if (error == QNetworkReply::NoError)
   {
-    m_downloadMap.remove(key);
-
-    auto *item = new pixCacheItem_t;
+    // Decode in a worker thread, the tile stays in the download map until then
+    PixDiscCache *discCache = Options::hIPSTileCache() > 0 ? &m_pixDiscCache : nullptr;
+    const int tileWidth = m_currentTileWidth;
+    const QByteArray image = data;
+    const pixCacheKey_t pixKey = key;
 
-    item->image = new QImage();
-    if (item->image->loadFromData(data))
-    {      
-      addToMemoryCache(key, item);
-
-      //SkyMap::Instance()->forceUpdate();
-    }
-    else
+    watchPix(key, QtConcurrent::run(&m_decodePool, [image, pixKey, tileWidth, discCache]()
     {
-      delete item;
-      qCWarning(KSTARS) << "no image" << data;
-    }
+      return decodePix(image, pixKey, tileWidth, discCache);
+    }));
   }
   else
   {
@@ -377,11 +373,108 @@ void HIPSManager::removeTimer(pixCacheKey_t &key)
   emit sigRepaint();
 }
 
+void HIPSManager::watchPix(const pixCacheKey_t &key, const QFuture<QImage *> &future, const QUrl &url)
+{
+  auto *watcher = new QFutureWatcher<QImage *>(this);
+
+  connect(watcher, &QFutureWatcher<QImage *>::finished, this, [this, watcher, key, url]()
+  {
+    pixCacheKey_t pixKey = key;
+    QImage *image = watcher->result();
+    watcher->deleteLater();
+
+    if (image == nullptr)
+    {
+      if (url.isValid())
+      {
+        // Not on disc, or not readable there, download it
+        g_download->begin(url, pixKey);
+        return;
+      }
+
+      m_downloadMap.remove(pixKey);
+      qCWarning(KSTARS) << "no image" << pixKey.level << pixKey.pix;
+      return;
+    }
+
+    m_downloadMap.remove(pixKey);
+
+    auto *item = new pixCacheItem_t;
+    item->image = image;
+    addToMemoryCache(pixKey, item);
+
+    emit sigRepaint();
+  });
+
+  watcher->setFuture(future);
+}
+
+QImage *HIPSManager::loadPix(const pixCacheKey_t &key, int tileWidth, PixDiscCache *discCache, PixStore *store)
+{
+  if (discCache != nullptr)
+  {
+    QImage *image = discCache->load(key);
+    if (image != nullptr)
+      return image;
+  }
+
+  // Opening and indexing the pack of the source may take a while the first time
+  const QByteArray data = store->read(key);
+  if (data.isEmpty())
+    return nullptr;
+
+  QImage *image = decodePix(data, key, tileWidth, discCache);
+  if (image == nullptr)
+    qCWarning(KSTARS) << "Cannot decode the stored HiPS tile" << key.level << key.pix;
+
+  return image;
+}
+
+QImage *HIPSManager::decodePix(const QByteArray &data, const pixCacheKey_t &key, int tileWidth, PixDiscCache *discCache)
+{
+  QImage image;
+
+  if (!image.loadFromData(data))
+    return nullptr;
+
+  // Tiles are kept with the width of the survey, the allsky image is a mosaic of smaller tiles
+  bool allsky = key.level == HIPS_ALLSKY_LEVEL;
+  if (!allsky && tileWidth > 0 && (image.width() != tileWidth || image.height() != tileWidth))
+    image = image.scaled(tileWidth, tileWidth, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+
+  if (discCache != nullptr)
+  {
+    // Saved in a 32-bit format, use the mapped tile, which the system may page out instead of the decoded one
+    discCache->save(key, image);
+    QImage *mapped = discCache->load(key);
+    if (mapped != nullptr)
+      return mapped;
+  }
+
+  return new QImage(image);
+}
+
 PixCache *HIPSManager::getCache()
 {
   return &m_cache;
 }
 
+PixStore *HIPSManager::getStore()
+{
+  return &m_pixStore;
+}
+
+QString HIPSManager::getPixPath(bool allsky, int level, int pix, const QString &format)
+{
+  if (allsky)
+    return "/Norder3/Allsky." + format;
+
+  int dir = (pix / 10000) * 10000;
+
+  return "/Norder" + QString::number(level) + "/Dir" + QString::number(dir) + "/Npix" + QString::number(pix) +
+         '.' + format;
+}
+
 void HIPSManager::addToMemoryCache(pixCacheKey_t &key, pixCacheItem_t *item)
 {    
   Q_ASSERT(item);
@@ -23,9 +23,13 @@
 #include "hips.h"
 #include "opships.h"
 #include "pixcache.h"
+#include "pixdisccache.h"
+#include "pixstore.h"
 #include "urlfiledownload.h"
 
+#include <QFuture>
 #include <QObject>
+#include <QThreadPool>
 
 #include <memory>
 
@@ -63,7 +67,8 @@ public:
 
   typedef enum { HIPS_EQUATORIAL_FRAME, HIPS_GALACTIC_FRAME, HIPS_OTHER_FRAME } HIPSFrame;
 
-  QImage *getPix(bool allsky, int level, int pix, bool &freeImage);
+  // Image of a tile, if available, and the part of it covering the tile in rect, the image stays owned by the cache
+  QImage *getPix(bool allsky, int level, int pix, QRect &rect);
 
   void readSources();
 
@@ -74,6 +79,7 @@ public:
   const QMap<QString,QString> & getCurrentSource() const { return m_currentSource; }
   const QList<QMap<QString,QString>> &getHIPSSources() const { return m_hipsSources; }
   PixCache *getCache();
+  PixStore *getStore();
   qint64 getDiscCacheSize() const;
   const QString &getCurrentFormat() const { return m_currentFormat; }
   HIPSFrame getCurrentFrame() const { return m_currentFrame; }
@@ -82,6 +88,9 @@ public:
   const QUrl &getCurrentURL() const { return m_currentURL; }
   qint64 getUID() const { return m_uid; }
 
+  // Path of a tile relative to the URL of its source
+  static QString getPixPath(bool allsky, int level, int pix, const QString &format);
+
 public slots:
     bool setCurrentSource(const QString &title);
     void showSettings();
@@ -101,11 +110,25 @@ private:
 
   // Cache
   PixCache m_cache;
+  // Decoded tiles on disk, when enabled
+  PixDiscCache m_pixDiscCache;
+  // Tiles imported for offline use
+  PixStore m_pixStore;
+  // Tiles being loaded, downloaded or decoded
   QSet <pixCacheKey_t> m_downloadMap;
+  // Threads decoding tiles, destroyed first to wait for them
+  QThreadPool m_decodePool;
 
   void addToMemoryCache(pixCacheKey_t &key, pixCacheItem_t *item);
   pixCacheItem_t *getCacheItem(pixCacheKey_t &key);
 
+  // Add the tile loaded or decoded in a worker thread to the memory cache, or download it from url if not found
+  void watchPix(const pixCacheKey_t &key, const QFuture<QImage *> &future, const QUrl &url = QUrl());
+  // Load a tile from the disc cache, if enabled, or from the offline store, in a worker thread, nullptr if not found
+  static QImage *loadPix(const pixCacheKey_t &key, int tileWidth, PixDiscCache *discCache, PixStore *store);
+  // Decode a downloaded tile, normalized to tileWidth unless it is the allsky image, and save it to the disc cache
+  static QImage *decodePix(const QByteArray &data, const pixCacheKey_t &key, int tileWidth, PixDiscCache *discCache);
+
   // List of all sources in the database
   QList<QMap<QString,QString>> m_hipsSources;
 
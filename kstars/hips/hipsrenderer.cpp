@@ -27,9 +27,13 @@
 #include "skyqpainter.h"
 #include "projections/projector.h"
 
+#include <QElapsedTimer>
+#include <QQueue>
+#include <QtConcurrent>
+
 HIPSRenderer::HIPSRenderer()
 {
-    m_scanRender.reset(new ScanRender());
+    m_scanRenders.emplace_back(new ScanRender());
     m_HEALpix.reset(new HEALPix());
 }
 
@@ -101,159 +105,254 @@ bool HIPSRenderer::render(uint16_t w, uint16_t h, QImage *hipsImage, const Proje
   if (size < 0)
       size = HIPSManager::Instance()->getCurrentTileWidth();
 
-  bool old = m_scanRender->isBilinearInterpolationEnabled();
-  m_scanRender->setBilinearInterpolationEnabled(Options::hIPSBiLinearInterpolation() && (size >= HIPSManager::Instance()->getCurrentTileWidth() || allSky));
+  bool bilinear = Options::hIPSBiLinearInterpolation() && (size >= HIPSManager::Instance()->getCurrentTileWidth() || allSky);
+
+  QElapsedTimer timer;
+  timer.start();
+
+  collectTiles(allSky, level, centerPix);
+
+  qint64 collectTime = timer.restart();
 
-  renderRec(allSky, level, centerPix, hipsImage);
+  // One band per core, unless they would be too thin to be worth a thread
+  int bands = qBound(1, QThread::idealThreadCount(), qMax(1, h / 32));
 
-  m_scanRender->setBilinearInterpolationEnabled(old);
+  rasterize(bands, bilinear, hipsImage);
+
+  for (tile_t &tile : m_tiles)
+  {
+    if (Options::hIPSShowGrid())
+      renderGrid(tile, hipsImage);
+  }
+
+  m_tiles.clear();
+
+  qCDebug(KSTARS) << "HiPS rendered" << m_rendered << "of" << m_blocks << "tiles in" << bands << "bands, collected in"
+                  << collectTime << "ms, rasterized in" << timer.elapsed() << "ms";
 
   return true;
 }
 
-void HIPSRenderer::renderRec(bool allsky, int level, int pix, QImage *pDest)
+void HIPSRenderer::rasterize(int bands, bool bilinear, QImage *hipsImage)
 {
-  if (m_renderedMap.contains(pix))
+  // Rasterize horizontal bands of the image in parallel, each band with its own scan renderer.
+  // Bands render all their tiles in the same order, so overlapping tiles are drawn as if rendered serially.
+  while (static_cast<int>(m_scanRenders.size()) < bands)
+    m_scanRenders.emplace_back(new ScanRender());
+
+  // Each band writes through its own image over the pixels of hipsImage, as QImage objects may not be shared by threads
+  QVector<QImage> bandImages;
+  for (int i = 0; i < bands; i++)
+    bandImages.append(QImage(hipsImage->bits(), hipsImage->width(), hipsImage->height(), hipsImage->bytesPerLine(),
+                             hipsImage->format()));
+
+  QList<QFuture<void>> futures;
+  for (int i = 0; i < bands; i++)
   {
-    return;
+    ScanRender *scanRender = m_scanRenders[i].get();
+    QImage *bandImage = &bandImages[i];
+    int top = hipsImage->height() * i / bands;
+    int bottom = hipsImage->height() * (i + 1) / bands;
+
+    scanRender->setBilinearInterpolationEnabled(bilinear);
+
+    if (i < bands - 1)
+      futures.append(QtConcurrent::run([this, scanRender, top, bottom, bandImage]()
+      {
+        renderBand(scanRender, top, bottom, bandImage);
+      }));
+    else
+      renderBand(scanRender, top, bottom, bandImage);
   }
 
-  if (renderPix(allsky, level, pix, pDest))
+  for (QFuture<void> &future : futures)
+    future.waitForFinished();
+}
+
+void HIPSRenderer::collectTiles(bool allsky, int level, int pix)
+{
+  // Breadth-first walk of the neighbours of the visible tiles
+  QQueue<int> pending;
+  pending.enqueue(pix);
+  m_renderedMap.insert(pix);
+
+  while (!pending.isEmpty())
   {
-    m_renderedMap.insert(pix);
-    int dirs[8];
-    int nside = 1 << level;
+    int current = pending.dequeue();
 
-    m_HEALpix->neighbours(nside, pix, dirs);
+    if (collectPix(allsky, level, current))
+    {
+      int dirs[8];
+      int nside = 1 << level;
+
+      m_HEALpix->neighbours(nside, current, dirs);
 
-    renderRec(allsky, level, dirs[0], pDest);
-    renderRec(allsky, level, dirs[2], pDest);
-    renderRec(allsky, level, dirs[4], pDest);
-    renderRec(allsky, level, dirs[6], pDest);
+      for (int i = 0; i < 8; i += 2)
+      {
+        if (dirs[i] >= 0 && !m_renderedMap.contains(dirs[i]))
+        {
+          m_renderedMap.insert(dirs[i]);
+          pending.enqueue(dirs[i]);
+        }
+      }
+    }
   }
 }
 
-bool HIPSRenderer::renderPix(bool allsky, int level, int pix, QImage *pDest)
+bool HIPSRenderer::collectPix(bool allsky, int level, int pix)
 {
   SkyPoint cornerSkyCoords[4];
-  QPointF cornerScreenCoords[4];
-  bool freeImage = false;
+  tile_t tile;
+
+  tile.level = level;
+  tile.pix = pix;
+  tile.image = nullptr;
 
   m_HEALpix->getCornerPoints(level, pix, cornerSkyCoords);
   bool isVisible = false;
 
   for (int i=0; i < 4; i++)
   {
-      cornerScreenCoords[i] = m_projector->toScreen(&cornerSkyCoords[i]);
+      tile.corners[i] = m_projector->toScreen(&cornerSkyCoords[i]);
       isVisible |= m_projector->checkVisibility(&cornerSkyCoords[i]);
   }  
 
   //if (SKPLANECheckFrustumToPolygon(trfGetFrustum(), pts, 4))
   // Is the right way to do this?
 
-  if (isVisible)
+  if (!isVisible)
+    return false;
+
+  m_blocks++;
+
+  // Images are only requested on this thread, as HIPSManager starts their download
+  tile.image = HIPSManager::Instance()->getPix(allsky, level, pix, tile.source);
+
+  if (tile.image)
   {
-    m_blocks++;
+    m_rendered++;
 
-    /*for (int i = 0; i < 4; i++)
-    {
-      trfProjectPointNoCheck(&pts[i]);
-    } */
+    m_size += tile.source.width() * tile.source.height() * tile.image->depth() / 8;
+
+    int childPixelID[4];
 
-    QImage *image = HIPSManager::Instance()->getPix(allsky, level, pix, freeImage);
+    // Find all the 4 children of the current pixel
+    m_HEALpix->getPixChilds(pix, childPixelID);
 
-    if (image)      
+    double minY = tile.corners[0].y();
+    double maxY = tile.corners[0].y();
+
+    int j = 0;
+    for (int id : childPixelID)
     {
-      m_rendered++;
-
-      #if QT_VERSION >= QT_VERSION_CHECK(5,10,0)
-      m_size += image->sizeInBytes();
-      #else
-      m_size += image->byteCount();
-      #endif
-
-      // UV Mapping to apply image unto the destination image
-      // 4x4 = 16 points are mapped from the source image unto the destination image.
-      // Starting from each grandchild pixel, each pix polygon is mapped accordingly.
-      // For example, pixel 357 will have 4 child pixels, each of them will have 4 childs pixels and so
-      // on. Each healpix pixel appears roughly as a diamond on the sky map.
-      // The corners points for HealPIX moves from NORTH -> EAST -> SOUTH -> WEST
-      // Hence first point is 0.25, 0.25 in UV coordinate system.
-      // Depending on the selected algorithm, the mapping will either utilize nearest neighbour
-      // or bilinear interpolation.
-      QPointF uv[16][4] = {{QPointF(.25, .25), QPointF(0.25, 0), QPointF(0, .0),QPointF(0, .25)},
-                           {QPointF(.25, .5), QPointF(0.25, 0.25), QPointF(0, .25),QPointF(0, .5)},
-                           {QPointF(.5, .25), QPointF(0.5, 0), QPointF(.25, .0),QPointF(.25, .25)},
-                           {QPointF(.5, .5), QPointF(0.5, 0.25), QPointF(.25, .25),QPointF(.25, .5)},
-
-                           {QPointF(.25, .75), QPointF(0.25, 0.5), QPointF(0, 0.5), QPointF(0, .75)},
-                           {QPointF(.25, 1), QPointF(0.25, 0.75), QPointF(0, .75),QPointF(0, 1)},
-                           {QPointF(.5, .75), QPointF(0.5, 0.5), QPointF(.25, .5),QPointF(.25, .75)},
-                           {QPointF(.5, 1), QPointF(0.5, 0.75), QPointF(.25, .75),QPointF(.25, 1)},
-
-                           {QPointF(.75, .25), QPointF(0.75, 0), QPointF(0.5, .0),QPointF(0.5, .25)},
-                           {QPointF(.75, .5), QPointF(0.75, 0.25), QPointF(0.5, .25),QPointF(0.5, .5)},
-                           {QPointF(1, .25), QPointF(1, 0), QPointF(.75, .0),QPointF(.75, .25)},
-                           {QPointF(1, .5), QPointF(1, 0.25), QPointF(.75, .25),QPointF(.75, .5)},
-
-                           {QPointF(.75, .75), QPointF(0.75, 0.5), QPointF(0.5, .5),QPointF(0.5, .75)},
-                           {QPointF(.75, 1), QPointF(0.75, 0.75), QPointF(0.5, .75),QPointF(0.5, 1)},
-                           {QPointF(1, .75), QPointF(1, 0.5), QPointF(.75, .5),QPointF(.75, .75)},
-                           {QPointF(1, 1), QPointF(1, 0.75), QPointF(.75, .75),QPointF(.75, 1)},
-                          };
-
-      int childPixelID[4];
-
-      // Find all the 4 children of the current pixel
-      m_HEALpix->getPixChilds(pix, childPixelID);
-
-      int j = 0;
-      for (int id : childPixelID)
+      int grandChildPixelID[4];
+      // Find the children of this child (i.e. grand child)
+      // Then we have 4x4 pixels under the primary pixel
+      // The image is interpolated and rendered over these pixels
+      // coordinate to minimize any distortions due to the projection
+      // system.
+      m_HEALpix->getPixChilds(id, grandChildPixelID);
+
+      for (int id2 : grandChildPixelID)
       {
-        int grandChildPixelID[4];
-        // Find the children of this child (i.e. grand child)
-        // Then we have 4x4 pixels under the primary pixel
-        // The image is interpolated and rendered over these pixels
-        // coordinate to minimize any distortions due to the projection
-        // system.
-        m_HEALpix->getPixChilds(id, grandChildPixelID);
-
-        QPointF fineScreenCoords[4];
+        SkyPoint fineSkyPoints[4];
+        m_HEALpix->getCornerPoints(level + 2, id2, fineSkyPoints);
 
-        for (int id2 : grandChildPixelID)
+        for (int i = 0; i < 4; i++)
         {
-          SkyPoint fineSkyPoints[4];
-          m_HEALpix->getCornerPoints(level + 2, id2, fineSkyPoints);
-
-          for (int i = 0; i < 4; i++)
-              fineScreenCoords[i] = m_projector->toScreen(&fineSkyPoints[i]);
-          m_scanRender->renderPolygon(3, fineScreenCoords, pDest, image, uv[j]);
-          j++;
+          tile.fine[j][i] = m_projector->toScreen(&fineSkyPoints[i]);
+          minY = qMin(minY, tile.fine[j][i].y());
+          maxY = qMax(maxY, tile.fine[j][i].y());
         }
-      }
-
-      if (freeImage)
-      {
-        delete image;
+        j++;
       }
     }
 
-    if (Options::hIPSShowGrid())
+    tile.minY = static_cast<int>(std::floor(minY));
+    tile.maxY = static_cast<int>(std::ceil(maxY));
+  }
+
+  // Tiles without image are kept for the grid
+  m_tiles.append(tile);
+
+  return true;
+}
+
+void HIPSRenderer::renderBand(ScanRender *scanRender, int top, int bottom, QImage *pDest)
+{
+  // UV Mapping to apply image unto the destination image
+  // 4x4 = 16 points are mapped from the source image unto the destination image.
+  // Starting from each grandchild pixel, each pix polygon is mapped accordingly.
+  // For example, pixel 357 will have 4 child pixels, each of them will have 4 childs pixels and so
+  // on. Each healpix pixel appears roughly as a diamond on the sky map.
+  // The corners points for HealPIX moves from NORTH -> EAST -> SOUTH -> WEST
+  // Hence first point is 0.25, 0.25 in UV coordinate system.
+  // Depending on the selected algorithm, the mapping will either utilize nearest neighbour
+  // or bilinear interpolation.
+  static const QPointF uv[16][4] = {{QPointF(.25, .25), QPointF(0.25, 0), QPointF(0, .0),QPointF(0, .25)},
+                                    {QPointF(.25, .5), QPointF(0.25, 0.25), QPointF(0, .25),QPointF(0, .5)},
+                                    {QPointF(.5, .25), QPointF(0.5, 0), QPointF(.25, .0),QPointF(.25, .25)},
+                                    {QPointF(.5, .5), QPointF(0.5, 0.25), QPointF(.25, .25),QPointF(.25, .5)},
+
+                                    {QPointF(.25, .75), QPointF(0.25, 0.5), QPointF(0, 0.5), QPointF(0, .75)},
+                                    {QPointF(.25, 1), QPointF(0.25, 0.75), QPointF(0, .75),QPointF(0, 1)},
+                                    {QPointF(.5, .75), QPointF(0.5, 0.5), QPointF(.25, .5),QPointF(.25, .75)},
+                                    {QPointF(.5, 1), QPointF(0.5, 0.75), QPointF(.25, .75),QPointF(.25, 1)},
+
+                                    {QPointF(.75, .25), QPointF(0.75, 0), QPointF(0.5, .0),QPointF(0.5, .25)},
+                                    {QPointF(.75, .5), QPointF(0.75, 0.25), QPointF(0.5, .25),QPointF(0.5, .5)},
+                                    {QPointF(1, .25), QPointF(1, 0), QPointF(.75, .0),QPointF(.75, .25)},
+                                    {QPointF(1, .5), QPointF(1, 0.25), QPointF(.75, .25),QPointF(.75, .5)},
+
+                                    {QPointF(.75, .75), QPointF(0.75, 0.5), QPointF(0.5, .5),QPointF(0.5, .75)},
+                                    {QPointF(.75, 1), QPointF(0.75, 0.75), QPointF(0.5, .75),QPointF(0.5, 1)},
+                                    {QPointF(1, .75), QPointF(1, 0.5), QPointF(.75, .5),QPointF(.75, .75)},
+                                    {QPointF(1, 1), QPointF(1, 0.75), QPointF(.75, .75),QPointF(.75, 1)},
+                                   };
+
+  scanRender->setClipRows(top, bottom);
+
+  for (const tile_t &tile : m_tiles)
+  {
+    if (tile.image == nullptr || tile.maxY < top || tile.minY >= bottom)
+      continue;
+
+    if (tile.source == tile.image->rect())
     {
-      QPainter p(pDest);
-      p.setRenderHint(QPainter::Antialiasing);
-      p.setPen(gridColor);
-
-      p.drawLine(cornerScreenCoords[0].x(), cornerScreenCoords[0].y(), cornerScreenCoords[1].x(), cornerScreenCoords[1].y());
-      p.drawLine(cornerScreenCoords[1].x(), cornerScreenCoords[1].y(), cornerScreenCoords[2].x(), cornerScreenCoords[2].y());
-      p.drawLine(cornerScreenCoords[2].x(), cornerScreenCoords[2].y(), cornerScreenCoords[3].x(), cornerScreenCoords[3].y());
-      p.drawLine(cornerScreenCoords[3].x(), cornerScreenCoords[3].y(), cornerScreenCoords[0].x(), cornerScreenCoords[0].y());
-      p.drawText((cornerScreenCoords[0].x() + cornerScreenCoords[1].x() + cornerScreenCoords[2].x() + cornerScreenCoords[3].x()) / 4,
-                         (cornerScreenCoords[0].y() + cornerScreenCoords[1].y() + cornerScreenCoords[2].y() + cornerScreenCoords[3].y()) / 4, QString::number(pix) + " / " + QString::number(level));
+      for (int j = 0; j < 16; j++)
+        scanRender->renderPolygon(3, tile.fine[j], pDest, tile.image, uv[j]);
+      continue;
     }
 
-    return true;
+    // Map the UV of the tile into the part of the image covering it, to render it without copy
+    QPointF tileUV[16][4];
+    double sx = (tile.source.width() - 1) / qMax(1.0, tile.image->width() - 1.0);
+    double sy = (tile.source.height() - 1) / qMax(1.0, tile.image->height() - 1.0);
+    double ox = tile.source.x() / qMax(1.0, tile.image->width() - 1.0);
+    double oy = tile.source.y() / qMax(1.0, tile.image->height() - 1.0);
+
+    for (int j = 0; j < 16; j++)
+    {
+      for (int i = 0; i < 4; i++)
+        tileUV[j][i] = QPointF(ox + uv[j][i].x() * sx, oy + uv[j][i].y() * sy);
+
+      scanRender->renderPolygon(3, tile.fine[j], pDest, tile.image, tileUV[j]);
+    }
   }
+}
 
-  return false;
+void HIPSRenderer::renderGrid(const tile_t &tile, QImage *pDest)
+{
+  const QPointF *cornerScreenCoords = tile.corners;
+
+  QPainter p(pDest);
+  p.setRenderHint(QPainter::Antialiasing);
+  p.setPen(gridColor);
+
+  p.drawLine(cornerScreenCoords[0].x(), cornerScreenCoords[0].y(), cornerScreenCoords[1].x(), cornerScreenCoords[1].y());
+  p.drawLine(cornerScreenCoords[1].x(), cornerScreenCoords[1].y(), cornerScreenCoords[2].x(), cornerScreenCoords[2].y());
+  p.drawLine(cornerScreenCoords[2].x(), cornerScreenCoords[2].y(), cornerScreenCoords[3].x(), cornerScreenCoords[3].y());
+  p.drawLine(cornerScreenCoords[3].x(), cornerScreenCoords[3].y(), cornerScreenCoords[0].x(), cornerScreenCoords[0].y());
+  p.drawText((cornerScreenCoords[0].x() + cornerScreenCoords[1].x() + cornerScreenCoords[2].x() + cornerScreenCoords[3].x()) / 4,
+                     (cornerScreenCoords[0].y() + cornerScreenCoords[1].y() + cornerScreenCoords[2].y() + cornerScreenCoords[3].y()) / 4, QString::number(tile.pix) + " / " + QString::number(tile.level));
 }
@@ -25,6 +25,7 @@
 #include "scanrender.h"
 
 #include <memory>
+#include <vector>
 
 class Projector;
 
@@ -35,20 +36,45 @@ public:
   explicit HIPSRenderer();
   //void render(mapView_t *view, CSkPainter *painter, QImage *pDest);
   bool render(uint16_t w, uint16_t h, QImage *hipsImage, const Projector *m_proj);
-  void renderRec(bool allsky, int level, int pix, QImage *pDest);
-  bool renderPix(bool allsky, int level, int pix, QImage *pDest);
 
 signals:
 
 public slots:
 
-private:  
+private:
+  friend class TestHIPSRenderer;
+
+  // Visible tile, with the screen coordinates of its corners and of its 4x4 grand children
+  typedef struct
+  {
+    int     level;
+    int     pix;
+    QImage *image;
+    // Part of the image covering the tile, the whole image unless it is an allsky or parent tile
+    QRect   source;
+    QPointF corners[4];
+    QPointF fine[16][4];
+    int     minY;
+    int     maxY;
+  } tile_t;
+
+  // Collect the visible tiles around pix, walking neighbours from the center of the view
+  void collectTiles(bool allsky, int level, int pix);
+  bool collectPix(bool allsky, int level, int pix);
+  // Rasterize the collected tiles into the destination, in the given number of parallel horizontal bands
+  void rasterize(int bands, bool bilinear, QImage *hipsImage);
+  // Rasterize the tiles overlapping rows top to bottom - 1 of the destination
+  void renderBand(ScanRender *scanRender, int top, int bottom, QImage *pDest);
+  void renderGrid(const tile_t &tile, QImage *pDest);
+
   int m_blocks { 0 };
   int m_rendered { 0 };
   int m_size { 0 };
   QSet<int>  m_renderedMap;
+  QVector<tile_t> m_tiles;
   std::unique_ptr<HEALPix> m_HEALpix;
-  std::unique_ptr<ScanRender> m_scanRender;
+  // One scan renderer per band of the destination rendered in parallel
+  std::vector<std::unique_ptr<ScanRender>> m_scanRenders;
   const Projector *m_projector;
   QColor gridColor;
 };
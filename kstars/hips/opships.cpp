@@ -11,6 +11,8 @@
 #include "opships.h"
 
 #include "kstars.h"
+#include "kstarsdata.h"
+#include "hipsimporter.h"
 #include "hipsmanager.h"
 #include "Options.h"
 #include "skymap.h"
@@ -23,6 +25,7 @@
 #include <QCheckBox>
 #include <QComboBox>
 #include <QFileDialog>
+#include <QProgressDialog>
 #include <QPushButton>
 #include <QStringList>
 
@@ -36,6 +39,122 @@ OpsHIPSDisplay::OpsHIPSDisplay() : QFrame(KStars::Instance())
 OpsHIPSCache::OpsHIPSCache() : QFrame(KStars::Instance())
 {
     setupUi(this);
+
+    importer = new HIPSImporter(this);
+
+    connect(importer, &HIPSImporter::progress, this, &OpsHIPSCache::slotImportProgress);
+    connect(importer, &HIPSImporter::finished, this, &OpsHIPSCache::slotImportFinished);
+
+    connect(importViewB, &QPushButton::clicked, this, &OpsHIPSCache::slotImportView);
+    connect(importDirectoryB, &QPushButton::clicked, this, &OpsHIPSCache::slotImportDirectory);
+    connect(clearStoreB, &QPushButton::clicked, this, &OpsHIPSCache::slotClearStore);
+
+    updateStoreStatus();
+}
+
+void OpsHIPSCache::slotImportView()
+{
+    SkyPoint center = SkyMap::Instance()->getCenterPoint();
+    SkyPoint j2000  = center.catalogueCoord(KStarsData::Instance()->updateNum()->julianDay());
+
+    HIPSManager::Instance()->getStore()->setMaximumStoreSize(static_cast<qint64>(kcfg_HIPSStoreSize->value()) * 1024 * 1024);
+
+    startImport(importer->importRegion(HIPSManager::Instance()->getCurrentURL(), j2000, regionRadiusSpin->value(),
+                                       minOrderSpin->value(), maxOrderSpin->value()));
+}
+
+void OpsHIPSCache::slotImportDirectory()
+{
+    QString path = QFileDialog::getExistingDirectory(this, i18n("HiPS Directory of %1",
+                   HIPSManager::Instance()->getCurrentSource().value("obs_title")));
+
+    if (path.isEmpty())
+        return;
+
+    HIPSManager::Instance()->getStore()->setMaximumStoreSize(static_cast<qint64>(kcfg_HIPSStoreSize->value()) * 1024 * 1024);
+
+    startImport(importer->importDirectory(path));
+}
+
+void OpsHIPSCache::slotClearStore()
+{
+    if (importer->isRunning())
+        return;
+
+    HIPSManager::Instance()->getStore()->clear();
+    updateStoreStatus();
+}
+
+void OpsHIPSCache::startImport(bool started)
+{
+    if (!started)
+    {
+        KSNotification::sorry(i18n("Select a HiPS source to import its tiles."));
+        return;
+    }
+
+    if (importProgress == nullptr)
+    {
+        importProgress = new QProgressDialog(this);
+        importProgress->setWindowTitle(i18n("HiPS Import"));
+        importProgress->setMinimumDuration(0);
+        connect(importProgress, &QProgressDialog::canceled, importer, &HIPSImporter::cancel);
+    }
+
+    importProgress->setLabelText(i18n("Listing tiles..."));
+    importProgress->setRange(0, 0);
+    importProgress->setValue(0);
+    importProgress->show();
+}
+
+void OpsHIPSCache::slotImportProgress(int done, int total, qint64 bytes, double seconds)
+{
+    if (importProgress == nullptr)
+        return;
+
+    if (total == 0)
+    {
+        importProgress->setLabelText(i18n("Listing tiles..."));
+        return;
+    }
+
+    importProgress->setRange(0, total);
+    importProgress->setValue(done);
+
+    if (seconds > 0)
+        importProgress->setLabelText(i18n("%1 of %2 tiles, %3 tiles/s, %4 MB/s", done, total,
+                                          QString::number(done / seconds, 'f', 1),
+                                          QString::number(bytes / seconds / (1024 * 1024), 'f', 2)));
+}
+
+void OpsHIPSCache::slotImportFinished(int imported, int skipped, int failed, qint64 bytes, double seconds,
+                                      const QString &error)
+{
+    if (importProgress != nullptr)
+        importProgress->hide();
+
+    updateStoreStatus();
+
+    QString summary = i18n("%1 tiles imported (%2 MB) in %3 seconds, %4 tiles/s. %5 tiles were already stored, %6 could not be read.",
+                           imported, QString::number(bytes / (1024.0 * 1024.0), 'f', 1), QString::number(seconds, 'f', 1),
+                           QString::number(seconds > 0 ? imported / seconds : 0, 'f', 1), skipped, failed);
+
+    if (error.isEmpty())
+        KSNotification::info(summary, i18n("HiPS Import"));
+    else
+        KSNotification::sorry(error + '\n' + summary, i18n("HiPS Import"));
+
+    // Tiles that failed to download may now be read from the store
+    SkyMap::Instance()->forceUpdate();
+}
+
+void OpsHIPSCache::updateStoreStatus()
+{
+    PixStore *store = HIPSManager::Instance()->getStore();
+
+    storeStatusLabel->setText(i18n("%1 tiles of the current source, %2 MB in total",
+                                   store->count(HIPSManager::Instance()->getUID()),
+                                   QString::number(store->storeSize() / (1024.0 * 1024.0), 'f', 1)));
 }
 
 OpsHIPS::OpsHIPS() : QFrame(KStars::Instance())
@@ -15,6 +15,8 @@
 
 class KConfigDialog;
 class FileDownloader;
+class HIPSImporter;
+class QProgressDialog;
 
 class OpsHIPSDisplay : public QFrame, public Ui::OpsHIPSDisplay
 {
@@ -30,6 +32,22 @@ class OpsHIPSCache : public QFrame, public Ui::OpsHIPSCache
 
   public:
     explicit OpsHIPSCache();
+    virtual ~OpsHIPSCache() override = default;
+
+  protected slots:
+    void slotImportView();
+    void slotImportDirectory();
+    void slotClearStore();
+    void slotImportProgress(int done, int total, qint64 bytes, double seconds);
+    void slotImportFinished(int imported, int skipped, int failed, qint64 bytes, double seconds, const QString &error);
+
+  private:
+    /** Show the progress of an import, or report that it could not start */
+    void startImport(bool started);
+    void updateStoreStatus();
+
+    HIPSImporter *importer { nullptr };
+    QProgressDialog *importProgress { nullptr };
 };
 
 /**
@@ -0,0 +1,210 @@
+/*
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "pixdisccache.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+// "HPX1", the header of a tile file, followed by the pixels
+const quint32 TILE_MAGIC = 0x48505831;
+
+struct TileHeader
+{
+  quint32 magic;
+  qint32  width;
+  qint32  height;
+  qint32  bytesPerLine;
+  qint32  format;
+  qint32  reserved[3];
+};
+
+void unmapTile(void *file)
+{
+  // Closing the file unmaps the tile
+  delete static_cast<QFile *>(file);
+}
+}
+
+void PixDiscCache::setCacheDirectory(const QString &path)
+{
+  QMutexLocker locker(&m_lock);
+
+  m_path = path;
+  m_size = -1;
+}
+
+void PixDiscCache::setMaximumCacheSize(qint64 size)
+{
+  QMutexLocker locker(&m_lock);
+
+  m_maxSize = size;
+}
+
+QImage *PixDiscCache::load(const pixCacheKey_t &key) const
+{
+  auto *file = new QFile(fileName(key));
+
+  if (!file->open(QFile::ReadOnly) || file->size() < static_cast<qint64>(sizeof(TileHeader)))
+  {
+    delete file;
+    return nullptr;
+  }
+
+  const uchar *data = file->map(0, file->size());
+  if (data == nullptr)
+  {
+    delete file;
+    return nullptr;
+  }
+
+  TileHeader header;
+  memcpy(&header, data, sizeof(header));
+
+  const qint64 size = static_cast<qint64>(header.bytesPerLine) * header.height;
+  const QImage::Format format = static_cast<QImage::Format>(header.format);
+
+  if (header.magic != TILE_MAGIC || header.width <= 0 || header.height <= 0 ||
+      header.bytesPerLine < header.width * 4 || file->size() < static_cast<qint64>(sizeof(header)) + size ||
+      (format != QImage::Format_RGB32 && format != QImage::Format_ARGB32))
+  {
+    qWarning() << "Invalid HiPS tile" << file->fileName();
+    delete file;
+    return nullptr;
+  }
+
+#if QT_VERSION >= QT_VERSION_CHECK(5,10,0)
+  // Mark the tile as used, expire() removes the tiles used last the longest ago first
+  file->setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+#endif
+
+  // The image is read-only and keeps the file mapped until it is deleted
+  return new QImage(data + sizeof(header), header.width, header.height, header.bytesPerLine, format, unmapTile, file);
+}
+
+void PixDiscCache::save(const pixCacheKey_t &key, const QImage &image)
+{
+  const QImage tile = image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+
+  if (tile.isNull())
+    return;
+
+  TileHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic        = TILE_MAGIC;
+  header.width        = tile.width();
+  header.height       = tile.height();
+  header.bytesPerLine = tile.bytesPerLine();
+  header.format       = tile.format();
+
+  const QString name = fileName(key);
+  QDir().mkpath(QFileInfo(name).path());
+
+  // Tiles are written to a temporary file first, so that they are never mapped partially written
+  QSaveFile file(name);
+  if (!file.open(QFile::WriteOnly))
+    return;
+
+  const qint64 size = static_cast<qint64>(header.bytesPerLine) * header.height;
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(tile.constBits()), size);
+  if (!file.commit())
+    return;
+
+  QMutexLocker locker(&m_lock);
+
+  scan();
+  m_size += sizeof(header) + size;
+
+  if (m_maxSize > 0 && m_size > m_maxSize)
+    expire();
+}
+
+qint64 PixDiscCache::cacheSize() const
+{
+  QMutexLocker locker(&m_lock);
+
+  scan();
+  return m_size;
+}
+
+void PixDiscCache::clear()
+{
+  QMutexLocker locker(&m_lock);
+
+  if (!m_path.isEmpty())
+    QDir(m_path).removeRecursively();
+  m_size = 0;
+}
+
+QString PixDiscCache::fileName(const pixCacheKey_t &key) const
+{
+  QMutexLocker locker(&m_lock);
+
+  return QString("%1/%2/Norder%3/Npix%4.tile").arg(m_path).arg(key.uid).arg(key.level).arg(key.pix);
+}
+
+void PixDiscCache::scan() const
+{
+  if (m_size >= 0)
+    return;
+
+  m_size = 0;
+
+  QDirIterator it(m_path, QStringList() << "*.tile", QDir::Files, QDirIterator::Subdirectories);
+  while (it.hasNext())
+  {
+    it.next();
+    m_size += it.fileInfo().size();
+  }
+}
+
+void PixDiscCache::expire()
+{
+  QFileInfoList files;
+
+  QDirIterator it(m_path, QStringList() << "*.tile", QDir::Files, QDirIterator::Subdirectories);
+  while (it.hasNext())
+  {
+    it.next();
+    files.append(it.fileInfo());
+  }
+
+  std::sort(files.begin(), files.end(), [](const QFileInfo &a, const QFileInfo &b)
+  {
+    return a.lastModified() < b.lastModified();
+  });
+
+  const qint64 goal = m_maxSize - m_maxSize / 10;
+  for (const QFileInfo &info : files)
+  {
+    if (m_size <= goal)
+      break;
+
+    // Tiles still mapped are removed once unmapped on most systems, or kept for the next expiry
+    if (QFile::remove(info.filePath()))
+      m_size -= info.size();
+  }
+}
@@ -0,0 +1,62 @@
+/*
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#pragma once
+
+#include "hips.h"
+
+#include <QMutex>
+
+/**
+ * @class PixDiscCache
+ *
+ * Second level cache of decoded HiPS tiles on hard disk, behind the memory cache PixCache.
+ *
+ * Tiles are stored uncompressed, as 32-bit pixels, so that they are loaded by memory-mapping their file
+ * instead of decoding the JPEG or PNG image again. The least recently used tiles are removed when the cache
+ * grows over its maximum size: the modification time of a tile is updated when it is loaded, so that it
+ * is the time of its last use. With Qt older than 5.10, it stays the time the tile was saved, and the
+ * oldest tiles are removed first. All functions may be called from any thread.
+ */
+class PixDiscCache
+{
+public:
+  PixDiscCache() = default;
+
+  void setCacheDirectory(const QString &path);
+  void setMaximumCacheSize(qint64 size);
+
+  /** @return the tile memory-mapped from the cache, or nullptr if it is not cached */
+  QImage *load(const pixCacheKey_t &key) const;
+  /** Store a tile in the cache, converted to a 32-bit format if needed */
+  void save(const pixCacheKey_t &key, const QImage &image);
+
+  qint64 cacheSize() const;
+  void clear();
+
+private:
+  QString fileName(const pixCacheKey_t &key) const;
+  /** Scan the size of the cache if unknown, with the lock held */
+  void scan() const;
+  /** Remove the least recently used tiles until the cache is 10% under its maximum size, with the lock held */
+  void expire();
+
+  mutable QMutex m_lock;
+  QString m_path;
+  qint64 m_maxSize { 0 };
+  // Size of the cache in bytes, -1 until scanned
+  mutable qint64 m_size { -1 };
+};
@@ -0,0 +1,323 @@
+/*
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "pixstore.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QSaveFile>
+
+namespace
+{
+// "HPK1", the header of each tile in a pack, followed by its level, pix and size
+const quint32 RECORD_MAGIC = 0x48504B31;
+// "HPI1", the header of an index, followed by the size of the pack it indexes
+const quint32 INDEX_MAGIC = 0x48504931;
+
+struct RecordHeader
+{
+  quint32 magic;
+  qint32  level;
+  qint32  pix;
+  qint32  size;
+};
+}
+
+void PixStore::setStoreDirectory(const QString &path)
+{
+  QMutexLocker locker(&m_lock);
+
+  m_path = path;
+  m_size = -1;
+  m_packs.clear();
+}
+
+void PixStore::setMaximumStoreSize(qint64 size)
+{
+  QMutexLocker locker(&m_lock);
+
+  m_maxSize = size;
+}
+
+qint64 PixStore::getMaximumStoreSize() const
+{
+  QMutexLocker locker(&m_lock);
+
+  return m_maxSize;
+}
+
+bool PixStore::contains(const pixCacheKey_t &key) const
+{
+  QMutexLocker locker(&m_lock);
+
+  Pack *p = pack(key.uid);
+  return p != nullptr && p->index.contains(tileId(key));
+}
+
+QByteArray PixStore::read(const pixCacheKey_t &key) const
+{
+  QMutexLocker locker(&m_lock);
+
+  Pack *p = pack(key.uid);
+  if (p == nullptr)
+    return QByteArray();
+
+  auto entry = p->index.constFind(tileId(key));
+  if (entry == p->index.constEnd())
+    return QByteArray();
+
+  // Map the pack again when tiles were appended after it was mapped
+  if (p->map == nullptr || entry->offset + entry->size > p->mapSize)
+  {
+    if (p->map != nullptr)
+      p->file.unmap(const_cast<uchar *>(p->map));
+
+    p->mapSize = p->file.size();
+    p->map = p->file.map(0, p->mapSize);
+    if (p->map == nullptr)
+      return QByteArray();
+  }
+
+  return QByteArray(reinterpret_cast<const char *>(p->map + entry->offset), entry->size);
+}
+
+bool PixStore::write(const pixCacheKey_t &key, const QByteArray &data)
+{
+  QMutexLocker locker(&m_lock);
+
+  Pack *p = pack(key.uid, true);
+  if (p == nullptr)
+    return false;
+
+  const quint64 id = tileId(key);
+  if (p->index.contains(id))
+    return true;
+
+  scan();
+  const qint64 size = sizeof(RecordHeader) + data.size();
+  if (m_maxSize > 0 && m_size + size > m_maxSize)
+    return false;
+
+  // Some systems do not extend mapped files, the pack is mapped again by the next read
+  if (p->map != nullptr)
+  {
+    p->file.unmap(const_cast<uchar *>(p->map));
+    p->map = nullptr;
+  }
+
+  RecordHeader header;
+  header.magic = RECORD_MAGIC;
+  header.level = key.level;
+  header.pix   = key.pix;
+  header.size  = data.size();
+
+  const qint64 offset = p->file.size();
+  if (!p->file.seek(offset) ||
+      p->file.write(reinterpret_cast<const char *>(&header), sizeof(header)) != sizeof(header) ||
+      p->file.write(data) != data.size() || !p->file.flush())
+  {
+    // Drop a partial record, so that the pack stays readable
+    p->file.resize(offset);
+    return false;
+  }
+
+  entry_t entry;
+  entry.offset = offset + sizeof(header);
+  entry.size   = data.size();
+  p->index.insert(id, entry);
+  p->dirty = true;
+
+  m_size += size;
+  return true;
+}
+
+void PixStore::flush()
+{
+  QMutexLocker locker(&m_lock);
+
+  for (auto it = m_packs.begin(); it != m_packs.end(); ++it)
+  {
+    if (it.value() && it.value()->dirty)
+      saveIndex(it.value().get(), QString("%1/%2.idx").arg(m_path).arg(it.key()));
+  }
+}
+
+int PixStore::count(qint64 uid) const
+{
+  QMutexLocker locker(&m_lock);
+
+  Pack *p = pack(uid);
+  return p != nullptr ? p->index.size() : 0;
+}
+
+qint64 PixStore::storeSize() const
+{
+  QMutexLocker locker(&m_lock);
+
+  scan();
+  return m_size;
+}
+
+void PixStore::clear()
+{
+  QMutexLocker locker(&m_lock);
+
+  m_packs.clear();
+  if (!m_path.isEmpty())
+    QDir(m_path).removeRecursively();
+  m_size = 0;
+}
+
+PixStore::Pack *PixStore::pack(qint64 uid, bool create) const
+{
+  auto it = m_packs.constFind(uid);
+  if (it != m_packs.constEnd() && (it.value() || !create))
+    return it.value().get();
+
+  const QString packName = QString("%1/%2.pack").arg(m_path).arg(uid);
+
+  // Sources without pack are remembered, so that looking up their tiles costs no file access
+  if (m_path.isEmpty() || (!create && !QFile::exists(packName)))
+  {
+    m_packs.insert(uid, std::shared_ptr<Pack>());
+    return nullptr;
+  }
+
+  if (!QDir().mkpath(m_path))
+    return nullptr;
+
+  std::shared_ptr<Pack> p = std::make_shared<Pack>();
+  p->file.setFileName(packName);
+
+  if (!p->file.open(QFile::ReadWrite))
+  {
+    qWarning() << "Cannot open HiPS store" << p->file.fileName();
+    return nullptr;
+  }
+
+  const QString indexName = QString("%1/%2.idx").arg(m_path).arg(uid);
+  if (!loadIndex(p.get(), indexName))
+  {
+    scanPack(p.get());
+    if (!p->index.isEmpty())
+      saveIndex(p.get(), indexName);
+  }
+
+  m_packs.insert(uid, p);
+  return p.get();
+}
+
+bool PixStore::loadIndex(Pack *pack, const QString &indexName) const
+{
+  QFile file(indexName);
+  if (!file.open(QFile::ReadOnly))
+    return false;
+
+  QDataStream in(&file);
+  quint32 magic = 0;
+  qint64 packSize = -1;
+  qint32 count = 0;
+
+  in >> magic >> packSize >> count;
+
+  // An index is only valid for the pack it was saved with
+  if (magic != INDEX_MAGIC || packSize != pack->file.size() || count < 0)
+    return false;
+
+  pack->index.reserve(count);
+  for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; i++)
+  {
+    quint64 id;
+    entry_t entry;
+
+    in >> id >> entry.offset >> entry.size;
+    pack->index.insert(id, entry);
+  }
+
+  if (in.status() != QDataStream::Ok)
+  {
+    pack->index.clear();
+    return false;
+  }
+
+  return true;
+}
+
+void PixStore::scanPack(Pack *pack) const
+{
+  const qint64 size = pack->file.size();
+  qint64 offset = 0;
+
+  pack->index.clear();
+  while (offset + static_cast<qint64>(sizeof(RecordHeader)) <= size)
+  {
+    RecordHeader header;
+
+    if (!pack->file.seek(offset) ||
+        pack->file.read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header) ||
+        header.magic != RECORD_MAGIC || header.size < 0 || offset + sizeof(header) + header.size > size)
+      break;
+
+    pixCacheKey_t key { header.level, header.pix, 0 };
+    entry_t entry;
+    entry.offset = offset + sizeof(header);
+    entry.size   = header.size;
+    pack->index.insert(tileId(key), entry);
+
+    offset += sizeof(header) + header.size;
+  }
+
+  // Drop the end of a pack that was not completely written
+  if (offset < size)
+  {
+    qWarning() << "Truncating HiPS store" << pack->file.fileName() << "at" << offset;
+    pack->file.resize(offset);
+    m_size = -1;
+  }
+}
+
+void PixStore::saveIndex(Pack *pack, const QString &indexName) const
+{
+  QSaveFile file(indexName);
+  if (!file.open(QFile::WriteOnly))
+    return;
+
+  QDataStream out(&file);
+  out << INDEX_MAGIC << pack->file.size() << static_cast<qint32>(pack->index.size());
+
+  for (auto it = pack->index.constBegin(); it != pack->index.constEnd(); ++it)
+    out << it.key() << it->offset << it->size;
+
+  if (file.commit())
+    pack->dirty = false;
+}
+
+void PixStore::scan() const
+{
+  if (m_size >= 0)
+    return;
+
+  m_size = 0;
+
+  QDirIterator it(m_path, QStringList() << "*.pack", QDir::Files);
+  while (it.hasNext())
+  {
+    it.next();
+    m_size += it.fileInfo().size();
+  }
+}
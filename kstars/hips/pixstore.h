@@ -0,0 +1,94 @@
+/*
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#pragma once
+
+#include "hips.h"
+
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+
+#include <memory>
+
+/**
+ * @class PixStore
+ *
+ * Local store of HiPS tiles imported for offline use, which HIPSManager reads before downloading tiles.
+ *
+ * The tiles of each source are appended, as downloaded, to a single pack file, with an index of their offsets.
+ * The index is saved next to the pack by flush(), and rebuilt from the pack if it is missing or out of date.
+ * Tiles are read from the memory-mapped pack. The store never grows over its maximum size, and tiles are only
+ * removed by clear(). All functions may be called from any thread. The first access to a source opens and indexes
+ * its pack, which may scan the whole pack, so HIPSManager only reads the store from its decoding threads.
+ */
+class PixStore
+{
+public:
+  PixStore() = default;
+
+  void setStoreDirectory(const QString &path);
+  void setMaximumStoreSize(qint64 size);
+  qint64 getMaximumStoreSize() const;
+
+  bool contains(const pixCacheKey_t &key) const;
+  /** @return the JPEG or PNG data of a tile, empty if the tile is not stored */
+  QByteArray read(const pixCacheKey_t &key) const;
+  /** Append a tile, @return false if the store is full or the tile could not be written */
+  bool write(const pixCacheKey_t &key, const QByteArray &data);
+  /** Save the indexes of the packs written to */
+  void flush();
+
+  /** @return the number of tiles stored for a source */
+  int count(qint64 uid) const;
+  qint64 storeSize() const;
+  void clear();
+
+private:
+  typedef struct
+  {
+    qint64 offset;
+    qint32 size;
+  } entry_t;
+
+  // Pack of the tiles of a source
+  class Pack
+  {
+  public:
+    QFile file;
+    const uchar *map { nullptr };
+    qint64 mapSize { 0 };
+    QHash<quint64, entry_t> index;
+    bool dirty { false };
+  };
+
+  static quint64 tileId(const pixCacheKey_t &key) { return (quint64(key.level) << 32) | quint32(key.pix); }
+
+  /** @return the pack of a source, opened and indexed if needed, or created if requested, with the lock held */
+  Pack *pack(qint64 uid, bool create = false) const;
+  bool loadIndex(Pack *pack, const QString &indexName) const;
+  void scanPack(Pack *pack) const;
+  void saveIndex(Pack *pack, const QString &indexName) const;
+  /** Scan the size of the store if unknown, with the lock held */
+  void scan() const;
+
+  mutable QMutex m_lock;
+  QString m_path;
+  qint64 m_maxSize { 0 };
+  // Size of the store in bytes, -1 until scanned
+  mutable qint64 m_size { -1 };
+  mutable QHash<qint64, std::shared_ptr<Pack>> m_packs;
+};
@@ -66,6 +66,16 @@ void ScanRender::resetScanPoly(int sx, int sy)
 
   m_sx = sx;
   m_sy = sy;
+  m_top = qMax(0, m_clipTop);
+  m_bottom = qMin(sy, m_clipBottom);
+}
+
+/////////////////////////////////////////////////
+void ScanRender::setClipRows(int top, int bottom)
+/////////////////////////////////////////////////
+{
+  m_clipTop = top;
+  m_clipBottom = bottom;
 }
 
 //////////////////////////////////////////////////////////
@@ -85,12 +95,12 @@ void ScanRender::scanLine(int x1, int y1, int x2, int y2)
     side = 1;
   }
 
-  if (y2 < 0)
+  if (y2 < m_top)
   {
     return; // offscreen
   }
 
-  if (y1 >= m_sy)
+  if (y1 >= m_bottom)
   {
     return; // offscreen
   }
@@ -106,17 +116,17 @@ void ScanRender::scanLine(int x1, int y1, int x2, int y2)
   float x = x1;
   int   y;
 
-  if (y2 >= m_sy)
+  if (y2 >= m_bottom)
   {
-    y2 = m_sy - 1;
+    y2 = m_bottom - 1;
   }
 
-  if (y1 < 0)
+  if (y1 < m_top)
   { // partially off screen
-    float m = (float) -y1;
+    float m = (float) (m_top - y1);
 
     x += dx * m;
-    y1 = 0;
+    y1 = m_top;
   }
 
   int minY = qMin(y1, y2);
@@ -180,9 +190,9 @@ void ScanRender::scanLine(int x1, int y1, int x2, int y2, float u1, float v1, fl
     side = 1;
   }
 
-  if (y2 < 0)
+  if (y2 < m_top)
     return; // offscreen
-  if (y1 >= m_sy)
+  if (y1 >= m_bottom)
     return; // offscreen
 
   float dy = (float)(y2 - y1);
@@ -194,8 +204,8 @@ void ScanRender::scanLine(int x1, int y1, int x2, int y2, float u1, float v1, fl
   float x = x1;
   int   y;
 
-  if (y2 >= m_sy)
-    y2 = m_sy - 1;
+  if (y2 >= m_bottom)
+    y2 = m_bottom - 1;
 
   float duv[2];
   float uv[2] = {u1, v1};
@@ -203,15 +213,15 @@ void ScanRender::scanLine(int x1, int y1, int x2, int y2, float u1, float v1, fl
   duv[0] = (u2 - u1) / dy;
   duv[1] = (v2 - v1) / dy;
 
-  if (y1 < 0)
+  if (y1 < m_top)
   { // partially off screen
-    float m = (float) -y1;
+    float m = (float) (m_top - y1);
 
     uv[0] += duv[0] * m;
     uv[1] += duv[1] * m;
 
     x += dx * m;
-    y1 = 0;
+    y1 = m_top;
   }
 
   int minY = qMin(y1, y2);
@@ -345,7 +355,7 @@ void ScanRender::renderPolygon(QImage *dst, QImage *src)
     renderPolygonNI(dst, src);
 }
 
-void ScanRender::renderPolygon(int interpolation, QPointF *pts, QImage *pDest, QImage *pSrc, QPointF *uv)
+void ScanRender::renderPolygon(int interpolation, const QPointF *pts, QImage *pDest, QImage *pSrc, const QPointF *uv)
 {
   QPointF Auv = uv[0];
   QPointF Buv = uv[1];
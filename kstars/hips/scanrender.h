@@ -39,11 +39,13 @@ class ScanRender
     void setBilinearInterpolationEnabled(bool enable);
     bool isBilinearInterpolationEnabled(void);
     void resetScanPoly(int sx, int sy);
+    // Only rasterize rows top to bottom - 1 of the destination, so that bands of it may be rendered in parallel
+    void setClipRows(int top, int bottom);
     void scanLine(int x1, int y1, int x2, int y2);
     void scanLine(int x1, int y1, int x2, int y2, float u1, float v1, float u2, float v2);
     void renderPolygon(QColor col, QImage *dst);
     void renderPolygon(QImage *dst, QImage *src);
-    void renderPolygon(int interpolation, QPointF *pts, QImage *pDest, QImage *pSrc, QPointF *uv);
+    void renderPolygon(int interpolation, const QPointF *pts, QImage *pDest, QImage *pSrc, const QPointF *uv);
 
     void renderPolygonNI(QImage *dst, QImage *src);
     void renderPolygonBI(QImage *dst, QImage *src);
@@ -61,6 +63,11 @@ private:
     int      plMaxY { 0 };
     int      m_sx { 0 };
     int      m_sy { 0 };
+    int      m_clipTop { 0 };
+    int      m_clipBottom { MAX_BK_SCANLINES };
+    // Rows rasterized, the clip rows within the destination
+    int      m_top { 0 };
+    int      m_bottom { 0 };
     bkScan_t scLR[MAX_BK_SCANLINES];
     bool     bBilinear { false };
 };
@@ -479,6 +479,11 @@ class KStars : public KXmlGuiWindow
              */
         Q_SCRIPTABLE QString getObservingSessionPlanObjectNames();
 
+        /** DBUS interface function.  Return the counters of the cache of deep star blocks.
+             * @return a newline-separated list of key=value pairs, such as hits, misses, evictions and bytes.
+             */
+        Q_SCRIPTABLE QString getStarCacheStatistics();
+
         /** DBUS interface function.  Print the sky image.
              * @param usePrintDialog if true, the KDE print dialog will be shown; otherwise, default parameters will be used
              * @param useChartColors if true, the "Star Chart" color scheme will be used for the printout, which will save ink.
@@ -29,6 +29,7 @@
 #include "skymap.h"
 #include "skycomponents/constellationboundarylines.h"
 #include "skycomponents/skymapcomposite.h"
+#include "skycomponents/starblockfactory.h"
 #include "skyobjects/deepskyobject.h"
 #include "skyobjects/ksplanetbase.h"
 #include "skyobjects/starobject.h"
@@ -961,6 +962,24 @@ QString KStars::getObservingSessionPlanObjectNames()
     return output;
 }
 
+QString KStars::getStarCacheStatistics()
+{
+    const StarBlockFactory::Statistics stats = StarBlockFactory::Instance()->statistics();
+    QString output;
+
+    output.append(QString("hits=%1\n").arg(stats.hits));
+    output.append(QString("misses=%1\n").arg(stats.misses));
+    output.append(QString("prefetched=%1\n").arg(stats.prefetched));
+    output.append(QString("wasted=%1\n").arg(stats.wasted));
+    output.append(QString("evictions=%1\n").arg(stats.evictions));
+    output.append(QString("blocks=%1\n").arg(stats.blocks));
+    output.append(QString("usedBlocks=%1\n").arg(stats.usedBlocks));
+    output.append(QString("pinnedBlocks=%1\n").arg(stats.pinnedBlocks));
+    output.append(QString("bytes=%1\n").arg(stats.bytes));
+    output.append(QString("budget=%1\n").arg(stats.budget));
+    return output;
+}
+
 void KStars::setApproxFOV(double FOV_Degrees)
 {
     zoom(map()->width() / (FOV_Degrees * dms::DegToRad));
@@ -30,6 +30,7 @@
 #include "widgets/timespinbox.h"
 #include "widgets/timestepbox.h"
 #include "hips/hipsmanager.h"
+#include "dialogs/finddialog.h"
 #include "auxiliary/thememanager.h"
 
 #ifdef HAVE_INDI
@@ -807,6 +808,9 @@ void KStars::datainitFinished()
     // Connect cache function for Find dialog
     connect(data(), SIGNAL(clearCache()), this, SLOT(clearCachedFindDialog()));
 
+    // Index the object names for the Find dialog in the background
+    FindDialog::Instance();
+
     //Propagate config settings
     applyConfig(false);
 
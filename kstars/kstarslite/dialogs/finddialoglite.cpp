@@ -145,6 +145,10 @@ void FindDialogLite::selectObject(int index)
 {
     QVariant sObj     = m_sortModel->data(m_sortModel->index(index, 0), SkyObjectListModel::SkyObjectRole);
     SkyObject *skyObj = (SkyObject *)sObj.value<void *>();
+
+    // Large custom catalogs list the names of objects they have not loaded yet, which are loaded by name
+    if (!skyObj)
+        skyObj = KStarsData::Instance()->skyComposite()->findByName(m_sortModel->data(m_sortModel->index(index, 0)).toString());
     SkyMapLite::Instance()->slotSelectObject(skyObj);
 }
 
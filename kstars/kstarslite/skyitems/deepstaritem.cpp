@@ -121,10 +121,6 @@ void DeepStarItem::update()
         if (hideFaintStars && maglim > hideStarsMag)
             maglim = hideStarsMag;
 
-        StarBlockFactory *m_StarBlockFactory = StarBlockFactory::Instance();
-        //    m_StarBlockFactory->drawID = m_skyMesh->drawID();
-        //    qDebug() << "Mesh size = " << m_skyMesh->size() << "; drawID = " << m_skyMesh->drawID();
-
         /*t_dynamicLoad = 0;
         t_updateCache = 0;
         t_drawUnnamed = 0;*/
@@ -154,8 +150,6 @@ void DeepStarItem::update()
             //            region.reset();
         }
 
-        m_StarBlockFactory->drawID = m_skyMesh->drawID();
-
         int regionID = -1;
         if (region.hasNext())
         {
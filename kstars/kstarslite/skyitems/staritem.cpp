@@ -145,8 +145,6 @@ void StarItem::update()
     if (hideFaintStars && maglim > hideStarsMag)
         maglim = hideStarsMag;
 
-    m_StarBlockFactory->drawID = m_skyMesh->drawID();
-
     int regionID = -1;
     if (region.hasNext())
     {
@@ -258,7 +258,8 @@ bool  BinaryListComponent<T, Component>::dropText()
 template<class T, typename Component>
 void  BinaryListComponent<T, Component>::clearData()
 {
-    // Clear lists
+    // Clear lists, dropping the names of the objects before they are deleted
+    parent->unindexNames();
     qDeleteAll(parent->m_ObjectList);
     parent->m_ObjectList.clear();
     parent->m_ObjectHash.clear();
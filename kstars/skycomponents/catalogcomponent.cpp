@@ -19,10 +19,36 @@
 
 #include "catalogdata.h"
 #include "kstarsdata.h"
+#include "skymesh.h"
 #include "skypainter.h"
+#include "htmesh/MeshIterator.h"
 #include "skyobjects/starobject.h"
 #include "skyobjects/deepskyobject.h"
 #include "skycomponents/deepskycomponent.h"
+#include "skycomponents/skymapcomposite.h"
+#ifndef KSTARS_LITE
+#include "skymap.h"
+#endif
+
+#include "kstars_debug.h"
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+namespace
+{
+// Catalogs with more objects than this are loaded on demand
+const int ON_DEMAND_OBJECTS = 100000;
+
+// Trixels loaded at once by the worker thread, the others are loaded when the results are drawn
+const int TRIXELS_PER_LOAD = 16;
+
+// Objects of a catalog loaded on demand kept loaded, beyond which the least recently drawn trixels are unloaded
+const int MAX_LOADED_OBJECTS = ON_DEMAND_OBJECTS;
+}
 
 CatalogComponent::CatalogComponent(SkyComposite *parent, const QString &catname, bool showerrs, int index,
                                    bool callLoadData)
@@ -34,6 +60,9 @@ CatalogComponent::CatalogComponent(SkyComposite *parent, const QString &catname,
 
 CatalogComponent::~CatalogComponent()
 {
+    // The objects are deleted by ListComponent, but those of a pending load are not in the list yet
+    clearTrixels();
+
     // EH? WHY IS THIS EMPTY? -- AS
 
     // FIXME: Check this and implement it properly when you're not as
@@ -56,8 +85,256 @@ CatalogComponent::~CatalogComponent()
     */
 }
 
+void CatalogComponent::loadData()
+{
+    // The trixels of the catalog database must be those of the map
+    SkyMesh *skyMesh = SkyMesh::Instance();
+    if (skyMesh && skyMesh->level() == CatalogDB::TRIXEL_LEVEL &&
+        KStarsData::Instance()->catalogdb()->GetObjectCount(m_catName) > ON_DEMAND_OBJECTS)
+        _loadOnDemand();
+    else
+        _loadData(true);
+}
+
+void CatalogComponent::_loadOnDemand()
+{
+    emitProgressText(i18n("Loading custom catalog: %1", m_catName));
+
+    CatalogDB *catalogDB = KStarsData::Instance()->catalogdb();
+
+    unindexNames();
+    clearTrixels();
+    qDeleteAll(m_ObjectList);
+    m_ObjectList.clear();
+    m_ObjectHash.clear();
+    m_LoadOnDemand = true;
+    m_CatalogId    = catalogDB->FindCatalog(m_catName);
+
+    // The names are listed and indexed without the objects, which findByName() loads when looked up
+    QList<QPair<int, QString>> names;
+    m_NameTrixels.clear();
+    catalogDB->GetObjectNames(m_catName, names, m_NameTrixels);
+
+    // Names already listed for each type, so that the lists have no duplicates, as in _loadData()
+    QHash<int, QSet<QString>> listed;
+    for (const auto &name : names)
+    {
+        if (name.first > SkyObject::TYPE_UNKNOWN)
+            continue;
+
+        auto listedNames = listed.find(name.first);
+        if (listedNames == listed.end())
+        {
+            listedNames = listed.insert(name.first, QSet<QString>());
+            for (const auto &object : objectLists(name.first))
+                listedNames->insert(object.first);
+        }
+
+        if (!listedNames->contains(name.second))
+        {
+            listedNames->insert(name.second);
+            objectLists(name.first).append(QPair<QString, const SkyObject *>(name.second, nullptr));
+        }
+
+        objectNames(name.first).append(name.second);
+        indexDeferredName(name.second, name.first);
+    }
+
+    for (auto &list : objectNames())
+        list.removeDuplicates();
+
+    qCInfo(KSTARS) << "Custom catalog" << m_catName << "is loaded on demand," << names.size() << "names indexed";
+    loadCatalogData();
+}
+
+void CatalogComponent::loadTrixels(const QVector<Trixel> &trixels)
+{
+    if (!m_TrixelLoader)
+    {
+        m_TrixelLoader.reset(new QFutureWatcher<TrixelObjects>());
+        QObject::connect(m_TrixelLoader.get(), &QFutureWatcher<TrixelObjects>::finished, m_TrixelLoader.get(),
+                         [this]()
+        {
+            trixelsLoaded();
+        });
+    }
+
+    // The worker only passes the catalog to the objects it creates
+    const QString dbFile      = KStarsData::Instance()->catalogdb()->DatabaseFile();
+    const int catalogId       = m_CatalogId;
+    CatalogComponent *catalog = this;
+
+    m_PendingTrixels = trixels;
+    m_TrixelLoader->setFuture(QtConcurrent::run([dbFile, catalogId, trixels, catalog]()
+    {
+        TrixelObjects objects;
+        CatalogDB::GetObjectsInTrixels(dbFile, catalogId, trixels, objects, catalog);
+        return objects;
+    }));
+}
+
+void CatalogComponent::trixelsLoaded()
+{
+    // The results may have been added already by findByName()
+    if (m_PendingTrixels.isEmpty() || !m_TrixelLoader->isFinished())
+        return;
+
+    m_PendingTrixels.clear();
+    addTrixelObjects(m_TrixelLoader->result());
+
+#ifndef KSTARS_LITE
+    // Draw again with the objects loaded, and load the next trixels of the region if any
+    if (SkyMap::Instance())
+        SkyMap::Instance()->forceUpdate();
+#endif
+}
+
+void CatalogComponent::addTrixelObjects(const TrixelObjects &objects)
+{
+    for (auto trixel = objects.constBegin(); trixel != objects.constEnd(); ++trixel)
+    {
+        // Trixels loaded meanwhile by findByName()
+        if (m_TrixelObjects.contains(trixel.key()))
+        {
+            qDeleteAll(trixel.value());
+            continue;
+        }
+
+        m_TrixelObjects.insert(trixel.key(), trixel.value());
+        m_TrixelDrawn.insert(trixel.key(), m_DrawCount);
+        m_LoadedObjects += trixel.value().size();
+
+        // The names of the objects are already in the name index, see findByName()
+        for (auto obj : trixel.value())
+        {
+            m_ObjectList.append(obj);
+            m_ObjectHash.insert(obj->name().toLower(), obj);
+            if (!obj->longname().isEmpty())
+                m_ObjectHash.insert(obj->longname().toLower(), obj);
+        }
+    }
+}
+
+void CatalogComponent::unloadTrixels()
+{
+    if (m_LoadedObjects <= MAX_LOADED_OBJECTS)
+        return;
+
+    // Objects the sky map refers to stay loaded
+    QSet<const SkyObject *> used;
+    for (auto obj : KStarsData::Instance()->skyComposite()->labelObjects())
+        used.insert(obj);
+#ifndef KSTARS_LITE
+    if (SkyMap::Instance())
+    {
+        used.insert(SkyMap::Instance()->clickedObject());
+        used.insert(SkyMap::Instance()->focusObject());
+    }
+#endif
+
+    // Least recently drawn first, the trixels of the current draw are kept
+    QVector<QPair<quint64, Trixel>> trixels;
+    for (auto drawn = m_TrixelDrawn.constBegin(); drawn != m_TrixelDrawn.constEnd(); ++drawn)
+    {
+        if (drawn.value() < m_DrawCount)
+            trixels.append(qMakePair(drawn.value(), drawn.key()));
+    }
+    std::sort(trixels.begin(), trixels.end());
+
+    QSet<SkyObject *> unloaded;
+    for (const auto &trixel : trixels)
+    {
+        if (m_LoadedObjects <= MAX_LOADED_OBJECTS)
+            break;
+
+        const QList<SkyObject *> objects = m_TrixelObjects.value(trixel.second);
+        if (std::any_of(objects.begin(), objects.end(), [&used](SkyObject *obj) { return used.contains(obj); }))
+            continue;
+
+        for (auto obj : objects)
+        {
+            unloaded.insert(obj);
+            for (const QString &name : { obj->name().toLower(), obj->longname().toLower() })
+            {
+                if (m_ObjectHash.value(name) == obj)
+                    m_ObjectHash.remove(name);
+            }
+        }
+
+        m_LoadedObjects -= objects.size();
+        m_TrixelObjects.remove(trixel.second);
+        m_TrixelDrawn.remove(trixel.second);
+    }
+
+    if (unloaded.isEmpty())
+        return;
+
+    m_ObjectList.erase(std::remove_if(m_ObjectList.begin(), m_ObjectList.end(),
+                                      [&unloaded](SkyObject *obj) { return unloaded.contains(obj); }),
+                       m_ObjectList.end());
+    qDeleteAll(unloaded);
+}
+
+void CatalogComponent::clearTrixels()
+{
+    if (m_TrixelLoader)
+    {
+        m_TrixelLoader->waitForFinished();
+        if (!m_PendingTrixels.isEmpty())
+        {
+            for (const auto &objects : m_TrixelLoader->result())
+                qDeleteAll(objects);
+        }
+    }
+
+    m_PendingTrixels.clear();
+    m_TrixelObjects.clear();
+    m_TrixelDrawn.clear();
+    m_LoadedObjects = 0;
+}
+
+SkyObject *CatalogComponent::findByName(const QString &name)
+{
+    if (!m_LoadOnDemand)
+        return ListComponent::findByName(name);
+
+    // Objects are loaded and unloaded by the thread drawing the sky map only
+    if (QThread::currentThread() != QCoreApplication::instance()->thread())
+        return nullptr;
+
+    SkyObject *obj = m_ObjectHash.value(name.toLower());
+    auto trixel    = m_NameTrixels.constFind(name);
+    if (obj || trixel == m_NameTrixels.constEnd())
+        return obj;
+
+    if (m_PendingTrixels.contains(*trixel))
+    {
+        m_TrixelLoader->waitForFinished();
+        m_PendingTrixels.clear();
+        addTrixelObjects(m_TrixelLoader->result());
+    }
+
+    if (!m_TrixelObjects.contains(*trixel))
+    {
+        TrixelObjects objects;
+        CatalogDB::GetObjectsInTrixels(KStarsData::Instance()->catalogdb()->DatabaseFile(), m_CatalogId,
+                                       QVector<Trixel>() << *trixel, objects, this);
+        addTrixelObjects(objects);
+    }
+
+    // The trixel stays loaded as if drawn, until the object is unused and out of sight
+    if (m_TrixelObjects.contains(*trixel))
+        m_TrixelDrawn[*trixel] = m_DrawCount;
+
+    return m_ObjectHash.value(name.toLower());
+}
+
 void CatalogComponent::_loadData(bool includeCatalogDesignation)
 {
+    clearTrixels();
+    m_LoadOnDemand = false;
+    m_NameTrixels.clear();
+
     if (includeCatalogDesignation)
         emitProgressText(i18n("Loading custom catalog: %1", m_catName));
     else
@@ -134,6 +411,11 @@ void CatalogComponent::_loadData(bool includeCatalogDesignation)
             {
                 objectLists(obj->type()).append(QPair<QString, const SkyObject *>(longname, obj));
             }
+
+            // The name index keeps every name, the catalog removing its names alone when it goes
+            indexName(name, obj);
+            indexName(longname, obj);
+            indexName(obj->name2(), obj);
         }
     }
 
@@ -141,6 +423,11 @@ void CatalogComponent::_loadData(bool includeCatalogDesignation)
     for (auto &list : objectNames())
         list.removeDuplicates();
 
+    loadCatalogData();
+}
+
+void CatalogComponent::loadCatalogData()
+{
     CatalogData loaded_catalog_data;
     KStarsData::Instance()->catalogdb()->GetCatalogData(m_catName, loaded_catalog_data);
     m_catColor    = loaded_catalog_data.color;
@@ -150,42 +437,46 @@ void CatalogComponent::_loadData(bool includeCatalogDesignation)
 
 void CatalogComponent::update(KSNumbers *)
 {
-    if (selected())
+    // Objects of catalogs loaded on demand are updated as they are drawn
+    if (selected() && !m_LoadOnDemand)
     {
         KStarsData *data = KStarsData::Instance();
         foreach (SkyObject *obj, m_ObjectList)
+            updateObject(obj, data);
+        this->updateID = data->updateID();
+    }
+}
+
+void CatalogComponent::updateObject(SkyObject *obj, KStarsData *data)
+{
+    DeepSkyObject *dso = dynamic_cast<DeepSkyObject *>(obj);
+    StarObject *so     = dynamic_cast<StarObject *>(obj);
+    Q_ASSERT(dso || so); // We either have stars, or deep sky objects
+    if (dso)
+    {
+        // Update the deep sky object if need be
+        if (dso->updateID != data->updateID())
         {
-            DeepSkyObject *dso = dynamic_cast<DeepSkyObject *>(obj);
-            StarObject *so     = dynamic_cast<StarObject *>(obj);
-            Q_ASSERT(dso || so); // We either have stars, or deep sky objects
-            if (dso)
+            dso->updateID = data->updateID();
+            if (dso->updateNumID != data->updateNumID())
             {
-                // Update the deep sky object if need be
-                if (dso->updateID != data->updateID())
-                {
-                    dso->updateID = data->updateID();
-                    if (dso->updateNumID != data->updateNumID())
-                    {
-                        dso->updateCoords(data->updateNum());
-                    }
-                    dso->EquatorialToHorizontal(data->lst(), data->geo()->lat());
-                }
+                dso->updateCoords(data->updateNum());
             }
-            else
+            dso->EquatorialToHorizontal(data->lst(), data->geo()->lat());
+        }
+    }
+    else
+    {
+        // Do exactly the same thing for stars
+        if (so->updateID != data->updateID())
+        {
+            so->updateID = data->updateID();
+            if (so->updateNumID != data->updateNumID())
             {
-                // Do exactly the same thing for stars
-                if (so->updateID != data->updateID())
-                {
-                    so->updateID = data->updateID();
-                    if (so->updateNumID != data->updateNumID())
-                    {
-                        so->updateCoords(data->updateNum());
-                    }
-                    so->EquatorialToHorizontal(data->lst(), data->geo()->lat());
-                }
+                so->updateCoords(data->updateNum());
             }
+            so->EquatorialToHorizontal(data->lst(), data->geo()->lat());
         }
-        this->updateID = data->updateID();
     }
 }
 
@@ -211,7 +502,7 @@ void CatalogComponent::draw(SkyPainter *skyp)
     auto sizeRescaling = dms::PI * zoomFactor / 10800.0;
     bool showUnknownMagObjects = Options::showUnknownMagObjects();
 
-    foreach (SkyObject *obj, m_ObjectList)
+    auto drawObject = [&](SkyObject *obj)
     {
         if (obj->type() == 0)
         {
@@ -239,7 +530,45 @@ void CatalogComponent::draw(SkyPainter *skyp)
             if (sizeCriterion && magCriterion)
                 skyp->drawDeepSkyObject(dso, true);
         }
+    };
+
+    if (!m_LoadOnDemand)
+    {
+        foreach (SkyObject *obj, m_ObjectList)
+            drawObject(obj);
+        return;
     }
+
+    // Catalogs loaded on demand are drawn by trixel, the trixels not loaded yet are loaded by a worker thread
+    KStarsData *data = KStarsData::Instance();
+    QVector<Trixel> missing;
+    MeshIterator region(SkyMesh::Instance(), DRAW_BUF);
+
+    ++m_DrawCount;
+    while (region.hasNext())
+    {
+        const Trixel trixel = region.next();
+        auto objects        = m_TrixelObjects.constFind(trixel);
+        if (objects == m_TrixelObjects.constEnd())
+        {
+            if (!m_PendingTrixels.contains(trixel))
+                missing.append(trixel);
+            continue;
+        }
+
+        m_TrixelDrawn[trixel] = m_DrawCount;
+        for (auto obj : *objects)
+        {
+            updateObject(obj, data);
+            drawObject(obj);
+        }
+    }
+
+    unloadTrixels();
+
+    // One load at a time, and no more than the maximum number of objects when the region holds more
+    if (!missing.isEmpty() && m_PendingTrixels.isEmpty() && m_LoadedObjects < MAX_LOADED_OBJECTS)
+        loadTrixels(missing.mid(0, TRIXELS_PER_LOAD));
 }
 
 bool CatalogComponent::getVisibility()
@@ -18,8 +18,15 @@
 #pragma once
 
 #include "listcomponent.h"
+#include "typedef.h"
 #include "Options.h"
 
+#include <QFutureWatcher>
+#include <QHash>
+
+#include <memory>
+
+class KStarsData;
 struct stat;
 
 /**
@@ -27,6 +34,10 @@ struct stat;
  * Represents a custom user-defined catalog.
  * Code adapted from CustomCatalogComponent.cpp originally authored by Thomas Kabelmann --spacetime
  *
+ * Large catalogs are not loaded at once. Their names are listed and indexed up front, and their objects are read
+ * from the CatalogDB trixel by trixel in a worker thread, as the trixels are drawn. The least recently drawn
+ * trixels are unloaded beyond a number of objects. findByName() loads the trixel of an object not loaded yet.
+ *
  * @author Thomas Kabelmann
  *         Rishab Arora (spacetime)
  * @version 0.2
@@ -53,6 +64,9 @@ class CatalogComponent : public ListComponent
 
     void update(KSNumbers *num) override;
 
+    /** @short Find an object of the catalog by name, loading it if the catalog is loaded on demand */
+    SkyObject *findByName(const QString &name) override;
+
     /** @return the name of the catalog */
     inline QString name() const { return m_catName; }
 
@@ -74,6 +88,9 @@ class CatalogComponent : public ListComponent
      */
     bool getVisibility();
 
+    /** @return true if the catalog is loaded on demand and has an object of that name, loaded or not */
+    inline bool hasDeferredName(const QString &name) const { return m_NameTrixels.contains(name); }
+
     /** @see SyncedCatalogItem */
     quint32 getUpdateID() { return updateID; }
 
@@ -85,16 +102,61 @@ class CatalogComponent : public ListComponent
     bool selected() override;
 
   protected:
-    /** @short Load data into custom catalog */
-    virtual void loadData() { _loadData(true); }
+    /** @short Load data into custom catalog, at once or on demand depending on its size */
+    virtual void loadData();
 
     /** @short Load data into custom catalog */
     virtual void _loadData(bool includeCatalogDesignation);
 
+    /** @short Load the names of the catalog, and prepare it to be loaded trixel by trixel */
+    void _loadOnDemand();
+
     // FIXME: There seems to be no way to remove catalogs from the program. -- asimha
 
     QString m_catName, m_catColor, m_catFluxFreq, m_catFluxUnit;
     bool m_Showerrs { false };
     int m_ccIndex { 0 };
     quint32 updateID { 0 };
+
+  private:
+    /** Objects of a catalog loaded on demand, by trixel */
+    typedef QHash<Trixel, QList<SkyObject *>> TrixelObjects;
+
+    /** @short Load the color and the flux details of the catalog */
+    void loadCatalogData();
+
+    /** @short Update the coordinates of an object, if not done yet for the current update */
+    static void updateObject(SkyObject *obj, KStarsData *data);
+
+    /** @short Load the objects of the given trixels in a worker thread, see trixelsLoaded() */
+    void loadTrixels(const QVector<Trixel> &trixels);
+
+    /** @short Add the objects loaded by the worker thread, and draw them */
+    void trixelsLoaded();
+
+    /** @short Add the objects of loaded trixels to the catalog */
+    void addTrixelObjects(const TrixelObjects &objects);
+
+    /** @short Unload the least recently drawn trixels, beyond the maximum number of objects loaded */
+    void unloadTrixels();
+
+    /** @short Forget the trixels loaded, once the worker thread is done */
+    void clearTrixels();
+
+    /** True if the objects are loaded trixel by trixel */
+    bool m_LoadOnDemand { false };
+    /** Database ID of a catalog loaded on demand */
+    int m_CatalogId { -1 };
+    /** Objects of each trixel loaded, for catalogs loaded on demand */
+    TrixelObjects m_TrixelObjects;
+    /** Number of objects in m_TrixelObjects */
+    int m_LoadedObjects { 0 };
+    /** Draw when each trixel loaded was last drawn, the trixels of the current draw are never unloaded */
+    QHash<Trixel, quint64> m_TrixelDrawn;
+    quint64 m_DrawCount { 0 };
+    /** Trixel of the object of each name, for catalogs loaded on demand */
+    QHash<QString, Trixel> m_NameTrixels;
+    /** Trixels being loaded by m_TrixelLoader */
+    QVector<Trixel> m_PendingTrixels;
+    std::unique_ptr<QFutureWatcher<TrixelObjects>> m_TrixelLoader;
 };
@@ -93,6 +93,7 @@ void CometsComponent::loadData()
 
     emitProgressText(i18n("Loading comets"));
 
+    unindexNames();
     qDeleteAll(m_ObjectList);
     m_ObjectList.clear();
 
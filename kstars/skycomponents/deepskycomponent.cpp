@@ -324,6 +324,10 @@ void DeepSkyComponent::loadData()
                 nameHash[longname.toLower()] = o;
             if (!name2.isEmpty())
                 nameHash[name2.toLower()] = o;
+
+            indexName(name, o);
+            indexName(longname, o);
+            indexName(name2, o);
         }
 
         Trixel trixel = m_skyMesh->index(o);
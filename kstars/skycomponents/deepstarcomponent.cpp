@@ -26,7 +26,9 @@
 #include "skymesh.h"
 #include "skypainter.h"
 #include "starblock.h"
+#include "starblockloader.h"
 #include "starcomponent.h"
+#include "starcoordinateengine.h"
 #include "htmesh/MeshIterator.h"
 #include "projections/projector.h"
 
@@ -53,6 +55,8 @@ DeepStarComponent::DeepStarComponent(SkyComposite *parent, QString fileName, flo
 
 DeepStarComponent::~DeepStarComponent()
 {
+    // The loader may be reading the catalog
+    m_Loader.reset();
     if (fileOpened)
         starReader.closeFile();
     fileOpened = false;
@@ -107,6 +111,36 @@ bool DeepStarComponent::loadStaticStars()
     if (htm_level != m_skyMesh->level())
         qCWarning(KSTARS) << "HTM Level in shallow star data file and HTM Level in m_skyMesh do not match. EXPECT TROUBLE!";
 
+    if (starReader.isMapped())
+    {
+        // Records are decoded straight from the memory map, trixel by trixel
+        for (Trixel trixel = 0; trixel < m_skyMesh->size(); ++trixel)
+        {
+            const BinFileHelper::RecordSpan records = starReader.getRecords(trixel);
+            std::shared_ptr<StarBlock> SB(new StarBlock(records.count));
+
+            m_starBlockList.at(trixel)->setStaticBlock(SB);
+
+            if (recordSize == 32)
+                SB->addStars<StarData>(records.data, records.count, starReader.getByteSwap());
+            else
+                SB->addStars<DeepStarData>(records.data, records.count, starReader.getByteSwap());
+
+            for (int j = 0; j < SB->getStarCount(); ++j)
+            {
+#ifdef KSTARS_LITE
+                StarObject *star = &(SB->star(j)->star);
+#else
+                StarObject *star = SB->star(j);
+#endif
+                if (star->getHDIndex())
+                    m_CatalogNumber.insert(star->getHDIndex(), star);
+            }
+        }
+
+        return true;
+    }
+
     // JM 2012-12-05: Breaking into 2 loops instead of one previously with multiple IF checks for recordSize
     // While the CPU branch prediction might not suffer any penalties since the branch prediction after a few times
     // should always gets it right. It's better to do it this way to avoid any chances since the compiler might not optimize it.
@@ -299,9 +333,6 @@ void DeepStarComponent::draw(SkyPainter *skyp)
     if (hideFaintStars && maglim > hideStarsMag)
         maglim = hideStarsMag;
 
-    StarBlockFactory *m_StarBlockFactory = StarBlockFactory::Instance();
-    //    m_StarBlockFactory->drawID = m_skyMesh->drawID();
-    //    qDebug() << "Mesh size = " << m_skyMesh->size() << "; drawID = " << m_skyMesh->drawID();
     QElapsedTimer t;
     int nTrixels = 0;
 
@@ -311,31 +342,27 @@ void DeepStarComponent::draw(SkyPainter *skyp)
 
     visibleStarCount = 0;
 
+    // Coordinates of the stars of each block are updated in one batch, see StarCoordinateEngine
+    const StarCoordinateEngine engine(data->updateNum(), data->lst(), data->geo()->lat());
+    const UpdateID updateNumID = data->updateNumID();
+
     t.start();
 
-    // Mark used blocks in the LRU Cache. Not required for static stars
+    // Pin the blocks in use for the frame, so that the cache does not recycle them. Not required for static stars
+    StarBlockFactory::Pins pins;
     if (!staticStars)
     {
         while (region.hasNext())
         {
             Trixel currentRegion = region.next();
-            for (int i = 0; i < m_starBlockList.at(currentRegion)->getBlockCount(); ++i)
-            {
-                std::shared_ptr<StarBlock> prevBlock = ((i >= 1) ? m_starBlockList.at(currentRegion)->block(
-                        i - 1) : std::shared_ptr<StarBlock>());
-                std::shared_ptr<StarBlock> block     = m_starBlockList.at(currentRegion)->block(i);
-
-                if (i == 0 && !m_StarBlockFactory->markFirst(block))
-                    qCWarning(KSTARS) << "markFirst failed in trixel" << currentRegion;
-                if (i > 0 && !m_StarBlockFactory->markNext(prevBlock, block))
-                    qCWarning(KSTARS) << "markNext failed in trixel" << currentRegion << "while marking block" << i;
-                if (i < m_starBlockList.at(currentRegion)->getBlockCount() &&
-                        m_starBlockList.at(currentRegion)->block(i)->getFaintMag() < maglim)
-                    break;
-            }
+            if (currentRegion < m_starBlockList.size())
+                pins.pin(m_starBlockList.at(currentRegion).get(), maglim);
         }
         t_updateCache = t.elapsed();
         region.reset();
+
+        // Blocks loaded in the background go to the cache only now, so that they do not evict the ones in use
+        m_Loader->publish();
     }
 
     while (region.hasNext())
@@ -352,9 +379,16 @@ void DeepStarComponent::draw(SkyPainter *skyp)
         if (currentRegion >= m_starBlockList.size())
             continue;
 
+        // Stars still missing are loaded in the background, draw those already there. Exported and printed
+        // images are drawn once, so their stars are loaded first.
         if (!staticStars)
         {
-            m_starBlockList.at(currentRegion)->fillToMag(maglim);
+            if (skyp->getWaitForStars())
+                m_starBlockList.at(currentRegion)->fillToMag(maglim);
+            else
+                m_Loader->request(currentRegion, maglim);
+            // Blocks just published or loaded are pinned as well
+            pins.pin(m_starBlockList.at(currentRegion).get(), maglim);
         }
 
         //        if (!staticStars && !m_starBlockList.at(currentRegion)->fillToMag(maglim) &&
@@ -368,16 +402,10 @@ void DeepStarComponent::draw(SkyPainter *skyp)
         //        qDebug() << "Drawing SBL for trixel " << currentRegion << ", SBL has "
         //                 <<  m_starBlockList[ currentRegion ]->getBlockCount() << " blocks";
 
-        // REMARK: The following should never carry state, except for const parameters like updateID and maglim
-        std::function<void(std::shared_ptr<StarBlock>)> mapFunction = [&updateID, &maglim](std::shared_ptr<StarBlock> myBlock)
+        // REMARK: The following should never carry state, except for const parameters like engine, updateID and maglim
+        std::function<void(std::shared_ptr<StarBlock>)> mapFunction = [&](std::shared_ptr<StarBlock> myBlock)
         {
-            for (StarObject &star : myBlock->contents())
-            {
-                if (star.updateID != updateID)
-                    star.JITupdate();
-                if (star.mag() > maglim)
-                    break;
-            }
+            engine.update(myBlock.get(), maglim, updateID, updateNumID);
         };
 
         QtConcurrent::blockingMap(m_starBlockList.at(currentRegion)->contents(), mapFunction);
@@ -387,6 +415,8 @@ void DeepStarComponent::draw(SkyPainter *skyp)
             std::shared_ptr<StarBlock> block = m_starBlockList.at(currentRegion)->block(i);
             //            qDebug() << "---> Drawing stars from block " << i << " of trixel " <<
             //                currentRegion << ". SB has " << block->getStarCount() << " stars";
+            if (block->getBrightMag() <= maglim)
+                block->prefetched = false;
             for (int j = 0; j < block->getStarCount(); j++)
             {
                 StarObject *curStar = block->star(j);
@@ -409,6 +439,12 @@ void DeepStarComponent::draw(SkyPainter *skyp)
         t_drawUnnamed += t.restart();
     }
     m_skyMesh->inDraw(false);
+
+    if (!staticStars)
+    {
+        SkyPoint center(focus->ra(), focus->dec());
+        m_Loader->predict(center.catalogueCoord(data->updateNum()->julianDay()), radius + 1.0, maglim);
+    }
 #ifdef PROFILE_SINCOS
     trig_calls_here += dms::trig_function_calls;
     trig_redundancy_here += dms::redundant_trig_function_calls;
@@ -472,6 +508,8 @@ bool DeepStarComponent::openDataFile()
         ret = fread(&MSpT, 2, 1, starReader.getFileHandle());
         if (starReader.getByteSwap())
             MSpT = bswap_16(MSpT);
+        if (!starReader.mapFile())
+            qCInfo(KSTARS) << "  Could not map" << dataFileName << "in memory, reading it from file." << starReader.getError();
         fileOpened = true;
         qCInfo(KSTARS) << "  Sky Mesh Size: " << m_skyMesh->size();
         for (long int i = 0; i < m_skyMesh->size(); i++)
@@ -484,6 +522,18 @@ bool DeepStarComponent::openDataFile()
             }
             m_starBlockList.append(sbl);
         }
+        if (!staticStars)
+        {
+            m_Loader.reset(new StarBlockLoader(&starReader, m_skyMesh, m_starBlockList));
+#ifndef KSTARS_LITE
+            // Draw again once the missing stars are loaded
+            QObject::connect(m_Loader.get(), &StarBlockLoader::blocksReady, m_Loader.get(), []()
+            {
+                if (SkyMap::Instance())
+                    SkyMap::Instance()->forceUpdate();
+            });
+#endif
+        }
         m_zoomMagLimit = 0.06;
     }
 
@@ -651,13 +701,9 @@ bool DeepStarComponent::verifySBLIntegrity()
                                   << ", brightMag of block #" << i << " = " << block->getBrightMag();
                 integrity = false;
             }
-            if (i > 1 && (!block->prev))
-                qCWarning(KSTARS) << "Trixel " << trixel << ": ERROR: Block" << i << "is unlinked in LRU Cache";
-            if (block->prev && block->prev->parent == m_starBlockList[trixel].get() &&
-                    block->prev != m_starBlockList[trixel]->block(i - 1))
+            if (block->parent != m_starBlockList[trixel].get())
             {
-                qCWarning(KSTARS) << "Trixel " << trixel
-                                  << ": ERROR: SBF LRU Cache linked list seems to be broken at before block " << i;
+                qCWarning(KSTARS) << "Trixel " << trixel << ": ERROR: Block" << i << "belongs to another list";
                 integrity = false;
             }
             faintMag = block->getFaintMag();
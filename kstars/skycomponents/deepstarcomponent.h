@@ -33,10 +33,13 @@
 #include "skyobjects/deepstardata.h"
 #include "skyobjects/stardata.h"
 
+#include <memory>
+
 class SkyLabeler;
 class SkyMesh;
 class StarBlockFactory;
 class StarBlockList;
+class StarBlockLoader;
 class StarObject;
 
 class DeepStarComponent : public ListComponent
@@ -133,6 +136,8 @@ class DeepStarComponent : public ListComponent
     long unsigned t_updateCache { 0 };
 
     QVector<std::shared_ptr<StarBlockList>> m_starBlockList;
+    /// Fills m_starBlockList in the background for draw(), unless stars are static
+    std::unique_ptr<StarBlockLoader> m_Loader;
     QHash<int, StarObject *> m_CatalogNumber;
 
     bool staticStars { false };
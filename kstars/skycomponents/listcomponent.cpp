@@ -41,6 +41,8 @@ void ListComponent::clear()
     {
         SkyObject *o = m_ObjectList.takeFirst();
         removeFromNames(o);
+        if (nameIndex())
+            nameIndex()->remove(o);
         delete o;
     }
 }
@@ -54,6 +56,11 @@ void ListComponent::appendListObject(SkyObject *object)
     m_ObjectHash.insert(object->name().toLower(), object);
     m_ObjectHash.insert(object->longname().toLower(), object);
     m_ObjectHash.insert(object->name2().toLower(), object);
+
+    if (object->hasName())
+        indexName(object->name(), object);
+    indexName(object->longname(), object);
+    indexName(object->name2(), object);
 }
 
 void ListComponent::update(KSNumbers *num)
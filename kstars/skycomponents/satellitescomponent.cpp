@@ -76,6 +76,7 @@ void SatellitesComponent::loadData()
                 objectNames(SkyObject::SATELLITE).append(sat->name());
                 objectLists(SkyObject::SATELLITE).append(QPair<QString, const SkyObject *>(sat->name(), sat));
                 nameHash[sat->name().toLower()] = sat;
+                indexName(sat->name(), sat);
             }
         }
     }
@@ -19,12 +19,18 @@
 
 #include "Options.h"
 #include "skycomposite.h"
+#include "skyobjectnameindex.h"
 #include "skyobjects/skyobject.h"
 
 SkyComponent::SkyComponent(SkyComposite *parent) : m_parent(parent)
 {
 }
 
+SkyComponent::~SkyComponent()
+{
+    unindexNames();
+}
+
 //Hand the message up to SkyMapComposite
 void SkyComponent::emitProgressText(const QString &message)
 {
@@ -73,6 +79,37 @@ QHash<int, QVector<QPair<QString, const SkyObject *>>> &SkyComponent::getObjectL
     return parent()->objectLists();
 }
 
+SkyObjectNameIndex *SkyComponent::getNameIndex()
+{
+    if (!parent())
+        return nullptr;
+    return parent()->nameIndex();
+}
+
+void SkyComponent::indexName(const QString &name, SkyObject *obj)
+{
+    SkyObjectNameIndex *index = getNameIndex();
+
+    if (index && !name.isEmpty())
+        index->insert(name, obj, this);
+}
+
+void SkyComponent::indexDeferredName(const QString &name, int type)
+{
+    SkyObjectNameIndex *index = getNameIndex();
+
+    if (index && !name.isEmpty())
+        index->insertDeferred(name, type, this);
+}
+
+void SkyComponent::unindexNames()
+{
+    SkyObjectNameIndex *index = getNameIndex();
+
+    if (index)
+        index->removeOwner(this);
+}
+
 void SkyComponent::removeFromNames(const SkyObject *obj)
 {
     QStringList &names = getObjectNames()[obj->type()];
@@ -97,4 +134,8 @@ void SkyComponent::removeFromLists(const SkyObject *obj)
     i = names.indexOf(QPair<QString, const SkyObject *>(obj->longname(), obj));
     if (i >= 0)
         names.removeAt(i);
+
+    SkyObjectNameIndex *index = getNameIndex();
+    if (index)
+        index->remove(obj);
 }
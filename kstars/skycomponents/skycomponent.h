@@ -23,6 +23,7 @@
 class QString;
 
 class SkyObject;
+class SkyObjectNameIndex;
 class SkyPoint;
 class SkyComposite;
 class SkyPainter;
@@ -112,7 +113,11 @@ class SkyComponent
      */
     explicit SkyComponent(SkyComposite *parent = nullptr);
 
-    virtual ~SkyComponent() = default;
+    /**
+     * @short Destructor
+     * Removes the names of the objects of the component from the name index
+     */
+    virtual ~SkyComponent();
 
     /**
      * @short Draw the object on the SkyMap
@@ -199,9 +204,29 @@ class SkyComponent
     void removeFromNames(const SkyObject *obj);
     void removeFromLists(const SkyObject *obj);
 
+    /** @return the index of the names of all the objects of SkyMapComposite, nullptr without SkyMapComposite */
+    inline SkyObjectNameIndex *nameIndex() { return getNameIndex(); }
+
+    /**
+     * @short Add a name of an object of this component to the name index, see SkyMapComposite::findByName()
+     * @note  Empty names are ignored
+     */
+    void indexName(const QString &name, SkyObject *obj);
+
+    /**
+     * @short Add a name of an object this component has not loaded yet to the name index
+     * SkyMapComposite::findByName() then gets the object from findByName() of this component.
+     * @note  Empty names are ignored
+     */
+    void indexDeferredName(const QString &name, int type);
+
+    /** @short Remove the names of all the objects of this component from the name index */
+    void unindexNames();
+
   private:
     virtual QHash<int, QStringList> &getObjectNames();
     virtual QHash<int, QVector<QPair<QString, const SkyObject *>>> &getObjectLists();
+    virtual SkyObjectNameIndex *getNameIndex();
 
     // Disallow copying and assignment
     SkyComponent(const SkyComponent &);
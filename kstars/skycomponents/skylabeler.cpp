@@ -166,6 +166,9 @@ bool SkyLabeler::drawGuideLabel(QPointF &o, const QString &text, double angle)
     m_p.drawText(QPointF(-w2, h), text);
     m_p.restore(); //reset coordinate system
 
+    if (m_recording)
+        m_recordedLabels.append({ o, text, angle, true, m_fontMetrics, m_p.font(), m_p.pen() });
+
     return true;
 }
 
@@ -190,6 +193,10 @@ bool SkyLabeler::drawNameLabel(SkyObject *obj, const QPointF &_p)
         zoomFont.setPointSizeF(newPointSize);
         m_p.setFont(zoomFont);
         m_p.drawText(p, sLabel);
+
+        if (m_recording)
+            m_recordedLabels.append({ p, sLabel, 0.0, false, m_fontMetrics, zoomFont, m_p.pen() });
+
         return true;
     }
 }
@@ -630,6 +637,41 @@ void SkyLabeler::drawQueuedLabels()
     }
 }
 
+void SkyLabeler::startRecording()
+{
+    m_recordedLabels.clear();
+    m_recording = true;
+}
+
+void SkyLabeler::stopRecording()
+{
+    m_recording = false;
+}
+
+void SkyLabeler::replayLabels()
+{
+    QFont font            = m_p.font();
+    QPen pen              = m_p.pen();
+    QFontMetricsF metrics = m_fontMetrics;
+
+    for (auto &label : m_recordedLabels)
+    {
+        // Mark the label with the same metrics as when it was recorded
+        m_fontMetrics = label.metrics;
+        m_p.setFont(label.font);
+        m_p.setPen(label.pen);
+
+        if (label.guide)
+            drawGuideLabel(label.o, label.text, label.angle);
+        else if (markText(label.o, label.text))
+            m_p.drawText(label.o, label.text);
+    }
+
+    m_p.setFont(font);
+    m_p.setPen(pen);
+    m_fontMetrics = metrics;
+}
+
 void SkyLabeler::drawQueuedLabelsType(SkyLabeler::label_t type)
 {
     LabelList list = labelList[type];
@@ -275,6 +275,27 @@ class SkyLabeler
          */
     void drawQueuedLabelsType(SkyLabeler::label_t type);
 
+    //----- Recording Labels -----//
+
+    /**
+         * @short records the labels drawn from now on, until stopRecording(),
+         * so that they can be drawn again after a reset() with replayLabels().
+         * This lets SkyMapQDraw keep the labels of a sky map layer it caches.
+         */
+    void startRecording();
+
+    /**
+         * @short stops recording the labels drawn.
+         */
+    void stopRecording();
+
+    /**
+         * @short draws the recorded labels again, with the font and pen they
+         * were drawn with, skipping those that would overlap the labels drawn
+         * since reset().
+         */
+    void replayLabels();
+
     //----- Marking Regions -----//
 
     /**
@@ -354,6 +375,21 @@ class SkyLabeler
     QPainter m_p;
     QPicture m_picture;
     QVector<LabelList> labelList;
+
+    /// A label drawn while recording, with the metrics it was marked with
+    struct RecordedLabel
+    {
+        QPointF o;
+        QString text;
+        double angle;
+        bool guide;
+        QFontMetricsF metrics;
+        QFont font;
+        QPen pen;
+    };
+    QList<RecordedLabel> m_recordedLabels;
+    bool m_recording { false };
+
     const Projector *m_proj { nullptr };
     static SkyLabeler *pinstance;
 };
@@ -61,9 +61,12 @@
 #endif
 
 #include <QApplication>
+#include <QSet>
 
 #include <kstars_debug.h>
 
+#include <algorithm>
+
 SkyMapComposite::SkyMapComposite(SkyComposite *parent) : SkyComposite(parent), m_reindexNum(J2000)
 {
     m_skyLabeler.reset(SkyLabeler::Instance());
@@ -182,6 +185,15 @@ SkyMapComposite::SkyMapComposite(SkyComposite *parent) : SkyComposite(parent), m
     connect(this, SIGNAL(progressText(QString)), KStarsData::Instance(), SIGNAL(progressText(QString)));
 }
 
+SkyMapComposite::~SkyMapComposite()
+{
+    // ~SkyComposite() would delete the components after the name index, and after
+    // getNameIndex() stops resolving to it, so delete them while both are valid
+    m_CustomCatalogs.reset();
+    qDeleteAll(components());
+    componentsWithPriorities().clear();
+}
+
 void SkyMapComposite::update(KSNumbers *num)
 {
     //printf("updating SkyMapComposite\n");
@@ -246,18 +258,30 @@ void SkyMapComposite::updateMoons(KSNumbers *num )
 //z-ordering (the layering) of the components.  Objects which
 //should appear "behind" others should be drawn first.
 void SkyMapComposite::draw(SkyPainter *skyp)
+{
+    drawLayers(skyp, AllLayers);
+}
+
+void SkyMapComposite::drawLayers(SkyPainter *skyp, int layers)
 {
     Q_UNUSED(skyp)
+    Q_UNUSED(layers)
 #ifndef KSTARS_LITE
     SkyMap *map      = SkyMap::Instance();
     KStarsData *data = KStarsData::Instance();
 
-    // We delay one draw cycle before re-indexing
-    // we MUST ensure CLines do not get re-indexed while we use DRAW_BUF
-    // so we do it here.
-    m_CLines->reindex(&m_reindexNum);
-    // This queues re-indexing for the next draw cycle
-    m_reindexNum = KSNumbers(data->updateNum()->julianDay());
+    const bool drawStatic  = layers & StaticLayer;
+    const bool drawDynamic = layers & DynamicLayer;
+
+    if (drawStatic)
+    {
+        // We delay one draw cycle before re-indexing
+        // we MUST ensure CLines do not get re-indexed while we use DRAW_BUF
+        // so we do it here.
+        m_CLines->reindex(&m_reindexNum);
+        // This queues re-indexing for the next draw cycle
+        m_reindexNum = KSNumbers(data->updateNum()->julianDay());
+    }
 
     // This ensures that the JIT updates are synchronized for the entire draw
     // cycle so the sky moves as a single sheet.  May not be needed.
@@ -296,7 +320,7 @@ void SkyMapComposite::draw(SkyPainter *skyp)
     // map->infoBoxes()->reserveBoxes( psky );
 
     // JM 2016-12-01: Why is this done this way?!! It's too inefficient
-    if (KStars::Instance())
+    if (drawDynamic && KStars::Instance())
     {
         auto &obsList = KStarsData::Instance()->observingList()->sessionList();
 
@@ -311,66 +335,101 @@ void SkyMapComposite::draw(SkyPainter *skyp)
             }
     }
 
-    m_MilkyWay->draw(skyp);
+    // The labels of the static layer are drawn again with the dynamic layer, when it is drawn alone
+    if (drawStatic && !drawDynamic)
+        m_skyLabeler->startRecording();
 
-    // Draw HIPS after milky way but before everything else
-    m_HiPS->draw(skyp);
+    if (drawStatic)
+    {
+        m_MilkyWay->draw(skyp);
 
-    m_EquatorialCoordinateGrid->draw(skyp);
-    m_HorizontalCoordinateGrid->draw(skyp);
-    m_LocalMeridianComponent->draw(skyp);
+        // Draw HIPS after milky way but before everything else
+        m_HiPS->draw(skyp);
 
-    //Draw constellation boundary lines only if we draw western constellations
-    if (m_Cultures->current() == "Western")
-    {
-        m_CBoundLines->draw(skyp);
-        m_ConstellationArt->draw(skyp);
+        m_EquatorialCoordinateGrid->draw(skyp);
     }
-    else if (m_Cultures->current() == "Inuit")
+
+    // In horizontal coordinates, the horizontal grid and the meridian are fixed with the view and stay under
+    // the static objects. In equatorial coordinates they move with the clock, and are drawn over them.
+    if (Options::useAltAz() ? drawStatic : drawDynamic)
     {
-        m_ConstellationArt->draw(skyp);
+        m_HorizontalCoordinateGrid->draw(skyp);
+        m_LocalMeridianComponent->draw(skyp);
     }
 
-    m_CLines->draw(skyp);
+    if (drawStatic)
+    {
+        //Draw constellation boundary lines only if we draw western constellations
+        if (m_Cultures->current() == "Western")
+        {
+            m_CBoundLines->draw(skyp);
+            m_ConstellationArt->draw(skyp);
+        }
+        else if (m_Cultures->current() == "Inuit")
+        {
+            m_ConstellationArt->draw(skyp);
+        }
 
-    m_Equator->draw(skyp);
+        m_CLines->draw(skyp);
 
-    m_Ecliptic->draw(skyp);
+        m_Equator->draw(skyp);
 
-    m_DeepSky->draw(skyp);
+        m_Ecliptic->draw(skyp);
 
-    m_CustomCatalogs->draw(skyp);
-    m_internetResolvedComponent->draw(skyp);
-    m_manualAdditionsComponent->draw(skyp);
+        m_DeepSky->draw(skyp);
 
-    m_Stars->draw(skyp);
+        m_CustomCatalogs->draw(skyp);
+        m_internetResolvedComponent->draw(skyp);
+        m_manualAdditionsComponent->draw(skyp);
 
-    m_SolarSystem->drawTrails(skyp);
-    m_SolarSystem->draw(skyp);
+        m_Stars->draw(skyp);
+    }
 
-    m_Satellites->draw(skyp);
+    if (drawDynamic)
+    {
+        m_SolarSystem->drawTrails(skyp);
+        m_SolarSystem->draw(skyp);
 
-    m_Supernovae->draw(skyp);
+        m_Satellites->draw(skyp);
 
-    map->drawObjectLabels(labelObjects());
+        // Supernovae are few, keep them over the solar system as when all layers are drawn
+        m_Supernovae->draw(skyp);
+    }
 
-    m_skyLabeler->drawQueuedLabels();
-    m_CNames->draw(skyp);
-    m_Stars->drawLabels();
-    m_DeepSky->drawLabels();
+    if (drawDynamic)
+    {
+        map->drawObjectLabels(labelObjects());
+
+        m_skyLabeler->drawQueuedLabels();
+
+        if (!drawStatic)
+            m_skyLabeler->replayLabels();
+    }
+
+    if (drawStatic)
+    {
+        m_CNames->draw(skyp);
+        m_Stars->drawLabels();
+        m_DeepSky->drawLabels();
 
-    m_ObservingList->pen = QPen(QColor(data->colorScheme()->colorNamed("ObsListColor")), 1.);
-    m_ObservingList->list2 = KStarsData::Instance()->observingList()->sessionList();
-    m_ObservingList->draw(skyp);
+        m_skyLabeler->stopRecording();
+    }
 
-    m_Flags->draw(skyp);
+    if (drawDynamic)
+    {
+        m_ObservingList->pen = QPen(QColor(data->colorScheme()->colorNamed("ObsListColor")), 1.);
+        m_ObservingList->list2 = KStarsData::Instance()->observingList()->sessionList();
+        m_ObservingList->draw(skyp);
 
-    m_StarHopRouteList->pen = QPen(QColor(data->colorScheme()->colorNamed("StarHopRouteColor")), 1.);
-    m_StarHopRouteList->draw(skyp);
+        m_Flags->draw(skyp);
 
-    m_ArtificialHorizon->draw(skyp);
+        m_StarHopRouteList->pen = QPen(QColor(data->colorScheme()->colorNamed("StarHopRouteColor")), 1.);
+        m_StarHopRouteList->draw(skyp);
 
-    m_Horizon->draw(skyp);
+        m_ArtificialHorizon->draw(skyp);
+
+        m_Horizon->draw(skyp);
+    }
 
     m_skyMesh->inDraw(false);
 
@@ -570,6 +629,11 @@ QHash<int, QVector<QPair<QString, const SkyObject *>>> &SkyMapComposite::getObje
     return m_ObjectLists;
 }
 
+SkyObjectNameIndex *SkyMapComposite::getNameIndex()
+{
+    return &m_NameIndex;
+}
+
 QList<SkyObject *> SkyMapComposite::findObjectsInArea(const SkyPoint &p1, const SkyPoint &p2)
 {
     const SkyRegion &region = m_skyMesh->skyRegion(p1, p2);
@@ -590,40 +654,11 @@ SkyObject *SkyMapComposite::findByName(const QString &name)
         return nullptr;
 #endif
 
-    //We search the children in an "intelligent" order (most-used
-    //object types first), in order to avoid wasting too much time
-    //looking for a match.  The most important part of this ordering
-    //is that stars should be last (because the stars list is so long)
-    SkyObject *o = nullptr;
-    o            = m_SolarSystem->findByName(name);
-    if (o)
-        return o;
-    o = m_DeepSky->findByName(name);
-    if (o)
-        return o;
-    o = m_CustomCatalogs->findByName(name);
-    if (o)
-        return o;
-    o = m_internetResolvedComponent->findByName(name);
-    if (o)
-        return o;
-    o = m_manualAdditionsComponent->findByName(name);
-    if (o)
-        return o;
-    o = m_CNames->findByName(name);
-    if (o)
-        return o;
-    o = m_Stars->findByName(name);
-    if (o)
-        return o;
-    o = m_Supernovae->findByName(name);
-    if (o)
-        return o;
-    o = m_Satellites->findByName(name);
-    if (o)
-        return o;
-
-    return nullptr;
+    //The components index the names of their objects as they load them.
+    //Where several objects share a name, the index keeps the former
+    //search order: solar system, deep sky, constellations, stars,
+    //supernovae and satellites
+    return m_NameIndex.find(name);
 }
 
 SkyObject *SkyMapComposite::findStarByGenetiveName(const QString name)
@@ -677,7 +712,25 @@ void SkyMapComposite::removeCustomCatalog(const QString &name)
 
         if (ccc->name() == name)
         {
+            // Drop the names of the objects of the catalog before they are deleted
+            ccc->unindexNames();
+
+            QSet<const SkyObject *> objects;
+            for (SkyObject *obj : ccc->objectList())
+                objects.insert(obj);
+
+            for (auto &list : objectLists())
+            {
+                // Catalogs loaded on demand list the names of the objects they have not loaded without object
+                list.erase(std::remove_if(list.begin(), list.end(),
+                                          [&objects, ccc](const QPair<QString, const SkyObject *> &item)
+                {
+                    return item.second ? objects.contains(item.second) : ccc->hasDeferredName(item.first);
+                }), list.end());
+            }
+
             m_CustomCatalogs->removeComponent(ccc);
+            delete ccc;
             return;
         }
     }
@@ -23,6 +23,7 @@
 #include "skylabeler.h"
 #include "skymesh.h"
 #include "skyobject.h"
+#include "skyobjectnameindex.h"
 
 #include <QList>
 
@@ -81,7 +82,20 @@ class SkyMapComposite : public QObject, public SkyComposite
      */
     explicit SkyMapComposite(SkyComposite *parent = nullptr);
 
-    virtual ~SkyMapComposite() override = default;
+    /**
+     * Layers of the sky map, which SkyMapQDraw caches separately
+     */
+    enum SkyLayer
+    {
+        /// Components fixed on the celestial sphere, which only move on screen with the view
+        StaticLayer = 0x1,
+        /// Components moving with the clock: solar system, satellites, supernovae, horizon, and in
+        /// equatorial coordinates the horizontal grid and meridian
+        DynamicLayer = 0x2,
+        AllLayers = StaticLayer | DynamicLayer
+    };
+
+    virtual ~SkyMapComposite() override;
 
     void update(KSNumbers *num = nullptr) override;
 
@@ -122,6 +136,16 @@ class SkyMapComposite : public QObject, public SkyComposite
      */
     void draw(SkyPainter *skyp) override;
 
+    /**
+     * @short Draw the components of some layers of the sky map
+     *
+     * When the static layer is drawn alone, its labels are recorded by SkyLabeler, and
+     * drawing the dynamic layer alone replays them after the labels of the moving objects.
+     * @p skyp the painter to paint with
+     * @p layers the SkyLayer flags of the layers to draw
+     */
+    void drawLayers(SkyPainter *skyp, int layers);
+
     /**
      * @return the object nearest a given point in the sky.
      * @param p The point to find an object near
@@ -145,9 +169,10 @@ class SkyMapComposite : public QObject, public SkyComposite
      * a SkyObject whose name matches the argument.
      *
      * The objects' primary, secondary and long-form names will
-     * all be checked for a match.
-     * @note Overloaded from SkyComposite.  In this version, we search
-     * the most likely object classes first to be more efficient.
+     * all be checked for a match, as well as the genetive names of
+     * stars. Case and white space do not matter.
+     * @note Overloaded from SkyComposite.  In this version, the name
+     * is looked up in the name index, see SkyObjectNameIndex.
      * @p name the name to be matched
      * @return a pointer to the SkyObject whose name matches
      * the argument, or a nullptr pointer if no match was found.
@@ -239,7 +264,10 @@ class SkyMapComposite : public QObject, public SkyComposite
   private:
     QHash<int, QStringList> &getObjectNames() override;
     QHash<int, QVector<QPair<QString, const SkyObject *>>> &getObjectLists() override;
+    SkyObjectNameIndex *getNameIndex() override;
 
+    // The components are deleted by ~SkyMapComposite(), while they can still remove their names from it
+    SkyObjectNameIndex m_NameIndex;
     std::unique_ptr<CultureList> m_Cultures;
     ConstellationBoundaryLines *m_CBoundLines { nullptr };
     ConstellationNamesComponent *m_CNames { nullptr };
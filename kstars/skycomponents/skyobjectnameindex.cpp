@@ -0,0 +1,217 @@
+/***************************************************************************
+                skyobjectnameindex.cpp  -  K Desktop Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "skyobjectnameindex.h"
+
+#include "skycomponent.h"
+#include "skyobjects/skyobject.h"
+
+void SkyObjectNameIndex::insert(const QString &name, SkyObject *object, const SkyComponent *owner)
+{
+    const QString k = key(name);
+
+    if (k.isEmpty() || !object)
+        return;
+
+    QWriteLocker locker(&m_Lock);
+    QStringList &keys = m_Keys[object];
+    if (keys.contains(k))
+        return;
+    keys.append(k);
+    m_Owned[owner].insert(object);
+
+    Entry entry;
+    entry.name   = name;
+    entry.object = object;
+    entry.rank   = rank(object->type());
+    insertEntry(k, entry);
+}
+
+void SkyObjectNameIndex::insertDeferred(const QString &name, int type, SkyComponent *owner)
+{
+    const QString k = key(name);
+
+    if (k.isEmpty() || !owner)
+        return;
+
+    QWriteLocker locker(&m_Lock);
+    QSet<QString> &keys = m_Deferred[owner];
+    if (keys.contains(k))
+        return;
+    keys.insert(k);
+
+    Entry entry;
+    entry.name  = name;
+    entry.owner = owner;
+    entry.rank  = rank(type);
+    insertEntry(k, entry);
+}
+
+void SkyObjectNameIndex::insertEntry(const QString &k, const Entry &entry)
+{
+    // Entries stay sorted by rank, in the order they were added within a rank
+    QVector<Entry> &entries = m_Names[k];
+    int i                   = entries.size();
+    while (i > 0 && entries.at(i - 1).rank > entry.rank)
+        --i;
+    entries.insert(i, entry);
+}
+
+void SkyObjectNameIndex::remove(const SkyObject *object)
+{
+    QWriteLocker locker(&m_Lock);
+    const QStringList keys = m_Keys.take(object);
+
+    for (auto owned = m_Owned.begin(); owned != m_Owned.end(); ++owned)
+        owned->remove(object);
+
+    removeEntries(object, keys);
+}
+
+void SkyObjectNameIndex::removeOwner(const SkyComponent *owner)
+{
+    QWriteLocker locker(&m_Lock);
+    const QSet<const SkyObject *> objects = m_Owned.take(owner);
+
+    for (const SkyObject *object : objects)
+        removeEntries(object, m_Keys.take(object));
+
+    for (const QString &k : m_Deferred.take(owner))
+    {
+        auto entries = m_Names.find(k);
+        if (entries == m_Names.end())
+            continue;
+
+        for (int i = entries->size() - 1; i >= 0; --i)
+        {
+            if (!entries->at(i).object && entries->at(i).owner == owner)
+                entries->remove(i);
+        }
+
+        if (entries->isEmpty())
+            m_Names.erase(entries);
+    }
+}
+
+SkyObject *SkyObjectNameIndex::find(const QString &name) const
+{
+    Entry found;
+    {
+        QReadLocker locker(&m_Lock);
+        auto entries = m_Names.constFind(key(name));
+
+        if (entries == m_Names.constEnd() || entries->isEmpty())
+            return nullptr;
+
+        // Among entries of the same rank, prefer the one spelled the same way
+        found          = entries->first();
+        const int best = found.rank;
+        for (const Entry &entry : *entries)
+        {
+            if (entry.rank != best)
+                break;
+            if (entry.name.compare(name, Qt::CaseInsensitive) == 0)
+            {
+                found = entry;
+                break;
+            }
+        }
+    }
+
+    // The component loads the object of a deferred name, without the lock as it may index what it loads
+    if (!found.object && found.owner)
+        return found.owner->findByName(found.name);
+
+    return found.object;
+}
+
+QList<QPair<QString, SkyObject *>> SkyObjectNameIndex::findByPrefix(const QString &prefix, int limit) const
+{
+    QList<QPair<QString, SkyObject *>> found;
+    const QString k = key(prefix);
+
+    QReadLocker locker(&m_Lock);
+    for (auto entries = m_Names.lowerBound(k); entries != m_Names.constEnd() && entries.key().startsWith(k); ++entries)
+    {
+        if (limit >= 0 && found.size() >= limit)
+            break;
+        if (!entries->isEmpty())
+            found.append(qMakePair(entries->first().name, entries->first().object));
+    }
+
+    return found;
+}
+
+int SkyObjectNameIndex::size() const
+{
+    QReadLocker locker(&m_Lock);
+    return m_Names.size();
+}
+
+QString SkyObjectNameIndex::key(const QString &name)
+{
+    const QString folded = name.toCaseFolded();
+    QString k;
+
+    k.reserve(folded.size());
+    for (const QChar &c : folded)
+    {
+        if (!c.isSpace())
+            k.append(c);
+    }
+
+    return k;
+}
+
+int SkyObjectNameIndex::rank(int type)
+{
+    switch (type)
+    {
+        case SkyObject::PLANET:
+        case SkyObject::MOON:
+        case SkyObject::ASTEROID:
+        case SkyObject::COMET:
+            return 0;
+        case SkyObject::CONSTELLATION:
+            return 2;
+        case SkyObject::STAR:
+            return 3;
+        case SkyObject::SUPERNOVA:
+            return 4;
+        case SkyObject::SATELLITE:
+            return 5;
+        default:
+            // Deep sky objects, from the built-in catalogs first, then from custom catalogs
+            return 1;
+    }
+}
+
+void SkyObjectNameIndex::removeEntries(const SkyObject *object, const QStringList &keys)
+{
+    for (const QString &k : keys)
+    {
+        auto entries = m_Names.find(k);
+        if (entries == m_Names.end())
+            continue;
+
+        for (int i = entries->size() - 1; i >= 0; --i)
+        {
+            if (entries->at(i).object == object)
+                entries->remove(i);
+        }
+
+        if (entries->isEmpty())
+            m_Names.erase(entries);
+    }
+}
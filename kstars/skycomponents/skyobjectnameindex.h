@@ -0,0 +1,121 @@
+/***************************************************************************
+                 skyobjectnameindex.h  -  K Desktop Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+class SkyComponent;
+class SkyObject;
+
+/**
+ * @class SkyObjectNameIndex
+ *
+ * @short The names of all the SkyObjects of SkyMapComposite, for SkyMapComposite::findByName()
+ *
+ * Components add the names of their objects as they load them: primary and long names, catalog designations,
+ * and the genetive names of stars, both with Greek letters and spelled out. Names are compared case folded and
+ * without white space, so that "M 31", "m31" and "M31" are one and the same name.
+ *
+ * Several objects may have the same name. find() then returns the one of the component that comes first in the
+ * original search order of SkyMapComposite::findByName(): solar system, deep sky, constellations, stars,
+ * supernovae and satellites. Among objects of the same kind, the first one indexed wins.
+ *
+ * Names are kept sorted, so that exact and prefix queries both take logarithmic time. The index may be used from
+ * any thread, as some components load their objects in the background.
+ *
+ * Components that load their objects on demand add the names of the objects they have not loaded yet with
+ * insertDeferred(). find() then asks the component for the object, with SkyComponent::findByName().
+ */
+class SkyObjectNameIndex
+{
+  public:
+    SkyObjectNameIndex() = default;
+
+    /**
+     * @short Add a name of an object
+     * @param name the name, as displayed
+     * @param object the object, which must stay valid until removed from the index
+     * @param owner the component of the object, see removeOwner()
+     */
+    void insert(const QString &name, SkyObject *object, const SkyComponent *owner);
+
+    /**
+     * @short Add a name of an object that its component has not loaded yet
+     * @param name the name, as displayed
+     * @param type the type of the object, see SkyObject::TYPE
+     * @param owner the component of the object, which finds it by name, see removeOwner()
+     */
+    void insertDeferred(const QString &name, int type, SkyComponent *owner);
+
+    /** @short Remove all the names of an object */
+    void remove(const SkyObject *object);
+
+    /** @short Remove all the names of the objects of a component, including the deferred ones */
+    void removeOwner(const SkyComponent *owner);
+
+    /** @return the object with the given name, nullptr if there is none */
+    SkyObject *find(const QString &name) const;
+
+    /**
+     * @short Find the objects with a name that starts with the given prefix
+     * @param prefix the start of the names, compared like names
+     * @param limit the maximum number of names to return, or -1 for all of them
+     * @return the names found, as displayed, with their object, in the order of the index. The object is
+     * nullptr for deferred names, find() loads it.
+     */
+    QList<QPair<QString, SkyObject *>> findByPrefix(const QString &prefix, int limit = -1) const;
+
+    /** @return the number of distinct names */
+    int size() const;
+
+    /** @return the key of a name in the index: case folded, without white space */
+    static QString key(const QString &name);
+
+  private:
+    struct Entry
+    {
+        QString name;
+        SkyObject *object { nullptr };
+        /** Component that finds the object of a deferred name */
+        SkyComponent *owner { nullptr };
+        int rank { 0 };
+    };
+
+    /** @return the rank of a type of objects in the search order, lower first */
+    static int rank(int type);
+
+    /** Insert an entry among those of its name, with the lock held */
+    void insertEntry(const QString &k, const Entry &entry);
+
+    /** Remove the entries of the object from the names given by their key, with the lock held */
+    void removeEntries(const SkyObject *object, const QStringList &keys);
+
+    mutable QReadWriteLock m_Lock;
+    /** Entries of each name key, best first */
+    QMap<QString, QVector<Entry>> m_Names;
+    /** Name keys of each object */
+    QHash<const SkyObject *, QStringList> m_Keys;
+    /** Objects of each component */
+    QHash<const SkyComponent *, QSet<const SkyObject *>> m_Owned;
+    /** Name keys of the deferred names of each component */
+    QHash<const SkyComponent *, QSet<QString>> m_Deferred;
+};
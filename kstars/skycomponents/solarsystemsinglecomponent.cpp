@@ -52,6 +52,10 @@ SolarSystemSingleComponent::SolarSystemSingleComponent(SolarSystemComposite *par
         objectNames(m_Planet->type()).append(m_Planet->longname());
         objectLists(m_Planet->type()).append(QPair<QString, const SkyObject *>(m_Planet->longname(), m_Planet));
     }
+
+    indexName(m_Planet->name(), m_Planet);
+    indexName(m_Planet->longname(), m_Planet);
+    indexName(m_Planet->name2(), m_Planet);
 }
 
 SolarSystemSingleComponent::~SolarSystemSingleComponent()
@@ -17,8 +17,13 @@
 
 #include <QDebug>
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 #include "starblock.h"
 #include "skyobjects/starobject.h"
+#include "deepstarcomponent.h"
 #include "starcomponent.h"
 #include "skyobjects/stardata.h"
 #include "skyobjects/deepstardata.h"
@@ -42,13 +47,15 @@ StarNode::~StarNode()
 #endif
 
 StarBlock::StarBlock(int nstars)
-    : faintMag(-5), brightMag(35), parent(nullptr), prev(nullptr), next(nullptr), drawID(0), nStars(0),
+    : faintMag(-5), brightMag(35), parent(nullptr), nStars(0),
 #ifdef KSTARS_LITE
       stars(nstars, StarNode())
 #else
       stars(nstars, StarObject())
 #endif
 {
+    for (QVector<double> *array : { &coords.x, &coords.y, &coords.z, &coords.pmX, &coords.pmY, &coords.pmZ, &coords.pm2 })
+        array->resize(nstars);
 }
 
 void StarBlock::reset()
@@ -56,10 +63,41 @@ void StarBlock::reset()
     if (parent)
         parent->releaseBlock(this);
 
-    parent    = nullptr;
-    faintMag  = -5.0;
-    brightMag = 35.0;
-    nStars    = 0;
+    parent     = nullptr;
+    faintMag   = -5.0;
+    brightMag  = 35.0;
+    nStars     = 0;
+    maxPM2     = 0;
+    prefetched = false;
+}
+
+void StarBlock::setCoordinates(int i, const StarObject &star)
+{
+    const double sinRA = star.ra0().sin(), cosRA = star.ra0().cos();
+    const double sinDec = star.dec0().sin(), cosDec = star.dec0().cos();
+
+    coords.x[i] = cosDec * cosRA;
+    coords.y[i] = cosDec * sinRA;
+    coords.z[i] = sinDec;
+
+    // Same great circle motion as StarObject::getIndexCoords(): the rate is pmMagnitude() and the bearing from
+    // north towards east is atan2(pmRA, pmDec). Milliarcseconds per year are arcseconds per millenium.
+    const double pmms    = star.pmMagnitudeSquared();
+    const double bearing = std::hypot(star.pmRA(), star.pmDec());
+    if (std::isnan(pmms) || pmms <= 0 || !(bearing > 0))
+    {
+        coords.pmX[i] = coords.pmY[i] = coords.pmZ[i] = coords.pm2[i] = 0;
+        return;
+    }
+
+    const double rate = std::sqrt(pmms) * dms::DegToRad / 3600.0;
+    const double north = rate * star.pmDec() / bearing, east = rate * star.pmRA() / bearing;
+
+    coords.pmX[i] = -north * sinDec * cosRA - east * sinRA;
+    coords.pmY[i] = -north * sinDec * sinRA + east * cosRA;
+    coords.pmZ[i] = north * cosDec;
+    coords.pm2[i] = rate * rate;
+    maxPM2 = std::max(maxPM2, coords.pm2[i]);
 }
 
 #ifdef KSTARS_LITE
@@ -75,6 +113,7 @@ StarNode *StarBlock::addStar(const StarData &data)
         faintMag = star.mag();
     if (star.mag() < brightMag)
         brightMag = star.mag();
+    setCoordinates(nStars - 1, star);
     return &node;
 }
 
@@ -90,6 +129,7 @@ StarNode *StarBlock::addStar(const DeepStarData &data)
         faintMag = star.mag();
     if (star.mag() < brightMag)
         brightMag = star.mag();
+    setCoordinates(nStars - 1, star);
     return &node;
 }
 #else
@@ -104,6 +144,7 @@ StarObject *StarBlock::addStar(const StarData &data)
         faintMag = star.mag();
     if (star.mag() < brightMag)
         brightMag = star.mag();
+    setCoordinates(nStars - 1, star);
     return &star;
 }
 
@@ -118,6 +159,32 @@ StarObject *StarBlock::addStar(const DeepStarData &data)
         faintMag = star.mag();
     if (star.mag() < brightMag)
         brightMag = star.mag();
+    setCoordinates(nStars - 1, star);
     return &star;
 }
 #endif
+
+template <typename T>
+int StarBlock::addStars(const char *records, int count, bool byteSwap, float maglim)
+{
+    int read = 0;
+
+    while (read < count && !isFull())
+    {
+        // Records of mapped files are packed, so copy them out instead of casting
+        T data;
+        memcpy(&data, records + read * sizeof(T), sizeof(T));
+        if (byteSwap)
+            DeepStarComponent::byteSwap(&data);
+        addStar(data);
+        ++read;
+
+        if (faintMag > maglim)
+            break;
+    }
+
+    return read;
+}
+
+template int StarBlock::addStars<StarData>(const char *records, int count, bool byteSwap, float maglim);
+template int StarBlock::addStars<DeepStarData>(const char *records, int count, bool byteSwap, float maglim);
@@ -20,8 +20,11 @@
 #include "typedef.h"
 #include "starblocklist.h"
 
+#include <QAtomicInt>
 #include <QVector>
 
+#include <limits>
+
 class StarObject;
 class StarBlockList;
 class PointSourceNode;
@@ -60,6 +63,22 @@ class StarBlock
     typedef StarObject StarBlockEntry;
 #endif
 
+    /**
+     * @struct Coordinates
+     *
+     * Catalog positions and proper motions of the stars of the block, kept as structure of arrays
+     * for StarCoordinateEngine. Element i describes star i.
+     */
+    struct Coordinates
+    {
+        /** Unit vector of the J2000.0 catalog position */
+        QVector<double> x, y, z;
+        /** Proper motion as a tangent vector, in radians per Julian millenium */
+        QVector<double> pmX, pmY, pmZ;
+        /** Squared norm of the proper motion vector, zero if the star has no usable proper motion */
+        QVector<double> pm2;
+    };
+
     /**
      * Constructor
      *
@@ -84,6 +103,21 @@ class StarBlock
     StarBlockEntry *addStar(const StarData &data);
     StarBlockEntry *addStar(const DeepStarData &data);
 
+    /**
+     * @short Initialize stars with consecutive records of a catalog file.
+     *
+     * Records are decoded in order until the block is full, all of them are read, or a star fainter than maglim
+     * is added, which is how StarBlockList::fillToMag() reads a trixel.
+     *
+     * @param  records first record, StarData or DeepStarData, with no alignment requirement
+     * @param  count number of records available
+     * @param  byteSwap whether the records must be byte-swapped, see BinFileHelper::getByteSwap()
+     * @param  maglim magnitude after which to stop
+     * @return number of records read
+     */
+    template <typename T>
+    int addStars(const char *records, int count, bool byteSwap, float maglim = std::numeric_limits<float>::max());
+
     /**
      * @short Returns true if the StarBlock is full
      *
@@ -118,6 +152,15 @@ class StarBlock
 
     inline QVector<StarBlockEntry> &contents() { return stars; }
 
+    /**
+     * @return the catalog positions and proper motions of the stars of this StarBlock
+     * @note Only the first getStarCount() elements are meaningful.
+     */
+    inline const Coordinates &coordinates() const { return coords; }
+
+    /** @return the largest squared proper motion in this StarBlock, see Coordinates::pm2 */
+    inline double getMaxProperMotion2() const { return maxPM2; }
+
     // These methods are there because we might want to make faintMag and brightMag private at some point
     /**
      * @short  Return the magnitude of the brightest star in this StarBlock
@@ -146,17 +189,32 @@ class StarBlock
     float faintMag { 0 };
     float brightMag { 0 };
     StarBlockList *parent;
-    std::shared_ptr<StarBlock> prev;
-    std::shared_ptr<StarBlock> next;
-    quint32 drawID { 0 };
+    /** True if the block was loaded ahead of time by StarBlockLoader and has not been drawn yet */
+    bool prefetched { false };
+
+    // Bookkeeping of StarBlockFactory
+    /** Number of StarBlockFactory::Pins holding this block */
+    QAtomicInt pins;
+    /** Set when the block is used, cleared by the clock of StarBlockFactory */
+    QAtomicInt referenced;
+    /** Shard and slot of the block in StarBlockFactory, -1 for blocks that are not cached */
+    int cacheShard { -1 };
+    int cacheSlot { -1 };
 
   private:
     // Disallow copying and assignment. Just in case.
     StarBlock(const StarBlock &);
     StarBlock &operator=(const StarBlock &);
 
+    /** Record the catalog position and proper motion of the star just added at index i. */
+    void setCoordinates(int i, const StarObject &star);
+
     /** Number of initialized stars in StarBlock. */
     int nStars { 0 };
     /** Array of stars. */
     QVector<StarBlockEntry> stars;
+    /** Catalog coordinates of the stars, in the same order. */
+    Coordinates coords;
+    /** Largest element of coords.pm2. */
+    double maxPM2 { 0 };
 };
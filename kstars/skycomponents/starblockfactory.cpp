@@ -17,14 +17,12 @@
 
 #include "starblockfactory.h"
 
+#include "Options.h"
 #include "starblock.h"
 #include "starobject.h"
 
 #include <kstars_debug.h>
 
-// TODO: Implement a better way of deciding this
-#define DEFAULT_NCACHE 12
-
 StarBlockFactory *StarBlockFactory::pInstance = nullptr;
 
 StarBlockFactory *StarBlockFactory::Instance()
@@ -36,284 +34,226 @@ StarBlockFactory *StarBlockFactory::Instance()
 
 StarBlockFactory::StarBlockFactory()
 {
-    first   = nullptr;
-    last    = nullptr;
-    nBlocks = 0;
-    drawID  = 0;
-    nCache  = DEFAULT_NCACHE;
+    StarBlock sample;
+
+    // A block is mostly its stars and their coordinates, see StarBlock::coordinates()
+    blockBytes = sizeof(StarBlock) + sample.size() * (sizeof(StarBlock::StarBlockEntry) + 7 * sizeof(double));
+    budget     = static_cast<quint64>(Options::starBlockCacheSize()) * 1024 * 1024;
 }
 
 StarBlockFactory::~StarBlockFactory()
 {
-    deleteBlocks(nBlocks);
-    if (pInstance)
+    const Statistics stats = statistics();
+    qCDebug(KSTARS) << stats.blocks << "StarBlocks freed from StarBlockFactory," << stats.evictions << "recycled";
+
+    if (pInstance == this)
         pInstance = nullptr;
 }
 
-std::shared_ptr<StarBlock> StarBlockFactory::getBlock()
+QVector<std::shared_ptr<StarBlock>> StarBlockFactory::Pins::pin(StarBlockList *list, float maglim)
 {
-    std::shared_ptr<StarBlock> freeBlock;
+    QVector<std::shared_ptr<StarBlock>> pinned;
 
-    if (nBlocks < nCache)
+    QMutexLocker locker(StarBlockFactory::Instance()->lock(list->getTrixel()));
+    for (int i = 0; i < list->getBlockCount(); ++i)
     {
-        freeBlock.reset(new StarBlock);
-        if (freeBlock.get())
-        {
-            ++nBlocks;
-            return freeBlock;
-        }
-    }
-    if (last && (last->drawID != drawID || last->drawID == 0))
-    {
-        //        qCDebug(KSTARS) << "Recycling block with drawID =" << last->drawID << "and current drawID =" << drawID;
-        if (last->parent->block(last->parent->getBlockCount() - 1) != last)
-            qCDebug(KSTARS) << "ERROR: Goof up here!";
-        freeBlock = last;
-        last      = last->prev;
-        if (last)
-        {
-            last->next = nullptr;
-        }
-        if (freeBlock == first)
-        {
-            first = nullptr;
-        }
-        freeBlock->reset();
-        freeBlock->prev = nullptr;
-        freeBlock->next = nullptr;
-        return freeBlock;
+        std::shared_ptr<StarBlock> block = list->block(i);
+
+        block->pins.ref();
+        block->referenced.store(1);
+        pinned.append(block);
+
+        // Blocks are in magnitude order, the next ones are not needed
+        if (block->getFaintMag() >= maglim)
+            break;
     }
-    freeBlock.reset(new StarBlock);
-    if (freeBlock.get())
-        ++nBlocks;
+    blocks += pinned;
 
-    return freeBlock;
+    return pinned;
 }
 
-bool StarBlockFactory::markFirst(std::shared_ptr<StarBlock>& block)
+void StarBlockFactory::Pins::release()
 {
-    if (!block.get())
-        return false;
+    for (const auto &block : blocks)
+        block->pins.deref();
+    blocks.clear();
+}
 
-    //    fprintf(stderr, "markFirst()!\n");
-    if (!first)
-    {
-        //        qCDebug(KSTARS) << "INFO: Linking in first block";
-        last = first = block;
-        first->prev = first->next = nullptr;
-        first->drawID             = drawID;
-        return true;
-    }
+std::shared_ptr<StarBlock> StarBlockFactory::getBlock(Trixel trixel, bool mayRecycle)
+{
+    const int index = trixel % SHARDS;
+    Shard &shard    = shards[index];
+
+    QMutexLocker locker(&shard.mutex);
 
-    if (block == first) // Block is already in the front
+    if (shard.free.isEmpty())
     {
-        block->drawID = drawID;
-        return true;
+        if (!atBudget(shard))
+            allocateSlab(shard, index);
+        else if (!mayRecycle)
+            return std::shared_ptr<StarBlock>();
+        else if (!evict(shard))
+            allocateSlab(shard, index);
     }
 
-    if (block == last)
-        last = block->prev;
+    StarBlock *freeBlock = shard.free.takeLast();
+    freeBlock->referenced.store(1);
 
-    if (block->prev)
-        block->prev->next = block->next;
+    return shard.blocks.at(freeBlock->cacheSlot);
+}
 
-    if (block->next)
-        block->next->prev = block->prev;
+void StarBlockFactory::recycle(const std::shared_ptr<StarBlock> &block)
+{
+    if (!block.get() || block->cacheShard < 0)
+        return;
 
-    first->prev = block;
-    block->next = first;
-    block->prev = nullptr;
-    first       = block;
+    Shard &shard = shards[block->cacheShard];
 
-    block->drawID = drawID;
+    QMutexLocker locker(&shard.mutex);
 
-    return true;
+    // Ignore blocks of another factory, and blocks already appended to a list
+    if (block->cacheSlot >= shard.blocks.size() || shard.blocks.at(block->cacheSlot) != block || block->parent)
+        return;
+
+    if (block->prefetched)
+        ++wasted;
+    block->reset();
+    shard.free.append(block.get());
 }
 
-bool StarBlockFactory::markNext(std::shared_ptr<StarBlock>& after, std::shared_ptr<StarBlock>& block)
+int StarBlockFactory::trim()
 {
-    //    fprintf(stderr, "markNext()!\n");
-    if (!block.get() || !after.get())
-    {
-        qCDebug(KSTARS) << "WARNING: markNext called with nullptr argument";
-        return false;
-    }
+    int i = 0;
 
-    if (!first.get())
+    for (Shard &shard : shards)
     {
-        qCDebug(KSTARS) << "WARNING: markNext called without an existing linked list";
-        return false;
-    }
+        QMutexLocker locker(&shard.mutex);
 
-    if (block == after)
-    {
-        qCDebug(KSTARS) << "ERROR: Trying to mark a block after itself!";
-        return false;
+        while (atBudget(shard) && shard.free.size() < SLAB_SIZE && evict(shard))
+            ++i;
     }
 
-    if (block->prev == after) // Block is already after 'after'
-    {
-        block->drawID = drawID;
-        return true;
-    }
+    return i;
+}
 
-    if (block == first)
-    {
-        if (block->next == nullptr)
-        {
-            qCDebug(KSTARS) << "ERROR: Trying to mark only block after some other block";
-            return false;
-        }
-        first = block->next;
-    }
+void StarBlockFactory::setBudget(quint64 bytes)
+{
+    budget = bytes;
+}
+
+int StarBlockFactory::getBlockCount() const
+{
+    int count = 0;
 
-    if (after->getFaintMag() > block->getFaintMag() && block->getFaintMag() != -5)
+    for (const Shard &shard : shards)
     {
-        qCDebug(KSTARS) << "WARNING: Marking block with faint mag = " << block->getFaintMag() << " after block with faint mag "
-                 << after->getFaintMag() << "in trixel" << block->parent->getTrixel();
+        QMutexLocker locker(&shard.mutex);
+        count += shard.blocks.size();
     }
 
-    if (block == last)
-        last = block->prev;
-
-    if (block->prev)
-        block->prev->next = block->next;
-    if (block->next)
-        block->next->prev = block->prev;
-
-    block->next = after->next;
-    if (block->next)
-        block->next->prev = block;
-    block->prev = after;
-    after->next = block;
-
-    if (after == last)
-        last = block;
-
-    block->drawID = drawID;
-
-    return true;
+    return count;
 }
 
-/*
-bool StarBlockFactory::groupMove( StarBlock *start, const int nblocks ) {
-
-    StarBlock * end = nullptr;
-
-    // Check for trivial cases
-    if( !start || nblocks < 0 )
-        return false;
-
-    if( nblocks == 0 )
-        return true;
-
-    if( !first )
-        return false;
+StarBlockFactory::Statistics StarBlockFactory::statistics() const
+{
+    Statistics stats;
 
-    // Check for premature end
-    end = start;
-    for( int i = 1; i < nblocks; ++i ) {
-        if( end == nullptr )
-            return false;
-        end = end->next;
-    }
-    if( end == nullptr )
-        return false;
+    for (const Shard &shard : shards)
+    {
+        QMutexLocker locker(&shard.mutex);
 
-    // Update drawIDs
-    end = start;
-    for( int i = 1; i < nblocks; ++i ) {
-        end->drawID = drawID;
-        end = end->next;
+        stats.blocks += shard.blocks.size();
+        for (const auto &block : shard.blocks)
+        {
+            if (block->parent)
+                ++stats.usedBlocks;
+            if (block->pins.load() > 0)
+                ++stats.pinnedBlocks;
+        }
     }
-    end->drawID = drawID;
 
-    // Check if we are already in the front
-    if( !start->prev )
-        return true;
+    stats.hits       = hits;
+    stats.misses     = misses;
+    stats.prefetched = prefetched;
+    stats.wasted     = wasted;
+    stats.evictions  = evictions;
+    stats.bytes      = stats.blocks * blockBytes;
+    stats.budget     = budget;
 
-    start->prev->next = end->next;
-    end->next->prev = start->prev;
+    return stats;
+}
 
-    first->prev = end;
-    end->next = first;
-    start->prev = nullptr;
-    first = start;
+void StarBlockFactory::countLookup(bool hit)
+{
+    if (hit)
+        ++hits;
+    else
+        ++misses;
 }
-*/
 
-int StarBlockFactory::deleteBlocks(int nblocks)
+void StarBlockFactory::allocateSlab(Shard &shard, int index)
 {
-    int i           = 0;
-    std::shared_ptr<StarBlock> temp;
+    // The blocks share the ownership of their slab, which lives as long as any of them is held
+    std::shared_ptr<StarBlock> slab(new StarBlock[SLAB_SIZE], std::default_delete<StarBlock[]>());
 
-    while (last != nullptr && i != nblocks)
+    for (int i = 0; i < SLAB_SIZE; ++i)
     {
-        temp = last->prev;
-        last.reset();
-        last = temp;
-        i++;
+        StarBlock *block  = slab.get() + i;
+        block->cacheShard = index;
+        block->cacheSlot  = shard.blocks.size();
+        shard.blocks.append(std::shared_ptr<StarBlock>(slab, block));
+        shard.free.append(block);
     }
-    if (last)
-        last->next = nullptr;
-    else
-        first = nullptr;
-
-    qCDebug(KSTARS) << nblocks << "StarBlocks freed from StarBlockFactory";
-
-    nBlocks -= i;
-    return i;
 }
 
-void StarBlockFactory::printStructure() const
+bool StarBlockFactory::evict(Shard &shard)
 {
-    std::shared_ptr<StarBlock> cur;
-    Trixel curTrixel = 513; // TODO: Change if we change HTMesh level
-    int index        = 0;
-    bool draw        = false;
+    const int count = shard.blocks.size();
 
-    cur = first;
-    do
+    // Two turns of the clock clear all the reference bits, after which any unpinned block in a list goes
+    for (int i = 0; i < 2 * count; ++i)
     {
-        if (curTrixel != cur->parent->getTrixel())
-        {
-            qCDebug(KSTARS) << "Trixel" << cur->parent->getTrixel() << "starts at index" << index;
-            curTrixel = cur->parent->getTrixel();
-        }
-        if (cur->drawID == drawID && !draw)
+        StarBlock *block = shard.blocks.at(shard.hand).get();
+        shard.hand       = (shard.hand + 1) % count;
+
+        if (!block->parent || block->pins.load() > 0)
+            continue;
+        if (block->referenced.fetchAndStoreRelaxed(0))
+            continue;
+
+        // Lists drop their blocks from the faint end, down to the block under the hand
+        StarBlockList *list = block->parent;
+        bool recycled       = false;
+        while (list->getBlockCount() > 0)
         {
-            qCDebug(KSTARS) << "Blocks from index" << index << "are drawn";
-            draw = true;
-        }
-        if (cur->drawID != drawID && draw)
-        {
-            qCDebug(KSTARS) << "Blocks from index" << index << "are not drawn";
-            draw = false;
-        }
-        cur = cur->next;
-        ++index;
-    } while (cur != last);
-}
+            std::shared_ptr<StarBlock> last = list->block(list->getBlockCount() - 1);
 
-int StarBlockFactory::freeUnused()
-{
-    int i           = 0;
-    std::shared_ptr<StarBlock> temp;
+            if (last->pins.load() > 0)
+                break;
 
-    while (last != nullptr && last->drawID < drawID && i != nBlocks)
-    {
-        temp = last->prev;
-        last.reset();
-        last = temp;
-        i++;
+            if (last->prefetched)
+                ++wasted;
+            ++evictions;
+            last->reset();
+            shard.free.append(last.get());
+            recycled = true;
+
+            if (last.get() == block)
+                break;
+        }
+
+        if (recycled)
+            return true;
     }
-    if (last)
-        last->next = nullptr;
-    else
-        first = nullptr;
 
-    qCDebug(KSTARS) << i << "StarBlocks freed from StarBlockFactory";
+    return false;
+}
 
-    nBlocks -= i;
-    return i;
+bool StarBlockFactory::atBudget(const Shard &shard) const
+{
+    // A shard may always have one slab, so that a tiny budget does not recycle a block for every block requested
+    if (shard.blocks.isEmpty())
+        return false;
+
+    return quint64(shard.blocks.size() + SLAB_SIZE) * blockBytes > budget / SHARDS;
 }
@@ -19,16 +19,37 @@
 
 #include "typedef.h"
 
+#include <QMutex>
+#include <QVector>
+
+#include <atomic>
+#include <limits>
+#include <memory>
+
 class StarBlock;
+class StarBlockList;
 
 /**
  * @class StarBlockFactory
  *
- * @short A factory that creates StarBlocks and recycles them in an LRU Cache
+ * @short A cache of StarBlocks, allocated in slabs and recycled within a byte budget
+ *
+ * Blocks are grouped in shards by trixel, each shard with its own lock, so that blocks can be requested, pinned
+ * and recycled from several threads. A shard allocates its blocks a slab at a time until it reaches its share of
+ * the budget, Options::starBlockCacheSize(), though it always gets one slab whatever the budget. From then on, blocks are recycled with the clock, or second chance,
+ * algorithm: the clock hand spares once the blocks that were used since its last pass. As a StarBlockList can only
+ * drop its last block, recycling a block also recycles the fainter blocks of the same list.
+ *
+ * Pinned blocks are never recycled. Whoever reads stars from another thread than the one filling the lists must
+ * pin the blocks first, with StarBlockFactory::Pins, and may then read them until the pins are released.
+ *
+ * The lock of a shard also protects the list of blocks of the StarBlockLists in that shard: blocks are appended to
+ * and dropped from a StarBlockList under that lock, see lock(). A StarBlockList is still only to be filled from
+ * one thread at a time.
+ *
  * @author Akarsh Simha
- * @version 0.1
+ * @version 0.2
  */
-
 class StarBlockFactory
 {
   public:
@@ -36,84 +57,177 @@ class StarBlockFactory
 
     /**
      * Destructor
-     * Deletes the linked list that maintains the Cache, sets the pointer to nullptr
+     * Releases the slabs. Blocks still held by a StarBlockList are freed with the list.
      */
     ~StarBlockFactory();
 
     /**
-     * @short  Return a StarBlock available for use
+     * @class Pins
+     * @short Pins on StarBlocks, released on destruction, typically held for a frame
+     */
+    class Pins
+    {
+      public:
+        Pins() = default;
+        ~Pins() { release(); }
+
+        /**
+         * @short Pin the blocks of a list that hold stars up to the given magnitude
+         * @param list the list to pin
+         * @param maglim stars fainter than this are not needed, nor the blocks that only hold such stars
+         * @return the blocks that were pinned, in magnitude order
+         */
+        QVector<std::shared_ptr<StarBlock>> pin(StarBlockList *list, float maglim = std::numeric_limits<float>::max());
+
+        /** @short Release all the pins */
+        void release();
+
+        /** @return the number of blocks pinned */
+        inline int count() const { return blocks.size(); }
+
+      private:
+        Pins(const Pins &);
+        Pins &operator=(const Pins &);
+
+        QVector<std::shared_ptr<StarBlock>> blocks;
+    };
+
+    /**
+     * @short  Return an empty StarBlock for the given trixel
+     *
+     * The block is taken from the free blocks of the shard of the trixel. Without free block, the shard allocates
+     * a new slab within its budget, or else recycles a block with the clock. If every block is in use, a new slab
+     * is allocated regardless of the budget.
      *
-     * This method first checks if there are any cached StarBlocks that are not in use.
-     * If such a StarBlock is found, it returns the same for use. Else it freshly allocates
-     * a StarBlock and returns the same. It also moves the StarBlock to the front, marking it
-     * as the most recently used. If the StarBlock had a parent StarBlockList, this method
-     * detaches the StarBlock from the StarBlockList
+     * The block is not part of any StarBlockList yet and is not recycled until it is appended to one. If it ends up
+     * unused, it must be given back with recycle().
      *
-     * @return A StarBlock that is available for use
+     * @param  trixel  The trixel of the StarBlockList the block is for
+     * @param  mayRecycle  False to only take a free block or allocate within the budget. Threads other than the one
+     *         filling the lists must pass false, as recycling a block modifies the list that held it.
+     * @return A StarBlock available for use, nullptr if none is available without recycling
      */
-    std::shared_ptr<StarBlock> getBlock();
+    std::shared_ptr<StarBlock> getBlock(Trixel trixel, bool mayRecycle = true);
 
     /**
-     * @short  Mark a StarBlock as most recently used and sync its drawID with the current drawID
-     *
-     * @return true on success, false if the StarBlock supplied was not on our list at all
+     * @short  Give back a block from getBlock() that was not appended to a StarBlockList
      */
-    bool markFirst(std::shared_ptr<StarBlock>& block);
+    void recycle(const std::shared_ptr<StarBlock> &block);
 
     /**
-     * @short  Rank a given StarBlock after another given StarBlock in the LRU list
-     * and sync its drawID with the current drawID
+     * @short  Recycle blocks ahead of time, so that each shard at its budget keeps some free blocks
+     *
+     * Threads that may not recycle blocks, like the one of StarBlockLoader, then still find blocks to fill.
+     * To be called from the thread filling the lists.
      *
-     * @param  after  The block after which 'block' should be put
-     * @param  block  The block to mark for use
-     * @return true on success, false on failure
+     * @return The number of blocks recycled
      */
-    bool markNext(std::shared_ptr<StarBlock>& after, std::shared_ptr<StarBlock>& block);
+    int trim();
 
     /**
-     * @short  Returns the number of StarBlocks currently produced
-     *
-     * @return Number of StarBlocks currently allocated
+     * @return the lock protecting the blocks of the StarBlockLists in the shard of the given trixel
      */
-    inline int getBlockCount() const { return nBlocks; }
+    inline QMutex *lock(Trixel trixel) { return &shards[trixel % SHARDS].mutex; }
 
     /**
-     * @short  Frees all StarBlocks that are in the cache
-     * @return The number of StarBlocks freed
+     * @short  Set the byte budget of the cache
+     * @note   Slabs are never freed, a lower budget only stops the cache from growing further
      */
-    inline int freeAll() { return deleteBlocks(nBlocks); }
+    void setBudget(quint64 bytes);
+
+    /** @return the byte budget of the cache */
+    inline quint64 getBudget() const { return budget; }
 
     /**
-     * @short  Frees all StarBlocks that are not used in this draw cycle
-     * @return The number of StarBlocks freed
+     * @short  Returns the number of StarBlocks currently allocated
      */
-    int freeUnused();
+    int getBlockCount() const;
 
     /**
-     * @short  Prints the structure of the cache, for debugging
+     * @short  Returns the number of StarBlocks that fit in the budget
      */
-    void printStructure() const;
+    inline int getCacheSize() const { return int(budget / blockBytes); }
 
-    quint32 drawID; // A number identifying the current draw cycle
+    /**
+     * @short Counters of the cache, and of the background loading of StarBlocks by StarBlockLoader
+     */
+    struct Statistics
+    {
+        /** Trixels drawn with all the stars they needed */
+        quint64 hits { 0 };
+        /** Trixels drawn while some of their stars were still being loaded */
+        quint64 misses { 0 };
+        /** Blocks loaded ahead of time, for a predicted aperture */
+        quint64 prefetched { 0 };
+        /** Blocks loaded ahead of time that were discarded or recycled before being drawn */
+        quint64 wasted { 0 };
+        /** Blocks recycled by the clock */
+        quint64 evictions { 0 };
+        /** Blocks allocated, in use, and pinned */
+        int blocks { 0 };
+        int usedBlocks { 0 };
+        int pinnedBlocks { 0 };
+        /** Bytes allocated, and byte budget */
+        quint64 bytes { 0 };
+        quint64 budget { 0 };
+    };
+
+    /** @return a snapshot of the counters */
+    Statistics statistics() const;
+
+    /** @short Count a trixel drawn with, or without, all the stars it needed */
+    void countLookup(bool hit);
+
+    /** @short Count blocks loaded ahead of time and published */
+    inline void countPrefetched(int blocks) { prefetched += blocks; }
+
+    /** @short Count blocks loaded ahead of time that were discarded */
+    inline void countWasted(int blocks) { wasted += blocks; }
 
   private:
     /**
      * Constructor
-     * Initializes first and last StarBlock pointers to nullptr
+     * Sets the budget from the options
      */
     StarBlockFactory();
 
+    /** Number of shards, and number of blocks allocated at once by a shard */
+    static const int SHARDS    = 8;
+    static const int SLAB_SIZE = 16;
+
+    struct Shard
+    {
+        mutable QMutex mutex;
+        /** All the blocks of the shard, pointing in the slabs, in clock order */
+        QVector<std::shared_ptr<StarBlock>> blocks;
+        /** Blocks that are neither in a StarBlockList nor handed out by getBlock() */
+        QVector<StarBlock *> free;
+        /** Position of the clock hand in blocks */
+        int hand { 0 };
+    };
+
+    /** @short Allocate a slab of blocks in the free list of a shard, with its lock held */
+    void allocateSlab(Shard &shard, int index);
+
     /**
-     * @short  Deletes the N least recently used blocks
-     *
-     * @param  nblocks  Number of blocks to delete
-     * @return Number of blocks successfully deleted
+     * @short Run the clock of a shard, with its lock held, until a block is recycled
+     * @return true if a block was recycled, false if every block is in use
      */
-    int deleteBlocks(int nblocks);
+    bool evict(Shard &shard);
+
+    /** @return true if a shard may not allocate another slab, never before its first slab */
+    bool atBudget(const Shard &shard) const;
+
+    Shard shards[SHARDS];
+    std::atomic<quint64> budget { 0 };
+    /** Estimated size of a block with its stars */
+    quint64 blockBytes { 1 };
 
-    std::shared_ptr<StarBlock> first, last; // Pointers to the beginning and end of the linked list
-    int nBlocks;             // Number of blocks we currently have in the cache
-    int nCache;              // Number of blocks to start recycling cached blocks at
+    std::atomic<quint64> hits { 0 };
+    std::atomic<quint64> misses { 0 };
+    std::atomic<quint64> prefetched { 0 };
+    std::atomic<quint64> wasted { 0 };
+    std::atomic<quint64> evictions { 0 };
 
     static StarBlockFactory *pInstance;
 };
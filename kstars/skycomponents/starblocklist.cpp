@@ -20,6 +20,7 @@
 #include "binfilehelper.h"
 #include "deepstarcomponent.h"
 #include "starblock.h"
+#include "starblockfactory.h"
 #include "starcomponent.h"
 
 #ifdef KSTARS_LITE
@@ -33,7 +34,23 @@ StarBlockList::StarBlockList(const Trixel &tr, DeepStarComponent *parent)
 {
     trixel       = tr;
     this->parent = parent;
-    staticStars  = parent->hasStaticStars();
+    staticStars  = parent && parent->hasStaticStars();
+}
+
+StarBlockList::~StarBlockList()
+{
+    if (staticStars)
+        return;
+
+    StarBlockFactory *SBFactory = StarBlockFactory::Instance();
+    {
+        // The blocks leave the list as a whole, StarBlock::reset() must not release them one by one
+        QMutexLocker locker(SBFactory->lock(trixel));
+        for (const auto &block : blocks)
+            block->parent = nullptr;
+    }
+    for (const auto &block : blocks)
+        SBFactory->recycle(block);
 }
 
 int StarBlockList::releaseBlock(StarBlock *block)
@@ -58,7 +75,8 @@ int StarBlockList::releaseBlock(StarBlock *block)
         nBlocks--;
         nStars -= block->getStarCount();
 
-        readOffset -= parent->getStarReader()->guessRecordSize() * block->getStarCount();
+        if (parent)
+            readOffset -= parent->getStarReader()->guessRecordSize() * block->getStarCount();
         if (nBlocks <= 0)
             faintMag = -5.0;
         else
@@ -86,6 +104,10 @@ bool StarBlockList::fillToMag(float maglim)
     if (staticStars)
         return false;
 
+    // Spare the blocks in use from the next turn of the clock of StarBlockFactory
+    for (unsigned int i = 0; i < nBlocks && blocks[i]->getBrightMag() <= maglim; ++i)
+        blocks[i]->referenced.store(1);
+
     if (faintMag >= maglim)
         return true;
 
@@ -101,9 +123,13 @@ bool StarBlockList::fillToMag(float maglim)
     if (readOffset <= 0)
         readOffset = dSReader->getOffset(trixelId);
 
+    // Catalogs mapped in memory are decoded straight from the map, a block at a time
+    const BinFileHelper::RecordSpan records = dSReader->getRecords(trixelId);
+
     Q_ASSERT(nBlocks == (unsigned int)blocks.size());
 
-    BinFileHelper::unsigned_KDE_fseek(dataFile, readOffset, SEEK_SET);
+    if (!records.data)
+        BinFileHelper::unsigned_KDE_fseek(dataFile, readOffset, SEEK_SET);
 
     /*
     qDebug() << "Reading trixel" << trixel << ", id on disk =" << trixelId << ", currently nStars =" << nStars
@@ -117,7 +143,7 @@ bool StarBlockList::fillToMag(float maglim)
 
         if (nBlocks == 0 || blocks[nBlocks - 1]->isFull())
         {
-            std::shared_ptr<StarBlock> newBlock = SBFactory->getBlock();
+            std::shared_ptr<StarBlock> newBlock = SBFactory->getBlock(trixel);
 
             if (!newBlock.get())
             {
@@ -125,15 +151,34 @@ bool StarBlockList::fillToMag(float maglim)
                            << ", while trying to create block #" << nBlocks + 1;
                 return false;
             }
+
+            // Getting the block may have recycled the faint end of this very list
+            if (!records.data)
+                BinFileHelper::unsigned_KDE_fseek(dataFile, readOffset, SEEK_SET);
+
+            QMutexLocker locker(SBFactory->lock(trixel));
             blocks.append(newBlock);
             blocks[nBlocks]->parent = this;
-            if (nBlocks == 0)
-                SBFactory->markFirst(blocks[0]);
-            else if (!SBFactory->markNext(blocks[nBlocks - 1], blocks[nBlocks]))
-                qWarning() << "ERROR: markNext() failed on block #" << nBlocks + 1 << "in trixel" << trixel;
-
             ++nBlocks;
         }
+        if (records.data)
+        {
+            const int recordSize = dSReader->guessRecordSize();
+            const char *next     = records.data + nStars * recordSize;
+            const int available  = records.count - nStars;
+            int read             = 0;
+
+            if (recordSize == 32)
+                read = blocks[nBlocks - 1]->addStars<StarData>(next, available, dSReader->getByteSwap(), maglim);
+            else
+                read = blocks[nBlocks - 1]->addStars<DeepStarData>(next, available, dSReader->getByteSwap(), maglim);
+
+            readOffset += read * recordSize;
+            faintMag = blocks[nBlocks - 1]->getFaintMag();
+            nStars += read;
+            continue;
+        }
+
         // TODO: Make this more general
         if (dSReader->guessRecordSize() == 32)
         {
@@ -165,6 +210,31 @@ bool StarBlockList::fillToMag(float maglim)
     return ((maglim < faintMag) ? true : false);
 }
 
+bool StarBlockList::appendBlocks(unsigned long firstStar, long nextOffset, const QList<std::shared_ptr<StarBlock>> &newBlocks)
+{
+    StarBlockFactory *SBFactory = StarBlockFactory::Instance();
+
+    if (staticStars || firstStar != nStars)
+        return false;
+
+    QMutexLocker locker(SBFactory->lock(trixel));
+    for (const auto &newBlock : newBlocks)
+    {
+        if (newBlock->getStarCount() == 0)
+            continue;
+
+        blocks.append(newBlock);
+        blocks[nBlocks]->parent = this;
+        blocks[nBlocks]->referenced.store(1);
+        ++nBlocks;
+        nStars += newBlock->getStarCount();
+        faintMag = newBlock->getFaintMag();
+    }
+
+    readOffset = nextOffset;
+    return true;
+}
+
 void StarBlockList::setStaticBlock(std::shared_ptr<StarBlock> &block)
 {
     if (!block)
@@ -40,6 +40,12 @@ class StarBlockList
      */
     explicit StarBlockList(const Trixel &trixel, DeepStarComponent *parent = nullptr);
 
+    /**
+     * Destructor
+     * Gives the blocks back to StarBlockFactory
+     */
+    ~StarBlockList();
+
     /**
      * @short Ensures that the list is loaded with stars to given magnitude limit
      *
@@ -48,6 +54,20 @@ class StarBlockList
      */
     bool fillToMag(float maglim);
 
+    /**
+     * @short Appends StarBlocks filled elsewhere, typically by StarBlockLoader
+     *
+     * The blocks must hold the records that follow the ones already in the list, as they were when the blocks
+     * started to be filled.
+     *
+     * @param firstStar number of stars in the list when the blocks started to be filled
+     * @param nextOffset offset in the data file of the record following the last one in the blocks
+     * @param newBlocks the blocks to append, in magnitude order
+     * @return true if the blocks were appended, false if the list has changed meanwhile and the blocks are stale,
+     *         in which case they are still to be given back to StarBlockFactory
+     */
+    bool appendBlocks(unsigned long firstStar, long nextOffset, const QList<std::shared_ptr<StarBlock>> &newBlocks);
+
     /**
      * @short Sets the first StarBlock in the list to point to the given StarBlock
      *
@@ -97,6 +117,11 @@ class StarBlockList
      */
     inline float getFaintMag() const { return faintMag; }
 
+    /**
+     * @short  Returns the offset in the data file of the next record to read, 0 if nothing was read yet
+     */
+    inline long getReadOffset() const { return readOffset; }
+
     /**
      * @short  Returns the trixel that this SBL is meant for
      * @return The value of trixel
@@ -0,0 +1,377 @@
+/***************************************************************************
+                 starblockloader.cpp  -  K Desktop Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "starblockloader.h"
+
+#include "binfilehelper.h"
+#include "skymesh.h"
+#include "starblock.h"
+#include "starblockfactory.h"
+#include "starblocklist.h"
+#include "htmesh/MeshIterator.h"
+#include "skyobjects/deepstardata.h"
+#include "skyobjects/stardata.h"
+
+#include <QtConcurrent>
+
+#include <kstars_debug.h>
+
+#include <climits>
+#include <cmath>
+
+namespace
+{
+// Draws further apart than this, in milliseconds, do not belong to the same slew or zoom
+const qint64 PREDICT_MAX_INTERVAL = 1000;
+// Number of draws to look ahead
+const double PREDICT_LEAD = 2.0;
+
+void toUnitVector(const SkyPoint &p, double v[3])
+{
+    double sinRA, cosRA, sinDec, cosDec;
+    p.ra0().SinCos(sinRA, cosRA);
+    p.dec0().SinCos(sinDec, cosDec);
+    v[0] = cosDec * cosRA;
+    v[1] = cosDec * sinRA;
+    v[2] = sinDec;
+}
+}
+
+StarBlockLoader::StarBlockLoader(BinFileHelper *reader, SkyMesh *mesh,
+                                 const QVector<std::shared_ptr<StarBlockList>> &lists)
+    : m_Reader(reader), m_Mesh(mesh), m_Lists(lists)
+{
+    m_RecordSize = reader->guessRecordSize();
+    m_ByteSwap   = reader->getByteSwap();
+    m_Pool.setMaxThreadCount(1);
+
+    if (!reader->isMapped())
+        m_File.setFileName(reader->getFilePath());
+}
+
+StarBlockLoader::~StarBlockLoader()
+{
+    {
+        QMutexLocker locker(&m_Mutex);
+        m_Stopping = true;
+        m_Demand.clear();
+        m_Prefetch.clear();
+    }
+    m_Pool.waitForDone();
+
+    StarBlockFactory *SBFactory = StarBlockFactory::Instance();
+    for (const Result &result : m_Ready)
+    {
+        for (const auto &block : result.blocks)
+            SBFactory->recycle(block);
+    }
+
+    const StarBlockFactory::Statistics stats = SBFactory->statistics();
+    qCDebug(KSTARS) << "Deep star loading: trixel hits" << stats.hits << "misses" << stats.misses << ", blocks prefetched"
+                    << stats.prefetched << "wasted" << stats.wasted;
+}
+
+int StarBlockLoader::publish()
+{
+    QList<Result> ready;
+    {
+        QMutexLocker locker(&m_Mutex);
+        ready.swap(m_Ready);
+        m_Notified = false;
+        for (const Result &result : ready)
+        {
+            if (result.prefetch)
+                m_PrefetchBlocks -= result.blocks.size();
+        }
+    }
+
+    StarBlockFactory *SBFactory = StarBlockFactory::Instance();
+    int published               = 0;
+
+    for (const Result &result : ready)
+    {
+        m_Requested.remove(result.trixel);
+        if (result.blocks.isEmpty())
+            continue;
+
+        // The list may have been filled or recycled meanwhile, in which case the blocks no longer follow it
+        if (m_Lists.at(result.trixel)->appendBlocks(result.firstStar, result.nextOffset, result.blocks))
+        {
+            published += result.blocks.size();
+            if (result.prefetch)
+                SBFactory->countPrefetched(result.blocks.size());
+        }
+        else
+        {
+            // Counted as wasted if they were prefetched
+            for (const auto &block : result.blocks)
+                SBFactory->recycle(block);
+        }
+    }
+
+    // Keep free blocks at hand for the loading thread, which may not recycle blocks itself
+    SBFactory->trim();
+
+    return published;
+}
+
+bool StarBlockLoader::request(Trixel trixel, float maglim)
+{
+    const bool loaded = isLoaded(trixel, maglim);
+
+    StarBlockFactory::Instance()->countLookup(loaded);
+    if (!loaded)
+        enqueue(trixel, maglim, false);
+    return loaded;
+}
+
+void StarBlockLoader::predict(const SkyPoint &center, double radius, float maglim)
+{
+    {
+        QMutexLocker locker(&m_Mutex);
+        // Predictions of the previous draw are stale, drop those that are not loaded yet
+        for (const Request &request : m_Prefetch)
+            m_Requested.remove(request.trixel);
+        m_Prefetch.clear();
+        // Leave most of the cache to the blocks being drawn
+        m_PrefetchBudget = StarBlockFactory::Instance()->getCacheSize() / 4;
+    }
+
+    const bool sameMotion = m_LastPredict.isValid() && m_LastPredict.elapsed() < PREDICT_MAX_INTERVAL && m_LastRadius > 0;
+    const SkyPoint lastCenter = m_LastCenter;
+    const double lastRadius   = m_LastRadius;
+    const float lastMagLim    = m_LastMagLim;
+
+    m_LastCenter = center;
+    m_LastRadius = radius;
+    m_LastMagLim = maglim;
+    m_LastPredict.start();
+
+    if (!sameMotion)
+        return;
+
+    // Extrapolate the motion of the center, the zoom, and the magnitude limit that follows the zoom
+    double v[3], u[3], p[3];
+    toUnitVector(center, v);
+    toUnitVector(lastCenter, u);
+
+    double moved = 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        p[i] = v[i] + PREDICT_LEAD * (v[i] - u[i]);
+        moved += (v[i] - u[i]) * (v[i] - u[i]);
+    }
+
+    // Nothing to foresee when the sky map stands still
+    if (moved < 1e-12 && radius == lastRadius && maglim == lastMagLim)
+        return;
+
+    const double norm      = sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+    double ra              = atan2(p[1], p[0]) / dms::DegToRad;
+    const double dec       = asin(p[2] / norm) / dms::DegToRad;
+    const double predicted = qMin(90.0, radius * pow(radius / lastRadius, PREDICT_LEAD));
+    const float magLimit   = maglim + PREDICT_LEAD * (maglim - lastMagLim);
+
+    if (ra < 0)
+        ra += 360.0;
+
+    m_Mesh->intersect(ra, dec, predicted, (BufNum)PREFETCH_BUF);
+
+    MeshIterator region(m_Mesh, PREFETCH_BUF);
+    while (region.hasNext())
+    {
+        Trixel trixel = region.next();
+
+        if ((int)trixel >= m_Lists.size())
+            continue;
+
+        if (!isLoaded(trixel, magLimit))
+            enqueue(trixel, magLimit, true);
+    }
+}
+
+bool StarBlockLoader::isLoaded(Trixel trixel, float maglim) const
+{
+    const std::shared_ptr<StarBlockList> &sbl = m_Lists.at(trixel);
+
+    // Loading stops after the first star fainter than maglim, as in StarBlockList::fillToMag(): until then, stars
+    // as faint as the faintest one loaded may follow
+    return sbl->getFaintMag() > maglim || sbl->getStarCount() >= m_Reader->getRecordCount(trixel);
+}
+
+void StarBlockLoader::enqueue(Trixel trixel, float maglim, bool prefetch)
+{
+    if (m_Requested.contains(trixel))
+    {
+        if (prefetch)
+            return;
+
+        // A trixel that was predicted is needed now, move it ahead of the other predictions
+        QMutexLocker locker(&m_Mutex);
+        for (int i = 0; i < m_Prefetch.size(); ++i)
+        {
+            if (m_Prefetch.at(i).trixel == trixel)
+            {
+                Request request  = m_Prefetch.takeAt(i);
+                request.prefetch = false;
+                request.maglim   = qMax(request.maglim, maglim);
+                m_Demand.append(request);
+                break;
+            }
+        }
+        return;
+    }
+
+    const std::shared_ptr<StarBlockList> &sbl = m_Lists.at(trixel);
+
+    // The loading thread works on a copy of the state of the list, see StarBlockList::appendBlocks()
+    Request request;
+    request.trixel      = trixel;
+    request.maglim      = maglim;
+    request.prefetch    = prefetch;
+    request.firstStar   = sbl->getStarCount();
+    request.faintMag    = sbl->getFaintMag();
+    request.offset      = (sbl->getReadOffset() > 0) ? sbl->getReadOffset() : m_Reader->getOffset(trixel);
+    request.recordCount = m_Reader->getRecordCount(trixel);
+    request.records     = m_Reader->getRecords(trixel).data;
+
+    m_Requested.insert(trixel);
+
+    QMutexLocker locker(&m_Mutex);
+    if (prefetch)
+        m_Prefetch.append(request);
+    else
+        m_Demand.append(request);
+
+    if (!m_Running)
+    {
+        m_Running = true;
+        QtConcurrent::run(&m_Pool, [this]()
+        {
+            run();
+        });
+    }
+}
+
+void StarBlockLoader::run()
+{
+    while (true)
+    {
+        Request request;
+        int maxBlocks = INT_MAX;
+        {
+            QMutexLocker locker(&m_Mutex);
+            if (m_Stopping || (m_Demand.isEmpty() && m_Prefetch.isEmpty()))
+            {
+                m_Running = false;
+                return;
+            }
+            request = m_Demand.isEmpty() ? m_Prefetch.takeFirst() : m_Demand.takeFirst();
+            if (request.prefetch)
+                maxBlocks = qMax(0, m_PrefetchBudget - m_PrefetchBlocks);
+        }
+
+        // Requests are always answered, if only to be removed from m_Requested
+        Result result = load(request, maxBlocks);
+
+        bool notify = false;
+        {
+            QMutexLocker locker(&m_Mutex);
+            if (result.prefetch)
+                m_PrefetchBlocks += result.blocks.size();
+            if (!result.blocks.isEmpty() && !m_Notified)
+                notify = m_Notified = true;
+            m_Ready.append(result);
+        }
+
+        if (notify)
+            emit blocksReady();
+    }
+}
+
+StarBlockLoader::Result StarBlockLoader::load(const Request &request, int maxBlocks)
+{
+    Result result;
+    result.trixel    = request.trixel;
+    result.prefetch  = request.prefetch;
+    result.firstStar = request.firstStar;
+
+    unsigned long nStars = request.firstStar;
+    long offset          = request.offset;
+    float faintMag       = request.faintMag;
+    QByteArray buffer;
+    StarBlockFactory *SBFactory = StarBlockFactory::Instance();
+    std::shared_ptr<StarBlock> block;
+
+    if (!request.records && !m_File.isOpen() && !m_File.open(QIODevice::ReadOnly))
+    {
+        qCWarning(KSTARS) << "Could not open" << m_File.fileName() << "to load trixel" << request.trixel << ":"
+                          << m_File.errorString();
+        result.nextOffset = offset;
+        return result;
+    }
+
+    // Same as StarBlockList::fillToMag(), into new blocks
+    while (request.maglim >= faintMag && nStars < request.recordCount)
+    {
+        if (!block || block->isFull())
+        {
+            if (result.blocks.size() >= maxBlocks)
+                break;
+            // Without a free block, the stars are loaded again at the next request, after publish() made room
+            block = SBFactory->getBlock(request.trixel, false);
+            if (!block)
+                break;
+            block->prefetched = request.prefetch;
+            result.blocks.append(block);
+        }
+
+        int available    = request.recordCount - nStars;
+        const char *next = nullptr;
+
+        if (request.records)
+            next = request.records + nStars * m_RecordSize;
+        else
+        {
+            // Read no more than the block can take, the rest may not be needed
+            available = qMin(available, block->size() - block->getStarCount());
+            buffer.resize(available * m_RecordSize);
+            if (!m_File.seek(offset) || m_File.read(buffer.data(), buffer.size()) != buffer.size())
+            {
+                qCWarning(KSTARS) << "Could not read trixel" << request.trixel << "from" << m_File.fileName();
+                break;
+            }
+            next = buffer.constData();
+        }
+
+        int read = 0;
+        if (m_RecordSize == 32)
+            read = block->addStars<StarData>(next, available, m_ByteSwap, request.maglim);
+        else
+            read = block->addStars<DeepStarData>(next, available, m_ByteSwap, request.maglim);
+
+        offset += read * m_RecordSize;
+        nStars += read;
+        faintMag = block->getFaintMag();
+    }
+
+    if (block && block->getStarCount() == 0)
+    {
+        SBFactory->recycle(block);
+        result.blocks.removeLast();
+    }
+
+    result.nextOffset = offset;
+    return result;
+}
@@ -0,0 +1,164 @@
+/***************************************************************************
+                 starblockloader.h  -  K Desktop Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#pragma once
+
+#include "typedef.h"
+#include "skyobjects/skypoint.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QThreadPool>
+#include <QVector>
+
+#include <memory>
+
+class BinFileHelper;
+class SkyMesh;
+class StarBlock;
+class StarBlockList;
+
+/**
+ * @class StarBlockLoader
+ *
+ * @short Fills the StarBlockLists of a deep star catalog in the background
+ *
+ * DeepStarComponent::draw() used to call StarBlockList::fillToMag() for every visible trixel, reading the catalog
+ * in the paint path. Instead, draw() now asks this loader for the trixels it needs with request(), and draws
+ * whatever stars are already there. Only images drawn once, when exporting or printing the sky map, still call
+ * fillToMag(), see SkyPainter::setWaitForStars(). The loader reads the missing stars in a thread of its own, into fresh
+ * StarBlocks, and hands them back once complete. publish() then appends them to their StarBlockList in one go
+ * from the GUI thread, so that draw() never sees a half filled block and never waits for the disk.
+ *
+ * The loader also looks one step ahead: predict() extrapolates the motion and the zoom of the last draws, and loads
+ * the trixels of the predicted aperture before they are needed. The blocks loaded ahead of time may take up to a
+ * quarter of the budget of StarBlockFactory, which also keeps the hit, miss and prefetch waste counters.
+ *
+ * The loading thread takes its blocks from StarBlockFactory without recycling any, see StarBlockFactory::getBlock().
+ *
+ * All methods but the loading itself are to be called from the GUI thread.
+ */
+class StarBlockLoader : public QObject
+{
+    Q_OBJECT
+
+  public:
+    /**
+     * @param reader the open catalog, mapped in memory or not
+     * @param mesh the mesh indexing the catalog
+     * @param lists the StarBlockLists of the catalog, indexed by trixel
+     */
+    StarBlockLoader(BinFileHelper *reader, SkyMesh *mesh, const QVector<std::shared_ptr<StarBlockList>> &lists);
+
+    /** Cancel the pending requests and wait for the one being loaded */
+    ~StarBlockLoader() override;
+
+    /**
+     * @short Append the blocks loaded since the last call to their StarBlockList
+     * @note  To be called once per draw, after the blocks in use are pinned with StarBlockFactory::Pins
+     * @return the number of blocks appended
+     */
+    int publish();
+
+    /**
+     * @short Ask for the stars of a trixel to be loaded up to the given magnitude
+     * @return true if they are already loaded, false if they will be loaded in the background
+     */
+    bool request(Trixel trixel, float maglim);
+
+    /**
+     * @short Guess the next aperture from the last ones and load its trixels in the background
+     * @param center center of the current aperture, in catalog coordinates
+     * @param radius radius of the current aperture in degrees
+     * @param maglim magnitude limit of the current draw
+     */
+    void predict(const SkyPoint &center, double radius, float maglim);
+
+  signals:
+    /** Emitted from the loading thread when blocks are ready to be published */
+    void blocksReady();
+
+  private:
+    struct Request
+    {
+        Trixel trixel { 0 };
+        float maglim { 0 };
+        bool prefetch { false };
+        /** State of the StarBlockList when the request was made */
+        unsigned long firstStar { 0 };
+        float faintMag { 0 };
+        long offset { 0 };
+        quint32 recordCount { 0 };
+        /** Records of the trixel if the catalog is mapped in memory */
+        const char *records { nullptr };
+    };
+
+    struct Result
+    {
+        Trixel trixel { 0 };
+        bool prefetch { false };
+        unsigned long firstStar { 0 };
+        long nextOffset { 0 };
+        QList<std::shared_ptr<StarBlock>> blocks;
+    };
+
+    /** @return true if the list of the trixel holds all the stars down to maglim */
+    bool isLoaded(Trixel trixel, float maglim) const;
+
+    /** Queue a request, unless the trixel is already queued or being loaded */
+    void enqueue(Trixel trixel, float maglim, bool prefetch);
+
+    /** Load the queued requests, run in the thread pool */
+    void run();
+
+    /** Read the stars of a request into at most maxBlocks new StarBlocks */
+    Result load(const Request &request, int maxBlocks);
+
+    BinFileHelper *m_Reader { nullptr };
+    SkyMesh *m_Mesh { nullptr };
+    const QVector<std::shared_ptr<StarBlockList>> &m_Lists;
+    int m_RecordSize { 0 };
+    bool m_ByteSwap { false };
+
+    /** A single thread loads the requests in order, demand first */
+    QThreadPool m_Pool;
+    /** Own handle to the catalog when it is not mapped, only used by the loading thread */
+    QFile m_File;
+
+    /** Protects the queues, the results and the flags below */
+    QMutex m_Mutex;
+    QList<Request> m_Demand;
+    QList<Request> m_Prefetch;
+    QList<Result> m_Ready;
+    bool m_Running { false };
+    bool m_Stopping { false };
+    /** blocksReady() was emitted and publish() has not been called since */
+    bool m_Notified { false };
+    /** Prefetched blocks not published yet, and how many of them are allowed */
+    int m_PrefetchBlocks { 0 };
+    int m_PrefetchBudget { 0 };
+
+    /** Trixels queued or being loaded, GUI thread only */
+    QSet<Trixel> m_Requested;
+
+    /** Last aperture, for predict() */
+    SkyPoint m_LastCenter;
+    double m_LastRadius { 0 };
+    float m_LastMagLim { 0 };
+    QElapsedTimer m_LastPredict;
+};
@@ -312,8 +312,6 @@ void StarComponent::draw(SkyPainter *skyp)
     if (hideFaintStars && maglim > hideStarsMag)
         maglim = hideStarsMag;
 
-    m_StarBlockFactory->drawID = m_skyMesh->drawID();
-
     int nTrixels = 0;
 
     while (region.hasNext())
@@ -587,6 +585,15 @@ void StarComponent::appendListObject(SkyObject *object)
     m_ObjectHash.insert(object->name2().toLower(), object);
     m_ObjectHash.insert(object->name2().toLower(), object);
     m_ObjectHash.insert((dynamic_cast<StarObject *>(object))->gname(false).toLower(), object);
+
+    // Unnamed stars go by their genetive name only
+    if (object->name() != i18n("star"))
+        indexName(object->name(), object);
+    if (object->longname() != i18n("star"))
+        indexName(object->longname(), object);
+    indexName(object->name2(), object);
+    indexName((dynamic_cast<StarObject *>(object))->gname(false), object);
+    indexName((dynamic_cast<StarObject *>(object))->gname(true), object);
 }
 
 SkyObject *StarComponent::findStarByGenetiveName(const QString name)
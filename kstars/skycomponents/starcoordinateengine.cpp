@@ -0,0 +1,479 @@
+/***************************************************************************
+              starcoordinateengine.cpp  -  K Desktop Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "starcoordinateengine.h"
+
+#include "ksnumbers.h"
+#include "Options.h"
+#include "starblock.h"
+#include "skyobjects/starobject.h"
+
+#include <Eigen/Geometry>
+
+#include <algorithm>
+#include <cmath>
+#ifdef PROFILE_UPDATECOORDS
+#include <ctime>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STAR_COORDINATES_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+/** Number of stars transformed together, small enough for the batch to stay in L1 cache */
+const int ChunkSize = 64;
+
+/** Proper motions below one arcsecond are ignored, like StarObject::getIndexCoords() does */
+const double MinProperMotion2 = (dms::DegToRad / 3600.0) * (dms::DegToRad / 3600.0);
+
+/** Largest squared proper motion displacement, in radians, for which the vector kernels use series */
+const double MaxSeriesProperMotion2 = 0.1 * 0.1;
+
+/** Same as StarObject::JITupdate(), positions are recomputed once per solar minute */
+const double RecomputeInterval = 0.00069444;
+
+struct Constants
+{
+    double m[9];
+    double beta[3];
+    double sinLST, cosLST, sinLat, cosLat;
+    double t;
+};
+
+/**
+ * Positions of a batch of stars. Before the apparent kernel x, y, z and pm* are the catalog data of the
+ * stars, after it x, y, z are their apparent positions. The horizontal kernel fills sinAlt, north and east.
+ */
+struct Chunk
+{
+    alignas(32) double x[ChunkSize];
+    alignas(32) double y[ChunkSize];
+    alignas(32) double z[ChunkSize];
+    alignas(32) double pmX[ChunkSize];
+    alignas(32) double pmY[ChunkSize];
+    alignas(32) double pmZ[ChunkSize];
+    alignas(32) double pm2[ChunkSize];
+    alignas(32) double sinAlt[ChunkSize];
+    alignas(32) double north[ChunkSize];
+    alignas(32) double east[ChunkSize];
+};
+
+typedef void (*Kernel)(const Constants &c, Chunk &chunk, int begin, int end);
+
+inline void scalarApparentStar(const Constants &c, Chunk &chunk, int i)
+{
+    double x = chunk.x[i], y = chunk.y[i], z = chunk.z[i];
+
+    // Proper motion along a great circle: u cos(d) + w t sin(d) / d, with d = |w t|
+    const double d2 = chunk.pm2[i] * c.t * c.t;
+    if (d2 >= MinProperMotion2)
+    {
+        const double d = std::sqrt(d2);
+        const double cosD = std::cos(d), s = c.t * std::sin(d) / d;
+        x = x * cosD + chunk.pmX[i] * s;
+        y = y * cosD + chunk.pmY[i] * s;
+        z = z * cosD + chunk.pmZ[i] * s;
+    }
+
+    // Precession and nutation
+    const double vx = c.m[0] * x + c.m[1] * y + c.m[2] * z;
+    const double vy = c.m[3] * x + c.m[4] * y + c.m[5] * z;
+    const double vz = c.m[6] * x + c.m[7] * y + c.m[8] * z;
+
+    // Annual aberration, to first order in v/c
+    const double dot = vx * c.beta[0] + vy * c.beta[1] + vz * c.beta[2];
+    const double ax = vx + c.beta[0] - dot * vx;
+    const double ay = vy + c.beta[1] - dot * vy;
+    const double az = vz + c.beta[2] - dot * vz;
+    const double n = 1.0 / std::sqrt(ax * ax + ay * ay + az * az);
+
+    chunk.x[i] = ax * n;
+    chunk.y[i] = ay * n;
+    chunk.z[i] = az * n;
+}
+
+inline void scalarHorizontalStar(const Constants &c, Chunk &chunk, int i)
+{
+    // Hour angle components, then a rotation about the east-west axis by the colatitude
+    const double hx = chunk.x[i] * c.cosLST + chunk.y[i] * c.sinLST;
+    const double hy = chunk.x[i] * c.sinLST - chunk.y[i] * c.cosLST;
+
+    chunk.sinAlt[i] = chunk.z[i] * c.sinLat + hx * c.cosLat;
+    chunk.north[i]  = chunk.z[i] * c.cosLat - hx * c.sinLat;
+    chunk.east[i]   = -hy;
+}
+
+void scalarApparent(const Constants &c, Chunk &chunk, int begin, int end)
+{
+    for (int i = begin; i < end; ++i)
+        scalarApparentStar(c, chunk, i);
+}
+
+void scalarHorizontal(const Constants &c, Chunk &chunk, int begin, int end)
+{
+    for (int i = begin; i < end; ++i)
+        scalarHorizontalStar(c, chunk, i);
+}
+
+#ifdef STAR_COORDINATES_X86
+
+bool hasAVX2()
+{
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+#ifdef __SSE2__
+
+// The vector kernels replace sin(d) and cos(d) of the proper motion displacement with their series, which are
+// exact to better than a milliarcsecond for the displacements they are selected for.
+
+void sse2Apparent(const Constants &c, Chunk &chunk, int begin, int end)
+{
+    const __m128d one = _mm_set1_pd(1.0), t = _mm_set1_pd(c.t), t2 = _mm_set1_pd(c.t * c.t);
+    const __m128d minPM2 = _mm_set1_pd(MinProperMotion2);
+    const __m128d m0 = _mm_set1_pd(c.m[0]), m1 = _mm_set1_pd(c.m[1]), m2 = _mm_set1_pd(c.m[2]);
+    const __m128d m3 = _mm_set1_pd(c.m[3]), m4 = _mm_set1_pd(c.m[4]), m5 = _mm_set1_pd(c.m[5]);
+    const __m128d m6 = _mm_set1_pd(c.m[6]), m7 = _mm_set1_pd(c.m[7]), m8 = _mm_set1_pd(c.m[8]);
+    const __m128d bx = _mm_set1_pd(c.beta[0]), by = _mm_set1_pd(c.beta[1]), bz = _mm_set1_pd(c.beta[2]);
+
+    int i = begin;
+    for (; i + 2 <= end; i += 2)
+    {
+        __m128d x = _mm_loadu_pd(chunk.x + i), y = _mm_loadu_pd(chunk.y + i), z = _mm_loadu_pd(chunk.z + i);
+
+        const __m128d d2   = _mm_mul_pd(_mm_loadu_pd(chunk.pm2 + i), t2);
+        const __m128d mask = _mm_cmpge_pd(d2, minPM2);
+        __m128d cosD = _mm_add_pd(_mm_set1_pd(-0.5), _mm_mul_pd(d2, _mm_set1_pd(1.0 / 24.0)));
+        cosD = _mm_add_pd(one, _mm_mul_pd(d2, cosD));
+        __m128d s = _mm_add_pd(_mm_set1_pd(-1.0 / 6.0), _mm_mul_pd(d2, _mm_set1_pd(1.0 / 120.0)));
+        s = _mm_mul_pd(t, _mm_add_pd(one, _mm_mul_pd(d2, s)));
+        cosD = _mm_or_pd(_mm_and_pd(mask, cosD), _mm_andnot_pd(mask, one));
+        s = _mm_and_pd(mask, s);
+
+        x = _mm_add_pd(_mm_mul_pd(x, cosD), _mm_mul_pd(_mm_loadu_pd(chunk.pmX + i), s));
+        y = _mm_add_pd(_mm_mul_pd(y, cosD), _mm_mul_pd(_mm_loadu_pd(chunk.pmY + i), s));
+        z = _mm_add_pd(_mm_mul_pd(z, cosD), _mm_mul_pd(_mm_loadu_pd(chunk.pmZ + i), s));
+
+        const __m128d vx = _mm_add_pd(_mm_add_pd(_mm_mul_pd(m0, x), _mm_mul_pd(m1, y)), _mm_mul_pd(m2, z));
+        const __m128d vy = _mm_add_pd(_mm_add_pd(_mm_mul_pd(m3, x), _mm_mul_pd(m4, y)), _mm_mul_pd(m5, z));
+        const __m128d vz = _mm_add_pd(_mm_add_pd(_mm_mul_pd(m6, x), _mm_mul_pd(m7, y)), _mm_mul_pd(m8, z));
+
+        const __m128d dot = _mm_add_pd(_mm_add_pd(_mm_mul_pd(vx, bx), _mm_mul_pd(vy, by)), _mm_mul_pd(vz, bz));
+        const __m128d ax  = _mm_sub_pd(_mm_add_pd(vx, bx), _mm_mul_pd(dot, vx));
+        const __m128d ay  = _mm_sub_pd(_mm_add_pd(vy, by), _mm_mul_pd(dot, vy));
+        const __m128d az  = _mm_sub_pd(_mm_add_pd(vz, bz), _mm_mul_pd(dot, vz));
+        const __m128d n   = _mm_div_pd(one, _mm_sqrt_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(ax, ax), _mm_mul_pd(ay, ay)),
+                                                                 _mm_mul_pd(az, az))));
+
+        _mm_storeu_pd(chunk.x + i, _mm_mul_pd(ax, n));
+        _mm_storeu_pd(chunk.y + i, _mm_mul_pd(ay, n));
+        _mm_storeu_pd(chunk.z + i, _mm_mul_pd(az, n));
+    }
+
+    for (; i < end; ++i)
+        scalarApparentStar(c, chunk, i);
+}
+
+void sse2Horizontal(const Constants &c, Chunk &chunk, int begin, int end)
+{
+    const __m128d sinLST = _mm_set1_pd(c.sinLST), cosLST = _mm_set1_pd(c.cosLST);
+    const __m128d sinLat = _mm_set1_pd(c.sinLat), cosLat = _mm_set1_pd(c.cosLat);
+
+    int i = begin;
+    for (; i + 2 <= end; i += 2)
+    {
+        const __m128d x = _mm_loadu_pd(chunk.x + i), y = _mm_loadu_pd(chunk.y + i), z = _mm_loadu_pd(chunk.z + i);
+        const __m128d hx = _mm_add_pd(_mm_mul_pd(x, cosLST), _mm_mul_pd(y, sinLST));
+        const __m128d hy = _mm_sub_pd(_mm_mul_pd(x, sinLST), _mm_mul_pd(y, cosLST));
+
+        _mm_storeu_pd(chunk.sinAlt + i, _mm_add_pd(_mm_mul_pd(z, sinLat), _mm_mul_pd(hx, cosLat)));
+        _mm_storeu_pd(chunk.north + i, _mm_sub_pd(_mm_mul_pd(z, cosLat), _mm_mul_pd(hx, sinLat)));
+        _mm_storeu_pd(chunk.east + i, _mm_sub_pd(_mm_setzero_pd(), hy));
+    }
+
+    for (; i < end; ++i)
+        scalarHorizontalStar(c, chunk, i);
+}
+
+#endif // __SSE2__
+
+__attribute__((target("avx2")))
+void avx2Apparent(const Constants &c, Chunk &chunk, int begin, int end)
+{
+    const __m256d one = _mm256_set1_pd(1.0), t = _mm256_set1_pd(c.t), t2 = _mm256_set1_pd(c.t * c.t);
+    const __m256d minPM2 = _mm256_set1_pd(MinProperMotion2);
+    const __m256d m0 = _mm256_set1_pd(c.m[0]), m1 = _mm256_set1_pd(c.m[1]), m2 = _mm256_set1_pd(c.m[2]);
+    const __m256d m3 = _mm256_set1_pd(c.m[3]), m4 = _mm256_set1_pd(c.m[4]), m5 = _mm256_set1_pd(c.m[5]);
+    const __m256d m6 = _mm256_set1_pd(c.m[6]), m7 = _mm256_set1_pd(c.m[7]), m8 = _mm256_set1_pd(c.m[8]);
+    const __m256d bx = _mm256_set1_pd(c.beta[0]), by = _mm256_set1_pd(c.beta[1]), bz = _mm256_set1_pd(c.beta[2]);
+
+    int i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        __m256d x = _mm256_loadu_pd(chunk.x + i), y = _mm256_loadu_pd(chunk.y + i), z = _mm256_loadu_pd(chunk.z + i);
+
+        const __m256d d2   = _mm256_mul_pd(_mm256_loadu_pd(chunk.pm2 + i), t2);
+        const __m256d mask = _mm256_cmp_pd(d2, minPM2, _CMP_GE_OQ);
+        __m256d cosD = _mm256_add_pd(_mm256_set1_pd(-0.5), _mm256_mul_pd(d2, _mm256_set1_pd(1.0 / 24.0)));
+        cosD = _mm256_add_pd(one, _mm256_mul_pd(d2, cosD));
+        __m256d s = _mm256_add_pd(_mm256_set1_pd(-1.0 / 6.0), _mm256_mul_pd(d2, _mm256_set1_pd(1.0 / 120.0)));
+        s = _mm256_mul_pd(t, _mm256_add_pd(one, _mm256_mul_pd(d2, s)));
+        cosD = _mm256_blendv_pd(one, cosD, mask);
+        s = _mm256_and_pd(mask, s);
+
+        x = _mm256_add_pd(_mm256_mul_pd(x, cosD), _mm256_mul_pd(_mm256_loadu_pd(chunk.pmX + i), s));
+        y = _mm256_add_pd(_mm256_mul_pd(y, cosD), _mm256_mul_pd(_mm256_loadu_pd(chunk.pmY + i), s));
+        z = _mm256_add_pd(_mm256_mul_pd(z, cosD), _mm256_mul_pd(_mm256_loadu_pd(chunk.pmZ + i), s));
+
+        const __m256d vx = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(m0, x), _mm256_mul_pd(m1, y)), _mm256_mul_pd(m2, z));
+        const __m256d vy = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(m3, x), _mm256_mul_pd(m4, y)), _mm256_mul_pd(m5, z));
+        const __m256d vz = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(m6, x), _mm256_mul_pd(m7, y)), _mm256_mul_pd(m8, z));
+
+        const __m256d dot =
+            _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(vx, bx), _mm256_mul_pd(vy, by)), _mm256_mul_pd(vz, bz));
+        const __m256d ax = _mm256_sub_pd(_mm256_add_pd(vx, bx), _mm256_mul_pd(dot, vx));
+        const __m256d ay = _mm256_sub_pd(_mm256_add_pd(vy, by), _mm256_mul_pd(dot, vy));
+        const __m256d az = _mm256_sub_pd(_mm256_add_pd(vz, bz), _mm256_mul_pd(dot, vz));
+        const __m256d n  = _mm256_div_pd(
+                              one, _mm256_sqrt_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ax, ax), _mm256_mul_pd(ay, ay)),
+                                                                _mm256_mul_pd(az, az))));
+
+        _mm256_storeu_pd(chunk.x + i, _mm256_mul_pd(ax, n));
+        _mm256_storeu_pd(chunk.y + i, _mm256_mul_pd(ay, n));
+        _mm256_storeu_pd(chunk.z + i, _mm256_mul_pd(az, n));
+    }
+
+    for (; i < end; ++i)
+        scalarApparentStar(c, chunk, i);
+}
+
+__attribute__((target("avx2")))
+void avx2Horizontal(const Constants &c, Chunk &chunk, int begin, int end)
+{
+    const __m256d sinLST = _mm256_set1_pd(c.sinLST), cosLST = _mm256_set1_pd(c.cosLST);
+    const __m256d sinLat = _mm256_set1_pd(c.sinLat), cosLat = _mm256_set1_pd(c.cosLat);
+
+    int i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        const __m256d x = _mm256_loadu_pd(chunk.x + i), y = _mm256_loadu_pd(chunk.y + i);
+        const __m256d z = _mm256_loadu_pd(chunk.z + i);
+        const __m256d hx = _mm256_add_pd(_mm256_mul_pd(x, cosLST), _mm256_mul_pd(y, sinLST));
+        const __m256d hy = _mm256_sub_pd(_mm256_mul_pd(x, sinLST), _mm256_mul_pd(y, cosLST));
+
+        _mm256_storeu_pd(chunk.sinAlt + i, _mm256_add_pd(_mm256_mul_pd(z, sinLat), _mm256_mul_pd(hx, cosLat)));
+        _mm256_storeu_pd(chunk.north + i, _mm256_sub_pd(_mm256_mul_pd(z, cosLat), _mm256_mul_pd(hx, sinLat)));
+        _mm256_storeu_pd(chunk.east + i, _mm256_sub_pd(_mm256_setzero_pd(), hy));
+    }
+
+    for (; i < end; ++i)
+        scalarHorizontalStar(c, chunk, i);
+}
+
+#endif // STAR_COORDINATES_X86
+
+/** The vector kernels, for blocks whose proper motions are small enough for the series, see MaxSeriesProperMotion2 */
+Kernel selectApparent()
+{
+#ifdef STAR_COORDINATES_X86
+    if (hasAVX2())
+        return &avx2Apparent;
+#ifdef __SSE2__
+    return &sse2Apparent;
+#endif
+#endif
+    return &scalarApparent;
+}
+
+Kernel selectHorizontal()
+{
+#ifdef STAR_COORDINATES_X86
+    if (hasAVX2())
+        return &avx2Horizontal;
+#ifdef __SSE2__
+    return &sse2Horizontal;
+#endif
+#endif
+    return &scalarHorizontal;
+}
+
+#ifdef KSTARS_LITE
+inline StarObject &starOf(StarBlock::StarBlockEntry &entry)
+{
+    return entry.star;
+}
+#else
+inline StarObject &starOf(StarBlock::StarBlockEntry &entry)
+{
+    return entry;
+}
+#endif
+}
+
+StarCoordinateEngine::StarCoordinateEngine(const KSNumbers *num, const CachingDms *LST, const CachingDms *lat)
+{
+    // Nutation rotates the mean equator of date to the true equator of date: a rotation by dEcLong about the
+    // ecliptic pole, with the obliquity changing by dObliq. To first order, this is what SkyPoint::nutate() does.
+    const double obliquity = num->obliquity()->radians();
+    const double dEcLong   = num->dEcLong() * dms::DegToRad;
+    const double dObliq    = num->dObliq() * dms::DegToRad;
+    const Eigen::Matrix3d nutation = (Eigen::AngleAxisd(obliquity + dObliq, Eigen::Vector3d::UnitX()) *
+                                      Eigen::AngleAxisd(dEcLong, Eigen::Vector3d::UnitZ()) *
+                                      Eigen::AngleAxisd(-obliquity, Eigen::Vector3d::UnitX()))
+                                         .toRotationMatrix();
+    const Eigen::Matrix3d rotation = nutation * num->p2();
+    for (int row = 0; row < 3; ++row)
+        for (int column = 0; column < 3; ++column)
+            m_Rotation[3 * row + column] = rotation(row, column);
+
+    // Velocity of the Earth from the sun longitude and the eccentricity of the orbit, as in SkyPoint::aberrate()
+    double sinOb, cosOb, sinL, cosL, sinP, cosP;
+    num->obliquity()->SinCos(sinOb, cosOb);
+    num->sunTrueLongitude().SinCos(sinL, cosL);
+    num->earthPerihelionLongitude().SinCos(sinP, cosP);
+    const double K = num->constAberr().radians(), e = num->earthEccentricity();
+    m_Aberration[0] = K * (sinL - e * sinP);
+    m_Aberration[1] = K * (e * cosP - cosL) * cosOb;
+    m_Aberration[2] = K * (e * cosP - cosL) * sinOb;
+
+    LST->SinCos(m_SinLST, m_CosLST);
+    lat->SinCos(m_SinLat, m_CosLat);
+    m_Millenia = num->julianMillenia();
+    m_JD       = num->getJD();
+
+    m_Relativistic    = Options::useRelativistic();
+    m_AlwaysRecompute = Options::alwaysRecomputeCoordinates();
+}
+
+void StarCoordinateEngine::update(StarBlock *block, float maglim, quint64 updateID, quint64 updateNumID) const
+{
+    const int count = block->getStarCount();
+
+    if (m_Relativistic)
+    {
+        // Light bending is checked star by star against the position of the Sun
+        for (int i = 0; i < count; ++i)
+        {
+            StarObject &star = starOf(*block->star(i));
+            if (star.updateID != updateID)
+                star.JITupdate();
+            if (star.mag() > maglim)
+                break;
+        }
+        return;
+    }
+
+    Constants c;
+    std::copy(m_Rotation, m_Rotation + 9, c.m);
+    std::copy(m_Aberration, m_Aberration + 3, c.beta);
+    c.sinLST = m_SinLST;
+    c.cosLST = m_CosLST;
+    c.sinLat = m_SinLat;
+    c.cosLat = m_CosLat;
+    c.t      = m_Millenia;
+
+    static const Kernel vectorApparent = selectApparent(), vectorHorizontal = selectHorizontal();
+    const Kernel apparent =
+        block->getMaxProperMotion2() * c.t * c.t <= MaxSeriesProperMotion2 ? vectorApparent : &scalarApparent;
+
+    const StarBlock::Coordinates &coords = block->coordinates();
+    Chunk chunk;
+    // Stars whose position is recomputed go first in the chunk, followed by those only needing Alt/Az
+    int recomputed[ChunkSize], current[ChunkSize];
+    int nRecomputed = 0, nCurrent = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        StarObject &star = starOf(*block->star(i));
+        const bool last  = star.mag() > maglim;
+
+        if (star.updateID != updateID)
+        {
+            bool recompute = false;
+            if (star.updateNumID != updateNumID)
+            {
+                recompute        = m_AlwaysRecompute || std::abs(star.getLastPrecessJD() - m_JD) >= RecomputeInterval;
+                star.updateNumID = updateNumID;
+            }
+            if (recompute)
+                recomputed[nRecomputed++] = i;
+            else
+                current[nCurrent++] = i;
+        }
+
+        if (nRecomputed + nCurrent < ChunkSize && !last && i + 1 < count)
+            continue;
+
+#ifdef PROFILE_UPDATECOORDS
+        std::clock_t start = std::clock();
+#endif
+        for (int k = 0; k < nRecomputed; ++k)
+        {
+            const int j   = recomputed[k];
+            chunk.x[k]    = coords.x[j];
+            chunk.y[k]    = coords.y[j];
+            chunk.z[k]    = coords.z[j];
+            chunk.pmX[k]  = coords.pmX[j];
+            chunk.pmY[k]  = coords.pmY[j];
+            chunk.pmZ[k]  = coords.pmZ[j];
+            chunk.pm2[k]  = coords.pm2[j];
+        }
+        apparent(c, chunk, 0, nRecomputed);
+
+        for (int k = 0; k < nCurrent; ++k)
+        {
+            const StarObject &star  = starOf(*block->star(current[k]));
+            const double cosDec     = star.dec().cos();
+            chunk.x[nRecomputed + k] = cosDec * star.ra().cos();
+            chunk.y[nRecomputed + k] = cosDec * star.ra().sin();
+            chunk.z[nRecomputed + k] = star.dec().sin();
+        }
+        vectorHorizontal(c, chunk, 0, nRecomputed + nCurrent);
+
+        for (int k = 0; k < nRecomputed + nCurrent; ++k)
+        {
+            StarObject &star = starOf(*block->star(k < nRecomputed ? recomputed[k] : current[k - nRecomputed]));
+
+            if (k < nRecomputed)
+            {
+                CachingDms ra, dec;
+                ra.setUsing_atan2(chunk.y[k], chunk.x[k]);
+                ra.reduceToRange(dms::ZERO_TO_2PI);
+                dec.setUsing_atan2(chunk.z[k], std::sqrt(chunk.x[k] * chunk.x[k] + chunk.y[k] * chunk.y[k]));
+                star.setCurrentCoords(ra, dec, m_JD);
+            }
+
+            const double cosAlt = std::sqrt(chunk.north[k] * chunk.north[k] + chunk.east[k] * chunk.east[k]);
+            double az           = std::atan2(chunk.east[k], chunk.north[k]);
+            if (az < 0)
+                az += 2.0 * dms::PI;
+            star.setAlt(std::atan2(chunk.sinAlt[k], cosAlt) / dms::DegToRad);
+            star.setAz(az / dms::DegToRad);
+            star.updateID = updateID;
+        }
+
+#ifdef PROFILE_UPDATECOORDS
+        StarObject::updateCoordsCpuTime += double(std::clock() - start) / double(CLOCKS_PER_SEC);
+        StarObject::starsUpdated += nRecomputed;
+#endif
+        nRecomputed = nCurrent = 0;
+
+        if (last)
+            break;
+    }
+}
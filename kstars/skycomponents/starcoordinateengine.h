@@ -0,0 +1,76 @@
+/***************************************************************************
+               starcoordinateengine.h  -  K Desktop Planetarium
+                             -------------------
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QtGlobal>
+
+class CachingDms;
+class KSNumbers;
+class StarBlock;
+
+/**
+ * @class StarCoordinateEngine
+ *
+ * @short Updates the coordinates of all the stars of a StarBlock in one batch
+ *
+ * StarObject::JITupdate() updates one star at a time: proper motion, precession, nutation and aberration each
+ * convert the position to RA/Dec and back with their own trigonometry, and EquatorialToHorizontal() adds some
+ * more. This engine works on the unit vectors kept by StarBlock::coordinates() instead. Precession and nutation
+ * are folded into a single rotation matrix built once per KSNumbers, annual aberration is the first order shift
+ * of the unit vector along the velocity of the Earth, and the horizontal coordinates are derived from the
+ * apparent vector in the same pass. The vector arithmetic is done with SSE2 or AVX2 when available, leaving
+ * four atan2() per star to store RA, Dec, Alt and Az.
+ *
+ * The results agree with JITupdate() to a fraction of an arcsecond. Stars are left to JITupdate() when
+ * relativistic corrections are enabled, as those depend on the distance of each star to the Sun.
+ *
+ * An engine only holds constants, so one instance may update several blocks concurrently.
+ */
+class StarCoordinateEngine
+{
+  public:
+    /**
+     * @short Prepare the transformation for a given time and place
+     * @param num time-dependent values, usually KStarsData::updateNum()
+     * @param LST local sidereal time
+     * @param lat geographic latitude
+     */
+    StarCoordinateEngine(const KSNumbers *num, const CachingDms *LST, const CachingDms *lat);
+
+    /**
+     * @short Update the stars of a block, in the same way as calling StarObject::JITupdate() on each of them
+     *
+     * Stars are processed in magnitude order, up to and including the first one fainter than maglim. Stars
+     * whose updateID already matches are skipped.
+     *
+     * @param block the block of stars to update
+     * @param maglim the faintest magnitude to update
+     * @param updateID the current KStarsData::updateID()
+     * @param updateNumID the current KStarsData::updateNumID()
+     */
+    void update(StarBlock *block, float maglim, quint64 updateID, quint64 updateNumID) const;
+
+  private:
+    /** Precession and nutation from J2000.0 to the true equator of date, row major */
+    double m_Rotation[9];
+    /** Velocity of the Earth in units of the speed of light, in equatorial coordinates of date */
+    double m_Aberration[3];
+    double m_SinLST, m_CosLST, m_SinLat, m_CosLat;
+    /** Julian millenia since J2000.0, for proper motions */
+    double m_Millenia;
+    double m_JD;
+    bool m_Relativistic;
+    bool m_AlwaysRecompute;
+};
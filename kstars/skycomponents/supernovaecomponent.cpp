@@ -60,6 +60,7 @@ bool SupernovaeComponent::selected()
 
 void SupernovaeComponent::loadData()
 {
+    unindexNames();
     qDeleteAll(m_ObjectList);
     m_ObjectList.clear();
 
@@ -110,6 +110,8 @@ DeepSkyObject *SyncedCatalogComponent::addObject(CatalogEntryData &catalogEntry)
         objectNames()[newObj->type()].append(newObj->name());
         objectLists()[newObj->type()].append(QPair<QString, const SkyObject *>(newObj->name(), newObj));
     }
+    indexName(newObj->name(), newObj);
+    indexName(newObj->longname(), newObj);
     m_ObjectList.append(newObj);
     qDebug() << "Added new SkyObject " << newObj->name() << " to synced catalog " << m_catName << " which now contains "
              << m_ObjectList.count() << " objects.";
@@ -154,6 +156,8 @@ bool SyncedCatalogComponent::removeObject(SkyObject &object)
         qWarning() << "Can't find SkyObject " << name << " in the synced catalog " << m_catName;
         return false;
     }
+    if (nameIndex())
+        nameIndex()->remove(&object);
     m_ObjectList.removeAll(&object);
     qDebug() << "Remove SkyObject " << name << " from synced catalog " << m_catName;
     // Remove the catalog entry
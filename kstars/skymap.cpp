@@ -24,6 +24,7 @@
 #include "ksasteroid.h"
 #include "kstars_debug.h"
 #include "fov.h"
+#include "hips/hipsmanager.h"
 #include "imageviewer.h"
 #include "xplanetimageviewer.h"
 #include "ksdssdownloader.h"
@@ -193,6 +194,8 @@ SkyMap::SkyMap()
     connect(&m_HoverTimer, SIGNAL(timeout()), this, SLOT(slotTransientLabel()));
     connect(this, SIGNAL(destinationChanged()), this, SLOT(slewFocus()));
     connect(KStarsData::Instance(), SIGNAL(skyUpdate(bool)), this, SLOT(slotUpdateSky(bool)));
+    // HiPS tiles are drawn in the static layer, which the clock no longer redraws
+    connect(HIPSManager::Instance(), SIGNAL(sigRepaint()), this, SLOT(forceUpdate()));
 
     // Time infobox
     m_timeBox = new InfoBoxWidget(Options::shadeTimeBox(), Options::positionTimeBox(), Options::stickyTimeBox(),
@@ -445,9 +448,9 @@ void SkyMap::slotUpdateSky(bool now)
     if (now)
         QTimer::singleShot(
             0, this,
-            SLOT(forceUpdateNow())); // Why is it done this way rather than just calling forceUpdateNow()? -- asimha // --> Opening a neww thread? -- Valentin
+            SLOT(forceClockUpdateNow())); // Why is it done this way rather than just calling forceUpdateNow()? -- asimha // --> Opening a neww thread? -- Valentin
     else
-        forceUpdate();
+        forceClockUpdate();
 }
 
 void SkyMap::slotDSS()
@@ -1206,6 +1209,14 @@ void SkyMap::setZoomFactor(double factor)
 // if now=true, SkyMap::paintEvent() is run immediately, rather than being added to the event queue
 // also, determine new coordinates of mouse cursor.
 void SkyMap::forceUpdate(bool now)
+{
+    // Anything but the clock may change what the static layer of the sky map shows
+    computeStaticLayer = true;
+
+    forceClockUpdate(now);
+}
+
+void SkyMap::forceClockUpdate(bool now)
 {
     QPoint mp(mapFromGlobal(QCursor::pos()));
     if (!projector()->unusablePoint(mp))
@@ -636,7 +636,17 @@ class SkyMap : public QGraphicsView
         /** Set the shape of mouse cursor to a cross with 4 arrows. */
         void setMouseMoveCursor();
 
+        /** @short Convenience function; simply calls forceClockUpdate(true). */
+        void forceClockUpdateNow()
+        {
+            forceClockUpdate(true);
+        }
+
     private:
+        /** @short Same as forceUpdate(), but the static layer of the sky map is only
+             * computed again if the view changed. Used when the clock ticked.
+             */
+        void forceClockUpdate(bool now = false);
 
         /** @short Sets the shape of the mouse cursor to a magnifying glass. */
         void setZoomMouseCursor();
@@ -693,6 +703,9 @@ class SkyMap : public QGraphicsView
         //if false only old pixmap will repainted with bitBlt(), this
         // saves a lot of cpu usage
         bool computeSkymap { false };
+        //if false the static layer of the sky map is only recomputed when the view
+        // changed, set by forceUpdate() but not by the clock
+        bool computeStaticLayer { true };
         // True if we are either looking for angular distance or star hopping directions
         bool rulerMode { false };
         // True only if we are looking for star hopping directions. If
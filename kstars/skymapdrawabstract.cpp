@@ -426,6 +426,9 @@ void SkyMapDrawAbstract::exportSkyImage(SkyQPainter *painter, bool scale)
     vectorStarState = painter->getVectorStars();
     painter->setVectorStars(
         true); // Since we are exporting an image, we may use vector stars without worrying about time
+    // No later draw completes an exported image, so the stars are loaded before they are drawn
+    bool waitForStarsState = painter->getWaitForStars();
+    painter->setWaitForStars(true);
     painter->setRenderHint(QPainter::Antialiasing, Options::useAntialias());
 
     if (scale)
@@ -443,6 +446,7 @@ void SkyMapDrawAbstract::exportSkyImage(SkyQPainter *painter, bool scale)
     m_KStarsData->skyComposite()->draw(painter);
     drawOverlays(*painter);
     painter->setVectorStars(vectorStarState); // Restore the state of the painter
+    painter->setWaitForStars(waitForStarsState);
 }
 
 /* JM 2016-05-03: Not needed since we're not using OpenGL for now
@@ -21,16 +21,55 @@
 #include "projections/projector.h"
 #include "printing/legend.h"
 #include "kstars_debug.h"
+#include "kstarsdata.h"
+#include "Options.h"
 #include <QPainterPath>
 
+#include <cmath>
+
 SkyMapQDraw::SkyMapQDraw(SkyMap *sm) : QWidget(sm), SkyMapDrawAbstract(sm)
 {
-    m_SkyPixmap = new QPixmap(width(), height());
+    m_SkyPixmap    = new QPixmap(width(), height());
+    m_StaticPixmap = new QPixmap(width(), height());
 }
 
 SkyMapQDraw::~SkyMapQDraw()
 {
     delete m_SkyPixmap;
+    delete m_StaticPixmap;
+}
+
+bool SkyMapQDraw::StaticLayerKey::operator==(const StaticLayerKey &other) const
+{
+    return focusX == other.focusX && focusY == other.focusY && zoomFactor == other.zoomFactor &&
+           width == other.width && height == other.height && projection == other.projection &&
+           useAltAz == other.useAltAz && useRefraction == other.useRefraction && fillGround == other.fillGround &&
+           slewing == other.slewing && lstBucket == other.lstBucket && updateNumID == other.updateNumID;
+}
+
+SkyMapQDraw::StaticLayerKey SkyMapQDraw::staticLayerKey() const
+{
+    StaticLayerKey key;
+    SkyPoint *focus = m_SkyMap->focus();
+
+    key.useAltAz      = Options::useAltAz();
+    key.useRefraction = Options::useRefraction();
+    key.fillGround    = Options::showGround();
+    key.focusX        = key.useAltAz ? focus->az().Degrees() : focus->ra().Degrees();
+    key.focusY        = key.useAltAz ? focus->alt().Degrees() : focus->dec().Degrees();
+    key.zoomFactor    = Options::zoomFactor();
+    key.width         = width();
+    key.height        = height();
+    key.projection    = Options::projection();
+    key.slewing       = m_SkyMap->isSlewing();
+    key.updateNumID   = m_KStarsData->updateNumID();
+
+    // In horizontal coordinates the whole sky turns with the LST, in equatorial coordinates the
+    // ground hides what is under the horizon. The zoom factor is the number of pixels per radian.
+    if (key.useAltAz || key.fillGround)
+        key.lstBucket = static_cast<qint64>(std::floor(m_KStarsData->lst()->radians() * key.zoomFactor));
+
+    return key;
 }
 
 void SkyMapQDraw::paintEvent(QPaintEvent *event)
@@ -71,20 +110,40 @@ void SkyMapQDraw::paintEvent(QPaintEvent *event)
     m_SkyMap->showFocusCoords();
     m_SkyMap->setupProjector();
 
+    QPainterPath path;
+    path.addPolygon(m_SkyMap->projector()->clipPoly());
+
+    // The static layer is only drawn again if the view or the options changed, not if the clock ticked
+    StaticLayerKey key = staticLayerKey();
+    if (m_SkyMap->computeStaticLayer || !(key == m_StaticLayerKey))
+    {
+        SkyQPainter pstatic(this, m_StaticPixmap);
+        pstatic.begin();
+        pstatic.drawSkyBackground();
+
+        // Set Clipping
+        pstatic.setClipPath(path);
+        pstatic.setClipping(true);
+
+        m_KStarsData->skyComposite()->drawLayers(&pstatic, SkyMapComposite::StaticLayer);
+        pstatic.end();
+
+        m_StaticLayerKey             = key;
+        m_SkyMap->computeStaticLayer = false;
+    }
+
     SkyQPainter psky(this, m_SkyPixmap);
     //FIXME: we may want to move this into the components.
     psky.begin();
 
-    //Draw all sky elements
-    psky.drawSkyBackground();
+    //Draw the moving sky elements over the static ones
+    psky.drawPixmap(0, 0, *m_StaticPixmap);
 
     // Set Clipping
-    QPainterPath path;
-    path.addPolygon(m_SkyMap->projector()->clipPoly());
     psky.setClipPath(path);
     psky.setClipping(true);
 
-    m_KStarsData->skyComposite()->draw(&psky);
+    m_KStarsData->skyComposite()->drawLayers(&psky, SkyMapComposite::DynamicLayer);
     //Finish up
     psky.end();
 
@@ -109,5 +168,7 @@ void SkyMapQDraw::resizeEvent(QResizeEvent *e)
 {
     Q_UNUSED(e)
     delete m_SkyPixmap;
-    m_SkyPixmap = new QPixmap(width(), height());
+    delete m_StaticPixmap;
+    m_SkyPixmap    = new QPixmap(width(), height());
+    m_StaticPixmap = new QPixmap(width(), height());
 }
@@ -25,6 +25,15 @@
 /**
  *@short This class draws the SkyMap using native QPainter. It
  * implements SkyMapDrawAbstract
+ *
+ * The components fixed on the celestial sphere are drawn in a static layer,
+ * cached in its own pixmap, which is only drawn again when the view or the
+ * options change. When the clock ticks, only the dynamic layer, with the
+ * solar system, satellites and horizon, is drawn over the cached layer.
+ *
+ * In horizontal coordinates the whole static layer turns with the sky, so it
+ * is drawn again each time the sky turned by a pixel. A fast time-lapse in
+ * horizontal coordinates therefore draws it on most clock ticks, as before.
  *@version 1.0
  *@author Akarsh Simha <akarsh.simha@kdemail.net>
  */
@@ -50,6 +59,33 @@ class SkyMapQDraw : public QWidget, public SkyMapDrawAbstract
     void resizeEvent(QResizeEvent *e) override;
 
     QPixmap *m_SkyPixmap;
+
+  private:
+    /** @short What the static layer depends on, except the options, which force it to be computed again */
+    struct StaticLayerKey
+    {
+        double focusX { 0 };
+        double focusY { 0 };
+        double zoomFactor { 0 };
+        int width { 0 };
+        int height { 0 };
+        int projection { -1 };
+        bool useAltAz { false };
+        bool useRefraction { false };
+        bool fillGround { false };
+        bool slewing { false };
+        /// The LST in pixels of sky rotation, if the static layer moves with the LST
+        qint64 lstBucket { 0 };
+        unsigned int updateNumID { 0 };
+
+        bool operator==(const StaticLayerKey &other) const;
+    };
+
+    /** @return the key of the static layer for the current view */
+    StaticLayerKey staticLayerKey() const;
+
+    QPixmap *m_StaticPixmap;
+    StaticLayerKey m_StaticLayerKey;
 };
 
 #endif
@@ -196,6 +196,17 @@ class StarObject : public SkyObject
     /** @short added for JIT updates from both StarComponent and ConstellationLines */
     void JITupdate();
 
+    /**
+     * @short Store the current coordinates computed for this star by StarCoordinateEngine.
+     * @param jd Julian Day the coordinates are valid for, compared with getLastPrecessJD() by JITupdate()
+     */
+    inline void setCurrentCoords(const CachingDms &ra, const CachingDms &dec, double jd)
+    {
+        setRA(ra);
+        setDec(dec);
+        lastPrecessJD = jd;
+    }
+
     /** @short returns the magnitude of the proper motion correction in milliarcsec/year */
     inline double pmMagnitude() const
     {
@@ -60,6 +60,13 @@ class SkyPainter
     //FIXME: find a better way to do this.
     void setSizeMagLimit(float sizeMagLim);
 
+    /**
+     * @param waitForStars Load the deep stars to draw before drawing them, instead of in the background.
+     * @note Set when drawing a single image, as when exporting or printing the sky map, which no later draw completes.
+     */
+    inline void setWaitForStars(bool waitForStars) { m_waitForStars = waitForStars; }
+    inline bool getWaitForStars() const { return m_waitForStars; }
+
     /**
      * Begin painting.
      * @note this function <b>must</b> be called before painting anything.
@@ -188,4 +195,5 @@ class SkyPainter
 
   private:
     float m_sizeMagLim { 10.0f };
+    bool m_waitForStars { false };
 };
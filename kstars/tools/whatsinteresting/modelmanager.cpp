@@ -71,7 +71,8 @@ void ModelManager::loadLists()
     {
         QPair<QString, const SkyObject *> pair = listStars.value(i);
         const StarObject *star                 = dynamic_cast<const StarObject *>(pair.second);
-        if (star->hasLatinName())
+        // Objects of large custom catalogs that are not loaded yet have no object
+        if (star && star->hasLatinName())
             m_ObjectList[Stars].append(new SkyObjItem((SkyObject *)(star)));
     }
     QString prevName;
@@ -262,7 +263,8 @@ void ModelManager::loadObjectList(QList<SkyObjItem *> &skyObjectList, int type)
 
         QPair<QString, const SkyObject *> pair = objects.value(i);
         const SkyObject *listObject            = pair.second;
-        if (listObject->name() != i18n("Sun"))
+        // Objects of large custom catalogs that are not loaded yet have no object
+        if (listObject && listObject->name() != i18n("Sun"))
             skyObjectList.append(new SkyObjItem(const_cast<SkyObject *>(listObject)));
     }
     QString prevName;
@@ -291,6 +291,10 @@ void WUTDialog::slotLoadList(const QString &c)
             {
                 const SkyObject *o =  object.second;
 
+                // Objects of large custom catalogs that are not loaded yet
+                if (!o)
+                    continue;
+
                 if (checkVisibility(o) && o->mag() <= m_Mag)
                 {
                     visibleObjects(c).insert(o);